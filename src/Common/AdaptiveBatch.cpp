@@ -0,0 +1,295 @@
+#include "AdaptiveBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+using namespace scai;
+
+/*! \brief Initialize the adaptive batch from the configuration
+ *
+ * The adaptive batch is used with random shot selection (useRandomSource != 0) and useAdaptiveBatch = 1.
+ \param config Configuration
+ \param commAll Communicator of all processes
+ \param setNumshots Number of shots of the survey
+ \param setNumShotDomains Number of shot domains
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::init(KITGPI::Configuration::Configuration const &config, scai::dmemo::CommunicatorPtr commAll, IndexType setNumshots, IndexType setNumShotDomains)
+{
+    useAdaptiveBatch = 0;
+    if (config.getAndCatch("useRandomSource", 0) != 0) {
+        useAdaptiveBatch = config.getAndCatch("useAdaptiveBatch", 0);
+    }
+    if (useAdaptiveBatch == 0)
+        return;
+
+    SCAI_ASSERT_ERROR(config.getAndCatch("useSourceEncode", 0) == 0, "useAdaptiveBatch is not compatible with useSourceEncode");
+    numshots = setNumshots;
+    numShotDomains = setNumShotDomains;
+    batchSize = config.getAndCatch("batchSizeInit", std::max(numShotDomains, IndexType(2)));
+    SCAI_ASSERT_ERROR(batchSize >= 2, "batchSizeInit = " << batchSize << ", the variance of the gradients needs at least two shots per batch");
+    batchSize = std::min(batchSize, numshots);
+    theta = config.getAndCatch("batchVarianceTheta", ValueType(0.5));
+    SCAI_ASSERT_ERROR(theta > 0, "batchVarianceTheta = " << theta);
+    // all processes have to draw the same shots
+    seed = config.getAndCatch("batchSeed", IndexType(time(0)));
+    commAll->bcast(&seed, 1, MASTERGPI);
+    numSelections = 0;
+    numForwardSolves = 0;
+
+    std::string logFilenameInversion = config.get<std::string>("logFilename");
+    logFilename = logFilenameInversion.substr(0, logFilenameInversion.length() - 4) + ".batch" + logFilenameInversion.substr(logFilenameInversion.length() - 4, 4);
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream logFile(logFilename, std::ios::trunc);
+        logFile << "# Adaptive batch records during inversion\n";
+        logFile << "# batchVarianceTheta = " << theta << ", batchSeed = " << seed << ", number of shots = " << numshots << "\n";
+        logFile << "# Stage | Iteration | batch size | gradient variance | squared norm of mean gradient | cumulative forward solves\n";
+    }
+}
+
+/*! \brief Select the shots of the next iteration
+ *
+ * The batch size is the one estimated from the gradients of the last iteration. The shot history is increased for all selected shots.
+ \param shotHistory Number of iterations every shot has been used in
+ \return Indices of the selected shots (ascending)
+ */
+template <typename ValueType>
+std::vector<IndexType> const &KITGPI::AdaptiveBatch<ValueType>::selectShots(std::vector<IndexType> &shotHistory)
+{
+    shotInds = drawShots(shotHistory, batchSize, seed + numSelections);
+    for (auto shotInd : shotInds) {
+        shotHistory[shotInd]++;
+    }
+    numSelections++;
+    numForwardSolves += shotInds.size();
+    sumNormSquared = 0;
+    return shotInds;
+}
+
+/*! \brief Add the squared norm of the gradient of one shot to the statistics of this shot domain
+ \param gradientPerShot Gradient of one shot
+ \param workflow Workflow
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::addShotGradient(KITGPI::Gradient::Gradient<ValueType> const &gradientPerShot, KITGPI::Workflow::Workflow<ValueType> const &workflow)
+{
+    sumNormSquared += calcNormSquared(gradientPerShot, workflow);
+}
+
+/*! \brief Estimate the gradient variance of the batch and the batch size of the next iteration
+ \param commInterShot Communicator between the shot domains
+ \param gradient Batch gradient, i.e. the sum of the per-shot gradients over all shot domains
+ \param workflow Workflow
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::update(scai::dmemo::CommunicatorPtr commInterShot, KITGPI::Gradient::Gradient<ValueType> const &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow)
+{
+    ValueType sumNormSquaredAll = commInterShot->sum(sumNormSquared);
+    IndexType currentBatchSize = shotInds.size();
+    batchNormSquared = calcNormSquared(gradient, workflow);
+    variance = calcVariance(sumNormSquaredAll, batchNormSquared, currentBatchSize);
+    batchSize = calcBatchSize(variance, batchNormSquared, currentBatchSize, theta, numshots, numShotDomains);
+}
+
+/*! \brief Append the batch size, the variance estimate and the number of forward solves of the last iteration to the log file
+ \param commAll Communicator of all processes
+ \param stage Workflow stage (starting at 1)
+ \param iteration Iteration
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::writeToLogFile(scai::dmemo::CommunicatorPtr commAll, IndexType stage, IndexType iteration)
+{
+    if (commAll->getRank() == MASTERGPI) {
+        IndexType currentBatchSize = shotInds.size();
+        std::ofstream logFile(logFilename, std::ios::app);
+        logFile << std::setw(5) << stage << std::setw(10) << iteration + 1 << std::setw(10) << currentBatchSize << std::scientific << std::setprecision(6) << std::setw(18) << variance << std::setw(18) << batchNormSquared / (currentBatchSize * currentBatchSize) << std::setw(10) << numForwardSolves << "\n";
+    }
+}
+
+/*! \brief Return the squared l2-norm of all inverted parameters of a gradient
+ \param gradient Gradient
+ \param workflow To check which parameter class is inverted for
+ */
+template <typename ValueType>
+ValueType KITGPI::AdaptiveBatch<ValueType>::calcNormSquared(KITGPI::Gradient::Gradient<ValueType> const &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow)
+{
+    ValueType normSquared = 0;
+    if (workflow.isSeismic) {
+        if (workflow.getInvertForVp())
+            normSquared += pow(gradient.getVelocityP().l2Norm(), 2);
+        if (workflow.getInvertForVs())
+            normSquared += pow(gradient.getVelocityS().l2Norm(), 2);
+        if (workflow.getInvertForDensity())
+            normSquared += pow(gradient.getDensity().l2Norm(), 2);
+    } else {
+        if (workflow.getInvertForSigma())
+            normSquared += pow(gradient.getElectricConductivity().l2Norm(), 2);
+        if (workflow.getInvertForEpsilon())
+            normSquared += pow(gradient.getDielectricPermittivity().l2Norm(), 2);
+        if (workflow.getInvertForTauSigma())
+            normSquared += pow(gradient.getTauElectricConductivity().l2Norm(), 2);
+        if (workflow.getInvertForTauEpsilon())
+            normSquared += pow(gradient.getTauDielectricPermittivity().l2Norm(), 2);
+    }
+    if (workflow.getInvertForPorosity())
+        normSquared += pow(gradient.getPorosity().l2Norm(), 2);
+    if (workflow.getInvertForSaturation())
+        normSquared += pow(gradient.getSaturation().l2Norm(), 2);
+    return normSquared;
+}
+
+/*! \brief Return the sample variance of the per-shot gradients
+ \param sumNormSquared Sum of the squared norms of the per-shot gradients
+ \param batchNormSquared Squared norm of the sum of the per-shot gradients
+ \param batchSize Number of shots
+ */
+template <typename ValueType>
+ValueType KITGPI::AdaptiveBatch<ValueType>::calcVariance(ValueType sumNormSquared, ValueType batchNormSquared, IndexType batchSize)
+{
+    if (batchSize < 2)
+        return 0;
+    // rounding errors can make the difference slightly negative if all shot gradients are equal
+    return std::max(ValueType(0), (sumNormSquared - batchNormSquared / batchSize) / (batchSize - 1));
+}
+
+/*! \brief Return the batch size of the next iteration after the norm test
+ *
+ * The batch size never decreases, is rounded up to a multiple of the number of shot domains and is limited to the number of shots.
+ \param variance Sample variance of the per-shot gradients
+ \param batchNormSquared Squared norm of the sum of the per-shot gradients
+ \param batchSize Current batch size
+ \param theta Tolerated ratio of the standard deviation of the batch gradient and the norm of the mean gradient
+ \param numshots Number of shots of the survey
+ \param numShotDomains Number of shot domains
+ */
+template <typename ValueType>
+IndexType KITGPI::AdaptiveBatch<ValueType>::calcBatchSize(ValueType variance, ValueType batchNormSquared, IndexType batchSize, ValueType theta, IndexType numshots, IndexType numShotDomains)
+{
+    ValueType meanNormSquared = batchNormSquared / (ValueType(batchSize) * batchSize);
+    IndexType newBatchSize = batchSize;
+    if (meanNormSquared <= 0) {
+        // no signal left in the mean gradient, only the full survey can give a reliable gradient
+        newBatchSize = numshots;
+    } else if (variance / batchSize > theta * theta * meanNormSquared) {
+        newBatchSize = std::max(batchSize, IndexType(ceil(variance / (theta * theta * meanNormSquared))));
+    }
+    newBatchSize = ceil(ValueType(newBatchSize) / numShotDomains) * numShotDomains;
+    return std::min(newBatchSize, numshots);
+}
+
+/*! \brief Draw a batch of shots
+ *
+ * The shots which have been used the least are preferred, shots with the same history are chosen randomly.
+ \param shotHistory Number of iterations every shot has been used in
+ \param batchSize Number of shots to draw
+ \param seed Seed of the random number generator
+ \return Indices of the drawn shots (ascending)
+ */
+template <typename ValueType>
+std::vector<IndexType> KITGPI::AdaptiveBatch<ValueType>::drawShots(std::vector<IndexType> const &shotHistory, IndexType batchSize, IndexType seed)
+{
+    std::vector<IndexType> candidates(shotHistory.size());
+    std::iota(candidates.begin(), candidates.end(), 0);
+    std::mt19937 generator(seed);
+    std::shuffle(candidates.begin(), candidates.end(), generator);
+    std::stable_sort(candidates.begin(), candidates.end(), [&shotHistory](IndexType a, IndexType b) { return shotHistory[a] < shotHistory[b]; });
+
+    std::vector<IndexType> shots(candidates.begin(), candidates.begin() + std::min(batchSize, IndexType(candidates.size())));
+    std::sort(shots.begin(), shots.end());
+    return shots;
+}
+
+/*! \brief Return true if the adaptive batch is used */
+template <typename ValueType>
+bool KITGPI::AdaptiveBatch<ValueType>::isActive() const
+{
+    return useAdaptiveBatch != 0;
+}
+
+/*! \brief Return the batch size of the next iteration */
+template <typename ValueType>
+IndexType KITGPI::AdaptiveBatch<ValueType>::getBatchSize() const
+{
+    return batchSize;
+}
+
+/*! \brief Return the indices of the shots selected for the current iteration */
+template <typename ValueType>
+std::vector<IndexType> const &KITGPI::AdaptiveBatch<ValueType>::getShotInds() const
+{
+    return shotInds;
+}
+
+/*! \brief Return the gradient variance of the last batch */
+template <typename ValueType>
+ValueType KITGPI::AdaptiveBatch<ValueType>::getVariance() const
+{
+    return variance;
+}
+
+/*! \brief Return the number of forward solves of the gradient calculation so far */
+template <typename ValueType>
+IndexType KITGPI::AdaptiveBatch<ValueType>::getNumForwardSolves() const
+{
+    return numForwardSolves;
+}
+
+/*! \brief Write the state of the adaptive batch and its log file to a checkpoint
+ \param checkpoint Checkpoint
+ \param commAll Communicator of all processes
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll) const
+{
+    checkpoint.write(useAdaptiveBatch);
+    if (useAdaptiveBatch == 0)
+        return;
+    checkpoint.write(batchSize);
+    checkpoint.write(seed);
+    checkpoint.write(numSelections);
+    checkpoint.write(numForwardSolves);
+    checkpoint.write(variance);
+    checkpoint.write(batchNormSquared);
+    std::string logFileContent;
+    if (commAll->getRank() == MASTERGPI) {
+        std::ifstream logFile(logFilename);
+        std::stringstream logStream;
+        logStream << logFile.rdbuf();
+        logFileContent = logStream.str();
+    }
+    checkpoint.write(logFileContent);
+}
+
+/*! \brief Read the state of the adaptive batch and its log file from a checkpoint
+ \param checkpoint Checkpoint
+ \param commAll Communicator of all processes
+ */
+template <typename ValueType>
+void KITGPI::AdaptiveBatch<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll)
+{
+    IndexType checkpointUseAdaptiveBatch = 0;
+    checkpoint.read(checkpointUseAdaptiveBatch);
+    SCAI_ASSERT_ERROR(checkpointUseAdaptiveBatch == useAdaptiveBatch, "Checkpoint has been written with useAdaptiveBatch = " << checkpointUseAdaptiveBatch);
+    if (useAdaptiveBatch == 0)
+        return;
+    checkpoint.read(batchSize);
+    checkpoint.read(seed);
+    checkpoint.read(numSelections);
+    checkpoint.read(numForwardSolves);
+    checkpoint.read(variance);
+    checkpoint.read(batchNormSquared);
+    std::string logFileContent;
+    checkpoint.read(logFileContent);
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream logFile(logFilename, std::ios::trunc);
+        logFile << logFileContent;
+    }
+}
+
+template class KITGPI::AdaptiveBatch<double>;
+template class KITGPI::AdaptiveBatch<float>;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/lama.hpp>
+
+#include <Configuration/Configuration.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Common/Checkpoint.hpp"
+#include "../Gradient/Gradient.hpp"
+#include "../Workflow/Workflow.hpp"
+
+namespace KITGPI
+{
+    /*! \brief Random shot selection with an adaptive batch size
+     *
+     * Starts with a small batch of shots per iteration and increases the batch size if the batch gradient is too noisy (norm test, Byrd et al., 2012):
+     * The sample variance of the per-shot gradients g_i is estimated from their squared norms and the norm of the batch gradient G = sum(g_i),
+     * var = (sum(|g_i|^2) - |G|^2 / B) / (B - 1). If var / B > theta^2 |G / B|^2, the batch size is increased to B = var / (theta^2 |G / B|^2) (up to all shots).
+     * Within a batch the shots which have been used the least are selected, ties are broken randomly with a fixed seed.
+     */
+    template <typename ValueType>
+    class AdaptiveBatch
+    {
+      public:
+        AdaptiveBatch() : useAdaptiveBatch(0), batchSize(1), numshots(1), numShotDomains(1), theta(0.5), seed(0), numSelections(0), numForwardSolves(0), sumNormSquared(0), variance(0), batchNormSquared(0){};
+        ~AdaptiveBatch(){};
+
+        void init(KITGPI::Configuration::Configuration const &config, scai::dmemo::CommunicatorPtr commAll, scai::IndexType setNumshots, scai::IndexType setNumShotDomains);
+
+        std::vector<scai::IndexType> const &selectShots(std::vector<scai::IndexType> &shotHistory);
+        void addShotGradient(KITGPI::Gradient::Gradient<ValueType> const &gradientPerShot, KITGPI::Workflow::Workflow<ValueType> const &workflow);
+        void update(scai::dmemo::CommunicatorPtr commInterShot, KITGPI::Gradient::Gradient<ValueType> const &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow);
+        void writeToLogFile(scai::dmemo::CommunicatorPtr commAll, scai::IndexType stage, scai::IndexType iteration);
+
+        static ValueType calcNormSquared(KITGPI::Gradient::Gradient<ValueType> const &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow);
+        static ValueType calcVariance(ValueType sumNormSquared, ValueType batchNormSquared, scai::IndexType batchSize);
+        static scai::IndexType calcBatchSize(ValueType variance, ValueType batchNormSquared, scai::IndexType batchSize, ValueType theta, scai::IndexType numshots, scai::IndexType numShotDomains);
+        static std::vector<scai::IndexType> drawShots(std::vector<scai::IndexType> const &shotHistory, scai::IndexType batchSize, scai::IndexType seed);
+
+        bool isActive() const;
+        scai::IndexType getBatchSize() const;
+        std::vector<scai::IndexType> const &getShotInds() const;
+        ValueType getVariance() const;
+        scai::IndexType getNumForwardSolves() const;
+
+        void writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll) const;
+        void readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll);
+
+      private:
+        scai::IndexType useAdaptiveBatch;
+        scai::IndexType batchSize;
+        scai::IndexType numshots;
+        scai::IndexType numShotDomains;
+        ValueType theta;
+        scai::IndexType seed;
+        scai::IndexType numSelections;
+        scai::IndexType numForwardSolves;
+        std::vector<scai::IndexType> shotInds;
+
+        ValueType sumNormSquared;   // sum of the squared norms of the per-shot gradients of this shot domain
+        ValueType variance;         // sample variance of the per-shot gradients of the last batch
+        ValueType batchNormSquared; // squared norm of the last batch gradient
+
+        std::string logFilename;
+    };
+}
@@ -0,0 +1,213 @@
+#include "Checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace scai;
+
+/*! \brief Return the name of the checkpoint file of one process
+ \param filename Base name of the checkpoint
+ \param checkpointVersion Version of the checkpoint
+ \param rank Rank of the process
+ */
+std::string KITGPI::Checkpoint::getFilename(std::string const &filename, IndexType checkpointVersion, IndexType rank)
+{
+    return filename + ".v_" + std::to_string(checkpointVersion) + ".rank_" + std::to_string(rank) + ".ckpt";
+}
+
+/*! \brief Return the name of the manifest which contains the version of the last complete checkpoint
+ \param filename Base name of the checkpoint
+ */
+std::string KITGPI::Checkpoint::getManifestFilename(std::string const &filename)
+{
+    return filename + ".ckpt";
+}
+
+/*! \brief Return the version of the last complete checkpoint on all processes
+ *
+ * The manifest is read by rank 0 only, so all processes use the same version even if the manifest is replaced meanwhile.
+ \param commAll Communicator of all processes
+ \param filename Base name of the checkpoint
+ \return 0 if there is no complete checkpoint
+ */
+IndexType KITGPI::Checkpoint::readManifest(dmemo::CommunicatorPtr commAll, std::string const &filename)
+{
+    IndexType checkpointVersion = 0;
+    if (commAll->getRank() == 0) {
+        std::ifstream manifest(getManifestFilename(filename));
+        std::string magic;
+        if (manifest >> magic >> checkpointVersion) {
+            if (magic.compare("WAVECKPT") != 0 || checkpointVersion < 1)
+                checkpointVersion = 0;
+        } else {
+            checkpointVersion = 0;
+        }
+    }
+    return commAll->sum(checkpointVersion);
+}
+
+/*! \brief Open the checkpoint file of the next version on this process and write the header
+ \param commAll Communicator of all processes
+ \param filename Base name of the checkpoint
+ \param valueSize Size of ValueType in bytes
+ */
+void KITGPI::Checkpoint::openWrite(dmemo::CommunicatorPtr commAll, std::string const &filename, IndexType valueSize)
+{
+    comm = commAll;
+    filenameBase = filename;
+    checkpointVersion = readManifest(comm, filename) + 1;
+    filenameRank = getFilename(filename, checkpointVersion, comm->getRank());
+    file.open(filenameRank, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        COMMON_THROWEXCEPTION("Could not open checkpoint file " << filenameRank);
+    }
+    writeBytes("WAVECKPT", 8);
+    write(IndexType(version));
+    write(valueSize);
+    write(IndexType(comm->getSize()));
+    write(IndexType(comm->getRank()));
+    write(checkpointVersion);
+}
+
+/*! \brief Close the checkpoint file and make it the last complete checkpoint once all processes have finished writing
+ *
+ * Rank 0 writes the manifest of the new version to a temporary file and renames it, which replaces the manifest atomically. The files of the previous version are removed afterwards.
+ */
+void KITGPI::Checkpoint::commit()
+{
+    file.close();
+    IndexType isWritten = file.fail() ? 0 : 1;
+    if (comm->min(isWritten) == 0) {
+        COMMON_THROWEXCEPTION("Could not write checkpoint file " << filenameRank << " on all processes");
+    }
+    comm->synchronize();
+    IndexType isCommitted = 1;
+    if (comm->getRank() == 0) {
+        std::string filenameManifest = getManifestFilename(filenameBase);
+        std::string filenameManifestTemp = filenameManifest + ".tmp";
+        std::ofstream manifest(filenameManifestTemp, std::ios::out | std::ios::trunc);
+        manifest << "WAVECKPT " << checkpointVersion << " " << comm->getSize() << "\n";
+        manifest.close();
+        if (manifest.fail() || std::rename(filenameManifestTemp.c_str(), filenameManifest.c_str()) != 0)
+            isCommitted = 0;
+    }
+    if (comm->min(isCommitted) == 0) {
+        COMMON_THROWEXCEPTION("Could not write checkpoint manifest " << getManifestFilename(filenameBase));
+    }
+    if (checkpointVersion > 1)
+        std::remove(getFilename(filenameBase, checkpointVersion - 1, comm->getRank()).c_str());
+}
+
+/*! \brief Open the checkpoint file of the last complete checkpoint on this process and check the header
+ \param commAll Communicator of all processes
+ \param filename Base name of the checkpoint
+ \param valueSize Size of ValueType in bytes
+ */
+void KITGPI::Checkpoint::openRead(dmemo::CommunicatorPtr commAll, std::string const &filename, IndexType valueSize)
+{
+    comm = commAll;
+    filenameBase = filename;
+    checkpointVersion = readManifest(comm, filename);
+    if (checkpointVersion == 0) {
+        COMMON_THROWEXCEPTION("There is no complete checkpoint " << filename << " (manifest " << getManifestFilename(filename) << ")");
+    }
+    filenameRank = getFilename(filename, checkpointVersion, comm->getRank());
+    file.open(filenameRank, std::ios::in | std::ios::binary);
+    IndexType isOpen = file.is_open() ? 1 : 0;
+    if (comm->min(isOpen) == 0) {
+        COMMON_THROWEXCEPTION("Could not open checkpoint " << filename << " on all processes (checkpoint file " << filenameRank << ")");
+    }
+
+    char magic[8];
+    readBytes(magic, 8);
+    if (std::strncmp(magic, "WAVECKPT", 8) != 0) {
+        COMMON_THROWEXCEPTION(filenameRank << " is not a checkpoint file");
+    }
+    IndexType fileVersion = 0;
+    IndexType fileValueSize = 0;
+    IndexType fileNumProcesses = 0;
+    IndexType fileRank = 0;
+    IndexType fileCheckpointVersion = 0;
+    read(fileVersion);
+    read(fileValueSize);
+    read(fileNumProcesses);
+    read(fileRank);
+    if (fileVersion != version) {
+        COMMON_THROWEXCEPTION("Checkpoint " << filenameRank << " has version " << fileVersion << " but version " << version << " is required");
+    }
+    read(fileCheckpointVersion);
+    if (fileValueSize != valueSize) {
+        COMMON_THROWEXCEPTION("Checkpoint " << filenameRank << " has been written with another ValueType");
+    }
+    if (fileNumProcesses != comm->getSize() || fileRank != comm->getRank()) {
+        COMMON_THROWEXCEPTION("Checkpoint " << filenameRank << " has been written by rank " << fileRank << " of " << fileNumProcesses << " processes but is read by rank " << comm->getRank() << " of " << comm->getSize());
+    }
+    if (fileCheckpointVersion != checkpointVersion) {
+        COMMON_THROWEXCEPTION("Checkpoint file " << filenameRank << " belongs to checkpoint " << fileCheckpointVersion << " but the manifest refers to checkpoint " << checkpointVersion);
+    }
+}
+
+/*! \brief Close the checkpoint file
+ */
+void KITGPI::Checkpoint::close()
+{
+    file.close();
+}
+
+/*! \brief Abort if a value read from the checkpoint differs between the processes
+ *
+ * This detects checkpoint files from different checkpoints, e.g. if the files of a checkpoint have been replaced by hand.
+ \param value Value on this process
+ \param name Name of the value for the error message
+ */
+void KITGPI::Checkpoint::checkConsistency(IndexType value, std::string const &name)
+{
+    if (comm->min(value) != comm->max(value)) {
+        COMMON_THROWEXCEPTION("The checkpoint files of the processes belong to different checkpoints (" << name << " differs)");
+    }
+}
+
+/*! \brief Write a string
+ \param value String
+ */
+void KITGPI::Checkpoint::write(std::string const &value)
+{
+    write(IndexType(value.size()));
+    writeBytes(value.data(), value.size());
+}
+
+/*! \brief Read a string
+ \param value String
+ */
+void KITGPI::Checkpoint::read(std::string &value)
+{
+    IndexType size = 0;
+    read(size);
+    value.resize(size);
+    readBytes(&value[0], size);
+}
+
+/*! \brief Write raw bytes to the checkpoint file
+ \param data Pointer to the data
+ \param numBytes Number of bytes
+ */
+void KITGPI::Checkpoint::writeBytes(void const *data, size_t numBytes)
+{
+    file.write(static_cast<char const *>(data), numBytes);
+    if (!file.good()) {
+        COMMON_THROWEXCEPTION("Could not write checkpoint file " << filenameRank);
+    }
+}
+
+/*! \brief Read raw bytes from the checkpoint file
+ \param data Pointer to the data
+ \param numBytes Number of bytes
+ */
+void KITGPI::Checkpoint::readBytes(void *data, size_t numBytes)
+{
+    file.read(static_cast<char *>(data), numBytes);
+    if (!file.good()) {
+        COMMON_THROWEXCEPTION("Checkpoint file " << filenameRank << " is truncated or does not match the configuration");
+    }
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/dmemo/NoDistribution.hpp>
+#include <scai/hmemo/HArray.hpp>
+#include <scai/hmemo/ReadAccess.hpp>
+#include <scai/hmemo/WriteAccess.hpp>
+#include <scai/lama.hpp>
+#include <scai/lama/DenseVector.hpp>
+#include <scai/lama/matrix/all.hpp>
+
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Versioned binary checkpoint of the inversion state
+     *
+     * Every process writes its own file <filename>.v_<version>.rank_<rank>.ckpt which contains its local part of the distributed vectors, so a checkpoint can only be read with the same number of processes and the same distribution.
+     * Every checkpoint is written with a new version number. After all processes have finished writing, rank 0 replaces the manifest <filename>.ckpt, which contains the version of the last complete checkpoint, by a rename.
+     * The files of the previous version are only removed afterwards, i.e. an interrupted write never destroys the last complete checkpoint and the processes never read files of different checkpoints.
+     * Values have to be read in the same order as they have been written.
+     */
+    class Checkpoint
+    {
+      public:
+        Checkpoint(){};
+        ~Checkpoint(){};
+
+        static std::string getFilename(std::string const &filename, scai::IndexType checkpointVersion, scai::IndexType rank);
+        static std::string getManifestFilename(std::string const &filename);
+        static scai::IndexType readManifest(scai::dmemo::CommunicatorPtr commAll, std::string const &filename);
+
+        void openWrite(scai::dmemo::CommunicatorPtr commAll, std::string const &filename, scai::IndexType valueSize);
+        void commit();
+        void openRead(scai::dmemo::CommunicatorPtr commAll, std::string const &filename, scai::IndexType valueSize);
+        void close();
+
+        template <typename T>
+        void write(T const &value);
+        void write(std::string const &value);
+        template <typename T>
+        void write(std::vector<T> const &values);
+        template <typename T>
+        void write(scai::hmemo::HArray<T> const &array);
+        template <typename T>
+        void write(scai::lama::DenseVector<T> const &vector);
+        template <typename T>
+        void write(scai::lama::DenseMatrix<T> const &matrix);
+
+        template <typename T>
+        void read(T &value);
+        void read(std::string &value);
+        template <typename T>
+        void read(std::vector<T> &values);
+        template <typename T>
+        void read(scai::hmemo::HArray<T> &array);
+        template <typename T>
+        void read(scai::lama::DenseVector<T> &vector);
+        template <typename T>
+        void read(scai::lama::DenseMatrix<T> &matrix);
+
+        void checkConsistency(scai::IndexType value, std::string const &name);
+
+      private:
+        void writeBytes(void const *data, size_t numBytes);
+        void readBytes(void *data, size_t numBytes);
+
+        static const scai::IndexType version = 3;
+
+        scai::dmemo::CommunicatorPtr comm = nullptr;
+        std::string filenameBase;
+        std::string filenameRank;
+        scai::IndexType checkpointVersion = 0; // version of the checkpoint which is written or read
+        std::fstream file;
+    };
+}
+
+/*! \brief Write a scalar value (bool, integer or floating point)
+ \param value Value
+ */
+template <typename T>
+void KITGPI::Checkpoint::write(T const &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::write: type has to be trivially copyable");
+    writeBytes(&value, sizeof(T));
+}
+
+/*! \brief Write a std::vector element by element
+ \param values Values
+ */
+template <typename T>
+void KITGPI::Checkpoint::write(std::vector<T> const &values)
+{
+    write(scai::IndexType(values.size()));
+    for (auto const &value : values) {
+        T const &element = value;
+        write(element);
+    }
+}
+
+/*! \brief Write a local array
+ \param array Array
+ */
+template <typename T>
+void KITGPI::Checkpoint::write(scai::hmemo::HArray<T> const &array)
+{
+    write(scai::IndexType(array.size()));
+    scai::hmemo::ReadAccess<T> readArray(array);
+    writeBytes(readArray.get(), array.size() * sizeof(T));
+}
+
+/*! \brief Write the local part of a vector
+ *
+ * Replicated vectors are restored with the same size, distributed vectors need the same distribution when they are read.
+ \param vector Vector
+ */
+template <typename T>
+void KITGPI::Checkpoint::write(scai::lama::DenseVector<T> const &vector)
+{
+    write(scai::IndexType(vector.size()));
+    write(vector.getDistribution().isReplicated());
+    write(vector.getLocalValues());
+}
+
+/*! \brief Write the local part of a matrix
+ \param matrix Matrix
+ */
+template <typename T>
+void KITGPI::Checkpoint::write(scai::lama::DenseMatrix<T> const &matrix)
+{
+    write(scai::IndexType(matrix.getNumRows()));
+    write(scai::IndexType(matrix.getNumColumns()));
+    write(matrix.getLocalStorage().getValues());
+}
+
+/*! \brief Read a scalar value
+ \param value Value
+ */
+template <typename T>
+void KITGPI::Checkpoint::read(T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::read: type has to be trivially copyable");
+    readBytes(&value, sizeof(T));
+}
+
+/*! \brief Read a std::vector element by element
+ \param values Values
+ */
+template <typename T>
+void KITGPI::Checkpoint::read(std::vector<T> &values)
+{
+    scai::IndexType size = 0;
+    read(size);
+    values.resize(size);
+    for (scai::IndexType i = 0; i < size; i++) {
+        T value;
+        read(value);
+        values[i] = std::move(value);
+    }
+}
+
+/*! \brief Read a local array
+ \param array Array
+ */
+template <typename T>
+void KITGPI::Checkpoint::read(scai::hmemo::HArray<T> &array)
+{
+    scai::IndexType size = 0;
+    read(size);
+    scai::hmemo::WriteOnlyAccess<T> writeArray(array, size);
+    readBytes(writeArray.get(), size * sizeof(T));
+}
+
+/*! \brief Read the local part of a vector
+ *
+ * A distributed vector has to be allocated with the distribution it had when it was written.
+ \param vector Vector
+ */
+template <typename T>
+void KITGPI::Checkpoint::read(scai::lama::DenseVector<T> &vector)
+{
+    scai::IndexType globalSize = 0;
+    bool isReplicated = false;
+    read(globalSize);
+    read(isReplicated);
+    scai::hmemo::HArray<T> localValues;
+    read(localValues);
+
+    scai::dmemo::DistributionPtr dist = vector.getDistributionPtr();
+    if (isReplicated) {
+        dist = std::make_shared<scai::dmemo::NoDistribution>(globalSize);
+    }
+    SCAI_ASSERT_ERROR(dist->getGlobalSize() == globalSize && dist->getLocalSize() == localValues.size(), "Distribution of the checkpoint vector does not match: global size " << globalSize << ", local size " << localValues.size());
+    vector = scai::lama::DenseVector<T>(dist, std::move(localValues));
+}
+
+/*! \brief Read the local part of a matrix
+ *
+ * The matrix has to be allocated with the distribution it had when it was written.
+ \param matrix Matrix
+ */
+template <typename T>
+void KITGPI::Checkpoint::read(scai::lama::DenseMatrix<T> &matrix)
+{
+    scai::IndexType numRows = 0;
+    scai::IndexType numColumns = 0;
+    read(numRows);
+    read(numColumns);
+    scai::hmemo::HArray<T> localValues;
+    read(localValues);
+    scai::hmemo::HArray<T> &matrixValues = matrix.getLocalStorage().getValues();
+    SCAI_ASSERT_ERROR(matrix.getNumRows() == numRows && matrix.getNumColumns() == numColumns && matrixValues.size() == localValues.size(), "Distribution of the checkpoint matrix does not match: " << numRows << " x " << numColumns);
+    matrixValues.swap(localValues);
+}
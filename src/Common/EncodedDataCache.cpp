@@ -0,0 +1,182 @@
+#include "EncodedDataCache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace scai;
+
+/*! \brief Initialize the cache from the configuration
+ *
+ * The cache is only used with source encoding (useSourceEncode != 0) and useEncodedDataCache = 1.
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::EncodedDataCache<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useCache = 0;
+    if (config.getAndCatch("useSourceEncode", 0) != 0) {
+        useCache = config.getAndCatch("useEncodedDataCache", 0);
+    }
+    memoryLimit = config.getAndCatch("encodedDataCacheMemory", 1024.0);
+    SCAI_ASSERT_ERROR(memoryLimit >= 0, "encodedDataCacheMemory = " << memoryLimit);
+    clear();
+}
+
+/*! \brief Encode the observed data of a supershot or take it from the cache
+ *
+ * Replaces receiversTrue.encode(config, fieldSeisName, shotNumberEncode, sourceSettingsEncode, 1). The field data is only read if the supershot is not cached with the current encoding.
+ \param receiversTrue Receivers of the observed data
+ \param config Configuration
+ \param shotNumberEncode Number of the supershot
+ \param sourceSettingsEncode Source settings of the current encoding
+ */
+template <typename ValueType>
+void KITGPI::EncodedDataCache<ValueType>::encode(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Configuration::Configuration config, IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode)
+{
+    if (useCache != 0 && restore(receiversTrue, shotNumberEncode, sourceSettingsEncode)) {
+        numHits++;
+        return;
+    }
+    receiversTrue.encode(config, config.get<std::string>("fieldSeisName"), shotNumberEncode, sourceSettingsEncode, 1);
+    numReads++;
+    if (useCache != 0) {
+        store(receiversTrue, shotNumberEncode, sourceSettingsEncode);
+    }
+}
+
+/*! \brief Copy the cached seismograms of a supershot to the receivers
+ \param receiversTrue Receivers of the observed data
+ \param shotNumberEncode Number of the supershot
+ \param sourceSettingsEncode Source settings of the current encoding
+ \return false if the supershot is not cached or has been cached with another encoding
+ */
+template <typename ValueType>
+bool KITGPI::EncodedDataCache<ValueType>::restore(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode)
+{
+    auto entry = entries.find(shotNumberEncode);
+    if (entry == entries.end() || entry->second.encoding != getEncoding(sourceSettingsEncode, shotNumberEncode)) {
+        return false;
+    }
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receiversTrue.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            auto &seismogram = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent));
+            SCAI_ASSERT_ERROR(seismogram.getData().getNumRows() == entry->second.data[iComponent].getNumRows(), "Cached data of supershot " << shotNumberEncode << " does not match the receivers");
+            seismogram.getData() = entry->second.data[iComponent];
+            seismogram.getDataDecode() = entry->second.dataDecode[iComponent];
+        }
+    }
+    entry->second.lastUse = ++useCount;
+    return true;
+}
+
+/*! \brief Store the encoded seismograms of a supershot
+ *
+ * Has to be called directly after Receivers::encode, i.e. before the seismograms are filtered or muted.
+ * The least recently used supershots are removed if the memory limit would be exceeded, a supershot which exceeds the limit alone is not stored.
+ \param receiversTrue Receivers of the observed data
+ \param shotNumberEncode Number of the supershot
+ \param sourceSettingsEncode Source settings of the current encoding
+ */
+template <typename ValueType>
+void KITGPI::EncodedDataCache<ValueType>::store(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode)
+{
+    Entry entry;
+    entry.encoding = getEncoding(sourceSettingsEncode, shotNumberEncode);
+    entry.data.assign(Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE, lama::DenseMatrix<ValueType>());
+    entry.dataDecode.assign(Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE, std::vector<lama::DenseMatrix<ValueType>>());
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receiversTrue.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            auto &seismogram = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent));
+            entry.data[iComponent] = seismogram.getData();
+            entry.dataDecode[iComponent] = seismogram.getDataDecode();
+        }
+    }
+    entry.lastUse = ++useCount;
+
+    entries.erase(shotNumberEncode);
+    double memoryEntry = getMemory(entry);
+    if (memoryEntry > memoryLimit)
+        return;
+    while (!entries.empty() && getMemory() + memoryEntry > memoryLimit) {
+        auto leastRecentlyUsed = std::min_element(entries.begin(), entries.end(), [](typename std::map<IndexType, Entry>::value_type const &entry1, typename std::map<IndexType, Entry>::value_type const &entry2) { return entry1.second.lastUse < entry2.second.lastUse; });
+        entries.erase(leastRecentlyUsed);
+    }
+    entries[shotNumberEncode] = std::move(entry);
+}
+
+/*! \brief Remove all supershots from the cache
+ */
+template <typename ValueType>
+void KITGPI::EncodedDataCache<ValueType>::clear()
+{
+    entries.clear();
+}
+
+/*! \brief Return the encoding of a supershot
+ *
+ * The encoding consists of the row (in the acquisition) and the signed source number of every constituent shot in the order of the source settings.
+ \param sourceSettingsEncode Source settings of the current encoding
+ \param shotNumberEncode Number of the supershot
+ */
+template <typename ValueType>
+std::vector<IndexType> KITGPI::EncodedDataCache<ValueType>::getEncoding(std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode, IndexType shotNumberEncode)
+{
+    std::vector<IndexType> encoding;
+    for (auto const &settings : sourceSettingsEncode) {
+        if (std::abs(settings.sourceNo) == shotNumberEncode) {
+            encoding.push_back(settings.row);
+            encoding.push_back(settings.sourceNo);
+        }
+    }
+    return encoding;
+}
+
+/*! \brief Return true if the cache is used */
+template <typename ValueType>
+bool KITGPI::EncodedDataCache<ValueType>::isActive() const
+{
+    return useCache != 0;
+}
+
+/*! \brief Return the number of supershots which have been read from the field data */
+template <typename ValueType>
+IndexType KITGPI::EncodedDataCache<ValueType>::getNumReads() const
+{
+    return numReads;
+}
+
+/*! \brief Return the number of supershots which have been taken from the cache */
+template <typename ValueType>
+IndexType KITGPI::EncodedDataCache<ValueType>::getNumHits() const
+{
+    return numHits;
+}
+
+/*! \brief Return the memory of the cached seismograms on this process in MB */
+template <typename ValueType>
+double KITGPI::EncodedDataCache<ValueType>::getMemory() const
+{
+    double memory = 0;
+    for (auto const &entry : entries)
+        memory += getMemory(entry.second);
+    return memory;
+}
+
+/*! \brief Return the memory of the seismograms of one supershot on this process in MB
+ \param entry Cached supershot
+ */
+template <typename ValueType>
+double KITGPI::EncodedDataCache<ValueType>::getMemory(Entry const &entry)
+{
+    double numValues = 0;
+    for (IndexType iComponent = 0; iComponent < IndexType(entry.data.size()); iComponent++) {
+        numValues += entry.data[iComponent].getLocalStorage().getValues().size();
+        for (auto const &dataDecode : entry.dataDecode[iComponent]) {
+            numValues += dataDecode.getLocalStorage().getValues().size();
+        }
+    }
+    return numValues * sizeof(ValueType) / (1024.0 * 1024.0);
+}
+
+template class KITGPI::EncodedDataCache<double>;
+template class KITGPI::EncodedDataCache<float>;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/all.hpp>
+
+#include <Acquisition/Acquisition.hpp>
+#include <Acquisition/Receivers.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Cache of the encoded observed data of the supershots
+     *
+     * With source encoding, the observed data of a supershot is the encoded sum of the field data of its constituent shots, which has to be read from one file per shot.
+     * The cache keeps the encoded seismograms (and the decoded seismograms of the constituent shots) of every supershot as they are returned by Receivers::encode before any filtering.
+     * A supershot is only read and encoded again if its encoding, i.e. the constituent shots and their polarities, has changed since it has been cached, so the field data is read once as long as the encoding stays the same.
+     * The same cache is used for the gradient calculation, the extra modelling and the step length search. It is cleared at the beginning of every workflow stage.
+     * The cached seismograms of a process are limited to encodedDataCacheMemory MB, the least recently used supershots are removed first.
+     */
+    template <typename ValueType>
+    class EncodedDataCache
+    {
+      public:
+        EncodedDataCache() : useCache(0), memoryLimit(1024), numReads(0), numHits(0), useCount(0){};
+        ~EncodedDataCache(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        void encode(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Configuration::Configuration config, scai::IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode);
+
+        bool restore(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, scai::IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode);
+        void store(KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, scai::IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode);
+        void clear();
+
+        static std::vector<scai::IndexType> getEncoding(std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode, scai::IndexType shotNumberEncode);
+
+        bool isActive() const;
+        scai::IndexType getNumReads() const;
+        scai::IndexType getNumHits() const;
+        double getMemory() const;
+
+      private:
+        /*! \brief Encoded seismograms of one supershot */
+        struct Entry {
+            std::vector<scai::IndexType> encoding;                                  //!< Rows and signed source numbers of the constituent shots
+            std::vector<scai::lama::DenseMatrix<ValueType>> data;                   //!< Encoded data per seismogram type
+            std::vector<std::vector<scai::lama::DenseMatrix<ValueType>>> dataDecode; //!< Decoded data of the constituent shots per seismogram type
+            scai::IndexType lastUse;                                                //!< Value of useCount when the entry has been stored or restored
+        };
+
+        static double getMemory(Entry const &entry);
+
+        scai::IndexType useCache;
+        double memoryLimit; // MB per process
+        scai::IndexType numReads;
+        scai::IndexType numHits;
+        scai::IndexType useCount;
+        std::map<scai::IndexType, Entry> entries;
+    };
+}
@@ -86,10 +86,10 @@ void KITGPI::FK<ValueType>::FKTransform(scai::lama::DenseMatrix<ValueType> const
 {
     scai::IndexType len = freqVec.size();
 
+    // only the non-negative frequencies are used
     scai::lama::DenseMatrix<ComplexValueType> fSignal;
-    fSignal = scai::lama::cast<ComplexValueType>(signal);
-    fSignal.resize(signal.getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(len));
-    scai::lama::fft<ComplexValueType>(fSignal, 1);
+    traceFFT.init(signal.getNumColumns(), len);
+    traceFFT.forward(signal, fSignal);
     
     scai::lama::DenseMatrix<ComplexValueType> L;
     calcFKOperatorL(offset, L);
@@ -132,7 +132,8 @@ void KITGPI::FK<ValueType>::inverseFKTransform(scai::lama::DenseMatrix<ValueType
     scai::IndexType len = freqVec.size();
 
     scai::lama::DenseMatrix<ComplexValueType> fSignal;
-    fSignal.allocate(signal.getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(len));
+    traceFFT.init(signal.getNumColumns(), len);
+    fSignal.allocate(signal.getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(traceFFT.getNumFrequencies()));
     
     scai::lama::DenseMatrix<ComplexValueType> Linv;
     calcFKOperatorLinv(offset, Linv);
@@ -154,33 +155,16 @@ void KITGPI::FK<ValueType>::inverseFKTransform(scai::lama::DenseMatrix<ValueType
     scai::lama::DenseVector<ComplexValueType> k;
     auto distNK = std::make_shared<scai::dmemo::NoDistribution>(NK);
     auto distNX = std::make_shared<scai::dmemo::NoDistribution>(NX);
-    if (indexFc1 == 0) { // fc1 = 0
-        fk.getColumn(k, 0);
+    // the negative frequencies are the complex conjugates of the positive ones
+    for (int jf = 0; jf < NF; jf++) {
+        fk.getColumn(k, jf);
         x = Linv * k;
-        fSignal.setColumn(x, 0, common::BinaryOp::COPY);
-        for (int jf = 1; jf < NF; jf++) {
-            fk.getColumn(k, jf);
-            x = Linv * k;
-            fSignal.setColumn(x, indexFc1+jf, common::BinaryOp::COPY);
-            x = scai::lama::conj(x);
-            fSignal.setColumn(x, len-indexFc1-jf, common::BinaryOp::COPY);
-        }
-    } else {
-        for (int jf = 0; jf < NF; jf++) {
-            fk.getColumn(k, jf);
-            x = Linv * k;
-            fSignal.setColumn(x, indexFc1+jf, common::BinaryOp::COPY);
-            x = scai::lama::conj(x);
-            fSignal.setColumn(x, len-indexFc1-jf, common::BinaryOp::COPY);
-        }
+        fSignal.setColumn(x, indexFc1+jf, common::BinaryOp::COPY);
     }
     
     fSignal *= (1.0 / ValueType(NK)); // proper fft normalization
-    fSignal *= (1.0 / ValueType(len)); // proper fft normalization
 
-    scai::lama::ifft<ComplexValueType>(fSignal, 1);
-    fSignal.resize(signal.getRowDistributionPtr(), signal.getColDistributionPtr());
-    signal = scai::lama::real(fSignal);
+    traceFFT.inverse(fSignal, signal);
 }
 
 template class KITGPI::FK<double>;
@@ -11,6 +11,8 @@
 #include <Common/Common.hpp>
 #include <complex>
 
+#include "TraceFFT.hpp"
+
 namespace KITGPI
 {
     //! \brief Class to handle frequency filtering.
@@ -39,5 +41,6 @@ namespace KITGPI
             scai::IndexType NK = 256; 
             scai::lama::DenseVector<ValueType> freqVec; 
             scai::lama::DenseVector<ValueType> kVec;         
+            mutable KITGPI::TraceFFT<ValueType> traceFFT; // work buffer of the time transforms
     };
 }
@@ -0,0 +1,268 @@
+#include "ForwardHistoryCache.hpp"
+
+#include <algorithm>
+
+using namespace scai;
+
+/*! \brief Initialize the cache from the configuration
+ *
+ * The cache is only used with useTrialForwardHistory = 1 and a configuration which is supported (see isSupported).
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useCache = 0;
+    if (isSupported(config)) {
+        useCache = config.getAndCatch("useTrialForwardHistory", 0);
+    }
+    memoryLimit = config.getAndCatch("trialForwardHistoryMemory", 1024.0);
+    SCAI_ASSERT_ERROR(memoryLimit >= 0, "trialForwardHistoryMemory = " << memoryLimit);
+    dimension = config.get<std::string>("dimension");
+    equationType = config.get<std::string>("equationType");
+    std::transform(dimension.begin(), dimension.end(), dimension.begin(), ::tolower);
+    std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower);
+    numRelaxationMechanisms = config.get<IndexType>("numRelaxationMechanisms");
+    clear();
+    resetStatistics();
+}
+
+/*! \brief Return true if the forward run of a trial of the step length search is the forward run of the gradient calculation
+ *
+ * This is the case for the parabolic step length search if the sources and the forward wavefields do not depend on the iteration:
+ * no source encoding, no source time function inversion, no wavefield decomposition, no reflection forward run (gradientKernel = 2) and no misfit which sets the reference traces as sources (L3).
+ \param config Configuration
+ */
+template <typename ValueType>
+bool KITGPI::ForwardHistoryCache<ValueType>::isSupported(KITGPI::Configuration::Configuration const &config)
+{
+    std::string misfitType = config.get<std::string>("misfitType");
+    std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
+    std::string multiMisfitType = config.getAndCatch("multiMisfitType", misfitType);
+    std::transform(multiMisfitType.begin(), multiMisfitType.end(), multiMisfitType.begin(), ::tolower);
+    return config.getAndCatch("steplengthType", 2) == 2 && config.getAndCatch("useSourceEncode", 0) == 0 && config.get<IndexType>("useSourceSignalInversion") == 0 && config.getAndCatch("decomposition", 0) == 0 && config.getAndCatch("gradientKernel", 0) != 2 && misfitType.compare("l3") != 0 && multiMisfitType.find('3') == std::string::npos;
+}
+
+/*! \brief Start the recording of a trial of the step length search
+ *
+ * The history of an earlier trial is discarded.
+ \param trialParameters Parameters of the test model (see ModelPerShotCache::getParameters)
+ \param trialSteplength Step length of the trial
+ \param trialWorkflowStage Workflow stage of the trial
+ \param trialSkipDT Increment of the time steps which are stored by the gradient calculation
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::startTrial(std::vector<scai::lama::DenseVector<ValueType>> const &trialParameters, ValueType trialSteplength, IndexType trialWorkflowStage, IndexType trialSkipDT)
+{
+    clear();
+    if (useCache == 0)
+        return;
+    parameters = trialParameters;
+    steplength = trialSteplength;
+    workflowStage = trialWorkflowStage;
+    skipDT = trialSkipDT;
+}
+
+/*! \brief Start the recording of a test shot of the current trial
+ *
+ * The wavefields of the shot are allocated if they fit into the memory limit.
+ \param shotInd Index of the shot
+ \param wavefields Wavefields of the forward run
+ \param dist Distribution of the wavefields
+ \param tStepEnd Number of time steps of the forward run
+ \return true if the shot is recorded
+ */
+template <typename ValueType>
+bool KITGPI::ForwardHistoryCache<ValueType>::startShot(IndexType shotInd, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, scai::dmemo::DistributionPtr dist, IndexType tStepEnd)
+{
+    recordShotInd = -1;
+    if (useCache == 0 || parameters.empty())
+        return false;
+
+    IndexType numSteps = (tStepEnd + skipDT - 1) / skipDT;
+    double memoryShot = numSteps * wavefields.estimateMemory(dist, numRelaxationMechanisms) / dist->getNumPartitions();
+    if (getMemory() + memoryShot > memoryLimit)
+        return false;
+
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Entry &entry = entries[shotInd];
+    entry.wavefields.clear();
+    for (IndexType step = 0; step < numSteps; step++) {
+        typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr wavefieldsStep(KITGPI::Wavefields::Factory<ValueType>::Create(dimension, equationType));
+        wavefieldsStep->init(ctx, dist, numRelaxationMechanisms);
+        entry.wavefields.push_back(wavefieldsStep);
+    }
+    entry.data.clear();
+    entry.memory = memoryShot;
+    recordShotInd = shotInd;
+    return true;
+}
+
+/*! \brief Store the wavefields of a time step of the recorded shot
+ *
+ * Has to be called directly after ForwardSolver::run of every time step with tStep % skipDT == 0.
+ \param tStep Time step
+ \param wavefields Wavefields after the time step
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::storeStep(IndexType tStep, KITGPI::Wavefields::Wavefields<ValueType> &wavefields)
+{
+    SCAI_ASSERT_ERROR(recordShotInd >= 0, "no shot is recorded");
+    SCAI_ASSERT_ERROR(tStep % skipDT == 0, "time step " << tStep << " is not stored with skipDT = " << skipDT);
+    *entries[recordShotInd].wavefields.at(tStep / skipDT) = wavefields;
+}
+
+/*! \brief Finish the recording of a shot with its synthetic data
+ *
+ * Has to be called directly after the forward run, i.e. before the seismograms are muted, tapered or normalized.
+ \param receivers Receivers of the forward run
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::finishShot(KITGPI::Acquisition::Receivers<ValueType> &receivers)
+{
+    SCAI_ASSERT_ERROR(recordShotInd >= 0, "no shot is recorded");
+    Entry &entry = entries[recordShotInd];
+    entry.data.assign(Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE, lama::DenseMatrix<ValueType>());
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receivers.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            entry.data[iComponent] = receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent)).getData();
+        }
+    }
+    recordShotInd = -1;
+}
+
+/*! \brief Keep the recorded history if the step length search has accepted the step length of the trial, otherwise discard it
+ \param steplengthOptimum Accepted step length
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::accept(ValueType steplengthOptimum)
+{
+    if (entries.empty() || steplengthOptimum != steplength) {
+        clear();
+        return;
+    }
+    isAccepted = true;
+}
+
+/*! \brief Discard the history if the model of the gradient calculation is not the model of the accepted trial
+ *
+ * Has to be called with the current model before the loop over the shots. The parameters are compared exactly, so any change of the model after the step length search (e.g. by the joint inversion) invalidates the history.
+ \param currentParameters Parameters of the current model (see ModelPerShotCache::getParameters)
+ \param currentWorkflowStage Current workflow stage
+ \param currentSkipDT Current increment of the stored time steps
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::update(std::vector<scai::lama::DenseVector<ValueType>> const &currentParameters, IndexType currentWorkflowStage, IndexType currentSkipDT)
+{
+    if (!isAccepted)
+        clear();
+    if (entries.empty())
+        return;
+
+    bool isSameModel = currentWorkflowStage == workflowStage && currentSkipDT == skipDT && currentParameters.size() == parameters.size();
+    lama::DenseVector<ValueType> difference;
+    for (std::size_t iParameter = 0; isSameModel && iParameter < parameters.size(); iParameter++) {
+        difference = currentParameters[iParameter] - parameters[iParameter];
+        isSameModel = difference.maxNorm() == 0;
+    }
+    if (!isSameModel)
+        clear();
+}
+
+/*! \brief Reset the number of saved forward runs, e.g. at the beginning of an iteration */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::resetStatistics()
+{
+    numSaved = 0;
+}
+
+/*! \brief Discard the recorded history */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::clear()
+{
+    entries.clear();
+    parameters.clear();
+    isAccepted = false;
+    recordShotInd = -1;
+}
+
+/*! \brief Return true if the accepted history contains a shot, the shot is counted as a saved forward run
+ \param shotInd Index of the shot
+ */
+template <typename ValueType>
+bool KITGPI::ForwardHistoryCache<ValueType>::find(IndexType shotInd)
+{
+    auto entry = entries.find(shotInd);
+    if (useCache == 0 || !isAccepted || entry == entries.end() || entry->second.data.empty())
+        return false;
+    numSaved++;
+    return true;
+}
+
+/*! \brief Restore the wavefields of a time step of a shot
+ \param shotInd Index of the shot
+ \param tStep Time step with tStep % skipDT == 0
+ \param wavefields Wavefields (output)
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::restoreStep(IndexType shotInd, IndexType tStep, KITGPI::Wavefields::Wavefields<ValueType> &wavefields) const
+{
+    SCAI_ASSERT_ERROR(tStep % skipDT == 0, "time step " << tStep << " is not stored with skipDT = " << skipDT);
+    wavefields = *entries.at(shotInd).wavefields.at(tStep / skipDT);
+}
+
+/*! \brief Restore the synthetic data of a shot
+ \param shotInd Index of the shot
+ \param receivers Receivers (output)
+ */
+template <typename ValueType>
+void KITGPI::ForwardHistoryCache<ValueType>::restoreSeismograms(IndexType shotInd, KITGPI::Acquisition::Receivers<ValueType> &receivers) const
+{
+    Entry const &entry = entries.at(shotInd);
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receivers.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            auto &seismogram = receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent));
+            SCAI_ASSERT_ERROR(seismogram.getData().getNumRows() == entry.data[iComponent].getNumRows(), "Recorded data of shot " << shotInd << " does not match the receivers");
+            seismogram.getData() = entry.data[iComponent];
+        }
+    }
+}
+
+/*! \brief Return true if the cache is used */
+template <typename ValueType>
+bool KITGPI::ForwardHistoryCache<ValueType>::isActive() const
+{
+    return useCache != 0;
+}
+
+/*! \brief Return the number of recorded shots */
+template <typename ValueType>
+IndexType KITGPI::ForwardHistoryCache<ValueType>::getNumShots() const
+{
+    return entries.size();
+}
+
+/*! \brief Return the number of forward runs which have been taken from the cache since the last reset */
+template <typename ValueType>
+IndexType KITGPI::ForwardHistoryCache<ValueType>::getNumSaved() const
+{
+    return numSaved;
+}
+
+/*! \brief Return the memory of the recorded wavefields and seismograms on this process in MB */
+template <typename ValueType>
+double KITGPI::ForwardHistoryCache<ValueType>::getMemory() const
+{
+    double memory = 0;
+    double numValues = 0;
+    for (auto const &entry : entries) {
+        memory += entry.second.memory;
+        for (auto const &data : entry.second.data) {
+            numValues += data.getLocalStorage().getValues().size();
+        }
+    }
+    return memory + numValues * sizeof(ValueType) / (1024.0 * 1024.0);
+}
+
+template class KITGPI::ForwardHistoryCache<double>;
+template class KITGPI::ForwardHistoryCache<float>;
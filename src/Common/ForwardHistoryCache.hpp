@@ -0,0 +1,77 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/all.hpp>
+
+#include <Acquisition/Acquisition.hpp>
+#include <Acquisition/Receivers.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Wavefields/WavefieldsFactory.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Forward history of the last trial of the step length search (useTrialForwardHistory = 1)
+     *
+     * The parabolic step length search (steplengthType = 2) accepts the step length of its last test forward run if the misfit is still decreasing. The model of this trial is the updated model of the next iteration,
+     * so its forward wavefields are the ones which the gradient calculation of the next iteration stores for the cross correlation. The cache records the wavefields of every skipDT-th time step and the synthetic data of the test shots during each trial.
+     * If the search accepts the step length of the recorded trial and the model of the next gradient calculation equals the trial model (the model version), the gradient calculation takes the forward wavefields and the synthetic data of these shots from the cache instead of solving the forward problem.
+     * Otherwise the recorded history is discarded. The memory of the recorded shots is limited by trialForwardHistoryMemory (MB per process), the remaining test shots are not recorded.
+     * The wavefields are stored on the modelling grid before any compensation or restriction, so the stored wavefields of the gradient calculation are bitwise identical.
+     */
+    template <typename ValueType>
+    class ForwardHistoryCache
+    {
+      public:
+        ForwardHistoryCache() : useCache(0), memoryLimit(0), numRelaxationMechanisms(0), isAccepted(false), steplength(0), workflowStage(-1), skipDT(1), recordShotInd(-1), numSaved(0){};
+        ~ForwardHistoryCache(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        static bool isSupported(KITGPI::Configuration::Configuration const &config);
+
+        void startTrial(std::vector<scai::lama::DenseVector<ValueType>> const &trialParameters, ValueType trialSteplength, scai::IndexType trialWorkflowStage, scai::IndexType trialSkipDT);
+        bool startShot(scai::IndexType shotInd, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, scai::dmemo::DistributionPtr dist, scai::IndexType tStepEnd);
+        void storeStep(scai::IndexType tStep, KITGPI::Wavefields::Wavefields<ValueType> &wavefields);
+        void finishShot(KITGPI::Acquisition::Receivers<ValueType> &receivers);
+        void accept(ValueType steplengthOptimum);
+        void update(std::vector<scai::lama::DenseVector<ValueType>> const &parameters, scai::IndexType currentWorkflowStage, scai::IndexType currentSkipDT);
+        void resetStatistics();
+        void clear();
+
+        bool find(scai::IndexType shotInd);
+        void restoreStep(scai::IndexType shotInd, scai::IndexType tStep, KITGPI::Wavefields::Wavefields<ValueType> &wavefields) const;
+        void restoreSeismograms(scai::IndexType shotInd, KITGPI::Acquisition::Receivers<ValueType> &receivers) const;
+
+        bool isActive() const;
+        scai::IndexType getNumShots() const;
+        scai::IndexType getNumSaved() const;
+        double getMemory() const;
+
+      private:
+        /*! \brief Forward history of one test shot */
+        struct Entry {
+            std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> wavefields; //!< Wavefields of every skipDT-th time step
+            std::vector<scai::lama::DenseMatrix<ValueType>> data;                                    //!< Synthetic data per seismogram type
+            double memory;                                                                            //!< Memory of the wavefields on this process in MB
+        };
+
+        scai::IndexType useCache;
+        double memoryLimit;
+        std::string dimension;
+        std::string equationType;
+        scai::IndexType numRelaxationMechanisms;
+
+        bool isAccepted;                                          // the step length of the trial has been accepted
+        ValueType steplength;                                     // step length of the trial
+        scai::IndexType workflowStage;                            // workflow stage of the trial
+        scai::IndexType skipDT;                                   // increment of the stored time steps of the trial
+        std::vector<scai::lama::DenseVector<ValueType>> parameters; // model parameters of the trial
+        std::map<scai::IndexType, Entry> entries;
+        scai::IndexType recordShotInd; // shot which is recorded, -1 if none
+
+        scai::IndexType numSaved;
+    };
+}
@@ -35,6 +35,15 @@ KITGPI::InversionSingle<ValueType>::InversionSingle(KITGPI::Configuration::Confi
         snapType = config.getAndCatch("snapType", 0);
         breakLoopType = config.get<IndexType>("breakLoopType");
         exchangeStrategy = config.get<IndexType>("exchangeStrategy");
+        useSourceSignalInversionSingleSolve = config.getAndCatch("useSourceSignalInversionSingleSolve", true);
+        encodedDataCache.init(config);
+        sourceReceiverTaperCache.init(config);
+        modelPerShotCache.init(config, equationType);
+        wavefieldCompensation.init(config);
+        timeWindow.init(config);
+        boundConstraint.init(config);
+        traceCompaction.init(config);
+        seismogramDecimation.init(config);
         
         derivatives = ForwardSolver::Derivatives::Factory<ValueType>::Create(dimension);
         solver = ForwardSolver::Factory<ValueType>::Create(dimension, equationType);
@@ -148,6 +157,7 @@ void KITGPI::InversionSingle<ValueType>::init(scai::dmemo::CommunicatorPtr commA
             end_t = common::Walltime::get();
             HOST_PRINT(commAll, "", "Finished graph partitioning in " << end_t - start_t << " sec.\n\n");
         }    
+        wavefieldActivity.init(config, modelCoordinates, dist);
         
         /* --------------------------------------- */
         /* Calculate derivative matrices           */
@@ -197,6 +207,7 @@ void KITGPI::InversionSingle<ValueType>::init(scai::dmemo::CommunicatorPtr commA
         } else {
             shotDist = dmemo::blockDistribution(numshots, commInterShot);
         }
+        adaptiveBatch.init(config, commAll, numshots, numShotDomains);
         if (config.get<IndexType>("useReceiversPerShot") == 0) {
             receivers.init(config, modelCoordinates, ctx, dist);
         }
@@ -263,6 +274,7 @@ void KITGPI::InversionSingle<ValueType>::init(scai::dmemo::CommunicatorPtr commA
         /* Step length search                      */
         /* --------------------------------------- */
         SLsearch.initLogFile(commAll, logFilename, misfitType, config.getAndCatch("steplengthType", 2), workflow.getInvertForParameters().size(), config.getAndCatch("saveCrossGradientMisfit", 0));
+        SLsearch.getForwardHistoryCache().init(config);
         
         /* --------------------------------------- */
         /* Source estimation                       */
@@ -316,8 +328,11 @@ void KITGPI::InversionSingle<ValueType>::init(scai::dmemo::CommunicatorPtr commA
                 gradientTaper1D.read(configBig.get<std::string>("gradientTaperName"), config.get<IndexType>("FileFormat"));
             }  
         }
+        DHInversionStage = config.getAndCatch("DHInversion", 1);
+        if (DHInversionStage > 1)
+            distInversionStages[DHInversionStage] = distInversion;
         wavefieldTaper2D.initAverageMatrix(config, distInversion, dist, ctx); 
-        Acquisition::Coordinates<ValueType> modelCoordinatesInversion(config, config.getAndCatch("DHInversion", 1), NXPerShot);
+        Acquisition::Coordinates<ValueType> modelCoordinatesInversion(config, DHInversionStage, NXPerShot);
         wavefieldTaper2D.calcAverageMatrix(modelCoordinates, modelCoordinatesInversion);
         
         /* --------------------------------------- */
@@ -341,6 +356,115 @@ void KITGPI::InversionSingle<ValueType>::init(scai::dmemo::CommunicatorPtr commA
     }
 }
 
+/*! \brief Reinitialize the InversionSingle for another run with a different configuration (parameter sweep)
+ *
+ * Partitioning, derivative matrices, acquisition, wavefields and the cached data of init are reused. Only the members which depend on parameters of the inversion itself are read again from config:
+ * misfit type, output filenames, step length, optimization, adaptive batch, smoothing of the gradients, gradient taper and energy preconditioning. The workflow is restarted at the first stage.
+ \param commAll CommunicatorPtr
+ \param config Configuration of the run
+ \param inversionType inversionType
+ \param ctx context
+ \param dist dist
+ \param distBig distBig
+ \param model model
+ \param workflow workflow
+ \param crossGradientDerivative crossGradientDerivative
+ \param SLsearch SLsearch
+ */
+template <typename ValueType>
+void KITGPI::InversionSingle<ValueType>::initVariant(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, scai::dmemo::DistributionPtr distBig, KITGPI::Modelparameter::Modelparameter<ValueType> &model, KITGPI::Workflow::Workflow<ValueType> &workflow, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, KITGPI::StepLengthSearch<ValueType> &SLsearch)
+{
+    if (inversionType != 0) {
+        misfitType = config.get<std::string>("misfitType");
+        std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
+        multiMisfitType = config.getAndCatch("multiMisfitType", misfitType);
+        gradname = config.get<std::string>("gradientFilename");
+        logFilename = config.get<std::string>("logFilename");
+        steplengthInit = config.get<ValueType>("steplengthInit");
+        optimizationType = config.get<std::string>("optimizationType");
+        sourceReceiverTaperCache.init(config);
+        modelPerShotCache.init(config, equationType);
+        wavefieldCompensation.init(config);
+        timeWindow.init(config);
+        boundConstraint.init(config);
+        traceCompaction.init(config);
+        seismogramDecimation.init(config);
+        
+        workflow.init(config);
+        adaptiveBatch.init(config, commAll, numshots, numShotDomains);
+        misfitPerIt = scai::lama::fill<scai::lama::DenseVector<ValueType>>(numshots, 0);
+        SLsearch.initLogFile(commAll, logFilename, misfitType, config.getAndCatch("steplengthType", 2), workflow.getInvertForParameters().size(), config.getAndCatch("saveCrossGradientMisfit", 0));
+        SLsearch.getForwardHistoryCache().init(config);
+        
+        gradient->calcGaussianKernel(commAll, model, config);
+        if (config.getAndCatch("saveCrossGradientMisfit", 0)) {
+            crossGradientDerivative->calcGaussianKernel(commAll, model, config);
+        }
+        if (config.getAndCatch("stablizingFunctionalType", 0)) {
+            stabilizingFunctionalGradient->calcGaussianKernel(commAll, model, config);
+        }
+        gradient->prepareForInversion(config);
+        gradientPerShot->prepareForInversion(config);
+        stabilizingFunctionalGradient->prepareForInversion(config);
+        crossGradientDerivative->prepareForInversion(config);
+        
+        if (config.get<bool>("useGradientTaper")) {
+            gradientTaper1D.init(useStreamConfig ? distBig : dist, ctx, 1);
+            gradientTaper1D.read(useStreamConfig ? configBig.get<std::string>("gradientTaperName") : config.get<std::string>("gradientTaperName"), config.get<IndexType>("FileFormat"));
+        }
+        
+        energyPrecond.init(distInversion, config);
+        energyPrecondReflect.init(distInversion, config);
+        
+        gradientOptimization = Optimization::Factory<ValueType>::Create(optimizationType);
+        gradientOptimization->init(dist);
+    }
+}
+
+/*! \brief Get the indices of all shots, e.g. for an iteration of the optimization with the gradient of all shots (see Optimization::isFullBatch)
+ */
+template <typename ValueType>
+std::vector<IndexType> KITGPI::InversionSingle<ValueType>::getAllShotInds() const
+{
+    std::vector<IndexType> allShotInds(numshots);
+    for (IndexType shotInd = 0; shotInd < numshots; shotInd++) {
+        allShotInds[shotInd] = shotInd;
+    }
+    return allShotInds;
+}
+
+/*! \brief Cut the model of a shot out of the big model and prepare it for the modelling (useStreamConfig = 1)
+ *
+ * With useModelPerShotCache = 1 the prepared model is taken from the cache if the cut-out has not changed, otherwise modelPerShot is set to a new model which is stored in the cache.
+ \param config Configuration
+ \param model Big model
+ \param dist Distribution of the model per shot
+ \param ctx context
+ \param commShot Communicator of the shot domain
+ \param modelCoordinates Coordinates of the model per shot
+ \param modelCoordinatesBig Coordinates of the big model
+ \param shotIndPerShot Index of the cut-out
+ */
+template <typename ValueType>
+void KITGPI::InversionSingle<ValueType>::prepareModelPerShot(KITGPI::Configuration::Configuration const &config, Modelparameter::Modelparameter<ValueType> &model, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, scai::dmemo::CommunicatorPtr commShot, Acquisition::Coordinates<ValueType> const &modelCoordinates, Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, IndexType shotIndPerShot)
+{
+    PhaseTimer::Scope timerPrepare("prepareModelPerShot");
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShotCached = modelPerShotCache.find(shotIndPerShot);
+    if (modelPerShotCached) {
+        modelPerShot = modelPerShotCached;
+        return;
+    }
+    double startPrepare_t = common::Walltime::get();
+    if (modelPerShotCache.isActive()) {
+        // the cached model must not be overwritten by the next shot
+        modelPerShot = Modelparameter::Factory<ValueType>::Create(equationType);
+        modelPerShot->prepareForInversion(config, commShot);
+    }
+    model.getModelPerShot(*modelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinates.at(shotIndPerShot));
+    modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot);
+    modelPerShotCache.store(shotIndPerShot, modelPerShot, cutCoordinates.at(shotIndPerShot), modelCoordinates, common::Walltime::get() - startPrepare_t);
+}
+
 /*! \brief Estimate memory of the InversionSingle
  \param commAll CommunicatorPtr
  \param config Configuration
@@ -355,7 +479,7 @@ void KITGPI::InversionSingle<ValueType>::estimateMemory(scai::dmemo::Communicato
 {
     if (inversionType != 0) {
         ValueType memDerivatives = derivatives->estimateMemory(config, dist, modelCoordinates);
-        ValueType memWavefileds = wavefields->estimateMemory(dist, numRelaxationMechanisms);
+        memWavefileds = wavefields->estimateMemory(dist, numRelaxationMechanisms);
         IndexType NT = tStepEnd;
         if (useSourceEncode == 0 && (gradientDomain == 1 || gradientDomain == 2)) {            
             NT *= 2;
@@ -367,7 +491,7 @@ void KITGPI::InversionSingle<ValueType>::estimateMemory(scai::dmemo::Communicato
         } else {
             memWavefiledsStorage = memWavefileds * NT / pow(config.getAndCatch("DHInversion", 1), 2);
         }
-        ValueType memModel = model->estimateMemory(dist);
+        memModel = model->estimateMemory(dist);
         ValueType memSolver = solver->estimateMemory(config, dist, modelCoordinates);
         ValueType memTotal = memDerivatives + memWavefileds + memModel + memSolver + memWavefiledsStorage;
 
@@ -382,6 +506,36 @@ void KITGPI::InversionSingle<ValueType>::estimateMemory(scai::dmemo::Communicato
             HOST_PRINT(commAll, "\n Total Memory Usage (" << numShotDomains << " shot domains): \n " << memTotal * numShotDomains << " MB  ");
 
         HOST_PRINT(commAll, "\n\n===================================================\n")  
+        
+        /* Register the persistent allocations per process in the memory ledger, the stage dependent ones are registered in initStage */
+        std::string ledgerPrefix = equationType + " " + std::to_string(equationInd) + " ";
+        IndexType numPartitions = dist->getNumPartitions();
+        IndexType numSeismogramHandlers = 4; // receivers, receiversTrue, receiversStart, adjointSources
+        ValueType memSeismograms = ValueType(receivers.getNumTracesGlobal()) * tStepEnd * sizeof(ValueType) / (1024 * 1024) * numSeismogramHandlers;
+        IndexType numGradients = 4; // gradient, gradientPerShot, stabilizingFunctionalGradient, crossGradientDerivative
+        IndexType numOptimizerGradients = 0;
+        std::string optimizationTypeLower = optimizationType;
+        std::transform(optimizationTypeLower.begin(), optimizationTypeLower.end(), optimizationTypeLower.begin(), ::tolower);
+        if (optimizationTypeLower.compare("conjugategradient") == 0)
+            numOptimizerGradients = 2; // last gradient and last conjugate gradient
+        if (optimizationTypeLower.compare("adam") == 0 || optimizationTypeLower.compare("adagrad") == 0)
+            numOptimizerGradients = 2; // first and second moment
+        if (optimizationTypeLower.compare("nesterov") == 0 || optimizationTypeLower.compare("svrg") == 0)
+            numOptimizerGradients = 1; // velocity or full gradient of the snapshot
+        MemoryLedger::set(ledgerPrefix + "derivatives", memDerivatives / numPartitions);
+        MemoryLedger::set(ledgerPrefix + "wavefields", memWavefileds * 7 / numPartitions); // 3 in InversionSingle and 4 in GradientCalculation
+        MemoryLedger::set(ledgerPrefix + "boundaries", memSolver / numPartitions);
+        MemoryLedger::set(ledgerPrefix + "models", memModel * 3 / numPartitions); // model, modelPriori, modelPerShot
+        MemoryLedger::set(ledgerPrefix + "gradients", memModel * numGradients / numPartitions);
+        MemoryLedger::set(ledgerPrefix + "optimizer", memModel * numOptimizerGradients / numPartitions);
+        MemoryLedger::set(ledgerPrefix + "lineSearch", memModel * 3 / numPartitions); // test model, test model per shot, test gradient
+        MemoryLedger::set(ledgerPrefix + "seismograms", memSeismograms / numPartitions);
+        MemoryLedger::set(ledgerPrefix + "encodedData", encodedDataCache.getMemory());
+        MemoryLedger::set(ledgerPrefix + "sourceReceiverTapers", sourceReceiverTaperCache.getMemory());
+        MemoryLedger::set(ledgerPrefix + "approxHessians", energyPrecond.getMemory() + energyPrecondReflect.getMemory());
+        MemoryLedger::set(ledgerPrefix + "activityBlocks", wavefieldActivity.getMemory());
+        if (GradientCalculation<ValueType>::isSinglePassReflect(config))
+            MemoryLedger::set(ledgerPrefix + "singlePassReflect", (memWavefileds + memSolver) / numPartitions); // reflection adjoint wavefield and boundary memory variables of its solver
     }
 }
 
@@ -396,9 +550,10 @@ void KITGPI::InversionSingle<ValueType>::estimateMemory(scai::dmemo::Communicato
  \param breakLoop breakLoop
  \param dist dist
  \param breakLoopEM breakLoopEM
+ \param model model, its minimum velocity determines the grid of the stage with DHInversionPerStage
  */
 template <typename ValueType>
-void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, scai::hmemo::ContextPtr ctx, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr dataMisfit, bool breakLoop, scai::dmemo::DistributionPtr dist, bool &breakLoopEM) 
+void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, scai::hmemo::ContextPtr ctx, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr dataMisfit, bool breakLoop, scai::dmemo::DistributionPtr dist, bool &breakLoopEM, KITGPI::Modelparameter::Modelparameter<ValueType> const &model)
 {
     if (inversionType != 0 && (breakLoop == false || breakLoopType == 2)) {
         if (equationInd == 1 && (exchangeStrategy == 4 || exchangeStrategy == 6))
@@ -406,10 +561,65 @@ void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr
 
         HOST_PRINT(commAll, "\nChange workflow stage " << equationType << " " << equationInd << "\n");
         workflow.changeStage(config, *dataMisfit, steplengthInit);
+        /* the cached encoded data are filtered with the corner frequencies of the last stage */
+        encodedDataCache.clear();
+        if (isSeismic && config.getAndCatch("DHInversionPerStage", 0) != 0) {
+            ValueType velocityMin;
+            if (equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0) {
+                velocityMin = model.getVelocityS().min();
+            } else {
+                velocityMin = model.getVelocityP().min();
+                if (equationType.compare("elastic") == 0 || equationType.compare("viscoelastic") == 0) {
+                    ValueType velocitySMin = model.getVelocityS().min();
+                    if (velocitySMin > 0) // no S-waves in fluid layers
+                        velocityMin = std::min(velocityMin, velocitySMin);
+                }
+            }
+            Acquisition::Coordinates<ValueType> modelCoordinates(config, 1, NXPerShot);
+            workflow.calcDHInversion(config, velocityMin, {modelCoordinates.getNX(), modelCoordinates.getNY(), modelCoordinates.getNZ()});
+        }
+        
+        /* The wavefields of the modelling grid are stored if the inversion grid is applied to the accumulated cross correlation */
+        IndexType numRecordsModelling = (gradientDomain == 0) ? ceil(ValueType(tStepEnd) / workflow.skipDT) : 1;
+        if ((gradientKernel == 2 || gradientKernel == 3) && decomposition == 0)
+            numRecordsModelling *= 2;
+        std::string ledgerPrefixModelling = equationType + " " + std::to_string(equationInd) + " ";
+        double memoryModelling = MemoryLedger::predict({{ledgerPrefixModelling + "wavefieldStorage", numRecordsModelling * memWavefileds / dist->getNumPartitions()}, {ledgerPrefixModelling + "xcorr", memModel / dist->getNumPartitions()}});
+        workflow.restrictAfterAccumulation = Workflow::Workflow<ValueType>::calcRestrictAfterAccumulation(config.getAndCatch("DHInversionRestriction", 0), workflow.DHInversion, gradientDomain, commAll->max(memoryModelling), config.getAndCatch("memoryLimit", 0.0));
                 
         workflow.printParameters(commAll);
+        
+        if (workflow.DHInversion != DHInversionStage || workflow.restrictAfterAccumulation != restrictAfterAccumulationStage) {
+            /* Grid of the stored wavefields and the cross correlation of this stage */
+            DHInversionStage = workflow.DHInversion;
+            restrictAfterAccumulationStage = workflow.restrictAfterAccumulation;
+            if (DHInversionStage > 1) {
+                Acquisition::Coordinates<ValueType> modelCoordinates(config, 1, NXPerShot);
+                Acquisition::Coordinates<ValueType> modelCoordinatesInversion(config, DHInversionStage, NXPerShot);
+                if (restrictAfterAccumulationStage) {
+                    // matrix-free average of the accumulated cross correlation and approximated Hessian on the modelling grid
+                    distInversion = dist;
+                    wavefieldTaper2D.calcBlockAverage(modelCoordinates, modelCoordinatesInversion, dist);
+                } else {
+                    // the distribution of a coarse grid is created once from the grid partition of the modelling grid, the grid partition of the configuration is kept for its DHInversion
+                    auto distInversionStage = distInversionStages.find(DHInversionStage);
+                    if (distInversionStage == distInversionStages.end())
+                        distInversionStage = distInversionStages.emplace(DHInversionStage, Taper::Taper2D<ValueType>::calcDistInversion(modelCoordinates, modelCoordinatesInversion, dist)).first;
+                    distInversion = distInversionStage->second;
+                    wavefieldTaper2D.initAverageMatrix(config, distInversion, dist, ctx);
+                    wavefieldTaper2D.calcAverageMatrix(modelCoordinates, modelCoordinatesInversion);
+                }
+            } else {
+                distInversion = dist;
+            }
+            wavefieldsInversion->init(ctx, distInversion, numRelaxationMechanisms);
+            energyPrecond.init(distInversion, config);
+            energyPrecondReflect.init(distInversion, config);
+        }
 
+        double allocatedXcorr = MemoryLedger::getAllocated(ctx);
         gradientCalculation.allocate(config, dist, distInversion, ctx, workflow, numShotPerSuperShot);
+        allocatedXcorr = MemoryLedger::getAllocated(ctx) - allocatedXcorr;
         seismogramTaper1D.calcTimeDampingTaper(workflow.getTimeDampingFactor(), config.get<ValueType>("DT"));  
 
         if (workflow.getLowerCornerFreq() != 0.0 && workflow.getUpperCornerFreq() != 0.0)
@@ -426,7 +636,31 @@ void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr
         if (gradientDomain != 0) {
             NT = 1;
         }
+        
+        /* Predict the memory peak of this stage before the stage dependent buffers are allocated */
+        std::string ledgerPrefix = equationType + " " + std::to_string(equationInd) + " ";
+        IndexType numPartitions = dist->getNumPartitions();
+        ValueType DHInversion = workflow.DHInversion;
+        ValueType DHStorage = workflow.restrictAfterAccumulation ? 1 : DHInversion;
+        ValueType memWavefieldInversion = memWavefileds / pow(DHStorage, (dimension.compare("3d") == 0) ? 3 : 2) / numPartitions;
+        IndexType numRecords = ceil(ValueType(NT) / workflow.skipDT);
+        if ((gradientKernel == 2 || gradientKernel == 3) && decomposition == 0)
+            numRecords *= 2;
+        ValueType memXcorr = memModel / numPartitions;
+        if (gradientDomain == 1 || gradientDomain == 2) {
+            IndexType NTxcorr = floor(ValueType(tStepEnd) / workflow.skipDT) + 1;
+            if (useSourceEncode != 0)
+                NTxcorr = floor(ValueType(NTxcorr) / 2 + 0.5);
+            memXcorr += 2 * NTxcorr * memWavefieldInversion; // forward and adjoint
+        } else if (gradientDomain == 3) {
+            memXcorr += 2 * 2 * numShotPerSuperShot * memWavefieldInversion; // forward and adjoint, complex
+        }
+        std::vector<std::pair<std::string, double>> stageSizes = {{ledgerPrefix + "wavefieldStorage", numRecords * memWavefieldInversion}, {ledgerPrefix + "xcorr", memXcorr}};
+        MemoryLedger::checkLimit(commAll, equationType + " " + std::to_string(equationInd) + " stage " + std::to_string(workflow.workflowStage + 1), MemoryLedger::predict(stageSizes), config.getAndCatch("memoryLimit", 0.0));
+        
         wavefieldrecord.clear();
+        wavefieldrecordReflect.clear();
+        double allocatedStorage = MemoryLedger::getAllocated(ctx);
         for (IndexType tStep = 0; tStep < NT; tStep++) {
             if (tStep % workflow.skipDT == 0) {
                 // Only the local shared_ptr can be used to initialize a std::vector
@@ -436,7 +670,6 @@ void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr
             }
         }
         if ((gradientKernel == 2 || gradientKernel == 3) && decomposition == 0) {
-            wavefieldrecordReflect.clear();
             for (IndexType tStep = 0; tStep < NT; tStep++) {
                 if (tStep % workflow.skipDT == 0) {
                     wavefieldPtr wavefieldsInversion = Wavefields::Factory<ValueType>::Create(dimension, equationType);
@@ -445,6 +678,17 @@ void KITGPI::InversionSingle<ValueType>::initStage(scai::dmemo::CommunicatorPtr
                 }
             }
         }
+        // the measured allocations replace the prediction, the cross-correlation buffers of the last stage have been replaced by the allocation
+        MemoryLedger::set(ledgerPrefix + "wavefieldStorage", MemoryLedger::getAllocated(ctx) - allocatedStorage);
+        MemoryLedger::set(ledgerPrefix + "xcorr", MemoryLedger::getSize(ledgerPrefix + "xcorr") + allocatedXcorr);
+        if (config.getAndCatch("DHInversionPerStage", 0) != 0) {
+            /* Cost of the stored wavefields and the cross correlation relative to the grid and DT of the modelling, the modelling itself is not coarsened */
+            IndexType numDimensions = (dimension.compare("3d") == 0) ? 3 : 2;
+            ValueType relativeCost = 1.0 / (pow(DHStorage, numDimensions) * workflow.skipDT);
+            HOST_PRINT(commAll, "\nInversion grid of stage " << workflow.workflowStage + 1 << ": DHInversion = " << DHInversion << " (" << distInversion->getGlobalSize() << " grid points, DH = " << DHInversion * config.get<ValueType>("DH") << " m), skipDT = " << workflow.skipDT << " (DT = " << workflow.skipDT * config.get<ValueType>("DT") << " s)\n");
+            HOST_PRINT(commAll, "Stored wavefields " << numRecords * memWavefieldInversion << " MB per process, cross correlation and energy preconditioning " << relativeCost * 100 << " % of the modelling grid\n");
+        }
+        
         std::vector<IndexType> temp(numshots, 0);
         shotHistory = temp;
         std::vector<IndexType> temp2(misfitType.length() - 2, 0);
@@ -484,6 +728,8 @@ template <typename ValueType>
 void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr dist, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &model, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfit, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversion, KITGPI::StepLengthSearch<ValueType> &SLsearch, Taper::Taper2D<ValueType> modelTaper2DJoint, IndexType maxiterations, IndexType &useRTM, bool &breakLoop, scai::hmemo::ContextPtr ctx, IndexType &seedtime, IndexType inversionType, IndexType equationInd, bool &breakLoopEM, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &modelEM, KITGPI::Configuration::Configuration configEM, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesEM, KITGPI::Workflow::Workflow<ValueType> &workflowEM, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfitEM, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivativeEM, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversionEM)
 {          
     if (inversionType != 0 && (breakLoop == false || breakLoopType == 2 || useRTM != 0)) {
+        PhaseTimer::Scope timerInversion(isSeismic ? "seismic" : "EM");
+        PhaseTimer::Scope timerCalcGradient("calcGradient");
         IndexType shotNumber;
         IndexType shotIndTrue = 0; 
         IndexType shotIndIncr = 0;  
@@ -509,11 +755,40 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
             *modelPerShot = *model;
             modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot); 
             solver->prepareForModelling(*modelPerShot, config.get<ValueType>("DT"));
+            gradientCalculation.prepareForModelling(config, *derivatives, *modelPerShot, modelCoordinates, ctx, false);
+        } else {
+            modelPerShotCache.resetStatistics();
+            modelPerShotCache.update(*model, modelCoordinatesBig);
+        }
+        ForwardHistoryCache<ValueType> &forwardHistoryCache = SLsearch.getForwardHistoryCache();
+        forwardHistoryCache.resetStatistics();
+        if (forwardHistoryCache.isActive()) {
+            forwardHistoryCache.update(ModelPerShotCache<ValueType>::getParameters(*model, equationType), workflow.workflowStage, workflow.skipDT);
         }
         
-        sources.calcUniqueShotInds(commAll, config, shotHistory, maxcount, seedtime);
-        std::vector<IndexType> uniqueShotInds = sources.getUniqueShotInds();
-        std::vector<IndexType> shotIndsIncr = sources.getShotIndsIncr();
+        std::vector<IndexType> uniqueShotInds;
+        std::vector<IndexType> shotIndsIncr;
+        if (adaptiveBatch.isActive()) {
+            uniqueShotInds = adaptiveBatch.selectShots(shotHistory);
+            shotIndsIncr = uniqueShotInds; // shotIndsIncr is only used for common offset profiles
+            shotDist = dmemo::blockDistribution(uniqueShotInds.size(), commInterShot);
+            SLsearch.setUniqueShotInds(uniqueShotInds);
+            HOST_PRINT(commAll, "\nAdaptive batch: " << uniqueShotInds.size() << " of " << numshots << " shots\n");
+        } else if (useRandomSource != 0 && gradientOptimization->isFullBatch(config, workflow)) {
+            uniqueShotInds = getAllShotInds();
+            shotIndsIncr = uniqueShotInds;
+            shotDist = dmemo::blockDistribution(numshots, commInterShot);
+            SLsearch.setUniqueShotInds(uniqueShotInds);
+            HOST_PRINT(commAll, "\nOptimization " << optimizationType << ": gradient of all " << numshots << " shots\n");
+        } else {
+            sources.calcUniqueShotInds(commAll, config, shotHistory, maxcount, seedtime);
+            uniqueShotInds = sources.getUniqueShotInds();
+            shotIndsIncr = sources.getShotIndsIncr();
+            if (useRandomSource != 0) {
+                shotDist = dmemo::blockDistribution(numShotDomains, commInterShot);
+                SLsearch.setUniqueShotInds(std::vector<IndexType>());
+            }
+        }
         Acquisition::writeRandomShotNosToFile(commAll, logFilename, uniqueShotNos, uniqueShotInds, workflow.workflowStage + 1, workflow.iteration, useRandomSource);
         dataMisfit->init(config, misfitTypeHistory, numshots, useRTM, model->getVmin(), seedtime); // in case of that random misfit function is used
         sources.calcSourceSettingsEncode(commAll, config, seedtime, workflow.getLowerCornerFreq(), workflow.getUpperCornerFreq()); // for sourceFC
@@ -566,8 +841,21 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
         stabilizingFunctionalGradient->setInvertForParameters(invertForParameters);
         workflow.setInvertForParameters(invertForParameters);
         
+        energyPrecond.startIteration(workflow.workflowStage, workflow.iteration);
+        energyPrecondReflect.startIteration(workflow.workflowStage, workflow.iteration);
+        timeWindow.resetStatistics();
+        wavefieldActivity.resetStatistics();
+        
+        gradientOptimization->startBatch(config, workflow, shotDist->getGlobalSize(), numshots);
+        dataMisfit->setTraceCompaction(traceCompaction.isActive() ? &traceCompaction : nullptr);
+        if (seismogramDecimation.setStage(workflow.getUpperCornerFreq())) {
+            HOST_PRINT(commAll, "\nSeismogram decimation: factor " << seismogramDecimation.getFactor() << ", misfit and adjoint sources with DT = " << seismogramDecimation.getDT() << " s\n");
+        }
+        dataMisfit->setSeismogramDecimation(seismogramDecimation.isActive() ? &seismogramDecimation : nullptr);
+        
         IndexType localShotInd = 0;     
         for (IndexType shotInd = shotDist->lb(); shotInd < shotDist->ub(); shotInd++) {
+            PhaseTimer::Scope timerShot("shot");
             shotIndTrue = uniqueShotInds[shotInd];
             shotIndIncr = shotIndsIncr[shotInd]; // it is not compatible with useSourceEncode != 0
             localShotInd++;
@@ -592,10 +880,10 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
             if (useStreamConfig) {
                 HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Switch to model subset\n");
                 
-                model->getModelPerShot(*modelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinates.at(shotIndPerShot)); 
-                modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot); 
+                prepareModelPerShot(config, *model, dist, ctx, commShot, modelCoordinates, modelCoordinatesBig, shotIndPerShot);
                 solver->initForwardSolver(config, *derivatives, *wavefields, *modelPerShot, modelCoordinates, ctx, config.get<ValueType>("DT"));
                 solver->prepareForModelling(*modelPerShot, config.get<ValueType>("DT"));
+                gradientCalculation.prepareForModelling(config, *derivatives, *modelPerShot, modelCoordinates, ctx, true);
             }
             CheckParameter::checkNumericalArtefactsAndInstabilities<ValueType>(config, sourceSettingsShot, *modelPerShot, modelCoordinates, shotNumber);
             HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "), local shot " << localShotInd << " of " << shotDist->getLocalSize() << ": Started\n");
@@ -611,18 +899,24 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 adjointSources.getSeismogramHandler().setShotInd(shotIndTrue, shotIndIncr);
             }
             /* Read field data (or pseudo-observed data, respectively) */
-            if (useSourceEncode == 0) {
-                receiversTrue.getSeismogramHandler().read(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("fieldSeisName") + ".shot_" + std::to_string(shotNumber), 1);
-            } else {
-                receiversTrue.encode(config, config.get<std::string>("fieldSeisName"), shotNumber, sourceSettingsEncode, 1);
+            {
+                PhaseTimer::Scope timerReadData("readData");
+                if (useSourceEncode == 0) {
+                    receiversTrue.getSeismogramHandler().read(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("fieldSeisName") + ".shot_" + std::to_string(shotNumber), 1);
+                } else {
+                    encodedDataCache.encode(receiversTrue, config, shotNumber, sourceSettingsEncode);
+                }
             }
                                 
-            if (workflow.getLowerCornerFreq() != 0.0 || workflow.getUpperCornerFreq() != 0.0){
-                receiversTrue.getSeismogramHandler().filter(freqFilter);
-            }
+            {
+                PhaseTimer::Scope timerFiltering("filtering");
+                if (workflow.getLowerCornerFreq() != 0.0 || workflow.getUpperCornerFreq() != 0.0){
+                    traceCompaction.filter(receiversTrue.getSeismogramHandler(), freqFilter, shotIndTrue, workflow.workflowStage);
+                }
             
-            if (workflow.getLowerCornerFreq() != 0.0 || workflow.getUpperCornerFreq() != 0.0)
-                sources.getSeismogramHandler().filter(freqFilter);
+                if (workflow.getLowerCornerFreq() != 0.0 || workflow.getUpperCornerFreq() != 0.0)
+                    sources.getSeismogramHandler().filter(freqFilter);
+            }
             
             /* Source time function inversion */                    
             std::string filenameSyn = config.get<std::string>("SeismogramFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration);
@@ -649,16 +943,26 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                     sourceEst.setRefTracesToSource(sources, receiversTrue, sourceSettingsEncode, shotIndTrue, shotNumber);
                 }
             }
+            if (traceCompaction.update(receiversTrue, shotIndTrue, workflow.workflowStage)) {
+                HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Trace compaction: " << traceCompaction.getNumActiveTraces(shotIndTrue) << " of " << traceCompaction.getNumTraces(shotIndTrue) << " traces are active\n");
+            }
+            /* The source time function can be estimated from the receivers of the regular forward solve if the wavefields only enter the gradient linearly and time-invariantly */
+            bool estimateSourceSignalFromForward = false;
+            Acquisition::Receivers<ValueType> receiversTrueSourceEst;
             if (config.get<IndexType>("useSourceSignalInversion") != 0){
                 if (workflow.iteration == 0 || shotHistory[shotIndTrue] != 0 || useSourceEncode != 0) {
                     HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "), local shot " << localShotInd << " of " << shotDist->getLocalSize() << ": Source Time Function Inversion\n");
 
-                    wavefields->resetWavefields();
+                    estimateSourceSignalFromForward = useSourceSignalInversionSingleSolve && useSourceEncode == 0 && gradientDomain == 0 && gradientKernelPerIt != 2 && decomposition == 0 && config.getAndCatch("compensation", 0) == 0 && config.get<IndexType>("useSourceSignalTaper") == 0;
+                    
+                    if (!estimateSourceSignalFromForward) {
+                        wavefields->resetWavefields();
 
-                    for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
-                        solver->run(receivers, sources, *modelPerShot, *wavefields, *derivatives, tStep);
+                        for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
+                            solver->run(receivers, sources, *modelPerShot, *wavefields, *derivatives, tStep);
+                        }
+                        solver->resetCPML();
                     }
-                    solver->resetCPML();
                     
                     /* Normalize observed and synthetic data */
                     if (config.get<IndexType>("normalizeTraces") == 3 || misfitType.compare("l6") == 0 || multiMisfitType.find('6') != std::string::npos) {
@@ -671,20 +975,26 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                         receiversTrue.getSeismogramHandler().write(5, config.get<std::string>("fieldSeisName") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".shot_" + std::to_string(shotNumber), modelCoordinates);    
                         receivers.getSeismogramHandler().setInverseAGC(receiversTrue.getSeismogramHandler());
                     }
-                    receivers.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
                     receiversTrue.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
                     
-                    if (useSourceEncode == 0) {
+                    if (estimateSourceSignalFromForward) {
+                        /* the Wiener filter is estimated after the forward solve, see below */
+                        receiversTrueSourceEst = receiversTrue;
+                    } else if (useSourceEncode == 0) {
+                        receivers.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
                         sourceEst.applyOffsetMute(config, shotIndTrue, receivers);
                         sourceEst.estimateSourceSignal(receivers, receiversTrue, shotIndTrue, shotNumber);
                     } else {
+                        receivers.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
                         receivers.decode(config, filenameSyn, shotNumber, sourceSettingsEncode, 0);
                         receiversTrue.decode(config, filenameObs, shotNumber, sourceSettingsEncode, 0);
                         sourceEst.applyOffsetMuteEncode(commShot, shotNumber, config, sourceSettingsEncode, receivers);
                         sourceEst.estimateSourceSignalEncode(commShot, shotNumber, config, modelCoordinates, ctx, dist, sourceSettingsEncode, receivers, receiversTrue);
                     }
                 }
-                if (useSourceEncode == 0) {
+                if (estimateSourceSignalFromForward) {
+                    // the forward solve uses the uncorrected source
+                } else if (useSourceEncode == 0) {
                     sourceEst.applyFilter(sources, shotNumber, sourceSettings);
                 } else {
                     sourceEst.applyFilter(sources, shotNumber, sourceSettingsEncode);
@@ -697,7 +1007,7 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                     sourceSignalTaper.apply(sources.getSeismogramHandler());
                 }
             }
-            if (config.get<bool>("writeInvertedSource") && (workflow.iteration == 0 || shotHistory[shotIndTrue] == 1))
+            if (config.get<bool>("writeInvertedSource") && (workflow.iteration == 0 || shotHistory[shotIndTrue] == 1) && !estimateSourceSignalFromForward)
                 sources.getSeismogramHandler().write(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("sourceSeismogramFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".shot_" + std::to_string(shotNumber), modelCoordinates);
             
             if (config.get<IndexType>("useSeismogramTaper") > 1) {
@@ -712,6 +1022,7 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 seismogramTaper2D.apply(receiversTrue.getSeismogramHandler()); 
             }
             seismogramTaper1D.apply(receiversTrue.getSeismogramHandler());                                        
+            IndexType tStepForwardEnd = timeWindow.calcForwardEnd(seismogramTaper2D, tStepEnd, !estimateSourceSignalFromForward);
             
             /* Normalize observed and synthetic data */
             if (config.get<IndexType>("normalizeTraces") == 3 || misfitType.compare("l6") == 0 || multiMisfitType.find('6') != std::string::npos) {
@@ -786,10 +1097,9 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
             /* --------------------------------------- */
             /*        Forward modelling 1              */
             /* --------------------------------------- */
-            HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start time stepping with " << tStepEnd << " time steps\n");
+            HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start time stepping with " << tStepForwardEnd << " time steps\n");
 
             ValueType DTinv = 1.0 / config.get<ValueType>("DT");
-            lama::DenseVector<ValueType> compensation;
             if (gradientKernelPerIt == 2 && decomposition == 0) { 
                 HOST_PRINT(commAll, "================ initWholeSpace receivers ===============\n");
                 sourcesReflect.initWholeSpace(config, modelCoordinates, ctx, dist, receivers.getSeismogramTypes());
@@ -797,51 +1107,56 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
             typename ForwardSolver::SourceReceiverImpl::SourceReceiverImpl<ValueType>::SourceReceiverImplPtr SourceReceiverReflect(ForwardSolver::SourceReceiverImpl::Factory<ValueType>::Create(dimension, equationType, sources, sourcesReflect, *wavefieldsTemp));
 
             start_t_shot = common::Walltime::get();
-            wavefields->resetWavefields();
-            energyPrecond.resetApproxHessian();
+            {
+                PhaseTimer::Scope timerForward("forward");
+                wavefields->resetWavefields();
+                energyPrecond.resetApproxHessian(shotNumber);
+                wavefieldActivity.initForward(sources.get1DCoordinates(), *modelPerShot, config.get<ValueType>("DT"));
+                wavefieldCompensation.initShot(*modelPerShot);
+                // the forward run of a test shot of the accepted trial of the step length search is taken from its history
+                bool replayForward = gradientKernelPerIt != 2 && forwardHistoryCache.find(shotIndTrue);
         
-            for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
-                *wavefieldsTemp = *wavefields;
-
-                solver->run(receivers, sources, *modelPerShot, *wavefields, *derivatives, tStep);
-                
-                if ((gradientKernelPerIt == 2 && decomposition == 0) || decomposition != 0) { 
-                    //calculate temporal derivative of wavefield
-                    *wavefieldsTemp -= *wavefields;
-                    *wavefieldsTemp *= -DTinv; // wavefieldsTemp will be gathered by sourcesReflect
-                    if (gradientKernelPerIt == 2 && decomposition == 0) 
-                        SourceReceiverReflect->gatherSeismogram(tStep);
-                    if (decomposition != 0) 
-                        wavefields->decompose(decomposition, *wavefieldsTemp, *derivatives);
-                }
-                if (tStep % workflow.skipDT == 0 && (useSourceEncode == 0 || (useSourceEncode != 0 && tStep >= tStepEnd / 2))) {
-                    if (config.getAndCatch("compensation", 0)) {
-                        compensation = modelPerShot->getCompensation(config.get<ValueType>("DT"), tStep);
-                        *wavefieldsInversion = *wavefields;
-                        *wavefieldsInversion *= compensation;
-                        if (config.getAndCatch("DHInversion", 1) > 1)
-                            wavefieldsInversion->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefieldsInversion);
+                // the synthetic data after tStepForwardEnd is muted by the seismogram taper
+                for (IndexType tStep = 0; tStep < tStepForwardEnd; tStep++) {
+                    if (replayForward) {
+                        if (tStep % workflow.skipDT == 0)
+                            forwardHistoryCache.restoreStep(shotIndTrue, tStep, *wavefields);
                     } else {
-                        if (config.getAndCatch("DHInversion", 1) > 1) {
-                            wavefieldsInversion->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
-                        } else {
-                            *wavefieldsInversion = *wavefields;
+                        *wavefieldsTemp = *wavefields;
+
+                        solver->run(receivers, sources, *modelPerShot, *wavefields, *derivatives, tStep);
+                    
+                        if ((gradientKernelPerIt == 2 && decomposition == 0) || decomposition != 0) { 
+                            //calculate temporal derivative of wavefield
+                            *wavefieldsTemp -= *wavefields;
+                            *wavefieldsTemp *= -DTinv; // wavefieldsTemp will be gathered by sourcesReflect
+                            if (gradientKernelPerIt == 2 && decomposition == 0) 
+                                SourceReceiverReflect->gatherSeismogram(tStep);
+                            if (decomposition != 0) 
+                                wavefields->decompose(decomposition, *wavefieldsTemp, *derivatives);
                         }
                     }
-                    if (gradientDomain == 0 || tStep == 0) {
-                        *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)] = *wavefieldsInversion;
-                    } 
-                    if (gradientDomain != 0 && (useSourceEncode == 0 || (useSourceEncode != 0 && tStep >= tStepEnd / 2))) {
-                        gradientCalculation.gatherWavefields(*wavefieldsInversion, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"));
-                    }
-                    energyPrecond.intSquaredWavefields(*wavefieldsInversion, config.get<ValueType>("DT"));
-                }       
+                    if (tStep % workflow.skipDT == 0 && (useSourceEncode == 0 || (useSourceEncode != 0 && tStep >= tStepEnd / 2))) {
+                        PhaseTimer::Scope timerStoreWavefields("storeWavefields");
+                        wavefieldCompensation.storeWavefields(*wavefieldsInversion, *wavefields, tStep, wavefieldTaper2D.getAverageMatrix(), DHInversionStage > 1 && !restrictAfterAccumulationStage);
+                        if (gradientDomain == 0 || tStep == 0) {
+                            *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)] = *wavefieldsInversion;
+                        } 
+                        if (gradientDomain != 0 && (useSourceEncode == 0 || (useSourceEncode != 0 && tStep >= tStepEnd / 2))) {
+                            gradientCalculation.gatherWavefields(*wavefieldsInversion, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"));
+                        }
+                        PhaseTimer::Scope timerEnergyPreconditioning("energyPreconditioning");
+                        energyPrecond.intSquaredWavefields(*wavefieldsInversion, config.get<ValueType>("DT"), false, wavefieldActivity.getForwardRanges(tStep));
+                    }       
                 
-                if (workflow.workflowStage == 0 && workflow.iteration == 0 && gradientDomain == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
-                    wavefields->write(snapType, config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) +  + ".shot_" + std::to_string(shotNumber) + ".source", tStep, *derivatives, *modelPerShot, config.get<IndexType>("FileFormat"));
+                    if (workflow.workflowStage == 0 && workflow.iteration == 0 && gradientDomain == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
+                        wavefields->write(snapType, config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) +  + ".shot_" + std::to_string(shotNumber) + ".source", tStep, *derivatives, *modelPerShot, config.get<IndexType>("FileFormat"));
+                    }
                 }
+                solver->resetCPML();
+                if (replayForward)
+                    forwardHistoryCache.restoreSeismograms(shotIndTrue, receivers);
             }
-            solver->resetCPML();
             
             if (gradientKernelPerIt == 2 && decomposition == 0) { 
                 HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start reflection forward \n");
@@ -849,7 +1164,7 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 reflectivity = modelPerShot->getReflectivity();
                 dataMisfit->calcReflectSources(sourcesReflect, reflectivity);
                 wavefields->resetWavefields(); 
-                energyPrecondReflect.resetApproxHessian();
+                energyPrecondReflect.resetApproxHessian(shotNumber);
                 bool isReflect = true;
                 
                 for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
@@ -857,19 +1172,7 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                     solver->run(adjointSources, sourcesReflect, *modelPerShot, *wavefields, *derivatives, tStep);
                     
                     if (tStep % workflow.skipDT == 0 && (useSourceEncode == 0 || (useSourceEncode != 0 && tStep >= tStepEnd / 2))) {
-                        if (config.getAndCatch("compensation", 0)) {
-                            compensation = modelPerShot->getCompensation(config.get<ValueType>("DT"), tStep);
-                            *wavefieldsInversion = *wavefields;
-                            *wavefieldsInversion *= compensation;                                
-                            if (config.getAndCatch("DHInversion", 1) > 1)
-                                wavefieldsInversion->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefieldsInversion);
-                        } else {
-                            if (config.getAndCatch("DHInversion", 1) > 1) {
-                                wavefieldsInversion->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
-                            } else {
-                                *wavefieldsInversion = *wavefields;
-                            }
-                        }
+                        wavefieldCompensation.storeWavefields(*wavefieldsInversion, *wavefields, tStep, wavefieldTaper2D.getAverageMatrix(), DHInversionStage > 1 && !restrictAfterAccumulationStage);
                         if (gradientDomain == 0 || tStep == 0) {
                             *wavefieldrecordReflect[floor(tStep / workflow.skipDT + 0.5)] = *wavefieldsInversion;
                         } 
@@ -890,6 +1193,20 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 model->write("model_crash", config.get<IndexType>("FileFormat"));
             COMMON_THROWEXCEPTION("Infinite or NaN value in seismogram or/and velocity wavefield, output model as model_crash.FILE_EXTENSION!");
             }
+            if (estimateSourceSignalFromForward) {
+                /* Estimate the Wiener filter from the receivers of the uncorrected source and correct the synthetics by convolution */
+                Acquisition::Receivers<ValueType> receiversSourceEst = receivers;
+                if (config.get<IndexType>("normalizeTraces") == 3 || misfitType.compare("l6") == 0 || multiMisfitType.find('6') != std::string::npos) {
+                    receiversSourceEst.getSeismogramHandler().setInverseAGC(receiversTrueSourceEst.getSeismogramHandler());
+                }
+                receiversSourceEst.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
+                sourceEst.applyOffsetMute(config, shotIndTrue, receiversSourceEst);
+                sourceEst.estimateSourceSignal(receiversSourceEst, receiversTrueSourceEst, shotIndTrue, shotNumber);
+                sourceEst.applyFilter(receivers, shotIndTrue);
+                sourceEst.applyFilter(sources, shotNumber, sourceSettings);
+                if (config.get<bool>("writeInvertedSource") && (workflow.iteration == 0 || shotHistory[shotIndTrue] == 1))
+                    sources.getSeismogramHandler().write(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("sourceSeismogramFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".shot_" + std::to_string(shotNumber), modelCoordinates);
+            }
             if (useSourceEncode == 0) {
                 sourceEst.applyOffsetMute(config, shotIndTrue, receivers);
             } else {
@@ -913,8 +1230,11 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                             
             receivers.decode(config, filenameSyn, shotNumber, sourceSettingsEncode, 1); // for StepLengthSearch
             receivers.encode(config, filenameSyn, shotNumber, sourceSettingsEncode, 0);
-            receivers.writeReceiverMark(config, shotNumber, workflow.workflowStage + 1, workflow.iteration);
-            receivers.getSeismogramHandler().write(config.get<IndexType>("SeismogramFormat"), filenameSyn + ".shot_" + std::to_string(shotNumber), modelCoordinates);
+            {
+                PhaseTimer::Scope timerOutput("output");
+                receivers.writeReceiverMark(config, shotNumber, workflow.workflowStage + 1, workflow.iteration);
+                receivers.getSeismogramHandler().write(config.get<IndexType>("SeismogramFormat"), filenameSyn + ".shot_" + std::to_string(shotNumber), modelCoordinates);
+            }
             
             if (useSourceEncode == 0) {
                 HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Calculate misfit and adjoint sources\n");
@@ -922,6 +1242,13 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 misfitPerIt.setValue(shotIndTrue, dataMisfit->calc(receivers, receiversTrue, shotIndTrue));
                 /* Calculate adjoint sources */
                 dataMisfit->calcAdjointSources(adjointSources, receivers, receiversTrue, shotIndTrue);
+                if (seismogramDecimation.isActive()) {
+                    // the interpolated adjoint sources are not zero after the last sample of the seismogram taper, which limits the forward modelling of the time window
+                    if (config.get<IndexType>("useSeismogramTaper") > 1) {
+                        seismogramTaper2D.apply(adjointSources.getSeismogramHandler());
+                    }
+                    seismogramTaper1D.apply(adjointSources.getSeismogramHandler());
+                }
             } else {
                 HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Calculate encode misfit and adjoint sources\n");
                 /* Calculate misfit and write adjoint sources */
@@ -930,6 +1257,11 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
             if (config.getAndCatch("writeAdjointSource", false))
                 adjointSources.getSeismogramHandler().write(config.get<IndexType>("SeismogramFormat"), filenameObs + ".adjointSource" + ".shot_" + std::to_string(shotNumber), modelCoordinates);
             
+            if (estimateSourceSignalFromForward) {
+                /* the stored forward wavefields belong to the uncorrected source, so the filter is moved to the adjoint sources */
+                sourceEst.applyFilterAdjoint(adjointSources, shotIndTrue);
+            }
+            
             /* Calculate gradient */
             end_t_shot = common::Walltime::get();
             if (gradientKernelPerIt == 2 && decomposition == 0) {
@@ -938,8 +1270,15 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
                 HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start backward in " << end_t_shot - start_t_shot << " sec.\n");
             }
             
-            gradientCalculation.run(commAll, *solver, *derivatives, receivers, sources, adjointSources, *modelPerShot, *gradientPerShot, wavefieldrecord, config, modelCoordinates, shotNumber, shotIndTrue, workflow, wavefieldTaper2D, wavefieldrecordReflect, *dataMisfit, energyPrecond, energyPrecondReflect, sourceSettingsEncode);
+            gradientCalculation.run(commAll, *solver, *derivatives, receivers, sources, adjointSources, *modelPerShot, *gradientPerShot, wavefieldrecord, config, modelCoordinates, shotNumber, shotIndTrue, workflow, wavefieldTaper2D, wavefieldrecordReflect, *dataMisfit, energyPrecond, energyPrecondReflect, sourceSettingsEncode, sourceReceiverTaperCache, timeWindow, wavefieldActivity, wavefieldCompensation);
+            if (timeWindow.isActive()) {
+                HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Time window skipped " << timeWindow.getNumSkippedForwardShot() << " forward and " << timeWindow.getNumSkippedAdjointShot() << " adjoint time steps of " << tStepEnd << "\n");
+            }
             
+            if (adaptiveBatch.isActive()) {
+                adaptiveBatch.addShotGradient(*gradientPerShot, workflow);
+            }
+            gradientOptimization->applyPerShot(*gradientPerShot, shotNumber, workflow);
             if (!useStreamConfig) {
                 *gradient += *gradientPerShot;
             } else {
@@ -1005,8 +1344,47 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
         dataMisfit->sumShotDomain(commInterShot);
         dataMisfit->addToStorage(misfitPerIt);
         misfitPerIt = 0;
-        gradient->sumShotDomain(commInterShot); 
-        gradient->smooth(commAll, config);
+        {
+            PhaseTimer::Scope timerSumShotDomain("sumShotDomain");
+            gradient->sumShotDomain(commInterShot); 
+        }
+        if (adaptiveBatch.isActive()) {
+            adaptiveBatch.update(commInterShot, *gradient, workflow);
+            adaptiveBatch.writeToLogFile(commAll, workflow.workflowStage + 1, workflow.iteration);
+            HOST_PRINT(commAll, "Adaptive batch: gradient variance = " << adaptiveBatch.getVariance() << ", next batch size = " << adaptiveBatch.getBatchSize() << ", forward solves = " << adaptiveBatch.getNumForwardSolves() << "\n");
+        }
+        {
+            PhaseTimer::Scope timerSmooth("smooth");
+            gradient->smooth(commAll, config);
+        }
+
+        if (encodedDataCache.isActive()) {
+            MemoryLedger::set(equationType + " " + std::to_string(equationInd) + " encodedData", encodedDataCache.getMemory());
+            HOST_PRINT(commAll, "\nEncoded data cache: " << encodedDataCache.getNumReads() << " supershots read, " << encodedDataCache.getNumHits() << " supershots taken from the cache (shot domain 0)\n");
+        }
+        if (sourceReceiverTaperCache.isActive()) {
+            MemoryLedger::set(equationType + " " + std::to_string(equationInd) + " sourceReceiverTapers", sourceReceiverTaperCache.getMemory());
+            HOST_PRINT(commAll, "\nSource receiver taper cache: " << sourceReceiverTaperCache.getNumReads() << " tapers calculated, " << sourceReceiverTaperCache.getNumHits() << " tapers taken from the cache (shot domain 0)\n");
+        }
+        if (modelPerShotCache.isActive()) {
+            MemoryLedger::set(equationType + " " + std::to_string(equationInd) + " modelPerShotCache", modelPerShotCache.getMemory());
+            HOST_PRINT(commAll, "\nModel per shot cache: " << modelPerShotCache.getNumMisses() << " models per shot prepared in " << modelPerShotCache.getPrepareTime() << " sec., " << modelPerShotCache.getNumHits() << " taken from the cache, saved about " << modelPerShotCache.getSavedTime() << " sec. (shot domain 0)\n");
+        }
+        if (forwardHistoryCache.isActive()) {
+            HOST_PRINT(commAll, "\nForward history of the step length search: " << forwardHistoryCache.getNumSaved() << " forward runs of " << shotDist->getLocalSize() << " shots saved (shot domain 0)\n");
+            forwardHistoryCache.clear();
+        }
+        if (timeWindow.isActive()) {
+            HOST_PRINT(commAll, "\nTime window: " << timeWindow.getNumSkippedForward() << " forward and " << timeWindow.getNumSkippedAdjoint() << " adjoint time steps of " << timeWindow.getNumTimeSteps() << " skipped (shot domain 0)\n");
+        }
+        if (wavefieldActivity.isActive()) {
+            HOST_PRINT(commAll, "\nWavefield activity: " << 100 * wavefieldActivity.getSkippedFractionCorrelation() << " % of the cross correlation and " << 100 * wavefieldActivity.getSkippedFraction() << " % of the stored forward and adjoint wavefields inactive (process 0)\n");
+        }
+        if (energyPrecond.isReuseActive()) {
+            MemoryLedger::set(equationType + " " + std::to_string(equationInd) + " approxHessians", energyPrecond.getMemory() + energyPrecondReflect.getMemory());
+            energyPrecond.writeToLogFile(commAll, workflow.workflowStage + 1, workflow.iteration);
+            HOST_PRINT(commAll, "\nEnergy preconditioning: " << energyPrecond.getNumCalculated() << " approximated Hessians calculated, " << energyPrecond.getNumReused() << " reused, staleness = " << energyPrecond.getStaleness() << " (shot domain 0)\n");
+        }
 
         HOST_PRINT(commAll, "\n======== Finished loop over shots " << equationType << " " << equationInd << " =========");
         HOST_PRINT(commAll, "\n=================================================\n");
@@ -1084,15 +1462,27 @@ void KITGPI::InversionSingle<ValueType>::calcGradient(scai::dmemo::CommunicatorP
         }
         
         // scale function in gradientOptimization must be the final operation for gradient.
-        gradientOptimization->apply(*gradient, workflow, *model, config);
+        {
+            PhaseTimer::Scope timerOptimization("optimization");
+            if (boundConstraint.isActive()) {
+                // the history of the optimization only sees the free cells, the second projection keeps the direction feasible
+                IndexType numActive = boundConstraint.project(*gradient, *model, workflow);
+                HOST_PRINT(commAll, "\nBound constraint: " << numActive << " cells on the bounds are not updated\n");
+            }
+            gradientOptimization->apply(*gradient, workflow, *model, config);
+            boundConstraint.project(*gradient, *model, workflow);
+        }
         
         /* Output of gradient */
         /* only shot domain 0 writes output */
-        if (config.get<IndexType>("writeGradient") > 0 && commInterShot->getRank() == 0) {
-            if (useRTM == 0) {
-                gradient->write(gradname + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1), config.get<IndexType>("FileFormat"), workflow);
-            } else {
-                gradient->write(gradname + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(maxiterations + 1), config.get<IndexType>("FileFormat"), workflow);
+        {
+            PhaseTimer::Scope timerOutput("output");
+            if (config.get<IndexType>("writeGradient") > 0 && commInterShot->getRank() == 0) {
+                if (useRTM == 0) {
+                    gradient->write(gradname + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1), config.get<IndexType>("FileFormat"), workflow);
+                } else {
+                    gradient->write(gradname + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(maxiterations + 1), config.get<IndexType>("FileFormat"), workflow);
+                }
             }
         }
         
@@ -1144,13 +1534,21 @@ template <typename ValueType>
 void KITGPI::InversionSingle<ValueType>::updateModel(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr dist, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &model, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfit, KITGPI::StepLengthSearch<ValueType> &SLsearch, IndexType &useRTM, bool &breakLoop, IndexType inversionType, IndexType equationInd)
 {         
     if (inversionType != 0 && (breakLoop == false || breakLoopType == 2 || useRTM != 0)) {
+        PhaseTimer::Scope timerInversion(isSeismic ? "seismic" : "EM");
+        PhaseTimer::Scope timerUpdateModel("updateModel");
         dmemo::CommunicatorPtr commShot = dist->getCommunicatorPtr();
         dmemo::CommunicatorPtr commInterShot = commAll->split(commShot->getRank());
         SCAI_DMEMO_TASK(commShot)
         
         HOST_PRINT(commAll, "\n================================================");
         HOST_PRINT(commAll, "\n========== Start step length search " << equationType << " " << equationInd << " ======\n");
-        if (config.getAndCatch("steplengthType", 2) == 1) {
+        ValueType steplengthScheduled = Optimization::Optimization<ValueType>::getScheduledSteplength(config, workflow.iteration);
+        if (steplengthScheduled > 0) {
+            /* a fixed step length schedule replaces the forward runs of the step length search */
+            HOST_PRINT(commAll, "Step length schedule: step length " << steplengthScheduled << ", no step length search\n");
+            SLsearch.setFixedSteplength(steplengthScheduled);
+            *gradient *= steplengthScheduled;
+        } else if (config.getAndCatch("steplengthType", 2) == 1) {
             std::vector<bool> invertForParameters = workflow.getInvertForParameters();
             SLsearch.init();
             for (unsigned i=0; i<invertForParameters.size()-1; i++) {
@@ -1159,17 +1557,33 @@ void KITGPI::InversionSingle<ValueType>::updateModel(scai::dmemo::CommunicatorPt
                     invertForParametersTemp[i] = invertForParameters[i];
                     gradient->setInvertForParameters(invertForParametersTemp);
                     
-                    SLsearch.run(commAll, *solver, *derivatives, sources, receivers, receiversTrue, *model, dist, config, modelCoordinates, *gradient, steplengthInit, *dataMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+                    SLsearch.run(commAll, *solver, *derivatives, sources, receivers, receiversTrue, *model, dist, config, modelCoordinates, *gradient, steplengthInit, *dataMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
 
                     *gradient *= SLsearch.getSteplength();
                 }
             }
             gradient->setInvertForParameters(invertForParameters);
-        } else if (config.getAndCatch("steplengthType", 2) == 0 || config.getAndCatch("steplengthType", 2) == 2) {                        
-            SLsearch.run(commAll, *solver, *derivatives, sources, receivers, receiversTrue, *model, dist, config, modelCoordinates, *gradient, steplengthInit, *dataMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+        } else if (config.getAndCatch("steplengthType", 2) == 3) {
+            /* the step lengths of all parameters are estimated together and applied to each parameter */
+            std::vector<bool> invertForParameters = workflow.getInvertForParameters();
+            SLsearch.init();
+            SLsearch.run(commAll, *solver, *derivatives, sources, receivers, receiversTrue, *model, dist, config, modelCoordinates, *gradient, steplengthInit, *dataMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
+            for (unsigned i=0; i<invertForParameters.size()-1; i++) {
+                if (invertForParameters[i]) {
+                    std::vector<bool> invertForParametersTemp(invertForParameters.size(), false);
+                    invertForParametersTemp[i] = invertForParameters[i];
+                    gradient->setInvertForParameters(invertForParametersTemp);
+                    *gradient *= SLsearch.getSteplength(i);
+                }
+            }
+            gradient->setInvertForParameters(invertForParameters);
+        } else if (config.getAndCatch("steplengthType", 2) == 0 || config.getAndCatch("steplengthType", 2) == 2) {                      
+            SLsearch.run(commAll, *solver, *derivatives, sources, receivers, receiversTrue, *model, dist, config, modelCoordinates, *gradient, steplengthInit, *dataMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
 
             *gradient *= SLsearch.getSteplength();
         }
+        if (SLsearch.getForwardHistoryCache().isActive())
+            MemoryLedger::set(equationType + " " + std::to_string(equationInd) + " forwardHistory", SLsearch.getForwardHistoryCache().getMemory());
         HOST_PRINT(commAll, "================= Update Model " << equationType << " " << equationInd << " ============\n\n");
         /* Apply model update */
         *model -= *gradient;
@@ -1195,9 +1609,12 @@ void KITGPI::InversionSingle<ValueType>::updateModel(scai::dmemo::CommunicatorPt
                     model->applyThresholds(config); 
             }                    
         }
-        if (commInterShot->getRank() == 0) {
-            /* only shot domain 0 writes output */
-            model->write((config.get<std::string>("ModelFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1)), config.get<IndexType>("FileFormat"));
+        {
+            PhaseTimer::Scope timerOutput("output");
+            if (commInterShot->getRank() == 0) {
+                /* only shot domain 0 writes output */
+                model->write((config.get<std::string>("ModelFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1)), config.get<IndexType>("FileFormat"));
+            }
         }
         
         steplengthInit *= 0.98; 
@@ -1242,6 +1659,8 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
     /* One extra forward modelling to ensure complete and consistent output */
     /* -------------------------------------------------------------------- */
     if (inversionType != 0 && (breakLoop == false || breakLoopType == 2 || useRTM != 0) && workflow.iteration == maxiterations - 1) {
+        PhaseTimer::Scope timerInversion(isSeismic ? "seismic" : "EM");
+        PhaseTimer::Scope timerExtraModelling("extraModelling");
         HOST_PRINT(commAll, "\n================ Maximum number of iterations reached " << equationType << " " << equationInd << " ================\n");
         HOST_PRINT(commAll, "== Do one more forward modelling to calculate misfit and save seismograms ==\n\n");
     
@@ -1257,10 +1676,20 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
             *modelPerShot = *model;
             modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot);
             solver->prepareForModelling(*modelPerShot, config.get<ValueType>("DT"));
+        } else {
+            modelPerShotCache.resetStatistics();
+            modelPerShotCache.update(*model, modelCoordinatesBig);
         }
                 
         std::vector<IndexType> uniqueShotInds = sources.getUniqueShotInds();
         std::vector<IndexType> shotIndsIncr = sources.getShotIndsIncr();
+        if (adaptiveBatch.isActive()) {
+            uniqueShotInds = adaptiveBatch.getShotInds();
+            shotIndsIncr = uniqueShotInds;
+        } else if (useRandomSource != 0 && gradientOptimization->isFullBatch(config, workflow)) {
+            uniqueShotInds = getAllShotInds();
+            shotIndsIncr = uniqueShotInds;
+        }
         Acquisition::writeRandomShotNosToFile(commAll, logFilename, uniqueShotNos, uniqueShotInds, workflow.workflowStage + 1, workflow.iteration + 1, useRandomSource);
         sources.writeSourceFC(commAll, config, workflow.workflowStage + 1, workflow.iteration + 1);
         sources.writeSourceEncode(commAll, config, workflow.workflowStage + 1, workflow.iteration + 1);
@@ -1289,8 +1718,7 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
                 if (useSourceEncode == 3) {
                     Acquisition::getuniqueShotInd(shotIndPerShot, sourceSettingsEncode, shotNumber);
                 }
-                model->getModelPerShot(*modelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinates.at(shotIndPerShot)); 
-                modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot); 
+                prepareModelPerShot(config, *model, dist, ctx, commShot, modelCoordinates, modelCoordinatesBig, shotIndPerShot);
                 solver->prepareForModelling(*modelPerShot, config.get<ValueType>("DT"));
             }
 
@@ -1307,7 +1735,7 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
             if (useSourceEncode == 0) {
                 receiversTrue.getSeismogramHandler().read(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("fieldSeisName") + ".shot_" + std::to_string(shotNumber), 1);
             } else {
-                receiversTrue.encode(config, config.get<std::string>("fieldSeisName"), shotNumber, sourceSettingsEncode, 1);
+                encodedDataCache.encode(receiversTrue, config, shotNumber, sourceSettingsEncode);
             }
 
             HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << shotDomain << ", index " << shotIndTrue + 1 << " of " << numshots << "): Additional forward run with " << tStepEnd << " time steps\n");
@@ -1475,6 +1903,9 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
         commInterShot->sumArray(misfitPerIt.getLocalValues());          
         dataMisfit->sumShotDomain(commInterShot);  
         dataMisfit->addToStorage(misfitPerIt);
+        if (modelPerShotCache.isActive()) {
+            HOST_PRINT(commAll, "\nModel per shot cache: " << modelPerShotCache.getNumMisses() << " models per shot prepared in " << modelPerShotCache.getPrepareTime() << " sec., " << modelPerShotCache.getNumHits() << " taken from the cache, saved about " << modelPerShotCache.getSavedTime() << " sec. (shot domain 0)\n");
+        }
 
         if (inversionType == 2 || config.getAndCatch("saveCrossGradientMisfit", 0)) {
             // joint inversion with cross gradient constraint
@@ -1518,5 +1949,174 @@ void KITGPI::InversionSingle<ValueType>::runExtraModelling(scai::dmemo::Communic
     } // end extra Seismic forward modelling
 }
 
+/*! \brief Write the state of the inversion which is carried over between iterations to a checkpoint
+ *
+ * The state consists of the model, the optimizer history, the misfit storage, the result of the last step length search, the estimated source time functions, the stored approximated Hessians of the energy preconditioning and the step length log file.
+ \param checkpoint Checkpoint
+ \param commAll CommunicatorPtr
+ \param model model
+ \param dataMisfit dataMisfit
+ \param SLsearch SLsearch
+ \param inversionType inversionType
+ */
+template <typename ValueType>
+void KITGPI::InversionSingle<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Misfit::Misfit<ValueType> const &dataMisfit, KITGPI::StepLengthSearch<ValueType> const &SLsearch, IndexType inversionType)
+{
+    checkpoint.write(inversionType);
+    if (inversionType == 0)
+        return;
+
+    checkpoint.write(equationType);
+    if (isSeismic) {
+        if (equationType.compare("sh") != 0 && equationType.compare("viscosh") != 0)
+            checkpoint.write(lama::DenseVector<ValueType>(model.getVelocityP()));
+        if (equationType.compare("acoustic") != 0)
+            checkpoint.write(lama::DenseVector<ValueType>(model.getVelocityS()));
+        checkpoint.write(lama::DenseVector<ValueType>(model.getDensity()));
+        if (equationType.compare("viscoelastic") == 0)
+            checkpoint.write(lama::DenseVector<ValueType>(model.getTauP()));
+        if (equationType.compare("viscoelastic") == 0 || equationType.compare("viscosh") == 0)
+            checkpoint.write(lama::DenseVector<ValueType>(model.getTauS()));
+    } else {
+        checkpoint.write(lama::DenseVector<ValueType>(model.getMagneticPermeability()));
+        checkpoint.write(lama::DenseVector<ValueType>(model.getElectricConductivity()));
+        checkpoint.write(lama::DenseVector<ValueType>(model.getDielectricPermittivity()));
+        if (equationType.compare("viscotmem") == 0 || equationType.compare("viscoemem") == 0) {
+            checkpoint.write(lama::DenseVector<ValueType>(model.getTauElectricConductivity()));
+            checkpoint.write(lama::DenseVector<ValueType>(model.getTauDielectricPermittivity()));
+        }
+    }
+    checkpoint.write(lama::DenseVector<ValueType>(model.getPorosity()));
+    checkpoint.write(lama::DenseVector<ValueType>(model.getSaturation()));
+    checkpoint.write(lama::DenseVector<ValueType>(model.getReflectivity()));
+
+    checkpoint.write(steplengthInit);
+    checkpoint.write(misfitType);
+    checkpoint.write(weightingStabilizingFunctionalGradient);
+    checkpoint.write(weightingCrossGradient);
+    checkpoint.write(shotHistory);
+    checkpoint.write(misfitTypeHistory);
+    checkpoint.write(misfitPerIt);
+    adaptiveBatch.writeCheckpoint(checkpoint, commAll);
+    energyPrecond.writeCheckpoint(checkpoint, commAll);
+    energyPrecondReflect.writeCheckpoint(checkpoint, commAll);
+
+    gradientOptimization->writeCheckpoint(checkpoint);
+    dataMisfit.writeCheckpoint(checkpoint);
+    SLsearch.writeCheckpoint(checkpoint);
+    sourceEst.writeCheckpoint(checkpoint);
+
+    // the log file is restored on resume, so it does not contain the iterations after the checkpoint twice
+    std::string logFileContent;
+    if (commAll->getRank() == MASTERGPI) {
+        std::ifstream logFile(logFilename);
+        std::stringstream logStream;
+        logStream << logFile.rdbuf();
+        logFileContent = logStream.str();
+    }
+    checkpoint.write(logFileContent);
+}
+
+/*! \brief Read the state of the inversion from a checkpoint
+ *
+ * The members have to be initialized (init and initStage) before, since the distributed vectors are read with their current distribution.
+ \param checkpoint Checkpoint
+ \param commAll CommunicatorPtr
+ \param model model
+ \param dataMisfit dataMisfit
+ \param SLsearch SLsearch
+ \param inversionType inversionType
+ */
+template <typename ValueType>
+void KITGPI::InversionSingle<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> &model, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::StepLengthSearch<ValueType> &SLsearch, IndexType inversionType)
+{
+    IndexType checkpointInversionType = 0;
+    checkpoint.read(checkpointInversionType);
+    SCAI_ASSERT_ERROR(checkpointInversionType == inversionType, "Checkpoint has been written with inversionType = " << checkpointInversionType);
+    if (inversionType == 0)
+        return;
+
+    std::string checkpointEquationType;
+    checkpoint.read(checkpointEquationType);
+    SCAI_ASSERT_ERROR(checkpointEquationType == equationType, "Checkpoint has been written with equationType = " << checkpointEquationType);
+
+    lama::DenseVector<ValueType> temp;
+    if (isSeismic) {
+        if (equationType.compare("sh") != 0 && equationType.compare("viscosh") != 0) {
+            temp = model.getVelocityP();
+            checkpoint.read(temp);
+            model.setVelocityP(temp);
+        }
+        if (equationType.compare("acoustic") != 0) {
+            temp = model.getVelocityS();
+            checkpoint.read(temp);
+            model.setVelocityS(temp);
+        }
+        temp = model.getDensity();
+        checkpoint.read(temp);
+        model.setDensity(temp);
+        if (equationType.compare("viscoelastic") == 0) {
+            temp = model.getTauP();
+            checkpoint.read(temp);
+            model.setTauP(temp);
+        }
+        if (equationType.compare("viscoelastic") == 0 || equationType.compare("viscosh") == 0) {
+            temp = model.getTauS();
+            checkpoint.read(temp);
+            model.setTauS(temp);
+        }
+    } else {
+        temp = model.getMagneticPermeability();
+        checkpoint.read(temp);
+        model.setMagneticPermeability(temp);
+        temp = model.getElectricConductivity();
+        checkpoint.read(temp);
+        model.setElectricConductivity(temp);
+        temp = model.getDielectricPermittivity();
+        checkpoint.read(temp);
+        model.setDielectricPermittivity(temp);
+        if (equationType.compare("viscotmem") == 0 || equationType.compare("viscoemem") == 0) {
+            temp = model.getTauElectricConductivity();
+            checkpoint.read(temp);
+            model.setTauElectricConductivity(temp);
+            temp = model.getTauDielectricPermittivity();
+            checkpoint.read(temp);
+            model.setTauDielectricPermittivity(temp);
+        }
+    }
+    temp = model.getPorosity();
+    checkpoint.read(temp);
+    model.setPorosity(temp);
+    temp = model.getSaturation();
+    checkpoint.read(temp);
+    model.setSaturation(temp);
+    temp = model.getReflectivity();
+    checkpoint.read(temp);
+    model.setReflectivity(temp);
+
+    checkpoint.read(steplengthInit);
+    checkpoint.read(misfitType);
+    checkpoint.read(weightingStabilizingFunctionalGradient);
+    checkpoint.read(weightingCrossGradient);
+    checkpoint.read(shotHistory);
+    checkpoint.read(misfitTypeHistory);
+    checkpoint.read(misfitPerIt);
+    adaptiveBatch.readCheckpoint(checkpoint, commAll);
+    energyPrecond.readCheckpoint(checkpoint, commAll, gradientPerShot->getPorosity().getDistributionPtr());
+    energyPrecondReflect.readCheckpoint(checkpoint, commAll, gradientPerShot->getPorosity().getDistributionPtr());
+
+    gradientOptimization->readCheckpoint(checkpoint);
+    dataMisfit.readCheckpoint(checkpoint);
+    SLsearch.readCheckpoint(checkpoint);
+    sourceEst.readCheckpoint(checkpoint);
+
+    std::string logFileContent;
+    checkpoint.read(logFileContent);
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream logFile(logFilename, std::ios::trunc);
+        logFile << logFileContent;
+    }
+}
+
 template class KITGPI::InversionSingle<double>;
 template class KITGPI::InversionSingle<float>;
@@ -4,7 +4,10 @@
 #include <scai/common/Walltime.hpp>
 #include <scai/dmemo/CommunicatorStack.hpp>
 
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -25,9 +28,22 @@
 #include <Modelparameter/ModelparameterFactory.hpp>
 #include <Wavefields/WavefieldsFactory.hpp>
 
+#include "../Common/AdaptiveBatch.hpp"
+#include "../Common/Checkpoint.hpp"
+#include "../Common/EncodedDataCache.hpp"
+#include "../Common/MemoryLedger.hpp"
+#include "../Common/ForwardHistoryCache.hpp"
+#include "../Common/ModelPerShotCache.hpp"
+#include "../Common/PhaseTimer.hpp"
+#include "../Common/TimeWindow.hpp"
+#include "../Common/SeismogramDecimation.hpp"
+#include "../Common/TraceCompaction.hpp"
+#include "../Common/WavefieldActivity.hpp"
+#include "../Common/WavefieldCompensation.hpp"
 #include "../Misfit/AbortCriterion.hpp"
 #include "../Misfit/Misfit.hpp"
 #include "../Misfit/MisfitFactory.hpp"
+#include "../Optimization/BoundConstraint.hpp"
 #include "../Optimization/OptimizationFactory.hpp"
 #include "../Preconditioning/EnergyPreconditioning.hpp"
 #include "../SourceEstimation/SourceEstimation.hpp"
@@ -63,9 +79,11 @@ namespace KITGPI
         
         void init(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, Acquisition::Coordinates<ValueType> &modelCoordinates, Acquisition::Coordinates<ValueType> &modelCoordinatesBig, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr &dist, scai::dmemo::DistributionPtr &distBig, IndexType maxiterations, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &model, KITGPI::Workflow::Workflow<ValueType> &workflow, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversion, KITGPI::StepLengthSearch<ValueType> &SLsearch);
         
+        void initVariant(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, scai::dmemo::DistributionPtr distBig, KITGPI::Modelparameter::Modelparameter<ValueType> &model, KITGPI::Workflow::Workflow<ValueType> &workflow, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, KITGPI::StepLengthSearch<ValueType> &SLsearch);
+        
         void estimateMemory(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, scai::dmemo::DistributionPtr dist, Acquisition::Coordinates<ValueType> modelCoordinates, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model);
         
-        void initStage(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, scai::hmemo::ContextPtr ctx, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr dataMisfit, bool breakLoop, scai::dmemo::DistributionPtr dist, bool &breakLoopEM);
+        void initStage(scai::dmemo::CommunicatorPtr commAll, KITGPI::Configuration::Configuration config, IndexType inversionType, IndexType equationInd, scai::hmemo::ContextPtr ctx, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr dataMisfit, bool breakLoop, scai::dmemo::DistributionPtr dist, bool &breakLoopEM, KITGPI::Modelparameter::Modelparameter<ValueType> const &model);
         
         void calcGradient(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr dist, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &model, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfit, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversion, KITGPI::StepLengthSearch<ValueType> &SLsearch, Taper::Taper2D<ValueType> modelTaper2DJoint, IndexType maxiterations, IndexType &useRTM, bool &breakLoop, scai::hmemo::ContextPtr ctx, IndexType &seedtime, IndexType inversionType, IndexType equationInd, bool &breakLoopEM, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &modelEM, KITGPI::Configuration::Configuration configEM, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesEM, KITGPI::Workflow::Workflow<ValueType> &workflowEM, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfitEM, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivativeEM, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversionEM);
         
@@ -73,7 +91,13 @@ namespace KITGPI
         
         void runExtraModelling(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr dist, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &model, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, KITGPI::Workflow::Workflow<ValueType> &workflow, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfit, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivative, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversion, KITGPI::StepLengthSearch<ValueType> &SLsearch, Taper::Taper2D<ValueType> modelTaper2DJoint, IndexType maxiterations, IndexType &useRTM, bool &breakLoop, scai::hmemo::ContextPtr ctx, IndexType &seedtime, IndexType inversionType, IndexType equationInd, bool &breakLoopEM, typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr &modelEM, KITGPI::Configuration::Configuration configEM, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesEM, KITGPI::Workflow::Workflow<ValueType> &workflowEM, typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr &dataMisfitEM, typename Gradient::Gradient<ValueType>::GradientPtr &crossGradientDerivativeEM, typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr &derivativesInversionEM);        
 
+        void writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Misfit::Misfit<ValueType> const &dataMisfit, KITGPI::StepLengthSearch<ValueType> const &SLsearch, IndexType inversionType);
+        
+        void readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> &model, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::StepLengthSearch<ValueType> &SLsearch, IndexType inversionType);
+
     private:
+        void prepareModelPerShot(KITGPI::Configuration::Configuration const &config, Modelparameter::Modelparameter<ValueType> &model, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, scai::dmemo::CommunicatorPtr commShot, Acquisition::Coordinates<ValueType> const &modelCoordinates, Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, IndexType shotIndPerShot);
+        std::vector<IndexType> getAllShotInds() const;
         
         double start_t, end_t, start_t_shot, end_t_shot; /* For timing */
         
@@ -95,8 +119,11 @@ namespace KITGPI
         IndexType numRelaxationMechanisms;
         IndexType useSourceEncode;
         IndexType gradientDomain;
+        bool useSourceSignalInversionSingleSolve;
         IndexType numShotDomains;
         ValueType memWavefiledsStorage = 0;
+        ValueType memWavefileds = 0;
+        ValueType memModel = 0;
         
         Acquisition::Receivers<ValueType> receivers; 
         ValueType NXPerShot;
@@ -104,6 +131,9 @@ namespace KITGPI
         
         IndexType shotDomain;
         dmemo::DistributionPtr distInversion = nullptr;
+        IndexType DHInversionStage = 1; // DHInversion of distInversion
+        std::map<IndexType, dmemo::DistributionPtr> distInversionStages; // distInversion of the DHInversion of the workflow stages
+        bool restrictAfterAccumulationStage = false; // distInversion is the modelling grid and the accumulated cross correlation is averaged
         
         typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr derivatives;
         typename ForwardSolver::ForwardSolver<ValueType>::ForwardSolverPtr solver;
@@ -127,12 +157,21 @@ namespace KITGPI
         IndexType numshots = 1;
         std::shared_ptr<const dmemo::BlockDistribution> shotDist;
         IndexType maxcount = 1;  
+        AdaptiveBatch<ValueType> adaptiveBatch;
           
         IndexType gradientKernel; 
         IndexType decomposition; 
         IndexType snapType;
         
         Acquisition::Receivers<ValueType> receiversTrue;
+        EncodedDataCache<ValueType> encodedDataCache;
+        Preconditioning::SourceReceiverTaperCache<ValueType> sourceReceiverTaperCache;
+        ModelPerShotCache<ValueType> modelPerShotCache;
+        TimeWindow<ValueType> timeWindow;
+        TraceCompaction<ValueType> traceCompaction;
+        SeismogramDecimation<ValueType> seismogramDecimation;
+        WavefieldActivity<ValueType> wavefieldActivity;
+        WavefieldCompensation<ValueType> wavefieldCompensation;
         Acquisition::Receivers<ValueType> receiversStart;
         Acquisition::Receivers<ValueType> adjointSources;
         Acquisition::Receivers<ValueType> sourcesReflect;
@@ -160,6 +199,7 @@ namespace KITGPI
         Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
         Preconditioning::EnergyPreconditioning<ValueType> energyPrecondReflect;
         typename Optimization::Optimization<ValueType>::OptimizationPtr gradientOptimization;
+        Optimization::BoundConstraint<ValueType> boundConstraint;
         
         std::vector<IndexType> shotHistory;
         std::vector<IndexType> misfitTypeHistory;
@@ -0,0 +1,201 @@
+#include "MemoryLedger.hpp"
+
+#include <Common/HostPrint.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace scai;
+
+std::vector<KITGPI::MemoryLedger::Entry> KITGPI::MemoryLedger::entries;
+double KITGPI::MemoryLedger::current = 0.0;
+double KITGPI::MemoryLedger::peak = 0.0;
+double KITGPI::MemoryLedger::predicted = 0.0;
+
+/*! \brief Register the current size of an allocation
+ *
+ * A size registered before under the same name is replaced.
+ \param name Name of the allocation
+ \param megaBytes Size on this process in MB
+ */
+void KITGPI::MemoryLedger::set(std::string const &name, double megaBytes)
+{
+    IndexType entryInd = findEntry(name);
+    if (entryInd < 0) {
+        Entry entry;
+        entry.name = name;
+        entry.size = 0.0;
+        entry.peak = 0.0;
+        entryInd = entries.size();
+        entries.push_back(entry);
+    }
+    current += megaBytes - entries[entryInd].size;
+    entries[entryInd].size = megaBytes;
+    entries[entryInd].peak = std::max(entries[entryInd].peak, megaBytes);
+    peak = std::max(peak, current);
+}
+
+/*! \brief Register that an allocation has been freed
+ \param name Name of the allocation
+ */
+void KITGPI::MemoryLedger::release(std::string const &name)
+{
+    if (findEntry(name) >= 0)
+        set(name, 0.0);
+}
+
+/*! \brief Set the peak values to the current values
+ */
+void KITGPI::MemoryLedger::resetPeak()
+{
+    for (auto &entry : entries)
+        entry.peak = entry.size;
+    peak = current;
+}
+
+/*! \brief Return the index of an entry or -1 if it does not exist
+ \param name Name of the allocation
+ */
+IndexType KITGPI::MemoryLedger::findEntry(std::string const &name)
+{
+    for (IndexType entryInd = 0; entryInd < IndexType(entries.size()); entryInd++) {
+        if (entries[entryInd].name == name)
+            return entryInd;
+    }
+    return -1;
+}
+
+/*! \brief Return the registered size of an allocation in MB
+ \param name Name of the allocation
+ */
+double KITGPI::MemoryLedger::getSize(std::string const &name)
+{
+    IndexType entryInd = findEntry(name);
+    return (entryInd < 0) ? 0.0 : entries[entryInd].size;
+}
+
+/*! \brief Return the sum of all registered sizes on this process in MB
+ */
+double KITGPI::MemoryLedger::getCurrent()
+{
+    return current;
+}
+
+/*! \brief Return the peak of the registered sum on this process in MB
+ */
+double KITGPI::MemoryLedger::getPeak()
+{
+    return peak;
+}
+
+/*! \brief Predict the sum of the registered sizes after some allocations have been replaced
+ \param newSizes Names and new sizes in MB of the allocations which will be (re)allocated
+ */
+double KITGPI::MemoryLedger::predict(std::vector<std::pair<std::string, double>> const &newSizes)
+{
+    double prediction = current;
+    for (auto const &newSize : newSizes)
+        prediction += newSize.second - getSize(newSize.first);
+    return prediction;
+}
+
+/*! \brief Read a value in kB from /proc/self/status and return it in MB or 0 if it is not available
+ \param key Key of the value, e.g. VmRSS
+ */
+double KITGPI::MemoryLedger::readProcStatus(std::string const &key)
+{
+    std::ifstream statusFile("/proc/self/status");
+    std::string line;
+    while (std::getline(statusFile, line)) {
+        if (line.compare(0, key.length() + 1, key + ":") == 0) {
+            std::istringstream values(line.substr(key.length() + 1));
+            double kiloBytes = 0.0;
+            values >> kiloBytes;
+            return kiloBytes / 1024;
+        }
+    }
+    return 0.0;
+}
+
+/*! \brief Return the memory currently allocated by LAMA in a context on this process in MB
+ *
+ * The difference before and after an allocation is the actual size of the allocation, independent of the reuse of freed memory by the heap.
+ \param ctx Context
+ */
+double KITGPI::MemoryLedger::getAllocated(hmemo::ContextPtr ctx)
+{
+    return double(ctx->getMemoryPtr()->allocatedBytes()) / (1024 * 1024);
+}
+
+/*! \brief Return the resident set size of this process in MB (0 if /proc is not available)
+ */
+double KITGPI::MemoryLedger::getResidentSetSize()
+{
+    return readProcStatus("VmRSS");
+}
+
+/*! \brief Return the peak resident set size of this process in MB (0 if /proc is not available)
+ */
+double KITGPI::MemoryLedger::getPeakResidentSetSize()
+{
+    return readProcStatus("VmHWM");
+}
+
+/*! \brief Abort if the predicted memory of any process exceeds the limit
+ \param commAll Communicator of all processes
+ \param title Name of the checked stage for the output
+ \param prediction Predicted peak on this process in MB
+ \param limit Memory limit per process in MB (0 = no limit)
+ */
+void KITGPI::MemoryLedger::checkLimit(dmemo::CommunicatorPtr commAll, std::string const &title, double prediction, double limit)
+{
+    double predictionMax = commAll->max(prediction);
+    predicted = std::max(predicted, prediction);
+    HOST_PRINT(commAll, "\nPredicted memory peak of " << title << ": " << predictionMax << " MB per process");
+    if (limit > 0) {
+        HOST_PRINT(commAll, " (limit " << limit << " MB)");
+    }
+    HOST_PRINT(commAll, "\n");
+    if (limit > 0 && predictionMax > limit) {
+        COMMON_THROWEXCEPTION("Predicted memory of " << title << " (" << predictionMax << " MB per process) exceeds memoryLimit = " << limit << " MB. Increase skipDT, DHInversion or the number of processes per shot domain.");
+    }
+}
+
+/*! \brief Print the breakdown of the registered memory and reset the peaks
+ *
+ * All values are the maximum over the processes.
+ \param commAll Communicator of all processes
+ \param title Title of the output, e.g. the workflow stage
+ */
+void KITGPI::MemoryLedger::print(dmemo::CommunicatorPtr commAll, std::string const &title)
+{
+    HOST_PRINT(commAll, "\n============== Memory Ledger " << title << ": ===============\n\n");
+    HOST_PRINT(commAll, " (current / peak per process)\n");
+    for (auto const &entry : entries) {
+        double sizeMax = commAll->max(entry.size);
+        double peakMax = commAll->max(entry.peak);
+        HOST_PRINT(commAll, " -  " << entry.name << " \t" << sizeMax << " / " << peakMax << " MB\n");
+    }
+    double currentMax = commAll->max(current);
+    double peakMax = commAll->max(peak);
+    double predictedMax = commAll->max(predicted);
+    double rssMax = commAll->max(getResidentSetSize());
+    double peakRssMax = commAll->max(getPeakResidentSetSize());
+    HOST_PRINT(commAll, "\n Ledger total: \t\t\t" << currentMax << " / " << peakMax << " MB\n");
+    if (predictedMax > 0) {
+        HOST_PRINT(commAll, " Predicted peak: \t\t" << predictedMax << " MB");
+        if (peakMax > 1.1 * predictedMax) {
+            HOST_PRINT(commAll, " (WARNING: ledger peak exceeds prediction by " << (peakMax / predictedMax - 1) * 100 << " %)");
+        }
+        HOST_PRINT(commAll, "\n");
+    }
+    HOST_PRINT(commAll, " Resident set size: \t\t" << rssMax << " / " << peakRssMax << " MB\n");
+    if (peakRssMax > 0 && peakMax > peakRssMax) {
+        HOST_PRINT(commAll, " WARNING: ledger peak exceeds the peak resident set size, the ledger overestimates the allocations\n");
+    }
+    HOST_PRINT(commAll, "\n===================================================\n");
+    resetPeak();
+    predicted = 0.0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/lama.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Ledger of the memory held by the major allocations of the inversion
+     *
+     * The owners of large allocations (wavefield storage, cross-correlation buffers, gradients, optimizer state, seismogram handlers) register their current size per process under a name.
+     * The wavefield storage and the cross-correlation buffers register the memory measured by getAllocated around their allocation, the caches their actual content; the other entries are the estimates of WAVE-Simulation.
+     * The ledger tracks the current and peak total per process, and together with the resident set size from /proc it is printed as a per-stage breakdown.
+     * Before a stage allocates its buffers, the stage peak can be predicted from the ledger and checked against a memory limit, so that the inversion aborts before the solve instead of running out of memory.
+     * All sizes are given in MB per process. All processes have to register the same names in the same order.
+     */
+    class MemoryLedger
+    {
+      public:
+        static void set(std::string const &name, double megaBytes);
+        static void release(std::string const &name);
+        static void resetPeak();
+
+        static double getSize(std::string const &name);
+        static double getCurrent();
+        static double getPeak();
+        static double predict(std::vector<std::pair<std::string, double>> const &newSizes);
+
+        static double getAllocated(scai::hmemo::ContextPtr ctx);
+        static double getResidentSetSize();
+        static double getPeakResidentSetSize();
+
+        static void checkLimit(scai::dmemo::CommunicatorPtr commAll, std::string const &title, double predicted, double limit);
+        static void print(scai::dmemo::CommunicatorPtr commAll, std::string const &title);
+
+      private:
+        struct Entry {
+            std::string name;
+            double size;
+            double peak;
+        };
+
+        static scai::IndexType findEntry(std::string const &name);
+        static double readProcStatus(std::string const &key);
+
+        static std::vector<Entry> entries;
+        static double current;
+        static double peak;
+        static double predicted; // largest prediction checked since the last print
+    };
+}
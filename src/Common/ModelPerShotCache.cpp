@@ -0,0 +1,314 @@
+#include "ModelPerShotCache.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace scai;
+
+/*! \brief Initialize the cache from the configuration
+ *
+ * The cache is only used with useStreamConfig = 1 and useModelPerShotCache = 1.
+ \param config Configuration
+ \param equationTypeIn Equation type (lower case)
+ */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::init(KITGPI::Configuration::Configuration const &config, std::string const &equationTypeIn)
+{
+    useCache = 0;
+    if (config.getAndCatch("useStreamConfig", false)) {
+        useCache = config.getAndCatch("useModelPerShotCache", 0);
+    }
+    equationType = equationTypeIn;
+    memoryLimit = config.getAndCatch("modelPerShotCacheMemory", 1024.0);
+    SCAI_ASSERT_ERROR(memoryLimit >= 0, "modelPerShotCacheMemory = " << memoryLimit);
+    clear();
+    resetStatistics();
+}
+
+/*! \brief Remove the shots whose cut-out has changed
+ *
+ * Has to be called with the current big model before the loop over the shots. The changed grid points of every parameter are combined in a bounding box per parameter,
+ * only the shots whose cut-out intersects one of these boxes are removed. Separate boxes keep the cut-outs between two local changes of different parameters.
+ \param model Big model
+ \param modelCoordinatesBig Coordinates of the big model
+ */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::update(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig)
+{
+    if (useCache == 0)
+        return;
+
+    std::vector<lama::DenseVector<ValueType>> parametersNew = getParameters(model, equationType);
+    if (parameters.size() != parametersNew.size()) {
+        // first call
+        clear();
+        parameters = parametersNew;
+        return;
+    }
+
+    std::vector<Box> changedBoxes;
+    for (std::size_t iParameter = 0; iParameter < parameters.size(); iParameter++) {
+        Box changedBox = calcChangedBox(parameters[iParameter], parametersNew[iParameter], modelCoordinatesBig);
+        if (!isEmpty(changedBox))
+            changedBoxes.push_back(changedBox);
+    }
+    if (changedBoxes.empty())
+        return;
+
+    modelVersion++;
+    for (auto entry = entries.begin(); entry != entries.end();) {
+        bool isChanged = false;
+        for (auto const &changedBox : changedBoxes)
+            isChanged = isChanged || intersects(changedBox, entry->second.cutCoordinate, *entry->second.modelCoordinates);
+        if (isChanged) {
+            entry = entries.erase(entry);
+        } else {
+            entry->second.version = modelVersion;
+            ++entry;
+        }
+    }
+    parameters = parametersNew;
+}
+
+/*! \brief Reset the numbers of hits and misses and the preparation time, e.g. at the beginning of an iteration */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::resetStatistics()
+{
+    numHits = 0;
+    numMisses = 0;
+    prepareTime = 0;
+}
+
+/*! \brief Return the prepared model of a shot of the current model version
+ \param shotInd Index of the shot
+ \return nullptr if the shot is not cached
+ */
+template <typename ValueType>
+typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr KITGPI::ModelPerShotCache<ValueType>::find(IndexType shotInd)
+{
+    auto entry = entries.find(shotInd);
+    if (useCache == 0 || entry == entries.end() || entry->second.version != modelVersion) {
+        numMisses++;
+        return nullptr;
+    }
+    numHits++;
+    entry->second.lastUse = ++useCount;
+    return entry->second.model;
+}
+
+/*! \brief Store the prepared model of a shot
+ *
+ * The least recently used shots are removed if the memory limit would be exceeded. The model must not be changed afterwards.
+ \param shotInd Index of the shot
+ \param modelPerShot Model per shot after prepareForModelling
+ \param cutCoordinate Origin of the cut-out in the big model
+ \param modelCoordinates Coordinates of the model per shot
+ \param prepareTimeShot Time of the cut-out and the preparation of the shot
+ */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::store(IndexType shotInd, typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShot, Acquisition::coordinate3D cutCoordinate, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, double prepareTimeShot)
+{
+    addPrepareTime(prepareTimeShot);
+    if (useCache == 0)
+        return;
+
+    if (memoryPerShot == 0) {
+        // the parameters and the prepared (averaged) parameters
+        double numValues = 0;
+        for (auto const &parameter : getParameters(*modelPerShot, equationType))
+            numValues += parameter.getLocalValues().size();
+        memoryPerShot = 2 * numValues * sizeof(ValueType) / (1024.0 * 1024.0);
+    }
+    if (memoryPerShot > memoryLimit)
+        return;
+    entries.erase(shotInd);
+    while (!entries.empty() && (entries.size() + 1) * memoryPerShot > memoryLimit) {
+        auto leastRecentlyUsed = std::min_element(entries.begin(), entries.end(), [](typename std::map<IndexType, Entry>::value_type const &entry1, typename std::map<IndexType, Entry>::value_type const &entry2) { return entry1.second.lastUse < entry2.second.lastUse; });
+        entries.erase(leastRecentlyUsed);
+    }
+    Entry &entry = entries[shotInd];
+    entry.model = modelPerShot;
+    entry.cutCoordinate = cutCoordinate;
+    entry.modelCoordinates = &modelCoordinates;
+    entry.version = modelVersion;
+    entry.lastUse = ++useCount;
+}
+
+/*! \brief Add the time of the cut-out and the preparation of a shot which has not been taken from the cache
+ \param prepareTimeShot Time in seconds
+ */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::addPrepareTime(double prepareTimeShot)
+{
+    prepareTime += prepareTimeShot;
+}
+
+/*! \brief Remove all shots from the cache */
+template <typename ValueType>
+void KITGPI::ModelPerShotCache<ValueType>::clear()
+{
+    entries.clear();
+    parameters.clear();
+    modelVersion = 0;
+}
+
+/*! \brief Return the bounding box of the grid points at which a parameter has changed
+ *
+ * The bounding box is reduced over the processes of the distribution.
+ \param parameterOld Parameter of the cached cut-outs
+ \param parameterNew Current parameter
+ \param modelCoordinatesBig Coordinates of the big model
+ */
+template <typename ValueType>
+typename KITGPI::ModelPerShotCache<ValueType>::Box KITGPI::ModelPerShotCache<ValueType>::calcChangedBox(scai::lama::DenseVector<ValueType> const &parameterOld, scai::lama::DenseVector<ValueType> const &parameterNew, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig)
+{
+    IndexType const maxIndex = std::numeric_limits<IndexType>::max();
+    IndexType first[3] = {maxIndex, maxIndex, maxIndex};
+    IndexType last[3] = {-1, -1, -1};
+
+    dmemo::DistributionPtr dist = parameterNew.getDistributionPtr();
+    hmemo::HArray<IndexType> ownedIndexes;
+    dist->getOwnedIndexes(ownedIndexes);
+    auto readOld = hmemo::hostReadAccess(parameterOld.getLocalValues());
+    auto readNew = hmemo::hostReadAccess(parameterNew.getLocalValues());
+    IndexType localIndex = 0;
+    for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+        if (readOld[localIndex] != readNew[localIndex]) {
+            Acquisition::coordinate3D coordinate = modelCoordinatesBig.index2coordinate(ownedIndex);
+            IndexType coordinates[3] = {coordinate.x, coordinate.y, coordinate.z};
+            for (IndexType i = 0; i < 3; i++) {
+                first[i] = std::min(first[i], coordinates[i]);
+                last[i] = std::max(last[i], coordinates[i]);
+            }
+        }
+        localIndex++;
+    }
+
+    dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    Box box;
+    box.first.x = comm->min(first[0]);
+    box.first.y = comm->min(first[1]);
+    box.first.z = comm->min(first[2]);
+    box.last.x = comm->max(last[0]);
+    box.last.y = comm->max(last[1]);
+    box.last.z = comm->max(last[2]);
+    return box;
+}
+
+/*! \brief Return the bounding box of two bounding boxes */
+template <typename ValueType>
+typename KITGPI::ModelPerShotCache<ValueType>::Box KITGPI::ModelPerShotCache<ValueType>::unite(Box const &box1, Box const &box2)
+{
+    if (isEmpty(box1))
+        return box2;
+    if (isEmpty(box2))
+        return box1;
+    Box box;
+    box.first.x = std::min(box1.first.x, box2.first.x);
+    box.first.y = std::min(box1.first.y, box2.first.y);
+    box.first.z = std::min(box1.first.z, box2.first.z);
+    box.last.x = std::max(box1.last.x, box2.last.x);
+    box.last.y = std::max(box1.last.y, box2.last.y);
+    box.last.z = std::max(box1.last.z, box2.last.z);
+    return box;
+}
+
+/*! \brief Return true if the bounding box contains no grid point */
+template <typename ValueType>
+bool KITGPI::ModelPerShotCache<ValueType>::isEmpty(Box const &box)
+{
+    return box.first.x > box.last.x;
+}
+
+/*! \brief Return true if the cut-out of a shot contains a grid point of the bounding box
+ \param box Bounding box in the big model
+ \param cutCoordinate Origin of the cut-out in the big model
+ \param modelCoordinates Coordinates of the model per shot
+ */
+template <typename ValueType>
+bool KITGPI::ModelPerShotCache<ValueType>::intersects(Box const &box, Acquisition::coordinate3D cutCoordinate, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates)
+{
+    if (isEmpty(box))
+        return false;
+    return box.first.x < cutCoordinate.x + modelCoordinates.getNX() && box.last.x >= cutCoordinate.x && box.first.y < cutCoordinate.y + modelCoordinates.getNY() && box.last.y >= cutCoordinate.y && box.first.z < cutCoordinate.z + modelCoordinates.getNZ() && box.last.z >= cutCoordinate.z;
+}
+
+/*! \brief Return the parameters of a model which are cut out for the shots (see Modelparameter::getModelPerShot)
+ *
+ * These are the parameters which enter the forward modelling of the equation type.
+ \param model Model
+ \param equationType Equation type (lower case)
+ */
+template <typename ValueType>
+std::vector<scai::lama::DenseVector<ValueType>> KITGPI::ModelPerShotCache<ValueType>::getParameters(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, std::string const &equationType)
+{
+    std::vector<lama::DenseVector<ValueType>> parametersModel;
+    if (equationType.compare("acoustic") == 0 || equationType.compare("elastic") == 0 || equationType.compare("viscoelastic") == 0 || equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0) {
+        if (equationType.compare("sh") != 0 && equationType.compare("viscosh") != 0)
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getVelocityP()));
+        if (equationType.compare("acoustic") != 0)
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getVelocityS()));
+        parametersModel.push_back(lama::DenseVector<ValueType>(model.getDensity()));
+        if (equationType.compare("viscoelastic") == 0)
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getTauP()));
+        if (equationType.compare("viscoelastic") == 0 || equationType.compare("viscosh") == 0)
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getTauS()));
+    } else {
+        parametersModel.push_back(lama::DenseVector<ValueType>(model.getMagneticPermeability()));
+        parametersModel.push_back(lama::DenseVector<ValueType>(model.getElectricConductivity()));
+        parametersModel.push_back(lama::DenseVector<ValueType>(model.getDielectricPermittivity()));
+        if (equationType.compare("viscotmem") == 0 || equationType.compare("viscoemem") == 0) {
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getTauElectricConductivity()));
+            parametersModel.push_back(lama::DenseVector<ValueType>(model.getTauDielectricPermittivity()));
+        }
+    }
+    return parametersModel;
+}
+
+/*! \brief Return true if the cache is used */
+template <typename ValueType>
+bool KITGPI::ModelPerShotCache<ValueType>::isActive() const
+{
+    return useCache != 0;
+}
+
+/*! \brief Return the number of shots which have been taken from the cache since the last reset */
+template <typename ValueType>
+IndexType KITGPI::ModelPerShotCache<ValueType>::getNumHits() const
+{
+    return numHits;
+}
+
+/*! \brief Return the number of shots which have been cut out and prepared since the last reset */
+template <typename ValueType>
+IndexType KITGPI::ModelPerShotCache<ValueType>::getNumMisses() const
+{
+    return numMisses;
+}
+
+/*! \brief Return the time of the cut-outs and preparations since the last reset in seconds */
+template <typename ValueType>
+double KITGPI::ModelPerShotCache<ValueType>::getPrepareTime() const
+{
+    return prepareTime;
+}
+
+/*! \brief Return the estimated time saved by the cache since the last reset in seconds, i.e. the mean preparation time times the number of hits */
+template <typename ValueType>
+double KITGPI::ModelPerShotCache<ValueType>::getSavedTime() const
+{
+    return numMisses > 0 ? numHits * prepareTime / numMisses : 0;
+}
+
+/*! \brief Return the memory of the cached models and of the copy of the big model on this process in MB */
+template <typename ValueType>
+double KITGPI::ModelPerShotCache<ValueType>::getMemory() const
+{
+    double numValues = 0;
+    for (auto const &parameter : parameters)
+        numValues += parameter.getLocalValues().size();
+    return entries.size() * memoryPerShot + numValues * sizeof(ValueType) / (1024.0 * 1024.0);
+}
+
+template class KITGPI::ModelPerShotCache<double>;
+template class KITGPI::ModelPerShotCache<float>;
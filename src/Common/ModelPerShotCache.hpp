@@ -0,0 +1,83 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <Acquisition/Acquisition.hpp>
+#include <Acquisition/Coordinates.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Modelparameter/Modelparameter.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Cache of the prepared models per shot of the stream configuration (useStreamConfig = 1)
+     *
+     * In the stream configuration, the model of every shot is cut out of the big model (Modelparameter::getModelPerShot) and prepared for the modelling (averaging, inverse density, ...) before every forward modelling.
+     * The cache keeps the prepared model per shot of the current model version. Before each loop over the shots, update compares the big model with the model of the cached cut-outs:
+     * only the shots whose cut-out contains a grid point of a parameter which has changed are removed, so a local model update or a repeated loop over the shots with the same model (e.g. the extra modelling and the first iteration of the next stage) reuses the other cut-outs.
+     * With a model update which changes every cut-out (e.g. a global gradient without taper), the cache only hits between the extra modelling of the last iteration (InversionSingle::runExtraModelling) and the next gradient calculation, which use the same model.
+     * The memory of the cached models is limited by modelPerShotCacheMemory (MB per process), the least recently used shot is removed first.
+     * The coefficients of the forward solver are owned by the solver and are still calculated for every shot.
+     */
+    template <typename ValueType>
+    class ModelPerShotCache
+    {
+      public:
+        //! \brief Bounding box of grid points of the big model [first, last], empty if first.x > last.x
+        struct Box {
+            Acquisition::coordinate3D first;
+            Acquisition::coordinate3D last;
+        };
+
+        ModelPerShotCache() : useCache(0), memoryLimit(0), modelVersion(0), useCount(0), memoryPerShot(0), numHits(0), numMisses(0), prepareTime(0){};
+        ~ModelPerShotCache(){};
+
+        void init(KITGPI::Configuration::Configuration const &config, std::string const &equationType);
+        void update(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig);
+        void resetStatistics();
+
+        typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr find(scai::IndexType shotInd);
+        void store(scai::IndexType shotInd, typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShot, Acquisition::coordinate3D cutCoordinate, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, double prepareTime);
+        void addPrepareTime(double prepareTime);
+        void clear();
+
+        static Box calcChangedBox(scai::lama::DenseVector<ValueType> const &parameterOld, scai::lama::DenseVector<ValueType> const &parameterNew, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesBig);
+        static Box unite(Box const &box1, Box const &box2);
+        static bool isEmpty(Box const &box);
+        static bool intersects(Box const &box, Acquisition::coordinate3D cutCoordinate, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates);
+        static std::vector<scai::lama::DenseVector<ValueType>> getParameters(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, std::string const &equationType);
+
+        bool isActive() const;
+        scai::IndexType getNumHits() const;
+        scai::IndexType getNumMisses() const;
+        double getPrepareTime() const;
+        double getSavedTime() const;
+        double getMemory() const;
+
+      private:
+        /*! \brief Prepared model of one shot */
+        struct Entry {
+            typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model; //!< Model per shot after prepareForModelling
+            Acquisition::coordinate3D cutCoordinate;                                            //!< Origin of the cut-out in the big model
+            KITGPI::Acquisition::Coordinates<ValueType> const *modelCoordinates;                //!< Grid of the model per shot
+            scai::IndexType version;                                                            //!< Model version the cut-out belongs to
+            scai::IndexType lastUse;                                                            //!< Counter of the last use for the eviction
+        };
+
+        scai::IndexType useCache;
+        std::string equationType;
+        double memoryLimit;
+        scai::IndexType modelVersion;
+        scai::IndexType useCount;
+        double memoryPerShot;
+        std::vector<scai::lama::DenseVector<ValueType>> parameters; // big model of the cached cut-outs
+        std::map<scai::IndexType, Entry> entries;
+
+        scai::IndexType numHits;
+        scai::IndexType numMisses;
+        double prepareTime;
+    };
+}
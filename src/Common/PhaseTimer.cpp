@@ -0,0 +1,236 @@
+#include "PhaseTimer.hpp"
+
+#include <Common/HostPrint.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <set>
+
+using namespace scai;
+
+bool KITGPI::PhaseTimer::enabled = false;
+std::vector<KITGPI::PhaseTimer::Phase> KITGPI::PhaseTimer::phases = {{"", "", -1, {}, 0.0, 0.0, 0}};
+IndexType KITGPI::PhaseTimer::current = 0;
+
+/*! \brief Enable or disable all timers
+ \param enable true to enable the timers
+ */
+void KITGPI::PhaseTimer::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+/*! \brief Return true if the timers are enabled
+ */
+bool KITGPI::PhaseTimer::isEnabled()
+{
+    return enabled;
+}
+
+/*! \brief Start a phase as child of the currently running phase
+ *
+ * Use this together with stop() only where a PhaseTimer::Scope does not fit into the block structure.
+ \param name Name of the phase
+ */
+void KITGPI::PhaseTimer::start(const char *name)
+{
+    if (!enabled)
+        return;
+    IndexType phaseInd = -1;
+    for (IndexType child : phases[current].children) {
+        // names are usually string literals, so comparing the pointers is mostly sufficient
+        if (phases[child].name == name || std::strcmp(phases[child].name, name) == 0) {
+            phaseInd = child;
+            break;
+        }
+    }
+    if (phaseInd < 0) {
+        Phase phase;
+        phase.name = name;
+        phase.path = (current == 0) ? std::string(name) : phases[current].path + "/" + name;
+        phase.parent = current;
+        phase.time = 0.0;
+        phase.startTime = 0.0;
+        phase.calls = 0;
+        phaseInd = phases.size();
+        phases.push_back(phase);
+        phases[current].children.push_back(phaseInd);
+    }
+    current = phaseInd;
+    phases[current].startTime = common::Walltime::get();
+}
+
+/*! \brief Stop the currently running phase
+ */
+void KITGPI::PhaseTimer::stop()
+{
+    if (!enabled)
+        return;
+    SCAI_ASSERT_ERROR(current != 0, "PhaseTimer::stop() without a running phase");
+    phases[current].time += common::Walltime::get() - phases[current].startTime;
+    phases[current].calls++;
+    current = phases[current].parent;
+}
+
+/*! \brief Reset the accumulated times and calls of all phases
+ *
+ * The phase tree is kept so that running phases are not affected.
+ */
+void KITGPI::PhaseTimer::reset()
+{
+    for (auto &phase : phases) {
+        phase.time = 0.0;
+        phase.calls = 0;
+    }
+}
+
+/*! \brief Return the index of a phase or -1 if it does not exist
+ \param path Full path of the phase
+ */
+IndexType KITGPI::PhaseTimer::findPhase(std::string const &path)
+{
+    for (IndexType phaseInd = 1; phaseInd < IndexType(phases.size()); phaseInd++) {
+        if (phases[phaseInd].path == path)
+            return phaseInd;
+    }
+    return -1;
+}
+
+/*! \brief Return the accumulated local time of a phase
+ \param name Full path of the phase
+ */
+double KITGPI::PhaseTimer::getTime(std::string const &name)
+{
+    IndexType phaseInd = findPhase(name);
+    return (phaseInd < 0) ? 0.0 : phases[phaseInd].time;
+}
+
+/*! \brief Return the local number of calls of a phase
+ \param name Full path of the phase
+ */
+IndexType KITGPI::PhaseTimer::getCalls(std::string const &name)
+{
+    IndexType phaseInd = findPhase(name);
+    return (phaseInd < 0) ? 0 : phases[phaseInd].calls;
+}
+
+/*! \brief Reduce the phase times over all processes and shot domains
+ *
+ * Processes may have seen different phases (e.g. line search trials only run on some shot domains), so the union of all phase names is collected on the master first.
+ \param commAll Communicator of all processes
+ \param commShot Communicator of the shot domain
+ \param commInterShot Communicator between the shot domains
+ */
+std::vector<KITGPI::PhaseTimer::PhaseStatistics> KITGPI::PhaseTimer::reduce(dmemo::CommunicatorPtr commAll, dmemo::CommunicatorPtr commShot, dmemo::CommunicatorPtr commInterShot)
+{
+    // collect the union of all phase paths on the master, phases are separated by newlines
+    std::vector<IndexType> localChars;
+    for (IndexType phaseInd = 1; phaseInd < IndexType(phases.size()); phaseInd++) {
+        localChars.insert(localChars.end(), phases[phaseInd].path.begin(), phases[phaseInd].path.end());
+        localChars.push_back('\n');
+    }
+    IndexType numLocalChars = localChars.size();
+    IndexType numProcesses = commAll->getSize();
+    std::vector<IndexType> numChars(numProcesses, 0);
+    commAll->gather(numChars.data(), 1, MASTERGPI, &numLocalChars);
+    IndexType numAllChars = 0;
+    for (IndexType numCharsProcess : numChars)
+        numAllChars += numCharsProcess;
+    std::vector<IndexType> allChars(std::max(numAllChars, IndexType(1)), 0);
+    localChars.push_back(0); // avoid empty arrays
+    commAll->gatherV(allChars.data(), numLocalChars, MASTERGPI, localChars.data(), numChars.data());
+
+    std::vector<IndexType> unionChars;
+    if (commAll->getRank() == MASTERGPI) {
+        // the order of the master is kept, phases only seen by other processes are appended
+        std::set<std::string> known;
+        std::string path;
+        for (IndexType i = 0; i < numAllChars; i++) {
+            if (allChars[i] == '\n') {
+                if (known.insert(path).second) {
+                    unionChars.insert(unionChars.end(), path.begin(), path.end());
+                    unionChars.push_back('\n');
+                }
+                path.clear();
+            } else {
+                path.push_back(char(allChars[i]));
+            }
+        }
+    }
+    IndexType numUnionChars = unionChars.size();
+    commAll->bcast(&numUnionChars, 1, MASTERGPI);
+    unionChars.resize(numUnionChars + 1, 0);
+    commAll->bcast(unionChars.data(), numUnionChars + 1, MASTERGPI);
+
+    std::vector<PhaseStatistics> statistics;
+    std::string path;
+    IndexType numShotDomains = commInterShot->getSize();
+    for (IndexType i = 0; i < numUnionChars; i++) {
+        if (unionChars[i] != '\n') {
+            path.push_back(char(unionChars[i]));
+            continue;
+        }
+        IndexType phaseInd = findPhase(path);
+        double time = (phaseInd < 0) ? 0.0 : phases[phaseInd].time;
+        IndexType calls = (phaseInd < 0) ? 0 : phases[phaseInd].calls;
+
+        PhaseStatistics phaseStatistics;
+        phaseStatistics.name = path;
+        phaseStatistics.calls = commAll->max(calls);
+        phaseStatistics.processMin = commAll->min(time);
+        phaseStatistics.processMax = commAll->max(time);
+        phaseStatistics.processMean = commAll->sum(time) / numProcesses;
+        // the processes of one shot domain work together, so the slowest one determines the time of the shot domain
+        double timeShotDomain = commShot->max(time);
+        phaseStatistics.shotDomainMin = commInterShot->min(timeShotDomain);
+        phaseStatistics.shotDomainMax = commInterShot->max(timeShotDomain);
+        phaseStatistics.shotDomainMean = commInterShot->sum(timeShotDomain) / numShotDomains;
+        statistics.push_back(phaseStatistics);
+        path.clear();
+    }
+    return statistics;
+}
+
+/*! \brief Write the reduced phase times of one iteration as JSON and reset the timers
+ *
+ * The report is written to filename.stage_<stage>.It_<iteration>.json by the master process. Each phase is written in one line.
+ \param commAll Communicator of all processes
+ \param commShot Communicator of the shot domain
+ \param commInterShot Communicator between the shot domains
+ \param filename Base name of the report
+ \param stage Workflow stage (starting with 1)
+ \param iteration Iteration (starting with 1)
+ */
+void KITGPI::PhaseTimer::writeReport(dmemo::CommunicatorPtr commAll, dmemo::CommunicatorPtr commShot, dmemo::CommunicatorPtr commInterShot, std::string const &filename, IndexType stage, IndexType iteration)
+{
+    if (!enabled)
+        return;
+
+    std::vector<PhaseStatistics> statistics = reduce(commAll, commShot, commInterShot);
+
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream outputFile(filename + ".stage_" + std::to_string(stage) + ".It_" + std::to_string(iteration) + ".json");
+        outputFile << std::scientific << std::setprecision(6);
+        outputFile << "{\n";
+        outputFile << "  \"stage\": " << stage << ",\n";
+        outputFile << "  \"iteration\": " << iteration << ",\n";
+        outputFile << "  \"numProcesses\": " << commAll->getSize() << ",\n";
+        outputFile << "  \"numShotDomains\": " << commInterShot->getSize() << ",\n";
+        outputFile << "  \"phases\": [\n";
+        for (unsigned i = 0; i < statistics.size(); i++) {
+            PhaseStatistics const &phase = statistics[i];
+            std::size_t pos = phase.name.find_last_of('/');
+            std::string parent = (pos == std::string::npos) ? "" : phase.name.substr(0, pos);
+            outputFile << "    {\"name\": \"" << phase.name << "\", \"parent\": \"" << parent << "\", \"calls\": " << phase.calls;
+            outputFile << ", \"process\": {\"min\": " << phase.processMin << ", \"mean\": " << phase.processMean << ", \"max\": " << phase.processMax << "}";
+            outputFile << ", \"shotDomain\": {\"min\": " << phase.shotDomainMin << ", \"mean\": " << phase.shotDomainMean << ", \"max\": " << phase.shotDomainMax << "}}";
+            outputFile << ((i + 1 < statistics.size()) ? ",\n" : "\n");
+        }
+        outputFile << "  ]\n";
+        outputFile << "}\n";
+        outputFile.close();
+    }
+    reset();
+}
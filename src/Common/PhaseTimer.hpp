@@ -0,0 +1,87 @@
+#pragma once
+
+#include <scai/common/Walltime.hpp>
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/lama.hpp>
+
+#include <string>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Hierarchical wall clock timers for the phases of an inversion iteration
+     *
+     * A phase is timed by a PhaseTimer::Scope which lives until the end of the enclosing block. Scopes opened inside other scopes become child phases, e.g. "seismic/calcGradient/shot/forward".
+     * Once per iteration the accumulated times are reduced to min/mean/max over all processes and over all shot domains and written as a JSON report.
+     * If the timers are disabled (default) a scope costs a single branch.
+     */
+    class PhaseTimer
+    {
+      public:
+        /*! \brief Times the phase name from construction to destruction
+         *
+         * The name has to be a string literal (or live at least as long as the scope).
+         */
+        class Scope
+        {
+          public:
+            explicit Scope(const char *name) : active(PhaseTimer::enabled)
+            {
+                if (active)
+                    PhaseTimer::start(name);
+            };
+            ~Scope()
+            {
+                if (active)
+                    PhaseTimer::stop();
+            };
+            Scope(Scope const &) = delete;
+            Scope &operator=(Scope const &) = delete;
+
+          private:
+            bool active;
+        };
+
+        /*! \brief Statistics of one phase as written to the report */
+        struct PhaseStatistics {
+            std::string name;           //!< full path of the phase
+            scai::IndexType calls;      //!< maximum number of calls on a process
+            double processMin;          //!< minimum time over all processes
+            double processMean;         //!< mean time over all processes
+            double processMax;          //!< maximum time over all processes
+            double shotDomainMin;       //!< minimum time over all shot domains (time of a shot domain = slowest process)
+            double shotDomainMean;      //!< mean time over all shot domains
+            double shotDomainMax;       //!< maximum time over all shot domains
+        };
+
+        static void setEnabled(bool enable);
+        static bool isEnabled();
+
+        static void start(const char *name);
+        static void stop();
+        static void reset();
+
+        static double getTime(std::string const &name);
+        static scai::IndexType getCalls(std::string const &name);
+
+        static std::vector<PhaseStatistics> reduce(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::CommunicatorPtr commShot, scai::dmemo::CommunicatorPtr commInterShot);
+        static void writeReport(scai::dmemo::CommunicatorPtr commAll, scai::dmemo::CommunicatorPtr commShot, scai::dmemo::CommunicatorPtr commInterShot, std::string const &filename, scai::IndexType stage, scai::IndexType iteration);
+
+      private:
+        struct Phase {
+            const char *name;
+            std::string path;
+            scai::IndexType parent;
+            std::vector<scai::IndexType> children;
+            double time;
+            double startTime;
+            scai::IndexType calls;
+        };
+
+        static scai::IndexType findPhase(std::string const &path);
+
+        static bool enabled;
+        static std::vector<Phase> phases; // phases[0] is the root which is never timed
+        static scai::IndexType current;
+    };
+}
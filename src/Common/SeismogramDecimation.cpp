@@ -0,0 +1,228 @@
+#include "SeismogramDecimation.hpp"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+using namespace scai;
+
+/*! \brief Initialize the decimation from the configuration
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useDecimation = config.getAndCatch("useSeismogramDecimation", 0);
+    oversampling = config.getAndCatch("decimationOversampling", ValueType(2));
+    SCAI_ASSERT_ERROR(oversampling >= 1, "decimationOversampling = " << oversampling << " must be >= 1");
+    DT = config.get<ValueType>("DT");
+    NT = static_cast<IndexType>((config.get<ValueType>("T") / DT) + 0.5);
+    factor = 1;
+}
+
+/*! \brief Set the decimation factor of a workflow stage
+ \param upperCornerFreq Upper corner frequency of the stage, 0 if the traces are not low-pass filtered
+ \return true if the decimation factor has changed
+ */
+template <typename ValueType>
+bool KITGPI::SeismogramDecimation<ValueType>::setStage(ValueType upperCornerFreq)
+{
+    IndexType lastFactor = factor;
+    factor = useDecimation == 0 ? 1 : calcFactor(DT, upperCornerFreq, oversampling, NT);
+    return factor != lastFactor;
+}
+
+/*! \brief Return true if the misfit and the adjoint sources of a misfit type can be calculated on decimated traces
+ *
+ * The convolved (L3) misfit uses reference traces, the FK (L4) misfit a transform for DT and the AGC (L6) misfit the inverse AGC, which are all sampled with DT.
+ * The adjoint sources of the normalized (L7) misfit are not scaled to the maximum of the observed data, so their amplitude depends on the number of samples.
+ \param misfitTypeNo Number of the misfit type, e.g. 2 for L2
+ */
+template <typename ValueType>
+bool KITGPI::SeismogramDecimation<ValueType>::isSupportedMisfitType(scai::IndexType misfitTypeNo)
+{
+    return misfitTypeNo != 3 && misfitTypeNo != 4 && misfitTypeNo != 6 && misfitTypeNo != 7;
+}
+
+/*! \brief Replace the traces of a seismogram by the decimated traces
+ \param seismogram Seismogram sampled with DT (in- and output)
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::decimate(KITGPI::Acquisition::Seismogram<ValueType> &seismogram) const
+{
+    lama::DenseMatrix<ValueType> dataDecimated;
+    decimateTraces(seismogram.getData(), dataDecimated, factor);
+    seismogram.getData() = dataDecimated;
+}
+
+/*! \brief Replace the traces of a decimated seismogram by the traces interpolated to DT
+ \param seismogram Decimated seismogram (in- and output)
+ \param nt Number of samples of the traces sampled with DT
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::interpolate(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType nt) const
+{
+    lama::DenseMatrix<ValueType> data;
+    interpolateTraces(seismogram.getData(), data, nt, factor);
+    seismogram.getData() = data;
+}
+
+/*! \brief Return the factor which scales the L2 norm based misfit of decimated traces to the misfit of the traces sampled with DT
+ *
+ * The misfits are normalized by the number of samples, the squared L2 norm of a band-limited trace is proportional to its number of samples.
+ \param nt Number of samples of the traces sampled with DT
+ */
+template <typename ValueType>
+ValueType KITGPI::SeismogramDecimation<ValueType>::getMisfitScale(scai::IndexType nt) const
+{
+    IndexType ntDecimated = (nt + factor - 1) / factor;
+    return std::sqrt(ValueType(factor)) * ntDecimated / nt;
+}
+
+/*! \brief Calculate the largest power of two decimation factor whose Nyquist frequency is at least oversampling times the upper corner frequency
+ \param DT Sample interval of the traces
+ \param upperCornerFreq Upper corner frequency, no decimation if it is 0
+ \param oversampling Ratio of the Nyquist frequency of the decimated traces to the upper corner frequency
+ \param nt Number of samples of the traces, the decimated traces keep at least four samples of the FFT length
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::SeismogramDecimation<ValueType>::calcFactor(ValueType DT, ValueType upperCornerFreq, ValueType oversampling, scai::IndexType nt)
+{
+    IndexType factorMax = calcNFFT(nt) / 4;
+    IndexType decimationFactor = 1;
+    if (upperCornerFreq <= 0)
+        return decimationFactor;
+    while (2 * decimationFactor <= factorMax && 0.5 / (2 * decimationFactor * DT) >= oversampling * upperCornerFreq) {
+        decimationFactor *= 2;
+    }
+    return decimationFactor;
+}
+
+/*! \brief Return the FFT length of a trace, the trace is padded with at least nt zeros against the wrap-around of the taper
+ \param nt Number of samples of a trace
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::SeismogramDecimation<ValueType>::calcNFFT(scai::IndexType nt)
+{
+    IndexType nFFT = 2;
+    while (nFFT < 2 * nt) {
+        nFFT *= 2;
+    }
+    return nFFT;
+}
+
+/*! \brief Low-pass filter and decimate traces
+ \param data Traces x nt samples
+ \param dataDecimated Traces x ceil(nt / factor) samples (output)
+ \param factor Decimation factor, a power of two
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::decimateTraces(scai::lama::DenseMatrix<ValueType> const &data, scai::lama::DenseMatrix<ValueType> &dataDecimated, scai::IndexType factor)
+{
+    SCAI_ASSERT_ERROR(factor >= 1 && (factor & (factor - 1)) == 0, "decimation factor " << factor << " must be a power of two");
+    IndexType nt = data.getNumColumns();
+    if (factor == 1) {
+        dataDecimated = data;
+        return;
+    }
+    IndexType nFFT = calcNFFT(nt);
+    IndexType nFFTDecimated = nFFT / factor;
+    SCAI_ASSERT_ERROR(nFFTDecimated >= 4, "decimation factor " << factor << " is too large for " << nt << " samples");
+
+    TraceFFT<ValueType> traceFFT;
+    TraceFFT<ValueType> traceFFTDecimated;
+    traceFFT.init(nt, nFFT);
+    traceFFTDecimated.init((nt + factor - 1) / factor, nFFTDecimated);
+
+    lama::DenseMatrix<ComplexValueType> spectra;
+    lama::DenseMatrix<ComplexValueType> spectraDecimated;
+    traceFFT.forward(data, spectra);
+    // the inverse transform of the shorter trace is scaled by factor / nFFT
+    copySpectra(spectra, spectraDecimated, nFFTDecimated / 2 + 1, nFFTDecimated / 2 + 1, ValueType(1) / factor);
+    traceFFTDecimated.inverse(spectraDecimated, dataDecimated);
+}
+
+/*! \brief Interpolate decimated traces by zero-padding of their spectra
+ \param dataDecimated Traces x ceil(nt / factor) samples
+ \param data Traces x nt samples (output)
+ \param nt Number of samples of the interpolated traces
+ \param factor Decimation factor, a power of two
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::interpolateTraces(scai::lama::DenseMatrix<ValueType> const &dataDecimated, scai::lama::DenseMatrix<ValueType> &data, scai::IndexType nt, scai::IndexType factor)
+{
+    SCAI_ASSERT_ERROR(factor >= 1 && (factor & (factor - 1)) == 0, "decimation factor " << factor << " must be a power of two");
+    SCAI_ASSERT_ERROR(dataDecimated.getNumColumns() == (nt + factor - 1) / factor, "number of samples " << dataDecimated.getNumColumns() << " does not match nt = " << nt << " and factor = " << factor);
+    if (factor == 1) {
+        data = dataDecimated;
+        return;
+    }
+    IndexType nFFT = calcNFFT(nt);
+    IndexType nFFTDecimated = nFFT / factor;
+    SCAI_ASSERT_ERROR(nFFTDecimated >= 4, "decimation factor " << factor << " is too large for " << nt << " samples");
+
+    TraceFFT<ValueType> traceFFT;
+    TraceFFT<ValueType> traceFFTDecimated;
+    traceFFT.init(nt, nFFT);
+    traceFFTDecimated.init(dataDecimated.getNumColumns(), nFFTDecimated);
+
+    lama::DenseMatrix<ComplexValueType> spectraDecimated;
+    lama::DenseMatrix<ComplexValueType> spectra;
+    traceFFTDecimated.forward(dataDecimated, spectraDecimated);
+    copySpectra(spectraDecimated, spectra, nFFT / 2 + 1, nFFTDecimated / 2 + 1, ValueType(factor));
+    traceFFT.inverse(spectra, data);
+}
+
+/*! \brief Copy the frequencies up to the Nyquist frequency of the decimated traces, tapered with a cosine over their upper quarter, the other frequencies are zero
+ \param spectraIn Input spectra
+ \param spectraOut Output spectra (output)
+ \param numFrequenciesOut Number of frequencies of the output spectra
+ \param numFrequenciesDecimated Number of frequencies of the decimated traces
+ \param scale Scaling of the spectra
+ */
+template <typename ValueType>
+void KITGPI::SeismogramDecimation<ValueType>::copySpectra(scai::lama::DenseMatrix<ComplexValueType> const &spectraIn, scai::lama::DenseMatrix<ComplexValueType> &spectraOut, scai::IndexType numFrequenciesOut, scai::IndexType numFrequenciesDecimated, ValueType scale)
+{
+    IndexType numFrequenciesIn = spectraIn.getNumColumns();
+    IndexType kNyquist = numFrequenciesDecimated - 1;
+    IndexType kTaper = (3 * kNyquist) / 4;
+    std::vector<ValueType> taper(numFrequenciesDecimated, scale);
+    for (IndexType k = kTaper; k <= kNyquist; k++) {
+        taper[k] = scale * 0.5 * (1 + std::cos(M_PI * (k - kTaper) / (kNyquist - kTaper)));
+    }
+
+    spectraOut.allocate(spectraIn.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(numFrequenciesOut));
+    IndexType numLocalTraces = spectraIn.getLocalStorage().getNumRows();
+    auto readIn = hmemo::hostReadAccess(spectraIn.getLocalStorage().getValues());
+    auto writeOut = hmemo::hostWriteAccess(spectraOut.getLocalStorage().getValues());
+    for (IndexType iTrace = 0; iTrace < numLocalTraces; iTrace++) {
+        ComplexValueType const *in = readIn.get() + iTrace * numFrequenciesIn;
+        ComplexValueType *out = writeOut.get() + iTrace * numFrequenciesOut;
+        for (IndexType k = 0; k < numFrequenciesOut; k++) {
+            out[k] = k < numFrequenciesDecimated ? ComplexValueType(in[k].real() * taper[k], in[k].imag() * taper[k]) : ComplexValueType(0, 0);
+        }
+    }
+}
+
+/*! \brief Return true if the traces of the current workflow stage are decimated */
+template <typename ValueType>
+bool KITGPI::SeismogramDecimation<ValueType>::isActive() const
+{
+    return factor > 1;
+}
+
+/*! \brief Return the decimation factor of the current workflow stage */
+template <typename ValueType>
+scai::IndexType KITGPI::SeismogramDecimation<ValueType>::getFactor() const
+{
+    return factor;
+}
+
+/*! \brief Return the sample interval of the decimated traces */
+template <typename ValueType>
+ValueType KITGPI::SeismogramDecimation<ValueType>::getDT() const
+{
+    return DT * factor;
+}
+
+template class KITGPI::SeismogramDecimation<double>;
+template class KITGPI::SeismogramDecimation<float>;
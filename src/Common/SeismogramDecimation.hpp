@@ -0,0 +1,57 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/all.hpp>
+
+#include <Acquisition/Seismogram.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include "TraceFFT.hpp"
+
+namespace KITGPI
+{
+    /*! \brief Anti-aliased decimation of the seismograms to the bandwidth of a workflow stage (useSeismogramDecimation = 1)
+     *
+     * The traces of the early workflow stages only contain frequencies up to the upper corner frequency of the stage, but they are sampled with DT.
+     * The misfit and the adjoint sources are calculated on traces which are decimated by a power of two factor, so that the Nyquist frequency of the decimated traces is
+     * at least decimationOversampling times the upper corner frequency. The traces are decimated in the frequency domain: the spectrum of the zero-padded trace is cut at the
+     * new Nyquist frequency with a cosine taper over its upper quarter (anti-alias filter) and transformed back with fewer samples.
+     * The adjoint sources are interpolated to DT in the same way by zero-padding their spectrum, so a band-limited trace is recovered by decimation and interpolation.
+     * The misfit is scaled to the misfit of the traces sampled with DT and the interpolated adjoint sources are scaled to the maximum of the observed data sampled with DT, like the adjoint sources of the supported misfit types.
+     */
+    template <typename ValueType>
+    class SeismogramDecimation
+    {
+      public:
+        SeismogramDecimation() : useDecimation(0), oversampling(2), DT(0), NT(0), factor(1){};
+        ~SeismogramDecimation(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        bool setStage(ValueType upperCornerFreq);
+        static bool isSupportedMisfitType(scai::IndexType misfitTypeNo);
+
+        void decimate(KITGPI::Acquisition::Seismogram<ValueType> &seismogram) const;
+        void interpolate(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType nt) const;
+        ValueType getMisfitScale(scai::IndexType nt) const;
+
+        static scai::IndexType calcFactor(ValueType DT, ValueType upperCornerFreq, ValueType oversampling, scai::IndexType nt);
+        static scai::IndexType calcNFFT(scai::IndexType nt);
+        static void decimateTraces(scai::lama::DenseMatrix<ValueType> const &data, scai::lama::DenseMatrix<ValueType> &dataDecimated, scai::IndexType factor);
+        static void interpolateTraces(scai::lama::DenseMatrix<ValueType> const &dataDecimated, scai::lama::DenseMatrix<ValueType> &data, scai::IndexType nt, scai::IndexType factor);
+
+        bool isActive() const;
+        scai::IndexType getFactor() const;
+        ValueType getDT() const;
+
+      private:
+        typedef typename TraceFFT<ValueType>::ComplexValueType ComplexValueType;
+
+        static void copySpectra(scai::lama::DenseMatrix<ComplexValueType> const &spectraIn, scai::lama::DenseMatrix<ComplexValueType> &spectraOut, scai::IndexType numFrequenciesOut, scai::IndexType numFrequenciesDecimated, ValueType scale);
+
+        scai::IndexType useDecimation;
+        ValueType oversampling; // ratio of the Nyquist frequency of the decimated traces to the upper corner frequency
+        ValueType DT;
+        scai::IndexType NT;
+        scai::IndexType factor; // decimation factor of the current workflow stage
+    };
+}
@@ -0,0 +1,181 @@
+#include "TimeWindow.hpp"
+
+#include <algorithm>
+
+using namespace scai;
+
+/*! \brief Initialize the time window from the configuration
+ *
+ * The time window is used with useTimeWindowTruncation = 1. The forward modelling is only truncated if the gradient only depends on the tapered synthetic data and on the forward wavefields of the time samples the adjoint wavefield is not zero:
+ * an L2 misfit on seismograms with a seismogram taper, no source encoding, no frequency domain gradient, no reflection kernel or decomposition and no energy preconditioning with the forward wavefield.
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::TimeWindow<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useTimeWindow = config.getAndCatch("useTimeWindowTruncation", 0);
+    truncateForward = false;
+    if (useTimeWindow != 0) {
+        std::string misfitType = config.get<std::string>("misfitType");
+        std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
+        IndexType gradientKernel = config.getAndCatch("gradientKernel", 0);
+        IndexType useEnergyPreconditioning = config.get<IndexType>("useEnergyPreconditioning");
+        truncateForward = config.get<IndexType>("useSeismogramTaper") > 1 && misfitType.compare("l2") == 0 && config.getAndCatch("useSourceEncode", 0) == 0 && config.getAndCatch("gradientDomain", 0) == 0 && (gradientKernel == 0 || gradientKernel == 1) && config.getAndCatch("decomposition", 0) == 0 && (useEnergyPreconditioning == 0 || useEnergyPreconditioning == 3);
+    }
+    resetStatistics();
+}
+
+/*! \brief Reset the numbers of skipped time steps, e.g. at the beginning of an iteration */
+template <typename ValueType>
+void KITGPI::TimeWindow<ValueType>::resetStatistics()
+{
+    numTimeSteps = 0;
+    numSkippedForward = 0;
+    numSkippedAdjoint = 0;
+}
+
+/*! \brief Calculate the number of time steps of the forward modelling of a shot
+ \param seismogramTaper2D Seismogram taper of the shot
+ \param tStepEnd Number of time steps
+ \param isExact false if the synthetic data is used before the seismogram taper is applied, e.g. to estimate the source signal
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcForwardEnd(KITGPI::Taper::Taper2D<ValueType> const &seismogramTaper2D, IndexType tStepEnd_in, bool isExact)
+{
+    tStepEnd = tStepEnd_in;
+    tStepForwardEnd = tStepEnd;
+    tStepAdjointStart = tStepEnd - 1;
+    if (truncateForward && isExact) {
+        tStepForwardEnd = calcForwardEnd(calcLastNonZeroSample(seismogramTaper2D.getData()), tStepEnd);
+    }
+    numTimeSteps += tStepEnd;
+    numSkippedForward += tStepEnd - tStepForwardEnd;
+    return tStepForwardEnd;
+}
+
+/*! \brief Calculate the first time step of the adjoint modelling of a shot
+ *
+ * Has to be called after calcForwardEnd of the same shot.
+ \param adjointSources Adjoint sources of the shot
+ \param tStepEnd_in Number of time steps
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcAdjointStart(KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, IndexType tStepEnd_in)
+{
+    tStepAdjointStart = tStepEnd_in - 1;
+    if (useTimeWindow != 0) {
+        tStepAdjointStart = calcAdjointStart(calcLastNonZeroSample(adjointSources.getSeismogramHandler()), tStepEnd_in);
+        // the adjoint wavefield must not be correlated with forward wavefields which have not been calculated
+        SCAI_ASSERT_ERROR(tStepForwardEnd == tStepEnd_in || tStepAdjointStart < tStepForwardEnd, "adjoint sources up to time step " << tStepAdjointStart << " but forward modelling up to time step " << tStepForwardEnd);
+        numSkippedAdjoint += tStepEnd_in - 1 - tStepAdjointStart;
+    }
+    return tStepAdjointStart;
+}
+
+/*! \brief Return the last time sample (column) which is not zero in any trace, the maximum over the processes of the row distribution
+ \param data Traces x time samples
+ \return -1 if all samples are zero
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcLastNonZeroSample(scai::lama::DenseMatrix<ValueType> const &data)
+{
+    IndexType lastSample = -1;
+    lama::DenseStorage<ValueType> const &localData = data.getLocalStorage();
+    IndexType numLocalRows = localData.getNumRows();
+    IndexType numColumns = localData.getNumColumns();
+    auto readData = hmemo::hostReadAccess(localData.getValues());
+    for (IndexType iRow = 0; iRow < numLocalRows; iRow++) {
+        for (IndexType iColumn = numColumns - 1; iColumn > lastSample; iColumn--) {
+            if (readData[iRow * numColumns + iColumn] != 0) {
+                lastSample = iColumn;
+                break;
+            }
+        }
+    }
+    return data.getRowDistributionPtr()->getCommunicatorPtr()->max(lastSample);
+}
+
+/*! \brief Return the last time sample which is not zero in any trace of all seismogram types
+ \param seismograms Seismogram handler
+ \return -1 if all samples are zero
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcLastNonZeroSample(KITGPI::Acquisition::SeismogramHandler<ValueType> const &seismograms)
+{
+    IndexType lastSample = -1;
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (seismograms.getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            lastSample = std::max(lastSample, calcLastNonZeroSample(seismograms.getSeismogram(Acquisition::SeismogramType(iComponent)).getData()));
+        }
+    }
+    return lastSample;
+}
+
+/*! \brief Return the number of forward time steps for the last sample of the seismogram taper which is not zero
+ *
+ * One time step more is modelled so that the forward wavefields cover the first adjoint time step (see calcAdjointStart).
+ \param lastSample Last sample of the seismogram taper which is not zero
+ \param tStepEnd Number of time steps
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcForwardEnd(IndexType lastSample, IndexType tStepEnd)
+{
+    return std::min(tStepEnd, std::max(lastSample + 2, IndexType(1)));
+}
+
+/*! \brief Return the first (i.e. latest) time step of the adjoint modelling for the last sample of the adjoint sources which is not zero
+ *
+ * The adjoint modelling runs backwards from this time step to time step 1. It starts one time step after the last sample to include the injection of the last sample in any case.
+ \param lastSample Last sample of the adjoint sources which is not zero
+ \param tStepEnd Number of time steps
+ */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::calcAdjointStart(IndexType lastSample, IndexType tStepEnd)
+{
+    return std::min(tStepEnd - 1, lastSample + 1);
+}
+
+/*! \brief Return true if the time window is used */
+template <typename ValueType>
+bool KITGPI::TimeWindow<ValueType>::isActive() const
+{
+    return useTimeWindow != 0;
+}
+
+/*! \brief Return the number of forward time steps skipped for the last shot */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::getNumSkippedForwardShot() const
+{
+    return tStepEnd - tStepForwardEnd;
+}
+
+/*! \brief Return the number of adjoint time steps skipped for the last shot */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::getNumSkippedAdjointShot() const
+{
+    return tStepEnd - 1 - tStepAdjointStart;
+}
+
+/*! \brief Return the number of time steps of all shots since the last reset */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::getNumTimeSteps() const
+{
+    return numTimeSteps;
+}
+
+/*! \brief Return the number of skipped forward time steps of all shots since the last reset */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::getNumSkippedForward() const
+{
+    return numSkippedForward;
+}
+
+/*! \brief Return the number of skipped adjoint time steps of all shots since the last reset */
+template <typename ValueType>
+IndexType KITGPI::TimeWindow<ValueType>::getNumSkippedAdjoint() const
+{
+    return numSkippedAdjoint;
+}
+
+template class KITGPI::TimeWindow<double>;
+template class KITGPI::TimeWindow<float>;
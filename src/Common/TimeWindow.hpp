@@ -0,0 +1,53 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <Acquisition/Receivers.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include "../Taper/Taper2D.hpp"
+
+namespace KITGPI
+{
+    /*! \brief Truncation of the forward and adjoint time stepping of a shot to the time window which contributes to the misfit
+     *
+     * The synthetic data of a shot is only used up to the last time sample of the seismogram taper (useSeismogramTaper > 1) which is not zero. If the gradient does not depend on the forward wavefields or the synthetic data after this sample in any other way, the forward modelling is stopped there.
+     * The adjoint wavefield is zero until the last time sample of the adjoint sources which is not zero, so the adjoint modelling starts there.
+     * Both truncations do not change the gradient.
+     */
+    template <typename ValueType>
+    class TimeWindow
+    {
+      public:
+        TimeWindow() : useTimeWindow(0), truncateForward(false), tStepEnd(0), tStepForwardEnd(0), tStepAdjointStart(0), numTimeSteps(0), numSkippedForward(0), numSkippedAdjoint(0){};
+        ~TimeWindow(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        void resetStatistics();
+
+        scai::IndexType calcForwardEnd(KITGPI::Taper::Taper2D<ValueType> const &seismogramTaper2D, scai::IndexType tStepEnd, bool isExact);
+        scai::IndexType calcAdjointStart(KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, scai::IndexType tStepEnd);
+
+        static scai::IndexType calcLastNonZeroSample(scai::lama::DenseMatrix<ValueType> const &data);
+        static scai::IndexType calcLastNonZeroSample(KITGPI::Acquisition::SeismogramHandler<ValueType> const &seismograms);
+        static scai::IndexType calcForwardEnd(scai::IndexType lastSample, scai::IndexType tStepEnd);
+        static scai::IndexType calcAdjointStart(scai::IndexType lastSample, scai::IndexType tStepEnd);
+
+        bool isActive() const;
+        scai::IndexType getNumSkippedForwardShot() const;
+        scai::IndexType getNumSkippedAdjointShot() const;
+        scai::IndexType getNumTimeSteps() const;
+        scai::IndexType getNumSkippedForward() const;
+        scai::IndexType getNumSkippedAdjoint() const;
+
+      private:
+        scai::IndexType useTimeWindow;
+        bool truncateForward;
+        scai::IndexType tStepEnd;
+        scai::IndexType tStepForwardEnd;
+        scai::IndexType tStepAdjointStart;
+        scai::IndexType numTimeSteps;
+        scai::IndexType numSkippedForward;
+        scai::IndexType numSkippedAdjoint;
+    };
+}
@@ -0,0 +1,249 @@
+#include "TraceCompaction.hpp"
+
+#include <algorithm>
+
+using namespace scai;
+
+/*! \brief Initialize the compaction from the configuration
+ *
+ * The compaction is only used with useTraceCompaction = 1 and a configuration which is supported (see isSupported).
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useCompaction = 0;
+    if (isSupported(config)) {
+        useCompaction = config.getAndCatch("useTraceCompaction", 0);
+    }
+    clear();
+}
+
+/*! \brief Return true if the traces of a shot can be compacted
+ *
+ * This is the case without source encoding, because the traces of a supershot are encoded and decoded in the layout of the seismogram handler.
+ \param config Configuration
+ */
+template <typename ValueType>
+bool KITGPI::TraceCompaction<ValueType>::isSupported(KITGPI::Configuration::Configuration const &config)
+{
+    return config.getAndCatch("useSourceEncode", 0) == 0;
+}
+
+/*! \brief Return true if the misfit and the adjoint sources of a misfit type only depend on each trace itself
+ *
+ * The convolved (L3) and FK (L4) misfits use neighbouring traces or the offsets and the AGC misfit (L6) uses the inverse AGC of all traces, so they are calculated on all traces.
+ \param misfitTypeNo Number of the misfit type, e.g. 2 for L2
+ */
+template <typename ValueType>
+bool KITGPI::TraceCompaction<ValueType>::isSupportedMisfitType(scai::IndexType misfitTypeNo)
+{
+    return misfitTypeNo != 3 && misfitTypeNo != 4 && misfitTypeNo != 6;
+}
+
+/*! \brief Build the index of the active traces of a shot if it does not exist
+ *
+ * Has to be called with the observed data after the offset mute. The index of all shots is discarded at a new workflow stage because the offset window depends on the stage.
+ \param receiversObs Receivers with the observed data
+ \param shotInd Index of the shot
+ \param currentWorkflowStage Current workflow stage
+ \return true if the index has been built
+ */
+template <typename ValueType>
+bool KITGPI::TraceCompaction<ValueType>::update(KITGPI::Acquisition::Receivers<ValueType> const &receiversObs, scai::IndexType shotInd, scai::IndexType currentWorkflowStage)
+{
+    if (useCompaction == 0)
+        return false;
+    if (currentWorkflowStage != workflowStage) {
+        clear();
+        workflowStage = currentWorkflowStage;
+    }
+    if (entries.count(shotInd) != 0)
+        return false;
+
+    Entry &entry = entries[shotInd];
+    entry.components.assign(Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE, Component());
+    entry.numActiveTraces = 0;
+    entry.numTraces = 0;
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receiversObs.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            lama::DenseMatrix<ValueType> const &data = receiversObs.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent)).getData();
+            Component &component = entry.components[iComponent];
+            component.activeRows = calcActiveRows(data);
+            component.fullDist = data.getRowDistributionPtr();
+            IndexType numActiveLocal = component.activeRows.size();
+            if (component.fullDist->isReplicated()) {
+                component.compactDist = std::make_shared<dmemo::NoDistribution>(numActiveLocal);
+            } else {
+                dmemo::CommunicatorPtr comm = component.fullDist->getCommunicatorPtr();
+                component.compactDist = dmemo::genBlockDistributionBySize(comm->sum(numActiveLocal), numActiveLocal, comm);
+            }
+            entry.numActiveTraces += component.compactDist->getGlobalSize();
+            entry.numTraces += data.getNumRows();
+        }
+    }
+    return true;
+}
+
+/*! \brief Discard the index of all shots */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::clear()
+{
+    entries.clear();
+    workflowStage = -1;
+}
+
+/*! \brief Return true if the index of a seismogram type of a shot exists and matches the layout of the data
+ \param shotInd Index of the shot
+ \param iComponent Seismogram type
+ \param data Traces x time samples in the layout of the seismogram handler
+ */
+template <typename ValueType>
+bool KITGPI::TraceCompaction<ValueType>::find(scai::IndexType shotInd, scai::IndexType iComponent, scai::lama::DenseMatrix<ValueType> const &data) const
+{
+    auto entry = entries.find(shotInd);
+    if (useCompaction == 0 || entry == entries.end())
+        return false;
+    Component const &component = entry->second.components.at(iComponent);
+    return component.fullDist != nullptr && data.getNumRows() == component.fullDist->getGlobalSize() && data.getRowDistribution().getLocalSize() == component.fullDist->getLocalSize() && data.getColDistribution().isReplicated();
+}
+
+/*! \brief Replace the data of a seismogram by its active traces
+ \param seismogram Seismogram in the layout of the seismogram handler (in- and output)
+ \param shotInd Index of the shot
+ \param iComponent Seismogram type
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::compact(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType shotInd, scai::IndexType iComponent) const
+{
+    SCAI_ASSERT_ERROR(find(shotInd, iComponent, seismogram.getData()), "No active traces of shot " << shotInd << " for the seismogram type " << iComponent);
+    Component const &component = entries.at(shotInd).components[iComponent];
+    lama::DenseMatrix<ValueType> dataCompact;
+    compactRows(seismogram.getData(), component.activeRows, component.compactDist, dataCompact);
+    seismogram.getData() = dataCompact;
+}
+
+/*! \brief Expand the data of a compacted seismogram to the layout of the seismogram handler, the inactive traces are zero
+ \param seismogram Compacted seismogram (in- and output)
+ \param shotInd Index of the shot
+ \param iComponent Seismogram type
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::expand(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType shotInd, scai::IndexType iComponent) const
+{
+    Component const &component = entries.at(shotInd).components.at(iComponent);
+    SCAI_ASSERT_ERROR(seismogram.getData().getNumRows() == component.compactDist->getGlobalSize(), "Seismogram of shot " << shotInd << " is not compacted");
+    lama::DenseMatrix<ValueType> data;
+    expandRows(seismogram.getData(), component.activeRows, component.fullDist, data);
+    seismogram.getData() = data;
+}
+
+/*! \brief Apply a frequency filter to the active traces of a shot, the inactive traces are set to zero
+ *
+ * All traces are filtered if the index of the shot does not exist yet or belongs to another workflow stage.
+ \param seismograms Seismogram handler (in- and output)
+ \param freqFilter Frequency filter
+ \param shotInd Index of the shot
+ \param currentWorkflowStage Current workflow stage
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::filter(KITGPI::Acquisition::SeismogramHandler<ValueType> &seismograms, KITGPI::Filter::Filter<ValueType> const &freqFilter, scai::IndexType shotInd, scai::IndexType currentWorkflowStage) const
+{
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (seismograms.getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            Acquisition::Seismogram<ValueType> &seismogram = seismograms.getSeismogram(Acquisition::SeismogramType(iComponent));
+            if (currentWorkflowStage == workflowStage && find(shotInd, iComponent, seismogram.getData())) {
+                compact(seismogram, shotInd, iComponent);
+                freqFilter.apply(seismogram.getData());
+                expand(seismogram, shotInd, iComponent);
+            } else {
+                seismogram.filter(freqFilter);
+            }
+        }
+    }
+}
+
+/*! \brief Return the local rows of the traces which are not zero
+ \param data Traces x time samples
+ */
+template <typename ValueType>
+std::vector<scai::IndexType> KITGPI::TraceCompaction<ValueType>::calcActiveRows(scai::lama::DenseMatrix<ValueType> const &data)
+{
+    SCAI_ASSERT_ERROR(data.getColDistribution().isReplicated(), "the time samples of the traces must not be distributed");
+    std::vector<IndexType> activeRows;
+    lama::DenseStorage<ValueType> const &localData = data.getLocalStorage();
+    IndexType numLocalRows = localData.getNumRows();
+    IndexType numColumns = localData.getNumColumns();
+    auto readData = hmemo::hostReadAccess(localData.getValues());
+    for (IndexType iRow = 0; iRow < numLocalRows; iRow++) {
+        ValueType const *trace = readData.get() + iRow * numColumns;
+        if (std::any_of(trace, trace + numColumns, [](ValueType sample) { return sample != 0; }))
+            activeRows.push_back(iRow);
+    }
+    return activeRows;
+}
+
+/*! \brief Copy the active traces into a compacted matrix, the traces stay on their process
+ \param data Traces x time samples
+ \param activeRows Local rows of the active traces
+ \param compactDist Row distribution of the compacted matrix, its local size is the number of local active traces
+ \param dataCompact Active traces x time samples (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::compactRows(scai::lama::DenseMatrix<ValueType> const &data, std::vector<scai::IndexType> const &activeRows, scai::dmemo::DistributionPtr compactDist, scai::lama::DenseMatrix<ValueType> &dataCompact)
+{
+    SCAI_ASSERT_ERROR(compactDist->getLocalSize() == IndexType(activeRows.size()), "distribution does not match the active traces");
+    IndexType numColumns = data.getNumColumns();
+    dataCompact.allocate(compactDist, std::make_shared<dmemo::NoDistribution>(numColumns));
+    auto readData = hmemo::hostReadAccess(data.getLocalStorage().getValues());
+    auto writeCompact = hmemo::hostWriteAccess(dataCompact.getLocalStorage().getValues());
+    for (std::size_t iActive = 0; iActive < activeRows.size(); iActive++) {
+        std::copy(readData.get() + activeRows[iActive] * numColumns, readData.get() + (activeRows[iActive] + 1) * numColumns, writeCompact.get() + iActive * numColumns);
+    }
+}
+
+/*! \brief Copy the traces of a compacted matrix back to their rows, all other traces are zero
+ \param dataCompact Active traces x time samples
+ \param activeRows Local rows of the active traces
+ \param fullDist Row distribution of all traces
+ \param data Traces x time samples (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceCompaction<ValueType>::expandRows(scai::lama::DenseMatrix<ValueType> const &dataCompact, std::vector<scai::IndexType> const &activeRows, scai::dmemo::DistributionPtr fullDist, scai::lama::DenseMatrix<ValueType> &data)
+{
+    SCAI_ASSERT_ERROR(dataCompact.getRowDistribution().getLocalSize() == IndexType(activeRows.size()), "compacted matrix does not match the active traces");
+    IndexType numColumns = dataCompact.getNumColumns();
+    data.allocate(fullDist, std::make_shared<dmemo::NoDistribution>(numColumns));
+    auto readCompact = hmemo::hostReadAccess(dataCompact.getLocalStorage().getValues());
+    auto writeData = hmemo::hostWriteAccess(data.getLocalStorage().getValues());
+    std::fill(writeData.get(), writeData.get() + fullDist->getLocalSize() * numColumns, ValueType(0));
+    for (std::size_t iActive = 0; iActive < activeRows.size(); iActive++) {
+        std::copy(readCompact.get() + iActive * numColumns, readCompact.get() + (iActive + 1) * numColumns, writeData.get() + activeRows[iActive] * numColumns);
+    }
+}
+
+/*! \brief Return true if the traces are compacted */
+template <typename ValueType>
+bool KITGPI::TraceCompaction<ValueType>::isActive() const
+{
+    return useCompaction != 0;
+}
+
+/*! \brief Return the number of active traces of all seismogram types of a shot, 0 if the index does not exist */
+template <typename ValueType>
+scai::IndexType KITGPI::TraceCompaction<ValueType>::getNumActiveTraces(scai::IndexType shotInd) const
+{
+    auto entry = entries.find(shotInd);
+    return entry == entries.end() ? 0 : entry->second.numActiveTraces;
+}
+
+/*! \brief Return the number of traces of all seismogram types of a shot, 0 if the index does not exist */
+template <typename ValueType>
+scai::IndexType KITGPI::TraceCompaction<ValueType>::getNumTraces(scai::IndexType shotInd) const
+{
+    auto entry = entries.find(shotInd);
+    return entry == entries.end() ? 0 : entry->second.numTraces;
+}
+
+template class KITGPI::TraceCompaction<double>;
+template class KITGPI::TraceCompaction<float>;
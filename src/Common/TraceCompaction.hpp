@@ -0,0 +1,70 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/all.hpp>
+
+#include <Acquisition/Acquisition.hpp>
+#include <Acquisition/Receivers.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Filter/Filter.hpp>
+
+#include <map>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Compaction of the active traces of a shot (useTraceCompaction = 1)
+     *
+     * The offset window of a workflow stage (see SourceEstimation::applyOffsetMute) and dead traces of field data set many traces of the observed data to zero.
+     * The active traces of a shot are the traces whose observed data is not zero after the offset mute, their index is built once per shot and workflow stage from the observed data.
+     * The misfit, the adjoint sources and the frequency filter of the observed data are calculated on a matrix which only contains the active traces,
+     * the adjoint sources are expanded to the layout of the seismogram handler for the injection. Inactive traces are treated as muted, i.e. dead traces of the observed data are excluded from the misfit.
+     * The rows of the compacted matrix stay on the process which owns the trace, so no communication is needed.
+     */
+    template <typename ValueType>
+    class TraceCompaction
+    {
+      public:
+        TraceCompaction() : useCompaction(0), workflowStage(-1){};
+        ~TraceCompaction(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        static bool isSupported(KITGPI::Configuration::Configuration const &config);
+        static bool isSupportedMisfitType(scai::IndexType misfitTypeNo);
+
+        bool update(KITGPI::Acquisition::Receivers<ValueType> const &receiversObs, scai::IndexType shotInd, scai::IndexType currentWorkflowStage);
+        void clear();
+
+        bool find(scai::IndexType shotInd, scai::IndexType iComponent, scai::lama::DenseMatrix<ValueType> const &data) const;
+        void compact(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType shotInd, scai::IndexType iComponent) const;
+        void expand(KITGPI::Acquisition::Seismogram<ValueType> &seismogram, scai::IndexType shotInd, scai::IndexType iComponent) const;
+        void filter(KITGPI::Acquisition::SeismogramHandler<ValueType> &seismograms, KITGPI::Filter::Filter<ValueType> const &freqFilter, scai::IndexType shotInd, scai::IndexType currentWorkflowStage) const;
+
+        static std::vector<scai::IndexType> calcActiveRows(scai::lama::DenseMatrix<ValueType> const &data);
+        static void compactRows(scai::lama::DenseMatrix<ValueType> const &data, std::vector<scai::IndexType> const &activeRows, scai::dmemo::DistributionPtr compactDist, scai::lama::DenseMatrix<ValueType> &dataCompact);
+        static void expandRows(scai::lama::DenseMatrix<ValueType> const &dataCompact, std::vector<scai::IndexType> const &activeRows, scai::dmemo::DistributionPtr fullDist, scai::lama::DenseMatrix<ValueType> &data);
+
+        bool isActive() const;
+        scai::IndexType getNumActiveTraces(scai::IndexType shotInd) const;
+        scai::IndexType getNumTraces(scai::IndexType shotInd) const;
+
+      private:
+        /*! \brief Active traces of one seismogram type */
+        struct Component {
+            std::vector<scai::IndexType> activeRows; //!< Local rows of the active traces
+            scai::dmemo::DistributionPtr fullDist;    //!< Row distribution of all traces
+            scai::dmemo::DistributionPtr compactDist; //!< Row distribution of the active traces
+        };
+
+        /*! \brief Active traces of one shot */
+        struct Entry {
+            std::vector<Component> components; //!< Active traces per seismogram type
+            scai::IndexType numActiveTraces;   //!< Number of active traces of all seismogram types
+            scai::IndexType numTraces;         //!< Number of traces of all seismogram types
+        };
+
+        scai::IndexType useCompaction;
+        scai::IndexType workflowStage; // workflow stage of the index
+        std::map<scai::IndexType, Entry> entries;
+    };
+}
@@ -0,0 +1,297 @@
+#include "TraceFFT.hpp"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+using namespace scai;
+
+/*! \brief Select the plan of a trace length and an FFT length
+ *
+ * The traces are padded with zeros to nFFT samples, samples beyond nFFT are not transformed.
+ \param nt Number of samples of a trace
+ \param nFFT Length of the zero-padded trace, a power of two >= 2
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::init(IndexType nt, IndexType nFFT)
+{
+    if (plan != nullptr && plan->nt == nt && plan->nFFT == nFFT)
+        return;
+    plan = getPlan(nt, nFFT);
+    work.resize(nFFT / 2);
+}
+
+/*! \brief Transform all traces of a seismogram
+ *
+ * The spectra have the row distribution of the traces and nFFT/2 + 1 columns (frequencies 0, ..., nFFT/2). The same scaling as lama::fft is used.
+ \param traces Traces x nt time samples
+ \param spectra Traces x nFFT/2 + 1 frequencies (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::forward(scai::lama::DenseMatrix<ValueType> const &traces, scai::lama::DenseMatrix<ComplexValueType> &spectra)
+{
+    SCAI_ASSERT_ERROR(plan != nullptr, "TraceFFT is not initialized");
+    SCAI_ASSERT_ERROR(traces.getNumColumns() == plan->nt, "number of samples " << traces.getNumColumns() << " != nt = " << plan->nt);
+    SCAI_ASSERT_ERROR(traces.getColDistribution().isReplicated(), "the time samples of the traces must not be distributed");
+
+    IndexType numFrequencies = getNumFrequencies();
+    if (spectra.getRowDistributionPtr() != traces.getRowDistributionPtr() || spectra.getNumColumns() != numFrequencies) {
+        spectra.allocate(traces.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(numFrequencies));
+    }
+
+    lama::DenseStorage<ValueType> const &localTraces = traces.getLocalStorage();
+    IndexType numLocalTraces = localTraces.getNumRows();
+    auto readTraces = hmemo::hostReadAccess(localTraces.getValues());
+    auto writeSpectra = hmemo::hostWriteAccess(spectra.getLocalStorage().getValues());
+    for (IndexType iTrace = 0; iTrace < numLocalTraces; iTrace++) {
+        forwardTrace(readTraces.get() + iTrace * plan->nt, writeSpectra.get() + iTrace * numFrequencies);
+    }
+}
+
+/*! \brief Transform a single replicated trace, e.g. a reference trace
+ \param trace Trace of nt samples
+ \param spectrum Spectrum of nFFT/2 + 1 frequencies (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::forward(scai::lama::DenseVector<ValueType> const &trace, scai::lama::DenseVector<ComplexValueType> &spectrum)
+{
+    SCAI_ASSERT_ERROR(plan != nullptr, "TraceFFT is not initialized");
+    SCAI_ASSERT_ERROR(trace.size() == plan->nt, "number of samples " << trace.size() << " != nt = " << plan->nt);
+    SCAI_ASSERT_ERROR(trace.getDistribution().isReplicated(), "the trace must not be distributed");
+
+    spectrum.allocate(std::make_shared<dmemo::NoDistribution>(getNumFrequencies()));
+    auto readTrace = hmemo::hostReadAccess(trace.getLocalValues());
+    auto writeSpectrum = hmemo::hostWriteAccess(spectrum.getLocalValues());
+    forwardTrace(readTrace.get(), writeSpectrum.get());
+}
+
+/*! \brief Transform the spectra of real traces back to the time domain
+ *
+ * The spectra are assumed to be Hermitian, i.e. the inverse equals the real part of lama::ifft of the full spectrum scaled by 1 / nFFT. The padded samples are cut off.
+ * If nt > nFFT, the samples nFFT, ..., nt - 1 which have not been transformed are set to zero like the resize of the complex path.
+ \param spectra Traces x nFFT/2 + 1 frequencies
+ \param traces Traces x nt time samples (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::inverse(scai::lama::DenseMatrix<ComplexValueType> const &spectra, scai::lama::DenseMatrix<ValueType> &traces)
+{
+    SCAI_ASSERT_ERROR(plan != nullptr, "TraceFFT is not initialized");
+    SCAI_ASSERT_ERROR(spectra.getNumColumns() == getNumFrequencies(), "number of frequencies " << spectra.getNumColumns() << " != " << getNumFrequencies());
+    SCAI_ASSERT_ERROR(spectra.getColDistribution().isReplicated(), "the frequencies of the spectra must not be distributed");
+
+    if (traces.getRowDistributionPtr() != spectra.getRowDistributionPtr() || traces.getNumColumns() != plan->nt || !traces.getColDistribution().isReplicated()) {
+        traces.allocate(spectra.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(plan->nt));
+    }
+
+    IndexType numFrequencies = getNumFrequencies();
+    lama::DenseStorage<ComplexValueType> const &localSpectra = spectra.getLocalStorage();
+    IndexType numLocalTraces = localSpectra.getNumRows();
+    auto readSpectra = hmemo::hostReadAccess(localSpectra.getValues());
+    auto writeTraces = hmemo::hostWriteAccess(traces.getLocalStorage().getValues());
+    for (IndexType iTrace = 0; iTrace < numLocalTraces; iTrace++) {
+        inverseTrace(readSpectra.get() + iTrace * numFrequencies, writeTraces.get() + iTrace * plan->nt);
+    }
+}
+
+/*! \brief Return the number of samples of a trace */
+template <typename ValueType>
+IndexType KITGPI::TraceFFT<ValueType>::getNT() const
+{
+    return plan == nullptr ? 0 : plan->nt;
+}
+
+/*! \brief Return the length of the zero-padded trace */
+template <typename ValueType>
+IndexType KITGPI::TraceFFT<ValueType>::getNFFT() const
+{
+    return plan == nullptr ? 0 : plan->nFFT;
+}
+
+/*! \brief Return the number of frequencies of a spectrum, nFFT/2 + 1 */
+template <typename ValueType>
+IndexType KITGPI::TraceFFT<ValueType>::getNumFrequencies() const
+{
+    return plan == nullptr ? 0 : plan->nFFT / 2 + 1;
+}
+
+/*! \brief Return the memory of the work buffer in MB, the plans are shared */
+template <typename ValueType>
+double KITGPI::TraceFFT<ValueType>::getMemory() const
+{
+    return work.size() * sizeof(std::complex<ValueType>) / (1024.0 * 1024.0);
+}
+
+/*! \brief Expand the spectrum of a real trace to all nFFT frequencies in the order of lama::fft
+ \param spectrum Spectrum of nFFT/2 + 1 frequencies
+ \param spectrumFull Spectrum of nFFT frequencies (output)
+ \param nFFT Length of the zero-padded trace
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::expandSpectrum(scai::lama::DenseVector<ComplexValueType> const &spectrum, scai::lama::DenseVector<ComplexValueType> &spectrumFull, IndexType nFFT)
+{
+    SCAI_ASSERT_ERROR(spectrum.size() == nFFT / 2 + 1, "number of frequencies " << spectrum.size() << " != " << nFFT / 2 + 1);
+    SCAI_ASSERT_ERROR(spectrum.getDistribution().isReplicated(), "the spectrum must not be distributed");
+
+    spectrumFull.allocate(std::make_shared<dmemo::NoDistribution>(nFFT));
+    auto readSpectrum = hmemo::hostReadAccess(spectrum.getLocalValues());
+    auto writeSpectrumFull = hmemo::hostWriteAccess(spectrumFull.getLocalValues());
+    for (IndexType k = 0; k <= nFFT / 2; k++) {
+        writeSpectrumFull[k] = readSpectrum[k];
+    }
+    for (IndexType k = nFFT / 2 + 1; k < nFFT; k++) {
+        ComplexValueType value = readSpectrum[nFFT - k];
+        writeSpectrumFull[k] = ComplexValueType(value.real(), -value.imag());
+    }
+}
+
+/*! \brief Return the number of cached plans of this value type */
+template <typename ValueType>
+IndexType KITGPI::TraceFFT<ValueType>::getNumPlans()
+{
+    return getPlans().size();
+}
+
+/*! \brief Return the plan of a trace length and an FFT length, it is calculated at the first request
+ \param nt Number of samples of a trace
+ \param nFFT Length of the zero-padded trace
+ */
+template <typename ValueType>
+std::shared_ptr<typename KITGPI::TraceFFT<ValueType>::Plan const> KITGPI::TraceFFT<ValueType>::getPlan(IndexType nt, IndexType nFFT)
+{
+    SCAI_ASSERT_ERROR(nFFT >= 2 && (nFFT & (nFFT - 1)) == 0, "nFFT = " << nFFT << " must be a power of two >= 2");
+    SCAI_ASSERT_ERROR(nt > 0, "nt = " << nt << " must be positive");
+
+    auto &plans = getPlans();
+    auto cached = plans.find(std::make_pair(nt, nFFT));
+    if (cached != plans.end())
+        return cached->second;
+
+    auto newPlan = std::make_shared<Plan>();
+    IndexType numComplex = nFFT / 2;
+    newPlan->nt = nt;
+    newPlan->nFFT = nFFT;
+    newPlan->bitReverse.resize(numComplex);
+    for (IndexType i = 0, j = 0; i < numComplex; i++) {
+        newPlan->bitReverse[i] = j;
+        IndexType bit = numComplex >> 1;
+        while (bit > 0 && (j & bit)) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+    // the factors are calculated in double precision for both value types
+    newPlan->twiddles.resize(numComplex / 2);
+    for (IndexType j = 0; j < numComplex / 2; j++) {
+        double angle = -2.0 * M_PI * j / numComplex;
+        newPlan->twiddles[j] = std::complex<ValueType>(std::cos(angle), std::sin(angle));
+    }
+    newPlan->twiddlesRC.resize(numComplex + 1);
+    for (IndexType k = 0; k <= numComplex; k++) {
+        double angle = -2.0 * M_PI * k / nFFT;
+        newPlan->twiddlesRC[k] = std::complex<ValueType>(std::cos(angle), std::sin(angle));
+    }
+
+    plans[std::make_pair(nt, nFFT)] = newPlan;
+    return newPlan;
+}
+
+/*! \brief Return the plan cache of this value type */
+template <typename ValueType>
+std::map<std::pair<IndexType, IndexType>, std::shared_ptr<typename KITGPI::TraceFFT<ValueType>::Plan const>> &KITGPI::TraceFFT<ValueType>::getPlans()
+{
+    static std::map<std::pair<IndexType, IndexType>, std::shared_ptr<Plan const>> plans;
+    return plans;
+}
+
+/*! \brief In-place radix-2 FFT of nFFT/2 complex samples, the inverse is not scaled
+ \param data Complex samples (in- and output)
+ \param isInverse if true the inverse transform (positive exponent) is calculated
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::transform(std::complex<ValueType> *data, bool isInverse) const
+{
+    IndexType numComplex = plan->nFFT / 2;
+    for (IndexType i = 0; i < numComplex; i++) {
+        IndexType j = plan->bitReverse[i];
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+    for (IndexType length = 2; length <= numComplex; length *= 2) {
+        IndexType halfLength = length / 2;
+        IndexType stride = numComplex / length;
+        for (IndexType start = 0; start < numComplex; start += length) {
+            for (IndexType k = 0; k < halfLength; k++) {
+                std::complex<ValueType> twiddle = plan->twiddles[k * stride];
+                if (isInverse)
+                    twiddle = std::conj(twiddle);
+                std::complex<ValueType> even = data[start + k];
+                std::complex<ValueType> odd = data[start + k + halfLength] * twiddle;
+                data[start + k] = even + odd;
+                data[start + k + halfLength] = even - odd;
+            }
+        }
+    }
+}
+
+/*! \brief Real-to-complex transform of one trace
+ *
+ * The FFT Z of the packed trace z[n] = x[2n] + i x[2n+1] gives the spectra of the even and odd samples E[k] = (Z[k] + conj(Z[N/2-k])) / 2 and O[k] = (Z[k] - conj(Z[N/2-k])) / 2i,
+ * the spectrum of the trace is X[k] = E[k] + exp(-2 pi i k / N) O[k].
+ \param trace nt samples
+ \param spectrum nFFT/2 + 1 frequencies (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::forwardTrace(ValueType const *trace, ComplexValueType *spectrum)
+{
+    IndexType nt = plan->nt;
+    IndexType numComplex = plan->nFFT / 2;
+    for (IndexType n = 0; n < numComplex; n++) {
+        work[n] = std::complex<ValueType>(2 * n < nt ? trace[2 * n] : 0, 2 * n + 1 < nt ? trace[2 * n + 1] : 0);
+    }
+    transform(work.data(), false);
+
+    std::complex<ValueType> const halfI(0, 0.5);
+    for (IndexType k = 0; k <= numComplex; k++) {
+        std::complex<ValueType> z = work[k % numComplex];
+        std::complex<ValueType> zMirror = std::conj(work[(numComplex - k) % numComplex]);
+        std::complex<ValueType> even = (z + zMirror) * ValueType(0.5);
+        std::complex<ValueType> odd = (zMirror - z) * halfI;
+        std::complex<ValueType> value = even + plan->twiddlesRC[k] * odd;
+        spectrum[k] = ComplexValueType(value.real(), value.imag());
+    }
+}
+
+/*! \brief Complex-to-real transform of one trace, the inverse of forwardTrace
+ \param spectrum nFFT/2 + 1 frequencies
+ \param trace nt samples (output)
+ */
+template <typename ValueType>
+void KITGPI::TraceFFT<ValueType>::inverseTrace(ComplexValueType const *spectrum, ValueType *trace)
+{
+    IndexType nt = plan->nt;
+    IndexType numComplex = plan->nFFT / 2;
+    std::complex<ValueType> const i(0, 1);
+    for (IndexType k = 0; k < numComplex; k++) {
+        // the imaginary parts of the frequencies 0 and nFFT/2 do not contribute to the real part
+        std::complex<ValueType> x(spectrum[k].real(), k == 0 ? 0 : spectrum[k].imag());
+        std::complex<ValueType> xMirror(spectrum[numComplex - k].real(), k == 0 ? 0 : -spectrum[numComplex - k].imag());
+        std::complex<ValueType> even = (x + xMirror) * ValueType(0.5);
+        std::complex<ValueType> odd = (x - xMirror) * ValueType(0.5) * std::conj(plan->twiddlesRC[k]);
+        work[k] = even + i * odd;
+    }
+    transform(work.data(), true);
+
+    ValueType scale = ValueType(1) / numComplex;
+    for (IndexType n = 0; n < numComplex; n++) {
+        if (2 * n < nt)
+            trace[2 * n] = work[n].real() * scale;
+        if (2 * n + 1 < nt)
+            trace[2 * n + 1] = work[n].imag() * scale;
+    }
+    for (IndexType n = plan->nFFT; n < nt; n++) {
+        trace[n] = 0;
+    }
+}
+
+template class KITGPI::TraceFFT<double>;
+template class KITGPI::TraceFFT<float>;
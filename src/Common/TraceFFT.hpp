@@ -0,0 +1,65 @@
+#pragma once
+
+#include <scai/common/Complex.hpp>
+#include <scai/lama.hpp>
+
+#include <complex>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Batched real-to-complex and complex-to-real FFT of the traces of a seismogram
+     *
+     * The traces (rows) of a seismogram are real, so their spectra are Hermitian and only the frequencies 0, ..., nFFT/2 are calculated.
+     * A trace of nFFT samples is packed into a complex signal of nFFT/2 samples (even samples as real part, odd samples as imaginary part) which is transformed by a radix-2 FFT,
+     * so the transform needs half the arithmetic and memory of a complex FFT of the zero-padded trace (lama::fft).
+     * The twiddle factors and the bit reversal of a transform are calculated once per trace length, nFFT and value type and shared by all instances (plan cache).
+     * Every instance owns a work buffer which is reused for all traces, e.g. one instance per shot domain.
+     */
+    template <typename ValueType>
+    class TraceFFT
+    {
+      public:
+        typedef scai::common::Complex<scai::RealType<ValueType>> ComplexValueType;
+
+        TraceFFT(){};
+        ~TraceFFT(){};
+
+        void init(scai::IndexType nt, scai::IndexType nFFT);
+
+        void forward(scai::lama::DenseMatrix<ValueType> const &traces, scai::lama::DenseMatrix<ComplexValueType> &spectra);
+        void forward(scai::lama::DenseVector<ValueType> const &trace, scai::lama::DenseVector<ComplexValueType> &spectrum);
+        void inverse(scai::lama::DenseMatrix<ComplexValueType> const &spectra, scai::lama::DenseMatrix<ValueType> &traces);
+
+        scai::IndexType getNT() const;
+        scai::IndexType getNFFT() const;
+        scai::IndexType getNumFrequencies() const;
+        double getMemory() const;
+
+        static void expandSpectrum(scai::lama::DenseVector<ComplexValueType> const &spectrum, scai::lama::DenseVector<ComplexValueType> &spectrumFull, scai::IndexType nFFT);
+        static scai::IndexType getNumPlans();
+
+      private:
+        /*! \brief Precalculated factors of a transform */
+        struct Plan {
+            scai::IndexType nt;                               //!< Number of samples of a trace
+            scai::IndexType nFFT;                             //!< Length of the zero-padded trace (power of two)
+            std::vector<scai::IndexType> bitReverse;          //!< Bit reversal permutation of the complex FFT of nFFT/2 samples
+            std::vector<std::complex<ValueType>> twiddles;    //!< exp(-2 pi i j / (nFFT/2)), j = 0, ..., nFFT/4 - 1
+            std::vector<std::complex<ValueType>> twiddlesRC;  //!< exp(-2 pi i k / nFFT), k = 0, ..., nFFT/2 of the real-to-complex post-processing
+        };
+
+        static std::shared_ptr<Plan const> getPlan(scai::IndexType nt, scai::IndexType nFFT);
+        static std::map<std::pair<scai::IndexType, scai::IndexType>, std::shared_ptr<Plan const>> &getPlans();
+
+        void transform(std::complex<ValueType> *data, bool isInverse) const;
+        void forwardTrace(ValueType const *trace, ComplexValueType *spectrum);
+        void inverseTrace(ComplexValueType const *spectrum, ValueType *trace);
+
+        std::shared_ptr<Plan const> plan;
+        std::vector<std::complex<ValueType>> work; // packed trace of nFFT/2 complex samples
+    };
+}
@@ -0,0 +1,312 @@
+#include "WavefieldActivity.hpp"
+
+#include <Common/Common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace scai;
+
+/*! \brief Initialize the blocks of the local grid points from the configuration
+ *
+ * The mask is used with useWavefieldActivity = 1 (exact) or 2 (physical travel distance), see the class description for the cases it is restricted to.
+ \param config Configuration
+ \param modelCoordinates Coordinates of the model
+ \param dist Distribution of the wavefields
+ \param defaultActivity useWavefieldActivity if it is not given in the configuration
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::init(KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::dmemo::DistributionPtr dist, IndexType defaultActivity)
+{
+    useActivity = config.getAndCatch("useWavefieldActivity", defaultActivity);
+    blockSize = config.getAndCatch("activityBlockSize", IndexType(16));
+    interval = config.getAndCatch("activityInterval", IndexType(10));
+    margin = config.getAndCatch("activityMargin", config.get<IndexType>("spatialFDorder"));
+    SCAI_ASSERT_ERROR(useActivity >= 0 && useActivity <= 2, "useWavefieldActivity = " << useActivity);
+    SCAI_ASSERT_ERROR(blockSize >= 1, "activityBlockSize = " << blockSize);
+    SCAI_ASSERT_ERROR(interval >= 1, "activityInterval = " << interval);
+
+    std::string equationType = config.get<std::string>("equationType");
+    std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower);
+    useVelocityS = (equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0);
+    IndexType gradientKernel = config.getAndCatch("gradientKernel", 0);
+    if (!Common::checkEquationType<ValueType>(equationType) || config.getAndCatch("gradientDomain", 0) != 0 || config.getAndCatch("decomposition", 0) != 0 || (gradientKernel != 0 && gradientKernel != 1) || config.getAndCatch("DHInversion", 1) > 1 || config.getAndCatch("DHInversionPerStage", 0) != 0 || config.getAndCatch("useVariableGrid", 0) != 0) {
+        useActivity = 0;
+    }
+    blockRuns.clear();
+    numBlocks = 0;
+    numLocalValues = 0;
+    if (useActivity == 0)
+        return;
+
+    coordinates = &modelCoordinates;
+    reachPerStep = config.get<IndexType>("spatialFDorder"); // the velocity and the stress update each reach spatialFDorder / 2 grid points
+    if (useActivity == 1)
+        margin = 0;
+    numBlocksX = (modelCoordinates.getNX() + blockSize - 1) / blockSize;
+    numBlocksY = (modelCoordinates.getNY() + blockSize - 1) / blockSize;
+    numBlocksZ = (modelCoordinates.getNZ() + blockSize - 1) / blockSize;
+    numBlocks = numBlocksX * numBlocksY * numBlocksZ;
+    blockRuns.resize(numBlocks);
+
+    // consecutive local grid points of the same block are one range
+    hmemo::HArray<IndexType> ownedIndexes;
+    dist->getOwnedIndexes(ownedIndexes);
+    numLocalValues = ownedIndexes.size();
+    IndexType lastBlock = -1;
+    IndexType localIndex = 0;
+    for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+        Acquisition::coordinate3D coord = modelCoordinates.index2coordinate(ownedIndex);
+        IndexType block = coord.x / blockSize + numBlocksX * (coord.y / blockSize + numBlocksY * (coord.z / blockSize));
+        if (block == lastBlock) {
+            blockRuns[block].back().second = localIndex + 1;
+        } else {
+            blockRuns[block].push_back(std::make_pair(localIndex, localIndex + 1));
+        }
+        lastBlock = block;
+        localIndex++;
+    }
+    resetStatistics();
+}
+
+/*! \brief Reset the numbers of skipped values, e.g. at the beginning of an iteration */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::resetStatistics()
+{
+    numValues = 0;
+    numValuesActive = 0;
+    numValuesCorrelation = 0;
+    numValuesCorrelationActive = 0;
+}
+
+/*! \brief Calculate the distances of the blocks to the sources before the forward modelling of a shot
+ \param sources1DCoordinates 1D coordinates of the sources
+ \param model Model of the shot, its maximum velocity is used with useWavefieldActivity = 2
+ \param DT Time step
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::initForward(scai::lama::DenseVector<IndexType> sources1DCoordinates, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, ValueType DT)
+{
+    if (useActivity == 0)
+        return;
+    if (useActivity == 2) {
+        ValueType velocityMax = useVelocityS ? model.getVelocityS().maxNorm() : model.getVelocityP().maxNorm();
+        reachPerStep = velocityMax * DT / coordinates->getDH();
+    }
+    calcDistances(sources1DCoordinates, distanceForward);
+    radiusForward = -1;
+    radiusCorrelationForward = -1;
+}
+
+/*! \brief Calculate the distances of the blocks to the receivers before the adjoint modelling of a shot
+ \param receivers1DCoordinates 1D coordinates of the receivers (adjoint sources)
+ \param tStepAdjointStart_in First time step of the adjoint modelling
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::initAdjoint(scai::lama::DenseVector<IndexType> receivers1DCoordinates, IndexType tStepAdjointStart_in)
+{
+    if (useActivity == 0)
+        return;
+    tStepAdjointStart = tStepAdjointStart_in;
+    calcDistances(receivers1DCoordinates, distanceAdjoint);
+    radiusAdjoint = -1;
+    radiusCorrelationAdjoint = -1;
+}
+
+/*! \brief Return the local ranges in which the forward wavefield after time step tStep is not zero
+ \param tStep Time step of the forward modelling
+ \return nullptr if all local grid points are active
+ */
+template <typename ValueType>
+typename KITGPI::WavefieldActivity<ValueType>::IndexRanges const *KITGPI::WavefieldActivity<ValueType>::getForwardRanges(IndexType tStep)
+{
+    if (useActivity == 0)
+        return nullptr;
+    IndexType radius = calcRadius(tStep + 1, interval, reachPerStep, margin);
+    if (radius != radiusForward) {
+        calcRanges(distanceForward, radius, rangesForward);
+        radiusForward = radius;
+    }
+    count(rangesForward, false);
+    return rangesForward.size() == 1 && rangesForward[0].second - rangesForward[0].first == numLocalValues ? nullptr : &rangesForward;
+}
+
+/*! \brief Return the local ranges in which the adjoint wavefield after time step tStep is not zero
+ \param tStep Time step of the adjoint modelling (backwards from tStepAdjointStart)
+ \return nullptr if all local grid points are active
+ */
+template <typename ValueType>
+typename KITGPI::WavefieldActivity<ValueType>::IndexRanges const *KITGPI::WavefieldActivity<ValueType>::getAdjointRanges(IndexType tStep)
+{
+    if (useActivity == 0)
+        return nullptr;
+    IndexType radius = calcRadius(tStepAdjointStart - tStep + 1, interval, reachPerStep, margin);
+    if (radius != radiusAdjoint) {
+        calcRanges(distanceAdjoint, radius, rangesAdjoint);
+        radiusAdjoint = radius;
+    }
+    count(rangesAdjoint, false);
+    return rangesAdjoint.size() == 1 && rangesAdjoint[0].second - rangesAdjoint[0].first == numLocalValues ? nullptr : &rangesAdjoint;
+}
+
+/*! \brief Return the local ranges in which both the forward wavefield and the adjoint wavefield of time step tStep are not zero
+ *
+ * The forward wavefields of time step tStep and of the stored time step before are used for the cross correlation, both are covered by the forward radius of time step tStep.
+ \param tStep Time step of the adjoint modelling (backwards from tStepAdjointStart)
+ \return nullptr if all local grid points are active
+ */
+template <typename ValueType>
+typename KITGPI::WavefieldActivity<ValueType>::IndexRanges const *KITGPI::WavefieldActivity<ValueType>::getCorrelationRanges(IndexType tStep)
+{
+    if (useActivity == 0)
+        return nullptr;
+    IndexType radiusF = calcRadius(tStep + 1, interval, reachPerStep, margin);
+    IndexType radiusA = calcRadius(tStepAdjointStart - tStep + 1, interval, reachPerStep, margin);
+    if (radiusF != radiusCorrelationForward || radiusA != radiusCorrelationAdjoint) {
+        std::vector<IndexType> distances(numBlocks);
+        for (IndexType block = 0; block < numBlocks; block++) {
+            // a block outside of one of the radii is excluded by a distance larger than radiusF
+            distances[block] = distanceAdjoint[block] <= radiusA ? distanceForward[block] : radiusF + 1;
+        }
+        calcRanges(distances, radiusF, rangesCorrelation);
+        radiusCorrelationForward = radiusF;
+        radiusCorrelationAdjoint = radiusA;
+    }
+    count(rangesCorrelation, true);
+    return rangesCorrelation.size() == 1 && rangesCorrelation[0].second - rangesCorrelation[0].first == numLocalValues ? nullptr : &rangesCorrelation;
+}
+
+/*! \brief Calculate the lower bound of the distance in grid points of each block to the nearest source or receiver
+ *
+ * The distance is the maximum over the directions, because the finite-difference stencils of a time step reach the same number of grid points in each direction.
+ \param acquisition1DCoordinates 1D coordinates of the sources or receivers
+ \param distances Distance of each block
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::calcDistances(scai::lama::DenseVector<IndexType> &acquisition1DCoordinates, std::vector<IndexType> &distances) const
+{
+    acquisition1DCoordinates.replicate();
+    // several sources or receivers in the same block have the same distances
+    std::vector<IndexType> acquisitionBlocks;
+    for (IndexType acquisition1DCoordinate : hmemo::hostReadAccess(acquisition1DCoordinates.getLocalValues())) {
+        Acquisition::coordinate3D coord = coordinates->index2coordinate(acquisition1DCoordinate);
+        acquisitionBlocks.push_back(coord.x / blockSize + numBlocksX * (coord.y / blockSize + numBlocksY * (coord.z / blockSize)));
+    }
+    std::sort(acquisitionBlocks.begin(), acquisitionBlocks.end());
+    acquisitionBlocks.erase(std::unique(acquisitionBlocks.begin(), acquisitionBlocks.end()), acquisitionBlocks.end());
+
+    distances.assign(numBlocks, std::numeric_limits<IndexType>::max());
+    for (IndexType block = 0; block < numBlocks; block++) {
+        IndexType blockX = block % numBlocksX;
+        IndexType blockY = (block / numBlocksX) % numBlocksY;
+        IndexType blockZ = block / (numBlocksX * numBlocksY);
+        for (IndexType acquisitionBlock : acquisitionBlocks) {
+            IndexType distance = std::max(calcBlockDistance(blockX, acquisitionBlock % numBlocksX, blockSize), std::max(calcBlockDistance(blockY, (acquisitionBlock / numBlocksX) % numBlocksY, blockSize), calcBlockDistance(blockZ, acquisitionBlock / (numBlocksX * numBlocksY), blockSize)));
+            distances[block] = std::min(distances[block], distance);
+        }
+    }
+}
+
+/*! \brief Collect the local ranges of all blocks within a radius
+ \param distances Distance of each block
+ \param radius Radius in grid points
+ \param ranges Local index ranges of the active blocks
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::calcRanges(std::vector<IndexType> const &distances, IndexType radius, IndexRanges &ranges) const
+{
+    ranges.clear();
+    IndexType numActive = 0;
+    for (IndexType block = 0; block < numBlocks; block++) {
+        if (distances[block] <= radius) {
+            ranges.insert(ranges.end(), blockRuns[block].begin(), blockRuns[block].end());
+            numActive++;
+        }
+    }
+    if (numActive == numBlocks) {
+        ranges.assign(1, std::make_pair(IndexType(0), numLocalValues));
+    }
+}
+
+/*! \brief Add the active and the total number of local values of one kernel call to the statistics
+ \param ranges Local index ranges of the active blocks
+ \param isCorrelation true for the cross correlation, false for the energy preconditioning
+ */
+template <typename ValueType>
+void KITGPI::WavefieldActivity<ValueType>::count(IndexRanges const &ranges, bool isCorrelation)
+{
+    double numActive = 0;
+    for (auto const &range : ranges) {
+        numActive += range.second - range.first;
+    }
+    if (isCorrelation) {
+        numValuesCorrelation += numLocalValues;
+        numValuesCorrelationActive += numActive;
+    } else {
+        numValues += numLocalValues;
+        numValuesActive += numActive;
+    }
+}
+
+/*! \brief Return the radius in grid points the wavefield can have reached after a number of time steps
+ *
+ * The number of time steps is rounded up to a multiple of the update interval, so the radius is constant within an interval.
+ \param numTimeSteps Number of time steps since the start of the modelling
+ \param interval Update interval in time steps
+ \param reachPerStep Distance in grid points per time step
+ \param margin Additional distance in grid points
+ */
+template <typename ValueType>
+IndexType KITGPI::WavefieldActivity<ValueType>::calcRadius(IndexType numTimeSteps, IndexType interval, ValueType reachPerStep, IndexType margin)
+{
+    IndexType numTimeStepsInterval = ((numTimeSteps + interval - 1) / interval) * interval;
+    return static_cast<IndexType>(std::ceil(reachPerStep * numTimeStepsInterval)) + margin;
+}
+
+/*! \brief Return the lower bound of the distance in grid points between the grid points of two blocks in one direction
+ \param blockIndex Index of the block in this direction
+ \param sourceBlockIndex Index of the block of the source in this direction
+ \param blockSize Number of grid points of a block per direction
+ */
+template <typename ValueType>
+IndexType KITGPI::WavefieldActivity<ValueType>::calcBlockDistance(IndexType blockIndex, IndexType sourceBlockIndex, IndexType blockSize)
+{
+    IndexType numBlocksBetween = std::abs(blockIndex - sourceBlockIndex);
+    return numBlocksBetween == 0 ? 0 : (numBlocksBetween - 1) * blockSize + 1;
+}
+
+/*! \brief Return true if the mask is used */
+template <typename ValueType>
+bool KITGPI::WavefieldActivity<ValueType>::isActive() const
+{
+    return useActivity != 0;
+}
+
+/*! \brief Return the fraction of the local values skipped by the energy preconditioning since the last reset */
+template <typename ValueType>
+double KITGPI::WavefieldActivity<ValueType>::getSkippedFraction() const
+{
+    return numValues == 0 ? 0 : 1 - numValuesActive / numValues;
+}
+
+/*! \brief Return the fraction of the local values skipped by the cross correlation since the last reset */
+template <typename ValueType>
+double KITGPI::WavefieldActivity<ValueType>::getSkippedFractionCorrelation() const
+{
+    return numValuesCorrelation == 0 ? 0 : 1 - numValuesCorrelationActive / numValuesCorrelation;
+}
+
+/*! \brief Return the memory of the local ranges of the blocks in MB */
+template <typename ValueType>
+double KITGPI::WavefieldActivity<ValueType>::getMemory() const
+{
+    double numRanges = 0;
+    for (auto const &runs : blockRuns) {
+        numRanges += runs.size();
+    }
+    return numRanges * sizeof(std::pair<IndexType, IndexType>) / (1024.0 * 1024.0);
+}
+
+template class KITGPI::WavefieldActivity<double>;
+template class KITGPI::WavefieldActivity<float>;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <Acquisition/Coordinates.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Modelparameter/Modelparameter.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace KITGPI
+{
+    /*! \brief Blocks of the model which can be reached by the forward or the adjoint wavefield of a shot
+     *
+     * The model is divided into blocks of activityBlockSize grid points per direction. Before the wavefield reaches a block, all its components are exactly zero in this block,
+     * so the cross correlation and the integration of the energy preconditioning can skip it. A block is active if its distance to the nearest source (forward) or receiver (adjoint)
+     * is not larger than the distance the wavefield can have travelled. The active blocks are updated every activityInterval time steps with the distance at the end of the interval.
+     *
+     * With useWavefieldActivity = 1 the distance is the numerical domain of dependence of spatialFDorder grid points per time step, so the gradient is exact.
+     * With useWavefieldActivity = 2 the distance is the physical travel distance of the maximum velocity plus activityMargin grid points, which skips more work but neglects the numerical precursors.
+     * The mask is only used for time domain gradients without decomposition, reflection kernel or inversion grid (DHInversion = 1) on a regular grid.
+     */
+    template <typename ValueType>
+    class WavefieldActivity
+    {
+      public:
+        //! \brief Local index ranges [first, second) of the active blocks
+        typedef std::vector<std::pair<scai::IndexType, scai::IndexType>> IndexRanges;
+
+        WavefieldActivity() : useActivity(0), blockSize(16), interval(10), margin(0), reachPerStep(0), numBlocksX(0), numBlocksY(0), numBlocksZ(0), numBlocks(0), numLocalValues(0), tStepAdjointStart(0), radiusForward(-1), radiusAdjoint(-1), radiusCorrelationForward(-1), radiusCorrelationAdjoint(-1), numValues(0), numValuesActive(0), numValuesCorrelation(0), numValuesCorrelationActive(0){};
+        ~WavefieldActivity(){};
+
+        void init(KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::dmemo::DistributionPtr dist, scai::IndexType defaultActivity = 0);
+        void resetStatistics();
+
+        void initForward(scai::lama::DenseVector<scai::IndexType> sources1DCoordinates, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, ValueType DT);
+        void initAdjoint(scai::lama::DenseVector<scai::IndexType> receivers1DCoordinates, scai::IndexType tStepAdjointStart);
+
+        IndexRanges const *getForwardRanges(scai::IndexType tStep);
+        IndexRanges const *getAdjointRanges(scai::IndexType tStep);
+        IndexRanges const *getCorrelationRanges(scai::IndexType tStep);
+
+        bool isActive() const;
+        double getSkippedFraction() const;
+        double getSkippedFractionCorrelation() const;
+        double getMemory() const;
+
+        static scai::IndexType calcRadius(scai::IndexType numTimeSteps, scai::IndexType interval, ValueType reachPerStep, scai::IndexType margin);
+        static scai::IndexType calcBlockDistance(scai::IndexType blockIndex, scai::IndexType sourceBlockIndex, scai::IndexType blockSize);
+
+      private:
+        void calcDistances(scai::lama::DenseVector<scai::IndexType> &acquisition1DCoordinates, std::vector<scai::IndexType> &distances) const;
+        void calcRanges(std::vector<scai::IndexType> const &distances, scai::IndexType radius, IndexRanges &ranges) const;
+        void count(IndexRanges const &ranges, bool isCorrelation);
+
+        scai::IndexType useActivity;
+        bool useVelocityS = false; // SH waves travel with the S-wave velocity
+        scai::IndexType blockSize;
+        scai::IndexType interval;
+        scai::IndexType margin;
+        ValueType reachPerStep;
+        scai::IndexType numBlocksX;
+        scai::IndexType numBlocksY;
+        scai::IndexType numBlocksZ;
+        scai::IndexType numBlocks;
+        scai::IndexType numLocalValues;
+        std::vector<IndexRanges> blockRuns; // local index ranges of each block on this process
+        KITGPI::Acquisition::Coordinates<ValueType> const *coordinates = nullptr;
+
+        std::vector<scai::IndexType> distanceForward; // lower bound of the distance in grid points of each block to the nearest source
+        std::vector<scai::IndexType> distanceAdjoint; // lower bound of the distance in grid points of each block to the nearest receiver
+        scai::IndexType tStepAdjointStart;
+        scai::IndexType radiusForward;
+        scai::IndexType radiusAdjoint;
+        scai::IndexType radiusCorrelationForward;
+        scai::IndexType radiusCorrelationAdjoint;
+        IndexRanges rangesForward;
+        IndexRanges rangesAdjoint;
+        IndexRanges rangesCorrelation;
+
+        double numValues;
+        double numValuesActive;
+        double numValuesCorrelation;
+        double numValuesCorrelationActive;
+    };
+}
@@ -0,0 +1,139 @@
+#include "WavefieldCompensation.hpp"
+
+using namespace scai;
+
+/*! \brief Initialize from the configuration
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::WavefieldCompensation<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useCompensation = config.getAndCatch("compensation", 0);
+    DT = config.get<ValueType>("DT");
+    model = nullptr;
+    stepFactor = lama::DenseVector<ValueType>();
+    tStepFactor = -1;
+    tStepDelta = 0;
+    numAdvances = 0;
+}
+
+/*! \brief Calculate the factor of one time step of the model of a shot
+ *
+ * The compensation is exponential in time if the factor of two time steps is the square of the factor of one time step.
+ \param modelIn Model of the shot, it must not be changed before the shot is finished
+ */
+template <typename ValueType>
+void KITGPI::WavefieldCompensation<ValueType>::initShot(KITGPI::Modelparameter::Modelparameter<ValueType> const &modelIn)
+{
+    if (!isActive())
+        return;
+
+    model = &modelIn;
+    lama::DenseVector<ValueType> stepFactorModel = model->getCompensation(DT, 1);
+    lama::DenseVector<ValueType> difference = model->getCompensation(DT, 2);
+    ValueType maxFactor = difference.maxNorm();
+    lama::DenseVector<ValueType> stepFactorSquared = stepFactorModel * stepFactorModel;
+    difference -= stepFactorSquared;
+    if (stepFactorModel.min() > 0 && difference.maxNorm() <= 1e-4 * maxFactor) {
+        initStepFactor(stepFactorModel);
+    } else {
+        stepFactor = stepFactorModel;
+        isExponential = false;
+    }
+}
+
+/*! \brief Set the factor of one time step of an exponential compensation
+ \param stepFactorIn Factor of one time step of each grid point, it has to be positive
+ */
+template <typename ValueType>
+void KITGPI::WavefieldCompensation<ValueType>::initStepFactor(scai::lama::DenseVector<ValueType> const &stepFactorIn)
+{
+    SCAI_ASSERT_ERROR(stepFactorIn.min() > 0, "the factor of one time step has to be positive");
+    stepFactor = stepFactorIn;
+    logStepFactor = stepFactor;
+    logStepFactor.unaryOp(logStepFactor, common::UnaryOp::LOG);
+    isExponential = true;
+    tStepFactor = -1;
+    tStepDelta = 0;
+    numAdvances = 0;
+}
+
+/*! \brief Return the factor of one time step, e.g. for the adjoint wavefield which is compensated in every time step */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> const &KITGPI::WavefieldCompensation<ValueType>::getStepFactor() const
+{
+    SCAI_ASSERT_ERROR(stepFactor.size() > 0, "initShot has not been called");
+    return stepFactor;
+}
+
+/*! \brief Return the compensation of a time step, equal to Modelparameter::getCompensation(DT, tStep)
+ *
+ * The factor is advanced from the factor of the previous call if the time step is larger, otherwise it is recalculated.
+ \param tStep Time step
+ */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> const &KITGPI::WavefieldCompensation<ValueType>::getFactor(IndexType tStep)
+{
+    SCAI_ASSERT_ERROR(stepFactor.size() > 0, "initShot has not been called");
+    if (!isExponential) {
+        factor = model->getCompensation(DT, tStep);
+    } else if (tStep != tStepFactor) {
+        if (tStepFactor >= 0 && tStep > tStepFactor && numAdvances < exactInterval) {
+            IndexType delta = tStep - tStepFactor;
+            if (delta != tStepDelta) {
+                deltaFactor = ValueType(delta) * logStepFactor;
+                deltaFactor.unaryOp(deltaFactor, common::UnaryOp::EXP);
+                tStepDelta = delta;
+            }
+            factor *= deltaFactor;
+            numAdvances++;
+        } else {
+            factor = ValueType(tStep) * logStepFactor;
+            factor.unaryOp(factor, common::UnaryOp::EXP);
+            numAdvances = 0;
+        }
+    }
+    tStepFactor = tStep;
+    return factor;
+}
+
+/*! \brief Store the wavefields of a time step for the gradient calculation
+ *
+ * The wavefields are copied, compensated in place and restricted to the inversion grid.
+ \param wavefieldsInversion Stored wavefields (output)
+ \param wavefields Wavefields of the time step
+ \param tStep Time step
+ \param averageMatrix Restriction to the inversion grid
+ \param useInversionGrid if true the wavefields are restricted to the inversion grid (DHInversion > 1)
+ */
+template <typename ValueType>
+void KITGPI::WavefieldCompensation<ValueType>::storeWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefieldsInversion, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, IndexType tStep, scai::lama::Matrix<ValueType> const &averageMatrix, bool useInversionGrid)
+{
+    if (isActive()) {
+        wavefieldsInversion = wavefields;
+        wavefieldsInversion *= getFactor(tStep);
+        if (useInversionGrid)
+            wavefieldsInversion.applyTransform(averageMatrix, wavefieldsInversion);
+    } else if (useInversionGrid) {
+        wavefieldsInversion.applyTransform(averageMatrix, wavefields);
+    } else {
+        wavefieldsInversion = wavefields;
+    }
+}
+
+/*! \brief Return true if the wavefields are compensated */
+template <typename ValueType>
+bool KITGPI::WavefieldCompensation<ValueType>::isActive() const
+{
+    return useCompensation != 0;
+}
+
+/*! \brief Return true if the compensation of the model of the shot is exponential in time and is advanced by the factor of the time steps */
+template <typename ValueType>
+bool KITGPI::WavefieldCompensation<ValueType>::getIsExponential() const
+{
+    return isExponential;
+}
+
+template class KITGPI::WavefieldCompensation<double>;
+template class KITGPI::WavefieldCompensation<float>;
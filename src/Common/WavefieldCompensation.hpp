@@ -0,0 +1,52 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <Configuration/Configuration.hpp>
+#include <Modelparameter/Modelparameter.hpp>
+#include <Wavefields/Wavefields.hpp>
+
+namespace KITGPI
+{
+    /*! \brief Amplitude compensation of the stored forward wavefields and the adjoint wavefields (compensation = 1)
+     *
+     * Modelparameter::getCompensation(DT, tStep) returns the factor exp(a * tStep) of each grid point which compensates the energy loss (e.g. by the electric conductivity) up to time step tStep.
+     * Instead of building this grid vector in every time step, the factor of one time step is calculated once per shot and model (initShot)
+     * and the factor of a stored time step is advanced from the previous one by multiplying the factor of the time steps in between. After every exactInterval advances the factor is recalculated from its logarithm to limit the rounding errors.
+     * If the compensation of the model is not exponential in time, the factor of the model is used in every time step as before.
+     */
+    template <typename ValueType>
+    class WavefieldCompensation
+    {
+      public:
+        WavefieldCompensation() : useCompensation(0), DT(0), isExponential(true), model(nullptr), tStepFactor(-1), tStepDelta(0), numAdvances(0){};
+        ~WavefieldCompensation(){};
+
+        void init(KITGPI::Configuration::Configuration const &config);
+        void initShot(KITGPI::Modelparameter::Modelparameter<ValueType> const &model);
+        void initStepFactor(scai::lama::DenseVector<ValueType> const &stepFactorIn);
+
+        scai::lama::DenseVector<ValueType> const &getStepFactor() const;
+        scai::lama::DenseVector<ValueType> const &getFactor(scai::IndexType tStep);
+        void storeWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefieldsInversion, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, scai::IndexType tStep, scai::lama::Matrix<ValueType> const &averageMatrix, bool useInversionGrid);
+
+        bool isActive() const;
+        bool getIsExponential() const;
+
+        static const scai::IndexType exactInterval = 64;
+
+      private:
+        scai::IndexType useCompensation;
+        ValueType DT;
+        bool isExponential;
+        KITGPI::Modelparameter::Modelparameter<ValueType> const *model;
+
+        scai::lama::DenseVector<ValueType> stepFactor;    // factor of one time step
+        scai::lama::DenseVector<ValueType> logStepFactor; // logarithm of the factor of one time step
+        scai::lama::DenseVector<ValueType> factor;        // factor of time step tStepFactor
+        scai::lama::DenseVector<ValueType> deltaFactor;   // factor of tStepDelta time steps
+        scai::IndexType tStepFactor;
+        scai::IndexType tStepDelta;
+        scai::IndexType numAdvances;
+    };
+}
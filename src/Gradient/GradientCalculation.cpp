@@ -34,6 +34,35 @@ void KITGPI::GradientCalculation<ValueType>::allocate(KITGPI::Configuration::Con
         ZeroLagXcorrReflect = KITGPI::ZeroLagXcorr::Factory<ValueType>::Create(dimension, equationType);
         ZeroLagXcorrReflect->init(ctx, distInversion, workflow, config, numShotPerSuperShot);
     }
+    if (isSinglePassReflect(config)) {
+        wavefieldsAdjointReflect = KITGPI::Wavefields::Factory<ValueType>::Create(dimension, equationType);
+        wavefieldsAdjointReflect->init(ctx, dist, numRelaxationMechanisms);
+        solverReflect = KITGPI::ForwardSolver::Factory<ValueType>::Create(dimension, equationType);
+    }
+    isSolverReflectInitialized = false;
+}
+
+/*! \brief Prepare the solver of the reflection adjoint wavefield of the single pass (useSinglePassReflect) for a model
+ *
+ * Like the forward solver, the solver is initialized once per workflow stage or for each model per shot of the stream configuration and prepared for each updated model.
+ * Has to be called before run, nothing is done without the single pass.
+ \param config Configuration
+ \param derivatives Derivatives
+ \param model Model of the modelling
+ \param modelCoordinates Coordinates of the model
+ \param ctx Context
+ \param isNewModel true if the solver has to be initialized again, e.g. for the model per shot of the stream configuration
+ */
+template <typename ValueType>
+void KITGPI::GradientCalculation<ValueType>::prepareForModelling(KITGPI::Configuration::Configuration const &config, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, bool isNewModel)
+{
+    if (!isSinglePassReflect(config))
+        return;
+    if (isNewModel || !isSolverReflectInitialized) {
+        solverReflect->initForwardSolver(config, derivatives, *wavefieldsAdjointReflect, model, modelCoordinates, ctx, config.get<ValueType>("DT"));
+        isSolverReflectInitialized = true;
+    }
+    solverReflect->prepareForModelling(model, config.get<ValueType>("DT"));
 }
 
 /*! \brief gather wavefields
@@ -53,6 +82,75 @@ void KITGPI::GradientCalculation<ValueType>::gatherWavefields(KITGPI::Wavefields
         ZeroLagXcorrReflect->gatherWavefields(wavefieldsInversion, sourceFC, workflow, tStep, DT, isAdjoint);
 }
 
+/*! \brief Return true if the reflection adjoint wavefield of the tomographic kernel is propagated in the backward time loop of the adjoint wavefield (useSinglePassReflect = 1)
+ *
+ * The reflection adjoint sources of a time step are the reflectivity times the temporal derivative of the adjoint wavefield of the same time step, so both adjoint wavefields can be propagated in one loop instead of a second adjoint modelling.
+ * This needs one more wavefield and the boundary memory variables of a second solver. It is only used for the Born kernels (gradientKernel 2 or 3 and decomposition = 0).
+ \param config Configuration
+ */
+template <typename ValueType>
+bool KITGPI::GradientCalculation<ValueType>::isSinglePassReflect(KITGPI::Configuration::Configuration const &config)
+{
+    IndexType gradientKernel = config.getAndCatch("gradientKernel", 0);
+    return config.getAndCatch("useSinglePassReflect", 0) != 0 && (gradientKernel == 2 || gradientKernel == 3) && config.getAndCatch("decomposition", 0) == 0;
+}
+
+/*! \brief Correlate a time step of the reflection adjoint wavefield with the stored forward wavefields
+ *
+ * Has to be called for every time step with tStep % skipDT == 0, the squared reflection adjoint wavefield is integrated for the energy preconditioning.
+ \param wavefieldsAdjointReflect Reflection adjoint wavefield
+ \param tStep Time step
+ \param tStepEnd Number of time steps
+ \param derivatives Derivatives matrices
+ \param sources Sources
+ \param model Model for the finite-difference simulation
+ \param wavefieldrecord Record of the forward wave fields
+ \param config Configuration
+ \param shotNumber Shot number
+ \param shotIndTrue Index of the shot
+ \param workflow Workflow
+ \param wavefieldTaper2D Transform to the inversion grid
+ \param energyPrecondReflect Energy preconditioning of the tomographic kernel
+ */
+template <typename ValueType>
+void KITGPI::GradientCalculation<ValueType>::correlateAdjointReflect(KITGPI::Wavefields::Wavefields<ValueType> &wavefieldsAdjointReflect, scai::IndexType tStep, scai::IndexType tStepEnd, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> &sources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration const &config, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> &wavefieldTaper2D, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecondReflect)
+{
+    IndexType gradientDomain = config.getAndCatch("gradientDomain", 0);
+    ValueType DTinv = 1.0 / config.get<ValueType>("DT");
+    bool isAdjoint = true;
+    if (workflow.DHInversion > 1 && !workflow.restrictAfterAccumulation) {
+        wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), wavefieldsAdjointReflect);
+    } else {
+        *wavefieldsAdjointTemp = wavefieldsAdjointReflect;
+    }
+    energyPrecondReflect.intSquaredWavefields(*wavefieldsAdjointTemp, config.get<ValueType>("DT"), isAdjoint);
+    if (gradientDomain == 0) { 
+        /*  Cross correlation in the time domain   */
+        //calculate temporal derivative of wavefield
+        *wavefieldsTemp = *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)];
+        *wavefieldsTemp -= *wavefieldrecord[floor(tStep / workflow.skipDT - 0.5)];
+        *wavefieldsTemp *= DTinv;      
+        *wavefieldsTemp *= workflow.skipDT; 
+    
+        /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
+        {
+            PhaseTimer::Scope timerXcorr("xcorr");
+            ZeroLagXcorr->update(*wavefieldsTemp, *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);
+        }
+    } else if (gradientDomain == 1 || gradientDomain == 2) {
+        /* Cross correlation in the frequency domain */
+        ZeroLagXcorr->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
+    } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
+        this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
+    }
+    if (workflow.workflowStage == 0 && workflow.iteration == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
+        if (gradientDomain == 0) {
+            ZeroLagXcorr->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiverReflect", tStep, workflow);
+        }
+        wavefieldsAdjointReflect.write(config.getAndCatch("snapType", 0), config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiverReflect", tStep, derivatives, model, config.get<IndexType>("FileFormat"));
+    }
+}
+
 /*! \brief Initialization of the boundary conditions
  *
  *
@@ -64,10 +162,15 @@ void KITGPI::GradientCalculation<ValueType>::gatherWavefields(KITGPI::Wavefields
  \param gradientPerShot Gradient for simulations
  \param config Configuration
  \param dataMisfit Misfit
+ \param taperCache Cache of the source and receiver tapers
+ \param timeWindow Time window of the shot, the adjoint modelling starts at the last sample of the adjoint sources
+ \param wavefieldActivity Active blocks of the shot, the cross correlation and the energy preconditioning are restricted to them
+ \param wavefieldCompensation Compensation of the shot, the adjoint wavefields are multiplied by the factor of one time step
  */
 template <typename ValueType>
-void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> wavefieldTaper2D, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecordReflect, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> energyPrecond, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> energyPrecondReflect, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode)
+void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> wavefieldTaper2D, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecordReflect, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecond, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecondReflect, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType> &taperCache, KITGPI::TimeWindow<ValueType> &timeWindow, KITGPI::WavefieldActivity<ValueType> &wavefieldActivity, KITGPI::WavefieldCompensation<ValueType> const &wavefieldCompensation)
 {
+    PhaseTimer::Scope timerGradientCalculation("gradientCalculation");
     IndexType tStepEnd = static_cast<IndexType>((config.get<ValueType>("T") / config.get<ValueType>("DT")) + 0.5);
     ValueType DTinv = 1.0 / config.get<ValueType>("DT");
     double start_t_shot, end_t_shot; /* For timing */
@@ -119,6 +222,7 @@ void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr co
     if (decomposition != 0) {
         snapType = decomposition + 3;
     }  
+    bool singlePassReflect = gradientKernel == 2 && decomposition == 0 && isSinglePassReflect(config);
     
     /* --------------------------------------- */
     /* Adjoint Wavefield record                */
@@ -146,149 +250,225 @@ void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr co
                 
     wavefields->resetWavefields();
     ZeroLagXcorr->prepareForInversion(gradientKernel, config);
+    scai::lama::DenseVector<ValueType> reflectivity;
+    if (gradientKernel == 2 && decomposition == 0) 
+        reflectivity = model.getReflectivity();
+    if (singlePassReflect) {
+        SCAI_ASSERT_ERROR(isSolverReflectInitialized, "prepareForModelling has to be called before the gradient calculation");
+        wavefieldsAdjointReflect->resetWavefields();
+    }
     bool isReflect = true;
     bool isAdjoint = true;
     
-    lama::DenseVector<ValueType> compensation;
-    if (config.getAndCatch("compensation", 0))
-        compensation = model.getCompensation(config.get<ValueType>("DT"), 1);
+    /* the adjoint wavefield is zero after the last sample of the adjoint sources */
+    IndexType tStepAdjointStart = tStepEnd - 1;
+    if (gradientKernel != 2 && decomposition == 0)
+        tStepAdjointStart = timeWindow.calcAdjointStart(adjointSources, tStepEnd);
+    wavefieldActivity.initAdjoint(adjointSources.get1DCoordinates(), tStepAdjointStart);
     
-    for (IndexType tStep = tStepEnd - 1; tStep > 0; tStep--) {
-        *wavefieldsReflect = *wavefields;
+    {
+        PhaseTimer::Scope timerAdjoint("adjoint");
+        for (IndexType tStep = tStepAdjointStart; tStep > 0; tStep--) {
+            *wavefieldsReflect = *wavefields;
 
-        solver.run(receivers, adjointSources, model, *wavefields, derivatives, tStep);
+            solver.run(receivers, adjointSources, model, *wavefields, derivatives, tStep);
 
-        if (config.getAndCatch("compensation", 0))
-            *wavefields *= compensation;
+            if (wavefieldCompensation.isActive())
+                *wavefields *= wavefieldCompensation.getStepFactor();
                 
-        if ((gradientKernel == 2 && decomposition == 0) || decomposition != 0) { 
-            //calculate temporal derivative of wavefield
-            *wavefieldsReflect -= *wavefields;
-            *wavefieldsReflect *= -DTinv; // wavefieldsReflect will be gathered by adjointSourcesReflect
-            if (gradientKernel == 2 && decomposition == 0) 
-                SourceReceiverReflect->gatherSeismogram(tStep);
-            if (decomposition != 0) 
-                wavefields->decompose(decomposition, *wavefieldsReflect, derivatives);
-        }
-            
-        if (((gradientKernel != 2 && decomposition == 0) || decomposition != 0) && tStep % workflow.skipDT == 0) {
-            if (config.getAndCatch("DHInversion", 1) > 1) {
-                wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
-            } else {
-                *wavefieldsAdjointTemp = *wavefields;
-            }
-            energyPrecond.intSquaredWavefields(*wavefieldsAdjointTemp, isAdjoint, config.get<ValueType>("DT"));
-            if (gradientDomain == 0) { 
-                /*  Cross correlation in the time domain   */
+            if ((gradientKernel == 2 && decomposition == 0) || decomposition != 0) { 
                 //calculate temporal derivative of wavefield
-                *wavefieldsTemp = *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)];
-                *wavefieldsTemp -= *wavefieldrecord[floor(tStep / workflow.skipDT - 0.5)];
-                *wavefieldsTemp *= DTinv;      
-                *wavefieldsTemp *= workflow.skipDT; 
-            
-                /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
-                ZeroLagXcorr->update(*wavefieldsTemp, *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);
-            } else if (gradientDomain == 1 || gradientDomain == 2) {
-                /* Cross correlation in the frequency domain */
-                ZeroLagXcorr->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
-            } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
-                this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
-            }
-        } else if (gradientKernel == 2 && decomposition == 0 && tStep % workflow.skipDT == 0) {
-            if (config.getAndCatch("DHInversion", 1) > 1) {
-                wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
-            } else {
-                *wavefieldsAdjointTemp = *wavefields;
+                *wavefieldsReflect -= *wavefields;
+                *wavefieldsReflect *= -DTinv; // wavefieldsReflect will be gathered by adjointSourcesReflect
+                if (gradientKernel == 2 && decomposition == 0) {
+                    SourceReceiverReflect->gatherSeismogram(tStep);
+                    if (singlePassReflect) {
+                        /* the reflection adjoint sources of this time step are complete, so the reflection adjoint wavefield follows in the same time step */
+                        dataMisfit.calcReflectSources(adjointSourcesReflect, reflectivity, tStep);
+                        solverReflect->run(receivers, adjointSourcesReflect, model, *wavefieldsAdjointReflect, derivatives, tStep);
+                        if (wavefieldCompensation.isActive())
+                            *wavefieldsAdjointReflect *= wavefieldCompensation.getStepFactor();
+                    }
+                }
+                if (decomposition != 0) 
+                    wavefields->decompose(decomposition, *wavefieldsReflect, derivatives);
             }
-            energyPrecond.intSquaredWavefields(*wavefieldsAdjointTemp, isAdjoint, config.get<ValueType>("DT"));
-            if (gradientDomain == 0) { 
-                /*  Cross correlation in the time domain   */
-                //calculate temporal derivative of wavefield
-                *wavefieldsTemp = *wavefieldrecordReflect[floor(tStep / workflow.skipDT + 0.5)];
-                *wavefieldsTemp -= *wavefieldrecordReflect[floor(tStep / workflow.skipDT - 0.5)];
-                *wavefieldsTemp *= DTinv;      
-                *wavefieldsTemp *= workflow.skipDT; 
             
-                /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
-                ZeroLagXcorrReflect->update(*wavefieldsTemp, *wavefieldrecordReflect[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);                
-            } else if (gradientDomain == 1 || gradientDomain == 2) {
-                /* Cross correlation in the frequency domain */
-                ZeroLagXcorrReflect->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
-            } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
-                this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint, isReflect);
-            }
-        }                
-        if (workflow.workflowStage == 0 && workflow.iteration == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
-            if (gradientDomain == 0) {
-                if ((gradientKernel != 2 && decomposition == 0) || decomposition != 0) {
-                    ZeroLagXcorr->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber), tStep, workflow);
-                } else if (gradientKernel == 2 && decomposition == 0) {
-                    ZeroLagXcorrReflect->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".sourceReflect", tStep, workflow);
+            if (((gradientKernel != 2 && decomposition == 0) || decomposition != 0) && tStep % workflow.skipDT == 0) {
+                if (workflow.DHInversion > 1 && !workflow.restrictAfterAccumulation) {
+                    wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
+                } else {
+                    *wavefieldsAdjointTemp = *wavefields;
+                }
+                energyPrecond.intSquaredWavefields(*wavefieldsAdjointTemp, config.get<ValueType>("DT"), isAdjoint, wavefieldActivity.getAdjointRanges(tStep));
+                auto const *activeRanges = wavefieldActivity.getCorrelationRanges(tStep);
+                // nothing is correlated as long as the forward and the adjoint wavefield do not overlap
+                if (gradientDomain == 0 && (activeRanges == nullptr || !activeRanges->empty())) { 
+                    /*  Cross correlation in the time domain   */
+                    //calculate temporal derivative of wavefield
+                    *wavefieldsTemp = *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)];
+                    *wavefieldsTemp -= *wavefieldrecord[floor(tStep / workflow.skipDT - 0.5)];
+                    *wavefieldsTemp *= DTinv;      
+                    *wavefieldsTemp *= workflow.skipDT; 
+            
+                    /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
+                    {
+                        PhaseTimer::Scope timerXcorr("xcorr");
+                        ZeroLagXcorr->setActiveRanges(activeRanges);
+                        ZeroLagXcorr->update(*wavefieldsTemp, *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);
+                        ZeroLagXcorr->setActiveRanges(nullptr);
+                    }
+                } else if (gradientDomain == 1 || gradientDomain == 2) {
+                    /* Cross correlation in the frequency domain */
+                    ZeroLagXcorr->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
+                } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
+                    this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
+                }
+            } else if (gradientKernel == 2 && decomposition == 0 && tStep % workflow.skipDT == 0) {
+                if (workflow.DHInversion > 1 && !workflow.restrictAfterAccumulation) {
+                    wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
+                } else {
+                    *wavefieldsAdjointTemp = *wavefields;
+                }
+                energyPrecond.intSquaredWavefields(*wavefieldsAdjointTemp, config.get<ValueType>("DT"), isAdjoint);
+                if (gradientDomain == 0) { 
+                    /*  Cross correlation in the time domain   */
+                    //calculate temporal derivative of wavefield
+                    *wavefieldsTemp = *wavefieldrecordReflect[floor(tStep / workflow.skipDT + 0.5)];
+                    *wavefieldsTemp -= *wavefieldrecordReflect[floor(tStep / workflow.skipDT - 0.5)];
+                    *wavefieldsTemp *= DTinv;      
+                    *wavefieldsTemp *= workflow.skipDT; 
+            
+                    /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
+                    {
+                        PhaseTimer::Scope timerXcorr("xcorr");
+                        ZeroLagXcorrReflect->update(*wavefieldsTemp, *wavefieldrecordReflect[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);
+                    }
+                } else if (gradientDomain == 1 || gradientDomain == 2) {
+                    /* Cross correlation in the frequency domain */
+                    ZeroLagXcorrReflect->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
+                } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
+                    this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint, isReflect);
                 }
+                if (singlePassReflect)
+                    correlateAdjointReflect(*wavefieldsAdjointReflect, tStep, tStepEnd, derivatives, sources, model, wavefieldrecord, config, shotNumber, shotIndTrue, workflow, wavefieldTaper2D, energyPrecondReflect);
+            }                
+            if (workflow.workflowStage == 0 && workflow.iteration == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
+                if (gradientDomain == 0) {
+                    if ((gradientKernel != 2 && decomposition == 0) || decomposition != 0) {
+                        ZeroLagXcorr->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber), tStep, workflow);
+                    } else if (gradientKernel == 2 && decomposition == 0) {
+                        ZeroLagXcorrReflect->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".sourceReflect", tStep, workflow);
+                    }
+                }
+                wavefields->write(snapType, config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiver", tStep, derivatives, model, config.get<IndexType>("FileFormat"));
             }
-            wavefields->write(snapType, config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiver", tStep, derivatives, model, config.get<IndexType>("FileFormat"));
         }
+        solver.resetCPML();
+        if (singlePassReflect)
+            solverReflect->resetCPML();
     }
-    solver.resetCPML();
 
     // check wavefield for NaNs or infinite values
-    if (commShot->any(!wavefields->isFinite(dist)) && commInterShot->getRank()==0){ // if any processor returns isfinite=false, write model and break
+    if (commShot->any(!wavefields->isFinite(dist) || (singlePassReflect && !wavefieldsAdjointReflect->isFinite(dist))) && commInterShot->getRank()==0){ // if any processor returns isfinite=false, write model and break
         model.write("model_crash", config.get<IndexType>("FileFormat"));
         COMMON_THROWEXCEPTION("Infinite or NaN value in adjoint wavefield, output model as model_crash.FILE_EXTENSION!");
     }
 
+    if (gradientKernel == 2 && decomposition == 0 && !singlePassReflect) {
+        dataMisfit.calcReflectSources(adjointSourcesReflect, reflectivity);
+        wavefields->resetWavefields();
+    
+        {
+            PhaseTimer::Scope timerAdjointReflect("adjointReflect");
+            for (IndexType tStep = tStepEnd - 1; tStep > 0; tStep--) {
+            
+                solver.run(receivers, adjointSourcesReflect, model, *wavefields, derivatives, tStep);
+
+                if (wavefieldCompensation.isActive())
+                    *wavefields *= wavefieldCompensation.getStepFactor();
+            
+                if (tStep % workflow.skipDT == 0)
+                    correlateAdjointReflect(*wavefields, tStep, tStepEnd, derivatives, sources, model, wavefieldrecord, config, shotNumber, shotIndTrue, workflow, wavefieldTaper2D, energyPrecondReflect);
+            }       
+            solver.resetCPML();
+        }
+    }
+
     /* ---------------------------------- */
     /*       Calculate gradients          */
     /* ---------------------------------- */
-    SourceTaper.init(dist, ctx, sources, config, modelCoordinates, config.get<IndexType>("sourceTaperRadius"));
-    ReceiverTaper.init(dist, ctx, receivers, config, modelCoordinates, config.get<IndexType>("receiverTaperRadius"));
-    if (useSourceEncode != 0) {
-        sourceReceiverTaper.init(commShot, dist, ctx, config, modelCoordinates, sourceSettingsEncode, shotNumber);
-    } else {
-        sourceReceiverTaper.init(dist, ctx, sources, receivers, config, modelCoordinates);
-    }
-    sourceReceiverTaper.stack(SourceTaper.getTaper());
-    sourceReceiverTaper.stack(ReceiverTaper.getTaper());
-    if (gradientDomain != 0) {        
-        /* Cross correlation in the frequency domain */
-        std::string filename = config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber);
-        if (gradientKernel == 2 && decomposition == 0) {
-            filename += ".sourceReflect";
+    scai::lama::DenseVector<ValueType> mask; //mask to restore vacuum
+    {
+        PhaseTimer::Scope timerPostprocessing("postprocessing");
+        std::vector<IndexType> taperKey;
+        if (useSourceEncode != 0) {
+            taperKey = Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(sourceSettingsEncode, shotNumber);
+        } else {
+            taperKey = Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(shotNumber, Preconditioning::SourceReceiverTaperCache<ValueType>::SHOT);
         }
-        ZeroLagXcorr->sumWavefields(commShot, filename, config.getAndCatch("snapType", 0), workflow, sources.getSourceFC(shotIndTrue), config.get<ValueType>("DT"), shotNumber, sourceReceiverTaper.getTaperEncode());
-    }
-    if (config.getAndCatch("DHInversion", 1) > 1)
-        ZeroLagXcorr->applyTransform(wavefieldTaper2D.getRecoverMatrix(), workflow);
-    gradientPerShot.estimateParameter(*ZeroLagXcorr, model, config.get<ValueType>("DT"), workflow);
-    ZeroLagXcorr->resetXcorr(workflow);
+        scai::lama::SparseVector<ValueType> taperCached;
+        std::vector<scai::lama::SparseVector<ValueType>> taperEncodeCached;
+        if (taperCache.restore(taperKey, taperCached, taperEncodeCached)) {
+            sourceReceiverTaper.setTaper(taperCached, taperEncodeCached);
+        } else {
+            SourceTaper.init(dist, ctx, sources, config, modelCoordinates, config.get<IndexType>("sourceTaperRadius"));
+            ReceiverTaper.init(dist, ctx, receivers, config, modelCoordinates, config.get<IndexType>("receiverTaperRadius"));
+            if (useSourceEncode != 0) {
+                sourceReceiverTaper.init(commShot, dist, ctx, config, modelCoordinates, sourceSettingsEncode, shotNumber, taperCache);
+            } else {
+                sourceReceiverTaper.init(dist, ctx, sources, receivers, config, modelCoordinates);
+            }
+            sourceReceiverTaper.stack(SourceTaper.getTaper());
+            sourceReceiverTaper.stack(ReceiverTaper.getTaper());
+            taperCache.store(taperKey, sourceReceiverTaper.getTaper(), sourceReceiverTaper.getTaperEncode());
+        }
+        if (gradientDomain != 0) {        
+            /* Cross correlation in the frequency domain */
+            std::string filename = config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber);
+            if (gradientKernel == 2 && decomposition == 0) {
+                filename += ".sourceReflect";
+            }
+            ZeroLagXcorr->sumWavefields(commShot, filename, config.getAndCatch("snapType", 0), workflow, sources.getSourceFC(shotIndTrue), config.get<ValueType>("DT"), shotNumber, sourceReceiverTaper.getTaperEncode());
+        }
+        if (workflow.DHInversion > 1 && workflow.restrictAfterAccumulation) {
+            ZeroLagXcorr->applyBlockAverage(wavefieldTaper2D.getBlockAverage());
+        } else if (workflow.DHInversion > 1) {
+            ZeroLagXcorr->applyTransform(wavefieldTaper2D.getRecoverMatrix(), workflow);
+        }
+        gradientPerShot.estimateParameter(*ZeroLagXcorr, model, config.get<ValueType>("DT"), workflow);
+        ZeroLagXcorr->resetXcorr(workflow);
     
-    if (gradientDomain == 0) {
-        sourceReceiverTaper.apply(gradientPerShot);
-    }
+        if (gradientDomain == 0) {
+            sourceReceiverTaper.apply(gradientPerShot);
+        }
 
-    /* Apply energy preconditioning per shot */
-    if (config.getAndCatch("DHInversion", 1) > 1)
-        energyPrecond.applyTransform(wavefieldTaper2D.getRecoverMatrix());
-    energyPrecond.apply(gradientPerShot, shotNumber, config.get<IndexType>("FileFormat"));
-    gradientPerShot.applyMedianFilter(commAll, config);  
+        /* Apply energy preconditioning per shot */
+        if (workflow.DHInversion > 1 && workflow.restrictAfterAccumulation) {
+            energyPrecond.applyBlockAverage(wavefieldTaper2D.getBlockAverage());
+        } else if (workflow.DHInversion > 1) {
+            energyPrecond.applyTransform(wavefieldTaper2D.getRecoverMatrix());
+        }
+        energyPrecond.apply(gradientPerShot, shotNumber, config.get<IndexType>("FileFormat"));
+        gradientPerShot.applyMedianFilter(commAll, config);  
     
-    scai::lama::DenseVector<ValueType> mask; //mask to restore vacuum
-    if (isSeismic) {
-        if(equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0){
-            mask = model.getVelocityS();  
-        } else {
-            mask = model.getVelocityP();      
-        }  
-    } else {    
-        mask = model.getDielectricPermittivity();
-        mask /= model.getDielectricPermittivityVacuum();  // calculate the relative dielectricPermittivity    
-        mask -= 1;
-    }
-    mask.unaryOp(mask, common::UnaryOp::SIGN);
-    mask.unaryOp(mask, common::UnaryOp::ABS); 
-    gradientPerShot *= mask;
+        if (isSeismic) {
+            if(equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0){
+                mask = model.getVelocityS();  
+            } else {
+                mask = model.getVelocityP();      
+            }  
+        } else {    
+            mask = model.getDielectricPermittivity();
+            mask /= model.getDielectricPermittivityVacuum();  // calculate the relative dielectricPermittivity    
+            mask -= 1;
+        }
+        mask.unaryOp(mask, common::UnaryOp::SIGN);
+        mask.unaryOp(mask, common::UnaryOp::ABS); 
+        gradientPerShot *= mask;
 
-    gradientPerShot.normalize();
+        gradientPerShot.normalize();
+    }
     
     end_t_shot = common::Walltime::get();
     HOST_PRINT(commShot, "Shot number " << shotNumber << ": Finish gradient calculation in " << end_t_shot - start_t_shot << " sec.\n");
@@ -296,53 +476,6 @@ void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr co
     if (gradientKernel == 2 && decomposition == 0) {
         typename KITGPI::Gradient::Gradient<ValueType>::GradientPtr testgradient(KITGPI::Gradient::Factory<ValueType>::Create(equationType));
         *testgradient = gradientPerShot;
-        scai::lama::DenseVector<ValueType> reflectivity;
-        reflectivity = model.getReflectivity();
-        dataMisfit.calcReflectSources(adjointSourcesReflect, reflectivity);
-        wavefields->resetWavefields();
-    
-        for (IndexType tStep = tStepEnd - 1; tStep > 0; tStep--) {
-            
-            solver.run(receivers, adjointSourcesReflect, model, *wavefields, derivatives, tStep);
-
-            if (config.getAndCatch("compensation", 0))
-                *wavefields *= compensation;
-            
-            /* --------------------------------------- */
-            /*  Cross correlation in the time domain   */
-            /* --------------------------------------- */
-            if (tStep % workflow.skipDT == 0) {
-                if (config.getAndCatch("DHInversion", 1) > 1) {
-                    wavefieldsAdjointTemp->applyTransform(wavefieldTaper2D.getAverageMatrix(), *wavefields);
-                } else {
-                    *wavefieldsAdjointTemp = *wavefields;
-                }
-                energyPrecondReflect.intSquaredWavefields(*wavefieldsAdjointTemp, isAdjoint, config.get<ValueType>("DT"));
-                if (gradientDomain == 0) { 
-                    /*  Cross correlation in the time domain   */
-                    //calculate temporal derivative of wavefield
-                    *wavefieldsTemp = *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)];
-                    *wavefieldsTemp -= *wavefieldrecord[floor(tStep / workflow.skipDT - 0.5)];
-                    *wavefieldsTemp *= DTinv;      
-                    *wavefieldsTemp *= workflow.skipDT; 
-                
-                    /* please note that we exchange the position of the derivative and the forwardwavefield itself, which is different with the defination in ZeroLagXcorr function */
-                    ZeroLagXcorr->update(*wavefieldsTemp, *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)], *wavefieldsAdjointTemp, workflow);                    
-                } else if (gradientDomain == 1 || gradientDomain == 2) {
-                    /* Cross correlation in the frequency domain */
-                    ZeroLagXcorr->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
-                } else if (gradientDomain == 3 && tStep < tStepEnd / 2) {
-                    this->gatherWavefields(*wavefieldsAdjointTemp, sources.getSourceFC(shotIndTrue), workflow, tStep, config.get<ValueType>("DT"), isAdjoint);
-                }
-                if (workflow.workflowStage == 0 && workflow.iteration == 0 && config.getAndCatch("snapType", 0) > 0 && tStep >= Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT")) && tStep <= Common::time2index(config.get<ValueType>("tlastSnapshot"), config.get<ValueType>("DT")) && (tStep - Common::time2index(config.get<ValueType>("tFirstSnapshot"), config.get<ValueType>("DT"))) % Common::time2index(config.get<ValueType>("tincSnapshot"), config.get<ValueType>("DT")) == 0) {
-                    if (gradientDomain == 0) {
-                        ZeroLagXcorr->write(config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiverReflect", tStep, workflow);
-                    }
-                    wavefields->write(config.getAndCatch("snapType", 0), config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiverReflect", tStep, derivatives, model, config.get<IndexType>("FileFormat"));
-                }
-            }
-        }       
-        solver.resetCPML();
         
         /* ---------------------------------- */
         /*       Calculate gradients          */
@@ -351,8 +484,11 @@ void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr co
             /* Cross correlation in the frequency domain */
             ZeroLagXcorrReflect->sumWavefields(commShot, config.getAndCatch<std::string>("WavefieldFileName", "") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration + 1) + ".shot_" + std::to_string(shotNumber) + ".receiverReflect", config.getAndCatch("snapType", 0), workflow, sources.getSourceFC(shotIndTrue), config.get<ValueType>("DT"), shotNumber, sourceReceiverTaper.getTaperEncode());
         }  
-        if (config.getAndCatch("DHInversion", 1) > 1)
-            ZeroLagXcorrReflect->applyTransform(wavefieldTaper2D.getRecoverMatrix(), workflow); 
+        if (workflow.DHInversion > 1 && workflow.restrictAfterAccumulation) {
+            ZeroLagXcorrReflect->applyBlockAverage(wavefieldTaper2D.getBlockAverage());
+        } else if (workflow.DHInversion > 1) {
+            ZeroLagXcorrReflect->applyTransform(wavefieldTaper2D.getRecoverMatrix(), workflow);
+        } 
         gradientPerShot.estimateParameter(*ZeroLagXcorrReflect, model, config.get<ValueType>("DT"), workflow);
         ZeroLagXcorrReflect->resetXcorr(workflow);
     
@@ -361,8 +497,11 @@ void KITGPI::GradientCalculation<ValueType>::run(scai::dmemo::CommunicatorPtr co
         }
 
         /* Apply energy preconditioning per shot */
-        if (config.getAndCatch("DHInversion", 1) > 1)
+        if (workflow.DHInversion > 1 && workflow.restrictAfterAccumulation) {
+            energyPrecondReflect.applyBlockAverage(wavefieldTaper2D.getBlockAverage());
+        } else if (workflow.DHInversion > 1) {
             energyPrecondReflect.applyTransform(wavefieldTaper2D.getRecoverMatrix());
+        }
         energyPrecondReflect.apply(gradientPerShot, shotNumber, config.get<IndexType>("FileFormat"));
         gradientPerShot.applyMedianFilter(commAll, config); 
         gradientPerShot *= mask;
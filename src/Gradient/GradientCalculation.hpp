@@ -18,9 +18,14 @@
 #include <ForwardSolver/Derivatives/DerivativesFactory.hpp>
 #include <ForwardSolver/SourceReceiverImpl/SourceReceiverImplFactory.hpp>
 #include <ForwardSolver/ForwardSolver.hpp>
+#include <ForwardSolver/ForwardSolverFactory.hpp>
 #include <Modelparameter/ModelparameterFactory.hpp>
 #include <Wavefields/WavefieldsFactory.hpp>
 #include "../Workflow/Workflow.hpp"
+#include "../Common/PhaseTimer.hpp"
+#include "../Common/TimeWindow.hpp"
+#include "../Common/WavefieldActivity.hpp"
+#include "../Common/WavefieldCompensation.hpp"
 #include "../Taper/Taper2D.hpp"
 
 using namespace scai;
@@ -36,16 +41,19 @@ namespace KITGPI
 
     public:
         /* Default constructor and destructor */
-        GradientCalculation(){};
+        GradientCalculation() : isSolverReflectInitialized(false){};
         ~GradientCalculation(){};
 
         void allocate(KITGPI::Configuration::Configuration config, scai::dmemo::DistributionPtr dist, scai::dmemo::DistributionPtr distInversion, scai::hmemo::ContextPtr ctx, KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType numShotPerSuperShot);
         void gatherWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefieldsInversion, scai::lama::DenseVector<ValueType> sourceFC, KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType tStep, ValueType DT, bool isAdjoint = false, bool isReflect = false);
+        static bool isSinglePassReflect(KITGPI::Configuration::Configuration const &config);
+        void prepareForModelling(KITGPI::Configuration::Configuration const &config, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, bool isNewModel);
         
         /* Calculate gradients */
-        void run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> wavefieldTaper2D, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecordReflect, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> energyPrecond, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> energyPrecondReflect, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode);
+        void run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> const &adjointSources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> wavefieldTaper2D, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecordReflect, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecond, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecondReflect, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType> &taperCache, KITGPI::TimeWindow<ValueType> &timeWindow, KITGPI::WavefieldActivity<ValueType> &wavefieldActivity, KITGPI::WavefieldCompensation<ValueType> const &wavefieldCompensation);
 
     private:
+        void correlateAdjointReflect(KITGPI::Wavefields::Wavefields<ValueType> &wavefieldsAdjointReflect, scai::IndexType tStep, scai::IndexType tStepEnd, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> &sources, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, std::vector<typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr> &wavefieldrecord, KITGPI::Configuration::Configuration const &config, int shotNumber, int shotIndTrue, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Taper::Taper2D<ValueType> &wavefieldTaper2D, KITGPI::Preconditioning::EnergyPreconditioning<ValueType> &energyPrecondReflect);
 
         typedef typename KITGPI::ZeroLagXcorr::ZeroLagXcorr<ValueType>::ZeroLagXcorrPtr ZeroLagXcorrPtr;
         ZeroLagXcorrPtr ZeroLagXcorr;
@@ -56,6 +64,10 @@ namespace KITGPI
         wavefieldPtr wavefieldsReflect;
         wavefieldPtr wavefieldsTemp;
         wavefieldPtr wavefieldsAdjointTemp;
+        wavefieldPtr wavefieldsAdjointReflect; // reflection adjoint wavefield of the single pass (useSinglePassReflect)
+
+        typename KITGPI::ForwardSolver::ForwardSolver<ValueType>::ForwardSolverPtr solverReflect; // own solver, the boundary memory variables of the two adjoint wavefields differ
+        bool isSolverReflectInitialized;
 
         KITGPI::Preconditioning::SourceReceiverTaper<ValueType> SourceTaper;
         KITGPI::Preconditioning::SourceReceiverTaper<ValueType> ReceiverTaper;
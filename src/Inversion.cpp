@@ -38,7 +38,10 @@
 #include "Workflow/Workflow.hpp"
 
 #include <Common/HostPrint.hpp>
+#include "Common/Checkpoint.hpp"
 #include "Common/InversionSingle.hpp"
+#include "Common/MemoryLedger.hpp"
+#include "Common/PhaseTimer.hpp"
 
 using namespace scai;
 using namespace KITGPI;
@@ -51,6 +54,19 @@ int main(int argc, char *argv[])
     globalStart_t = common::Walltime::get();
     IndexType seedtime = (int)time(0);
     
+    /* --resume continues the inversion from the last checkpoint */
+    bool resume = false;
+    std::vector<char *> arguments;
+    for (int i = 0; i < argc; i++) {
+        if (std::string(argv[i]) == "--resume") {
+            resume = true;
+        } else {
+            arguments.push_back(argv[i]);
+        }
+    }
+    argc = arguments.size();
+    argv = arguments.data();
+    
     /* --------------------------------------- */
     /* Read configuration from file            */
     /* --------------------------------------- */
@@ -132,6 +148,11 @@ int main(int argc, char *argv[])
     std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
     std::string logFilename = config.get<std::string>("logFilename");
     IndexType gradientKernel = config.getAndCatch("gradientKernel", 0);
+    PhaseTimer::setEnabled(config.getAndCatch("usePhaseTimers", false));
+    std::string phaseTimerFilename = config.getAndCatch<std::string>("phaseTimerFilename", logFilename.substr(0, logFilename.length() - 4) + ".timing");
+    IndexType checkpointInterval = config.getAndCatch("checkpointInterval", 0);
+    IndexType checkpointStop = config.getAndCatch("checkpointStop", 0);
+    std::string checkpointFilename = config.getAndCatch<std::string>("checkpointFilename", logFilename.substr(0, logFilename.length() - 4) + ".checkpoint");
     
     std::string misfitTypeEM = configEM.get<std::string>("misfitType");
     std::transform(misfitTypeEM.begin(), misfitTypeEM.end(), misfitTypeEM.begin(), ::tolower);
@@ -243,20 +264,16 @@ int main(int argc, char *argv[])
     if (inversionType > 1 || inversionTypeEM > 1 || config.getAndCatch("saveCrossGradientMisfit", 0) || configEM.getAndCatch("saveCrossGradientMisfit", 0)) {
         if (!useStreamConfig && !useStreamConfigEM) {
             modelTaper2DJoint.initTransformMatrix(dist, distEM, ctx);  
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinates, modelCoordinatesEM, 2);
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesEM, modelCoordinates, 1); 
+            modelTaper2DJoint.calcTransformMatrices(config, configEM, modelCoordinates, modelCoordinatesEM);
         } else if (useStreamConfig && !useStreamConfigEM) {
             modelTaper2DJoint.initTransformMatrix(distBig, distEM, ctx);  
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesBig, modelCoordinatesEM, 2);
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesEM, modelCoordinatesBig, 1); 
+            modelTaper2DJoint.calcTransformMatrices(config, configEM, modelCoordinatesBig, modelCoordinatesEM);
         } else if (!useStreamConfig && useStreamConfigEM) {
             modelTaper2DJoint.initTransformMatrix(dist, distBigEM, ctx);  
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinates, modelCoordinatesBigEM, 2);
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesBigEM, modelCoordinates, 1); 
+            modelTaper2DJoint.calcTransformMatrices(config, configEM, modelCoordinates, modelCoordinatesBigEM);
         } else if (useStreamConfig && useStreamConfigEM) {
             modelTaper2DJoint.initTransformMatrix(distBig, distBigEM, ctx);  
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesBig, modelCoordinatesBigEM, 2);
-            modelTaper2DJoint.calcTransformMatrix(modelCoordinatesBigEM, modelCoordinatesBig, 1); 
+            modelTaper2DJoint.calcTransformMatrices(config, configEM, modelCoordinatesBig, modelCoordinatesBigEM);
         }
     }
     
@@ -267,20 +284,56 @@ int main(int argc, char *argv[])
     /*       Loop over workflow stages         */
     /* --------------------------------------- */
     IndexType stageCount = 0;
-    for (workflow.workflowStage = 0; workflow.workflowStage < workflow.maxStage; workflow.workflowStage++) {
+    IndexType iterationCount = 0;
+    IndexType resumeStage = 0;
+    IndexType resumeIteration = 0;
+    Checkpoint checkpoint;
+    if (resume) {
+        checkpoint.openRead(commAll, checkpointFilename, sizeof(ValueType));
+        checkpoint.read(resumeStage);
+        checkpoint.read(resumeIteration);
+        checkpoint.read(iterationCount);
+        checkpoint.read(stageCount);
+        checkpoint.read(seedtime);
+        checkpoint.read(breakLoop);
+        checkpoint.read(breakLoopEM);
+        checkpoint.checkConsistency(iterationCount, "iteration count");
+        SCAI_ASSERT_ERROR(resumeStage < workflow.maxStage, "Checkpoint stage " << resumeStage + 1 << " does not exist in the workflow");
+        HOST_PRINT(commAll, "\nResume inversion from checkpoint " << checkpointFilename << " after stage " << resumeStage + 1 << ", iteration " << resumeIteration + 1 << "\n");
+    }
+    /* the communicator between the shot domains is only needed by the phase timer reports, the split is collective and done once */
+    dmemo::CommunicatorPtr commShot = dist->getCommunicatorPtr();
+    dmemo::CommunicatorPtr commInterShot;
+    if (PhaseTimer::isEnabled())
+        commInterShot = commAll->split(commShot->getRank());
+    
+    for (workflow.workflowStage = resumeStage; workflow.workflowStage < workflow.maxStage; workflow.workflowStage++) {
         workflowEM.workflowStage = workflow.workflowStage;
         bool breakLoopLast = breakLoop;
         bool breakLoopLastEM = breakLoopEM;
         IndexType useRTM = 0; 
         IndexType useRTMEM = 0; 
         
-        inversionSingle.initStage(commAll, config, inversionType, 1, ctx, workflow, dataMisfit, breakLoop, dist, breakLoopEM);        
-        inversionSingleEM.initStage(commAll, configEM, inversionTypeEM, 2, ctx, workflowEM, dataMisfitEM, breakLoopEM, distEM, breakLoop);
+        inversionSingle.initStage(commAll, config, inversionType, 1, ctx, workflow, dataMisfit, breakLoop, dist, breakLoopEM, *model);        
+        inversionSingleEM.initStage(commAll, configEM, inversionTypeEM, 2, ctx, workflowEM, dataMisfitEM, breakLoopEM, distEM, breakLoop, *modelEM);
+        
+        IndexType firstIteration = 0;
+        if (resume) {
+            checkpoint.read(breakLoop);
+            checkpoint.read(breakLoopEM);
+            checkpoint.read(useRTM);
+            checkpoint.read(useRTMEM);
+            inversionSingle.readCheckpoint(checkpoint, commAll, *model, *dataMisfit, SLsearch, inversionType);
+            inversionSingleEM.readCheckpoint(checkpoint, commAll, *modelEM, *dataMisfitEM, SLsearchEM, inversionTypeEM);
+            checkpoint.close();
+            firstIteration = resumeIteration + 1;
+            resume = false;
+        }
         
         /* --------------------------------------- */
         /*        Loop over iterations             */
         /* --------------------------------------- */ 
-        for (workflow.iteration = 0; workflow.iteration < maxiterations; workflow.iteration++) {
+        for (workflow.iteration = firstIteration; workflow.iteration < maxiterations; workflow.iteration++) {
             workflowEM.iteration = workflow.iteration;
             /* --------------------------------------- */
             /*        Start the first inversion        */
@@ -391,7 +444,40 @@ int main(int argc, char *argv[])
             }
 
             inversionSingleEM.runExtraModelling(commAll, distEM, modelEM, configEM, modelCoordinatesEM, modelCoordinatesBigEM, workflowEM, dataMisfitEM, crossGradientDerivativeEM, derivativesInversionEM, SLsearchEM, modelTaper2DJoint, maxiterations, useRTMEM, breakLoopEM, ctx, seedtime, inversionTypeEM, 2, breakLoop, model, config, modelCoordinates, workflow, dataMisfit, crossGradientDerivative, derivativesInversion);  
+            
+            PhaseTimer::writeReport(commAll, commShot, commInterShot, phaseTimerFilename, workflow.workflowStage + 1, workflow.iteration + 1);
+            
+            iterationCount++;
+            if (checkpointInterval > 0 && (iterationCount % checkpointInterval == 0 || iterationCount == checkpointStop)) {
+                checkpoint.openWrite(commAll, checkpointFilename, sizeof(ValueType));
+                checkpoint.write(workflow.workflowStage);
+                checkpoint.write(workflow.iteration);
+                checkpoint.write(iterationCount);
+                checkpoint.write(stageCount);
+                checkpoint.write(seedtime);
+                checkpoint.write(breakLoopLast);
+                checkpoint.write(breakLoopLastEM);
+                checkpoint.write(breakLoop);
+                checkpoint.write(breakLoopEM);
+                checkpoint.write(useRTM);
+                checkpoint.write(useRTMEM);
+                inversionSingle.writeCheckpoint(checkpoint, commAll, *model, *dataMisfit, SLsearch, inversionType);
+                inversionSingleEM.writeCheckpoint(checkpoint, commAll, *modelEM, *dataMisfitEM, SLsearchEM, inversionTypeEM);
+                checkpoint.commit();
+                HOST_PRINT(commAll, "\nWrote checkpoint " << checkpointFilename << " after stage " << workflow.workflowStage + 1 << ", iteration " << workflow.iteration + 1 << "\n");
+                if (iterationCount == checkpointStop) {
+                    HOST_PRINT(commAll, "\nStop inversion after " << iterationCount << " iterations (checkpointStop)\n");
+                    return 0;
+                }
+            }
         } // end of loop over iterations 
+        
+        if (workflow.iteration < maxiterations) {
+            // the iteration loop was left with break, the phases of this iteration are not reported yet
+            PhaseTimer::writeReport(commAll, commShot, commInterShot, phaseTimerFilename, workflow.workflowStage + 1, workflow.iteration + 1);
+        }
+        
+        MemoryLedger::print(commAll, "stage " + std::to_string(workflow.workflowStage + 1));
     
         if (workflow.workflowStage < workflow.maxStage - 1) {
             if (breakLoop == true && breakLoopEM == true) {
@@ -19,6 +19,26 @@ void KITGPI::Misfit::Misfit<ValueType>::setMisfitTypeShots(scai::lama::DenseVect
     misfitTypeShots = setMisfitTypeShots;
 }
 
+/*! \brief set the active traces of the shots which are used for the misfit and the adjoint sources
+ *
+ \param setTraceCompaction Active traces, nullptr to use all traces
+ */
+template <typename ValueType>
+void KITGPI::Misfit::Misfit<ValueType>::setTraceCompaction(KITGPI::TraceCompaction<ValueType> const *setTraceCompaction)
+{    
+    traceCompaction = setTraceCompaction;
+}
+
+/*! \brief set the decimation of the traces which is used for the misfit and the adjoint sources
+ *
+ \param setSeismogramDecimation Decimation of the current workflow stage, nullptr to use the traces sampled with DT
+ */
+template <typename ValueType>
+void KITGPI::Misfit::Misfit<ValueType>::setSeismogramDecimation(KITGPI::SeismogramDecimation<ValueType> const *setSeismogramDecimation)
+{    
+    seismogramDecimation = setSeismogramDecimation;
+}
+
 /*! \brief get misfitSum0Ratio of all shots
  *
  */
@@ -142,6 +162,34 @@ void KITGPI::Misfit::Misfit<ValueType>::clearStorage()
     this->crossGradientMisfitStorage.clear();
 }
 
+/*! \brief Write the misfit storage to a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Misfit::Misfit<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    checkpoint.write(misfitType);
+    checkpoint.write(misfitStorage);
+    checkpoint.write(misfitStorageL2);
+    checkpoint.write(misfitSum0Ratio);
+    checkpoint.write(crossGradientMisfitStorage);
+    checkpoint.write(misfitTypeShots);
+}
+
+/*! \brief Read the misfit storage from a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Misfit::Misfit<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    checkpoint.read(misfitType);
+    checkpoint.read(misfitStorage);
+    checkpoint.read(misfitStorageL2);
+    checkpoint.read(misfitSum0Ratio);
+    checkpoint.read(crossGradientMisfitStorage);
+    checkpoint.read(misfitTypeShots);
+}
+
 /*! \brief Set number of Relaxation Mechanisms
  */
 template <typename ValueType>
@@ -229,6 +277,8 @@ KITGPI::Misfit::Misfit<ValueType> &KITGPI::Misfit::Misfit<ValueType>::operator=(
     modelDerivativeY = rhs.modelDerivativeY;
     fkHandler = rhs.fkHandler;
     nFFT = rhs.nFFT;
+    traceCompaction = rhs.traceCompaction;
+    seismogramDecimation = rhs.seismogramDecimation;
     
     return *this;
 }
@@ -251,5 +301,29 @@ void KITGPI::Misfit::Misfit<ValueType>::calcReflectSources(KITGPI::Acquisition::
     }     
 }
 
+/*! \brief Calculate the reflection sources of one time step
+ *
+ * Gives the same samples as the calculation of all time steps, e.g. to propagate the reflection adjoint wavefield in the loop in which its sources are gathered.
+ \param sourcesReflect sources for reflection.
+ \param reflectivity reflectivity model.
+ \param tStep time step (column of the seismograms).
+ */
+template <typename ValueType>
+void KITGPI::Misfit::Misfit<ValueType>::calcReflectSources(KITGPI::Acquisition::Receivers<ValueType> &sourcesReflect, scai::lama::DenseVector<ValueType> reflectivity, scai::IndexType tStep)
+{
+    scai::lama::DenseVector<ValueType> sample;
+    for (int i=0; i<KITGPI::Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; i++) {
+        scai::lama::DenseMatrix<ValueType> &data = sourcesReflect.getSeismogramHandler().getSeismogram(static_cast<Acquisition::SeismogramType>(i)).getData();
+        if (data.getNumRows() != 0) {
+            if (static_cast<Acquisition::SeismogramTypeEM>(i) == Acquisition::SeismogramTypeEM::HZ) {
+                reflectivity *= -1;        
+            }
+            data.getColumn(sample, tStep);
+            sample *= reflectivity;
+            data.setColumn(sample, tStep, scai::common::BinaryOp::COPY);
+        }
+    }     
+}
+
 template class KITGPI::Misfit::Misfit<double>;
 template class KITGPI::Misfit::Misfit<float>;
@@ -4,7 +4,11 @@
 #include <vector>
 #include <Acquisition/Receivers.hpp>
 #include <Common/Hilbert.hpp>
+#include "../Common/Checkpoint.hpp"
 #include "../Common/FK.hpp"
+#include "../Common/PhaseTimer.hpp"
+#include "../Common/SeismogramDecimation.hpp"
+#include "../Common/TraceCompaction.hpp"
 #include "../Common/Common.hpp"
 #include <scai/lama/fft.hpp>
 
@@ -37,6 +41,7 @@ namespace KITGPI
             virtual void calcMisfitAndAdjointSources(scai::dmemo::CommunicatorPtr commShot, scai::lama::DenseVector<ValueType> &misfitPerIt, KITGPI::Acquisition::Receivers<ValueType> &adjointSourcesEncode, KITGPI::Acquisition::Receivers<ValueType> const &receivers, KITGPI::Acquisition::Receivers<ValueType> const &receiversTrue, scai::IndexType shotIndTrue, scai::IndexType shotNumberEncode, KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, ValueType vmin, scai::IndexType &seedtime) = 0;            
             
             void calcReflectSources(KITGPI::Acquisition::Receivers<ValueType> &sourcesReflect, scai::lama::DenseVector<ValueType> reflectivity);  
+            void calcReflectSources(KITGPI::Acquisition::Receivers<ValueType> &sourcesReflect, scai::lama::DenseVector<ValueType> reflectivity, scai::IndexType tStep);
             
             scai::lama::Vector<ValueType> const &getModelDerivativeX();
             scai::lama::Vector<ValueType> const &getModelDerivativeY();
@@ -51,6 +56,8 @@ namespace KITGPI
             void addToCrossGradientMisfitStorage(ValueType crossGradientMisfit); 
             ValueType getCrossGradientMisfit(int iteration);
             void clearStorage();            
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint);
             
             virtual void appendMisfitTypeShotsToFile(scai::dmemo::CommunicatorPtr comm, std::string logFilename, scai::IndexType stage, scai::IndexType iteration) = 0;
             virtual void appendMisfitPerShotToFile(scai::dmemo::CommunicatorPtr comm, std::string logFilename, scai::IndexType stage, scai::IndexType iteration) = 0;
@@ -58,6 +65,8 @@ namespace KITGPI
             virtual void sumShotDomain(scai::dmemo::CommunicatorPtr commInterShot) = 0;
             scai::lama::DenseVector<ValueType> getMisfitTypeShots();
             void setMisfitTypeShots(scai::lama::DenseVector<ValueType> setMisfitTypeShots);
+            void setTraceCompaction(KITGPI::TraceCompaction<ValueType> const *setTraceCompaction);
+            void setSeismogramDecimation(KITGPI::SeismogramDecimation<ValueType> const *setSeismogramDecimation);
             std::vector<scai::lama::DenseVector<ValueType>> getMisfitSum0Ratio();
             void setMisfitSum0Ratio(std::vector<scai::lama::DenseVector<ValueType>> setMisfitSum0Ratio);
             ValueType getMisfitResidualMax(int iteration1, int iteration2);
@@ -83,6 +92,8 @@ namespace KITGPI
             scai::lama::DenseVector<ValueType> modelDerivativeX; //!< Vector storing model derivative in x direction.
             scai::lama::DenseVector<ValueType> modelDerivativeY; //!< Vector storing model derivative in y direction.
             bool writeAdjointSource = false;
+            KITGPI::TraceCompaction<ValueType> const *traceCompaction = nullptr; //!< Active traces of the shots, nullptr if all traces are used
+            KITGPI::SeismogramDecimation<ValueType> const *seismogramDecimation = nullptr; //!< Decimation of the traces, nullptr if the traces are sampled with DT
         };
     }
 }
@@ -236,6 +236,7 @@ void KITGPI::Misfit::MisfitL2<ValueType>::sumShotDomain(scai::dmemo::Communicato
 template <typename ValueType>
 void KITGPI::Misfit::MisfitL2<ValueType>::calcMisfitAndAdjointSources(scai::dmemo::CommunicatorPtr commShot, scai::lama::DenseVector<ValueType> &misfitPerIt, KITGPI::Acquisition::Receivers<ValueType> &adjointSourcesEncode, KITGPI::Acquisition::Receivers<ValueType> const &receivers, KITGPI::Acquisition::Receivers<ValueType> const &receiversTrue, scai::IndexType shotIndTrue, scai::IndexType shotNumberEncode, KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, ValueType vmin, scai::IndexType &seedtime)
 {      
+    PhaseTimer::Scope timerMisfit("misfitAndAdjointSources");
     IndexType useSourceEncode = config.getAndCatch("useSourceEncode", 0);
     if (useSourceEncode != 0) {
         double start_t_shot, end_t_shot; /* For timing */
@@ -341,6 +342,7 @@ void KITGPI::Misfit::MisfitL2<ValueType>::calcMisfitAndAdjointSources(scai::dmem
 template <typename ValueType>
 ValueType KITGPI::Misfit::MisfitL2<ValueType>::calc(KITGPI::Acquisition::Receivers<ValueType> const &receiversSyn, KITGPI::Acquisition::Receivers<ValueType> const &receiversObs, scai::IndexType shotInd)
 {        
+    PhaseTimer::Scope timerMisfit("misfit");
     KITGPI::Acquisition::Seismogram<ValueType> seismogramSyn;
     KITGPI::Acquisition::Seismogram<ValueType> seismogramObs;
     KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerSyn;
@@ -375,6 +377,20 @@ ValueType KITGPI::Misfit::MisfitL2<ValueType>::calc(KITGPI::Acquisition::Receive
         for (int i=0; i<KITGPI::Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; i++) {
             seismogramSyn = seismoHandlerSyn.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
             seismogramObs = seismoHandlerObs.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+            // the misfit of the active traces is normalized by the number of all traces
+            ValueType activeRatio = 1;
+            if (seismogramSyn.getData().getNumRows() != 0 && traceCompaction != nullptr && TraceCompaction<ValueType>::isSupportedMisfitType(misfitTypeShotL2) && traceCompaction->find(shotInd, i, seismogramSyn.getData())) {
+                activeRatio = 1.0 / seismogramSyn.getData().getNumRows();
+                traceCompaction->compact(seismogramSyn, shotInd, i);
+                traceCompaction->compact(seismogramObs, shotInd, i);
+                activeRatio *= seismogramSyn.getData().getNumRows();
+            }
+            if (seismogramSyn.getData().getNumRows() != 0 && seismogramDecimation != nullptr && seismogramDecimation->isActive() && SeismogramDecimation<ValueType>::isSupportedMisfitType(misfitTypeShotL2)) {
+                PhaseTimer::Scope timerDecimation("decimation");
+                activeRatio *= seismogramDecimation->getMisfitScale(seismogramSyn.getData().getNumColumns());
+                seismogramDecimation->decimate(seismogramSyn);
+                seismogramDecimation->decimate(seismogramObs);
+            }
             if (seismogramSyn.getData().getNumRows() != 0) {
                 switch (misfitTypeShotL2) {
                 case 3:
@@ -402,6 +418,7 @@ ValueType KITGPI::Misfit::MisfitL2<ValueType>::calc(KITGPI::Acquisition::Receive
                     misfit = this->calcL2(seismogramSyn, seismogramObs);
                     break;
                 }
+                misfit *= activeRatio;
                 misfitSum += misfit;
                 if (misfit != 0) count++;
             } 
@@ -466,6 +483,7 @@ ValueType KITGPI::Misfit::MisfitL2<ValueType>::calc(KITGPI::Acquisition::Receive
 template <typename ValueType>
 void KITGPI::Misfit::MisfitL2<ValueType>::calcAdjointSources(KITGPI::Acquisition::Receivers<ValueType> &adjointSources, KITGPI::Acquisition::Receivers<ValueType> const &receiversSyn, KITGPI::Acquisition::Receivers<ValueType> const &receiversObs, scai::IndexType shotInd)
 {      
+    PhaseTimer::Scope timerMisfit("adjointSources");
     KITGPI::Acquisition::Seismogram<ValueType> seismogramSyn;
     KITGPI::Acquisition::Seismogram<ValueType> seismogramObs;
     KITGPI::Acquisition::Seismogram<ValueType> seismogramAdj;
@@ -479,7 +497,27 @@ void KITGPI::Misfit::MisfitL2<ValueType>::calcAdjointSources(KITGPI::Acquisition
     for (int i=0; i<KITGPI::Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; i++) {
         seismogramSyn = seismoHandlerSyn.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
         seismogramObs = seismoHandlerObs.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
-        if (seismogramSyn.getData().getNumRows() != 0) {
+        bool isCompacted = seismogramSyn.getData().getNumRows() != 0 && traceCompaction != nullptr && TraceCompaction<ValueType>::isSupportedMisfitType(misfitTypeShotL2) && traceCompaction->find(shotInd, i, seismogramSyn.getData());
+        if (isCompacted) {
+            traceCompaction->compact(seismogramSyn, shotInd, i);
+            traceCompaction->compact(seismogramObs, shotInd, i);
+        }
+        // the adjoint sources are calculated on the decimated traces and interpolated to DT
+        scai::IndexType nt = seismogramSyn.getData().getNumColumns();
+        bool isDecimated = seismogramSyn.getData().getNumRows() != 0 && seismogramDecimation != nullptr && seismogramDecimation->isActive() && SeismogramDecimation<ValueType>::isSupportedMisfitType(misfitTypeShotL2);
+        ValueType maxNormObs = 0;
+        if (isDecimated) {
+            PhaseTimer::Scope timerDecimation("decimation");
+            maxNormObs = seismogramObs.getData().maxNorm();
+            seismogramDecimation->decimate(seismogramSyn);
+            seismogramDecimation->decimate(seismogramObs);
+        }
+        if (isCompacted && seismogramSyn.getData().getNumRows() == 0) {
+            // no active trace, the adjoint sources of the muted traces are zero
+            seismogramAdj = seismoHandlerSyn.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+            seismogramAdj.getData().scale(0);
+            adjointSources.getSeismogramHandler().getSeismogram(seismogramAdj.getTraceType()) = seismogramAdj;
+        } else if (seismogramSyn.getData().getNumRows() != 0) {
             switch (misfitTypeShotL2) {
             case 3:
                 this->calcAdjointSeismogramL2Convolved(seismogramAdj, seismogramSyn, seismogramObs);
@@ -506,6 +544,15 @@ void KITGPI::Misfit::MisfitL2<ValueType>::calcAdjointSources(KITGPI::Acquisition
                 this->calcAdjointSeismogramL2(seismogramAdj, seismogramSyn, seismogramObs);
                 break;
             } 
+            if (isDecimated) {
+                PhaseTimer::Scope timerDecimation("decimation");
+                seismogramDecimation->interpolate(seismogramAdj, nt);
+                // the maximum of the decimated traces depends on the sampling
+                if (seismogramAdj.getData().maxNorm() != 0)
+                    seismogramAdj.getData().scale(maxNormObs / seismogramAdj.getData().maxNorm());
+            }
+            if (isCompacted)
+                traceCompaction->expand(seismogramAdj, shotInd, i);
             adjointSources.getSeismogramHandler().getSeismogram(seismogramAdj.getTraceType()) = seismogramAdj;
         }
     } 
@@ -581,35 +628,22 @@ ValueType KITGPI::Misfit::MisfitL2<ValueType>::calcL2Convolved(KITGPI::Acquisiti
     scai::lama::DenseVector<ComplexValueType> fTraceObs;
     scai::lama::DenseVector<ValueType> refTrace;
 
-    fSignalSyn = scai::lama::cast<ComplexValueType>(seismogramSyntemp.getData());
-    fSignalSyn.resize(seismogramSyn.getData().getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(nFFT));
-    fSignalObs = scai::lama::cast<ComplexValueType>(seismogramObstemp.getData());
-    fSignalObs.resize(seismogramObs.getData().getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(nFFT));
+    // real-to-complex transforms of the traces, only the non-negative frequencies are calculated
+    traceFFT.init(seismogramSyn.getData().getNumColumns(), nFFT);
+    traceFFT.forward(seismogramSyn.getData(), fSignalSyn);
+    traceFFT.forward(seismogramObs.getData(), fSignalObs);
     
     SCAI_ASSERT_ERROR(seismogramSyn.getRefTraces().getNumRows() != 0, "refTrace must be a single trace!");
     seismogramSyn.getRefTraces().getRow(refTrace, 0);
-    fTraceSyn = scai::lama::cast<ComplexValueType>(refTrace);
-    fTraceSyn.resize(std::make_shared<scai::dmemo::NoDistribution>(nFFT));
+    traceFFT.forward(refTrace, fTraceSyn);
     seismogramObs.getRefTraces().getRow(refTrace, 0);
-    fTraceObs = scai::lama::cast<ComplexValueType>(refTrace);
-    fTraceObs.resize(std::make_shared<scai::dmemo::NoDistribution>(nFFT));
-
-    scai::lama::fft<ComplexValueType>(fSignalSyn, 1);
-    scai::lama::fft<ComplexValueType>(fSignalObs, 1);
-    scai::lama::fft<ComplexValueType>(fTraceSyn);
-    scai::lama::fft<ComplexValueType>(fTraceObs);
+    traceFFT.forward(refTrace, fTraceObs);
     
     fSignalSyn.scaleColumns(fTraceObs);
     fSignalObs.scaleColumns(fTraceSyn);
-    fSignalSyn *= (1.0 / ValueType(nFFT)); // proper fft normalization
-    fSignalObs *= (1.0 / ValueType(nFFT)); // proper fft normalization
 
-    scai::lama::ifft<ComplexValueType>(fSignalSyn, 1);
-    fSignalSyn.resize(seismogramSyn.getData().getRowDistributionPtr(), seismogramSyn.getData().getColDistributionPtr());
-    seismogramSyntemp.getData() = scai::lama::real(fSignalSyn);
-    scai::lama::ifft<ComplexValueType>(fSignalObs, 1);
-    fSignalObs.resize(seismogramObs.getData().getRowDistributionPtr(), seismogramObs.getData().getColDistributionPtr());
-    seismogramObstemp.getData() = scai::lama::real(fSignalObs);
+    traceFFT.inverse(fSignalSyn, seismogramSyntemp.getData());
+    traceFFT.inverse(fSignalObs, seismogramObstemp.getData());
 
     if (writeAdjointSource && !seismogramObs.getFilename().empty()) {
         seismogramSyntemp.getData().writeToFile(seismogramSyn.getFilename() + ".conv.mtx");
@@ -647,23 +681,15 @@ void KITGPI::Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2Convolved(KITGP
         scai::lama::DenseVector<ComplexValueType> fTraceObs;
         scai::lama::DenseVector<ValueType> refTrace;
 
-        fSignalSyn = scai::lama::cast<ComplexValueType>(seismogramSyntemp.getData());
-        fSignalSyn.resize(seismogramSyn.getData().getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(nFFT));
-        fSignalObs = scai::lama::cast<ComplexValueType>(seismogramObstemp.getData());
-        fSignalObs.resize(seismogramObs.getData().getRowDistributionPtr(), std::make_shared<scai::dmemo::NoDistribution>(nFFT));
+        traceFFT.init(seismogramSyn.getData().getNumColumns(), nFFT);
+        traceFFT.forward(seismogramSyn.getData(), fSignalSyn);
+        traceFFT.forward(seismogramObs.getData(), fSignalObs);
         
         SCAI_ASSERT_ERROR(seismogramSyn.getRefTraces().getNumRows() != 0, "refTrace must be a single trace!");
         seismogramSyn.getRefTraces().getRow(refTrace, 0);
-        fTraceSyn = scai::lama::cast<ComplexValueType>(refTrace);
-        fTraceSyn.resize(std::make_shared<scai::dmemo::NoDistribution>(nFFT));
+        traceFFT.forward(refTrace, fTraceSyn);
         seismogramObs.getRefTraces().getRow(refTrace, 0);
-        fTraceObs = scai::lama::cast<ComplexValueType>(refTrace);
-        fTraceObs.resize(std::make_shared<scai::dmemo::NoDistribution>(nFFT));
-
-        scai::lama::fft<ComplexValueType>(fSignalSyn, 1);
-        scai::lama::fft<ComplexValueType>(fSignalObs, 1);
-        scai::lama::fft<ComplexValueType>(fTraceSyn);
-        scai::lama::fft<ComplexValueType>(fTraceObs);
+        traceFFT.forward(refTrace, fTraceObs);
         
         fSignalSyn.scaleColumns(fTraceObs);
         fSignalObs.scaleColumns(fTraceSyn);
@@ -671,13 +697,9 @@ void KITGPI::Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2Convolved(KITGP
         fSignalSyn.binaryOp(fSignalSyn, common::BinaryOp::SUB, fSignalObs);
         fTraceObs = scai::lama::conj(fTraceObs);
         fSignalSyn.scaleColumns(fTraceObs);
-        
-        fSignalSyn *= (1.0 / ValueType(nFFT)); // proper fft normalization
 
-        scai::lama::ifft<ComplexValueType>(fSignalSyn, 1);
-        fSignalSyn.resize(seismogramSyn.getData().getRowDistributionPtr(), seismogramSyn.getData().getColDistributionPtr());
         seismogramAdj = seismogramSyntemp;
-        seismogramAdj.getData() = scai::lama::real(fSignalSyn);
+        traceFFT.inverse(fSignalSyn, seismogramAdj.getData());
     } else {
         seismogramAdj = seismogramObs; 
         seismogramAdj.normalizeTrace(2);     
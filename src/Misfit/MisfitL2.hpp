@@ -5,6 +5,7 @@
 #include <Acquisition/Receivers.hpp>
 #include <Acquisition/Seismogram.hpp>
 #include "Misfit.hpp"
+#include "../Common/TraceFFT.hpp"
 
 namespace KITGPI
 {
@@ -75,6 +76,8 @@ namespace KITGPI
             using Misfit<ValueType>::numMisfitTypes;
             using Misfit<ValueType>::useRTM;
             using Misfit<ValueType>::writeAdjointSource;
+            
+            KITGPI::TraceFFT<ValueType> traceFFT; // transforms of the convolved misfit
         };        
     }
 }
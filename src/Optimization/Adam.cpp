@@ -0,0 +1,141 @@
+#include "Adam.hpp"
+
+#include <cmath>
+
+/*! \brief Constructor
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+KITGPI::Optimization::Adam<ValueType>::Adam(scai::dmemo::DistributionPtr dist) : useAdaGrad(false)
+{
+    this->init(dist);
+}
+
+/*! \brief Initialize the moments with zeros
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::init(scai::dmemo::DistributionPtr dist)
+{
+    firstMoment.assign(this->numParameters, scai::lama::DenseVector<ValueType>());
+    secondMoment.assign(this->numParameters, scai::lama::DenseVector<ValueType>());
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        firstMoment[parameterInd].setSameValue(dist, 0);
+        secondMoment[parameterInd].setSameValue(dist, 0);
+    }
+}
+
+/*! \brief Calculate the Adam or AdaGrad direction for all used parameters
+ \param gradient In- and output
+ \param workflow To check which parameter class is inverted for
+ \param model Model to scale the direction
+ \param config Configuration (adamBeta1, adamBeta2, optimizerEpsilon)
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config)
+{
+    ValueType beta1 = config.getAndCatch("adamBeta1", ValueType(0.9));
+    ValueType beta2 = config.getAndCatch("adamBeta2", ValueType(0.999));
+    ValueType epsilon = config.getAndCatch("optimizerEpsilon", ValueType(1e-3)); // relative to the normalized gradient
+    SCAI_ASSERT_ERROR(beta1 >= 0 && beta1 < 1, "adamBeta1 = " << beta1);
+    SCAI_ASSERT_ERROR(beta2 >= 0 && beta2 < 1, "adamBeta2 = " << beta2);
+    SCAI_ASSERT_ERROR(epsilon > 0, "optimizerEpsilon = " << epsilon);
+
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        if (!this->isInverted(workflow, parameterInd))
+            continue;
+        scai::lama::DenseVector<ValueType> parameterGradient = this->getParameter(gradient, parameterInd);
+        ValueType gradientMax = parameterGradient.maxNorm();
+        if (gradientMax != 0)
+            parameterGradient *= 1 / gradientMax;
+        if (workflow.iteration == 0) {
+            firstMoment[parameterInd].setSameValue(parameterGradient.getDistributionPtr(), 0);
+            secondMoment[parameterInd].setSameValue(parameterGradient.getDistributionPtr(), 0);
+        }
+
+        scai::lama::DenseVector<ValueType> direction;
+        if (useAdaGrad) {
+            calcDirectionAdaGrad(direction, secondMoment[parameterInd], parameterGradient, epsilon);
+        } else {
+            calcDirection(direction, firstMoment[parameterInd], secondMoment[parameterInd], parameterGradient, beta1, beta2, epsilon, workflow.iteration + 1);
+        }
+        this->setParameter(gradient, parameterInd, direction);
+    }
+
+    gradient.scale(model, workflow, config);
+}
+
+/*! \brief Update the moments and calculate the Adam direction of one parameter
+ \param direction Direction (output)
+ \param firstMoment Moving average of the gradient (in- and output)
+ \param secondMoment Moving average of the squared gradient (in- and output)
+ \param gradient Gradient
+ \param beta1 Decay rate of the first moment
+ \param beta2 Decay rate of the second moment
+ \param epsilon Stabilization of the division
+ \param step Number of the update since the reset of the moments (starts with 1) for the bias correction
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &firstMoment, scai::lama::DenseVector<ValueType> &secondMoment, scai::lama::DenseVector<ValueType> const &gradient, ValueType beta1, ValueType beta2, ValueType epsilon, scai::IndexType step)
+{
+    SCAI_ASSERT_ERROR(step > 0, "step = " << step);
+    scai::lama::DenseVector<ValueType> gradientSquared;
+    gradientSquared.binaryOp(gradient, scai::common::BinaryOp::MULT, gradient);
+    firstMoment = beta1 * firstMoment + (1 - beta1) * gradient;
+    secondMoment = beta2 * secondMoment + (1 - beta2) * gradientSquared;
+
+    scai::lama::DenseVector<ValueType> denominator;
+    denominator = ValueType(1 / (1 - std::pow(beta2, ValueType(step)))) * secondMoment;
+    denominator = scai::lama::sqrt(denominator);
+    denominator += epsilon;
+    direction = ValueType(1 / (1 - std::pow(beta1, ValueType(step)))) * firstMoment;
+    direction.binaryOp(direction, scai::common::BinaryOp::DIVIDE, denominator);
+}
+
+/*! \brief Update the sum of the squared gradients and calculate the AdaGrad direction of one parameter
+ \param direction Direction (output)
+ \param secondMoment Sum of the squared gradients (in- and output)
+ \param gradient Gradient
+ \param epsilon Stabilization of the division
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::calcDirectionAdaGrad(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &secondMoment, scai::lama::DenseVector<ValueType> const &gradient, ValueType epsilon)
+{
+    scai::lama::DenseVector<ValueType> gradientSquared;
+    gradientSquared.binaryOp(gradient, scai::common::BinaryOp::MULT, gradient);
+    secondMoment += gradientSquared;
+
+    scai::lama::DenseVector<ValueType> denominator;
+    denominator = scai::lama::sqrt(secondMoment);
+    denominator += epsilon;
+    direction.binaryOp(gradient, scai::common::BinaryOp::DIVIDE, denominator);
+}
+
+/*! \brief Write the moments to a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        checkpoint.write(firstMoment[parameterInd]);
+        checkpoint.write(secondMoment[parameterInd]);
+    }
+}
+
+/*! \brief Read the moments from a checkpoint
+ *
+ * The vectors have to be initialized with the same distribution as when the checkpoint was written.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Adam<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        checkpoint.read(firstMoment[parameterInd]);
+        checkpoint.read(secondMoment[parameterInd]);
+    }
+}
+
+template class KITGPI::Optimization::Adam<double>;
+template class KITGPI::Optimization::Adam<float>;
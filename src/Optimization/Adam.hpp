@@ -0,0 +1,45 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include "./Optimization.hpp"
+
+namespace KITGPI
+{
+    //! \brief Optimization namespace
+    namespace Optimization
+    {
+        /*! \brief Class to calculate the direction of Adam or AdaGrad with a scaling per grid cell
+         *
+         * The gradient of each parameter is normalized by its maximum norm before the moments are updated, so the moments of mini-batch iterations with different shots have the same scale.
+         * Adam uses the bias corrected moving averages m and v of the gradient and of its square, the direction is m / (sqrt(v) + epsilon).
+         * AdaGrad uses the sum v of the squared gradients of all iterations, the direction is g / (sqrt(v) + epsilon).
+         * The moments are reset in the first iteration of a workflow stage.
+         */
+        template <typename ValueType>
+        class Adam : public Optimization<ValueType>
+        {
+
+          public:
+            /* Default constructor and destructor */
+            Adam() : useAdaGrad(false){};
+            explicit Adam(bool setUseAdaGrad) : useAdaGrad(setUseAdaGrad){};
+            ~Adam(){};
+
+            Adam(scai::dmemo::DistributionPtr dist);
+
+            void init(scai::dmemo::DistributionPtr dist);
+            void apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config);
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint);
+
+            static void calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &firstMoment, scai::lama::DenseVector<ValueType> &secondMoment, scai::lama::DenseVector<ValueType> const &gradient, ValueType beta1, ValueType beta2, ValueType epsilon, scai::IndexType step);
+            static void calcDirectionAdaGrad(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &secondMoment, scai::lama::DenseVector<ValueType> const &gradient, ValueType epsilon);
+
+          private:
+            bool useAdaGrad;
+            std::vector<scai::lama::DenseVector<ValueType>> firstMoment;  // moving average of the gradient per parameter (Adam only)
+            std::vector<scai::lama::DenseVector<ValueType>> secondMoment; // moving average (Adam) or sum (AdaGrad) of the squared gradient per parameter
+        };
+    }
+}
@@ -0,0 +1,136 @@
+#include "BoundConstraint.hpp"
+#include "Optimization.hpp"
+
+using namespace scai;
+
+/*! \brief Initialize the bounds from the model thresholds
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::Optimization::BoundConstraint<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useBoundConstraint = config.getAndCatch("useBoundConstraint", 0);
+    boundTolerance = config.getAndCatch("boundTolerance", 1e-6);
+    SCAI_ASSERT_ERROR(boundTolerance >= 0, "boundTolerance = " << boundTolerance);
+    if (useBoundConstraint != 0) {
+        SCAI_ASSERT_ERROR(config.get<bool>("useModelThresholds"), "useBoundConstraint = 1 requires useModelThresholds = 1");
+    }
+
+    // parameters without thresholds in the configuration are not constrained
+    std::vector<std::string> boundNames{"VP", "VS", "Density", "Sigma", "Epsilonr", "", "", "Porosity", "Saturation", "Reflectivity"};
+    lowerBounds.assign(boundNames.size(), 1);
+    upperBounds.assign(boundNames.size(), 0);
+    for (std::size_t parameterInd = 0; parameterInd < boundNames.size(); parameterInd++) {
+        if (!boundNames[parameterInd].empty()) {
+            lowerBounds[parameterInd] = config.getAndCatch("lower" + boundNames[parameterInd] + "Th", ValueType(1));
+            upperBounds[parameterInd] = config.getAndCatch("upper" + boundNames[parameterInd] + "Th", ValueType(0));
+        }
+    }
+}
+
+/*! \brief Return true if the direction is projected onto the bounds */
+template <typename ValueType>
+bool KITGPI::Optimization::BoundConstraint<ValueType>::isActive() const
+{
+    return useBoundConstraint != 0;
+}
+
+/*! \brief Set the direction of all active cells of the inverted parameters to zero
+ *
+ * The update of the model is m - s * d, so a cell on the lower bound is active if d > 0 and a cell on the upper bound is active if d < 0.
+ * The gradient of vp and vs of parameterisation 0 is a gradient of lambda and mu, which increase with the velocities, so the same rule applies.
+ \param gradient Gradient or search direction (output)
+ \param model Current model
+ \param workflow Workflow
+ \return Number of active cells of all parameters
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Optimization::BoundConstraint<ValueType>::project(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Workflow::Workflow<ValueType> const &workflow) const
+{
+    IndexType numActive = 0;
+    if (useBoundConstraint == 0)
+        return numActive;
+
+    for (IndexType parameterInd = 0; parameterInd < Optimization<ValueType>::numParameters; parameterInd++) {
+        if (!Optimization<ValueType>::isInverted(workflow, parameterInd) || !hasModelParameter(parameterInd) || lowerBounds[parameterInd] > upperBounds[parameterInd])
+            continue;
+        ValueType lowerBound = lowerBounds[parameterInd];
+        ValueType upperBound = upperBounds[parameterInd];
+        if (parameterInd == 4) {
+            // epsilonr thresholds are relative to the permittivity of the vacuum
+            lowerBound *= model.getDielectricPermittivityVacuum();
+            upperBound *= model.getDielectricPermittivityVacuum();
+        }
+        scai::lama::DenseVector<ValueType> direction = Optimization<ValueType>::getParameter(gradient, parameterInd);
+        numActive += projectDirection(direction, getModelParameter(model, parameterInd), lowerBound, upperBound, boundTolerance * (upperBound - lowerBound));
+        Optimization<ValueType>::setParameter(gradient, parameterInd, direction);
+    }
+    return numActive;
+}
+
+/*! \brief Set the direction of the cells on a bound which point out of the box to zero
+ \param direction Direction of one parameter, the update is parameter - s * direction (output)
+ \param parameter Model parameter
+ \param lowerBound Lower bound
+ \param upperBound Upper bound
+ \param tolerance Distance to a bound within which a cell lies on the bound
+ \return Number of active cells of all processes
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Optimization::BoundConstraint<ValueType>::projectDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> const &parameter, ValueType lowerBound, ValueType upperBound, ValueType tolerance)
+{
+    SCAI_ASSERT_ERROR(direction.getDistribution() == parameter.getDistribution(), "direction and model parameter have different distributions");
+
+    scai::hmemo::ContextPtr hostCtx = scai::hmemo::Context::getHostPtr();
+    scai::hmemo::ReadAccess<ValueType> readParameter(parameter.getLocalValues(), hostCtx);
+    scai::hmemo::WriteAccess<ValueType> writeDirection(direction.getLocalValues(), hostCtx);
+    IndexType numActive = 0;
+    for (IndexType i = 0; i < writeDirection.size(); i++) {
+        if ((readParameter[i] <= lowerBound + tolerance && writeDirection[i] > 0) || (readParameter[i] >= upperBound - tolerance && writeDirection[i] < 0)) {
+            writeDirection[i] = 0;
+            numActive++;
+        }
+    }
+    return direction.getDistribution().getCommunicator().sum(numActive);
+}
+
+/*! \brief Return true if the model has a parameter with bounds (numbering see Optimization::isInverted)
+ \param parameterInd Index of the parameter
+ */
+template <typename ValueType>
+bool KITGPI::Optimization::BoundConstraint<ValueType>::hasModelParameter(scai::IndexType parameterInd)
+{
+    return parameterInd != 5 && parameterInd != 6;
+}
+
+/*! \brief Get one parameter of a model (numbering see Optimization::isInverted)
+ \param model Model
+ \param parameterInd Index of the parameter
+ */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> KITGPI::Optimization::BoundConstraint<ValueType>::getModelParameter(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::IndexType parameterInd)
+{
+    switch (parameterInd) {
+    case 0:
+        return scai::lama::DenseVector<ValueType>(model.getVelocityP());
+    case 1:
+        return scai::lama::DenseVector<ValueType>(model.getVelocityS());
+    case 2:
+        return scai::lama::DenseVector<ValueType>(model.getDensity());
+    case 3:
+        return scai::lama::DenseVector<ValueType>(model.getElectricConductivity());
+    case 4:
+        return scai::lama::DenseVector<ValueType>(model.getDielectricPermittivity());
+    case 7:
+        return scai::lama::DenseVector<ValueType>(model.getPorosity());
+    case 8:
+        return scai::lama::DenseVector<ValueType>(model.getSaturation());
+    case 9:
+        return scai::lama::DenseVector<ValueType>(model.getReflectivity());
+    }
+    COMMON_THROWEXCEPTION("No bounds for parameter " << Optimization<ValueType>::getParameterName(parameterInd));
+    return scai::lama::DenseVector<ValueType>();
+}
+
+template class KITGPI::Optimization::BoundConstraint<double>;
+template class KITGPI::Optimization::BoundConstraint<float>;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <Modelparameter/ModelparameterFactory.hpp>
+#include "../Gradient/GradientFactory.hpp"
+#include "../Workflow/Workflow.hpp"
+#include <Configuration/Configuration.hpp>
+
+#include <vector>
+
+namespace KITGPI
+{
+    //! \brief Optimization namespace
+    namespace Optimization
+    {
+        /*! \brief Projection of the search direction onto the bounds of the model parameters (useBoundConstraint = 1)
+         *
+         * The bounds are the model thresholds (useModelThresholds = 1), which project the updated model and the test models of the step length search onto the box.
+         * A cell of a parameter is active if it lies on a bound and the update m - s * d with the direction d points out of the box. The direction of the active cells is set to zero,
+         * once before the optimization, so that the history of the optimization (e.g. the conjugate gradient or the moments of Adam) only contains the free cells and the scaling of the direction is not dominated by cells which cannot move,
+         * and once after the optimization, so that the update is feasible and the step length search only moves the free cells.
+         * The bounds of vp, vs, density, sigma, epsilonr, porosity, saturation and reflectivity are supported, the parameters are numbered as in Optimization::isInverted.
+         */
+        template <typename ValueType>
+        class BoundConstraint
+        {
+          public:
+            BoundConstraint() : useBoundConstraint(0), boundTolerance(0){};
+            ~BoundConstraint(){};
+
+            void init(KITGPI::Configuration::Configuration const &config);
+            bool isActive() const;
+            scai::IndexType project(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Workflow::Workflow<ValueType> const &workflow) const;
+
+            static scai::IndexType projectDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> const &parameter, ValueType lowerBound, ValueType upperBound, ValueType tolerance);
+
+          private:
+            static bool hasModelParameter(scai::IndexType parameterInd);
+            static scai::lama::DenseVector<ValueType> getModelParameter(KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::IndexType parameterInd);
+
+            scai::IndexType useBoundConstraint;
+            ValueType boundTolerance;             // tolerance relative to the width of the bounds
+            std::vector<ValueType> lowerBounds;   // lower bound per parameter, a parameter without bounds has lowerBound > upperBound
+            std::vector<ValueType> upperBounds;   // upper bound per parameter
+        };
+    }
+}
@@ -262,5 +262,63 @@ void KITGPI::Optimization::ConjugateGradient<ValueType>::calcConjugateGradient(s
     conjugateGradient = gradient + beta * lastConjugateGradient;   
 }
 
+/*! \brief Write the last gradients and conjugate gradients to a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::ConjugateGradient<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    checkpoint.write(lastGradientVp);
+    checkpoint.write(lastGradientVs);
+    checkpoint.write(lastGradientDensity);
+    checkpoint.write(lastConjugateGradientVp);
+    checkpoint.write(lastConjugateGradientVs);
+    checkpoint.write(lastConjugateGradientDensity);
+    checkpoint.write(lastGradientPorosity);
+    checkpoint.write(lastGradientSaturation);
+    checkpoint.write(lastGradientReflectivity);
+    checkpoint.write(lastConjugateGradientPorosity);
+    checkpoint.write(lastConjugateGradientSaturation);
+    checkpoint.write(lastConjugateGradientReflectivity);
+    checkpoint.write(lastGradientSigma);
+    checkpoint.write(lastGradientEpsilon);
+    checkpoint.write(lastGradientTauSigma);
+    checkpoint.write(lastGradientTauEpsilon);
+    checkpoint.write(lastConjugateGradientSigma);
+    checkpoint.write(lastConjugateGradientEpsilon);
+    checkpoint.write(lastConjugateGradientTauSigma);
+    checkpoint.write(lastConjugateGradientTauEpsilon);
+}
+
+/*! \brief Read the last gradients and conjugate gradients from a checkpoint
+ *
+ * The vectors have to be initialized with the same distribution as when the checkpoint was written.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::ConjugateGradient<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    checkpoint.read(lastGradientVp);
+    checkpoint.read(lastGradientVs);
+    checkpoint.read(lastGradientDensity);
+    checkpoint.read(lastConjugateGradientVp);
+    checkpoint.read(lastConjugateGradientVs);
+    checkpoint.read(lastConjugateGradientDensity);
+    checkpoint.read(lastGradientPorosity);
+    checkpoint.read(lastGradientSaturation);
+    checkpoint.read(lastGradientReflectivity);
+    checkpoint.read(lastConjugateGradientPorosity);
+    checkpoint.read(lastConjugateGradientSaturation);
+    checkpoint.read(lastConjugateGradientReflectivity);
+    checkpoint.read(lastGradientSigma);
+    checkpoint.read(lastGradientEpsilon);
+    checkpoint.read(lastGradientTauSigma);
+    checkpoint.read(lastGradientTauEpsilon);
+    checkpoint.read(lastConjugateGradientSigma);
+    checkpoint.read(lastConjugateGradientEpsilon);
+    checkpoint.read(lastConjugateGradientTauSigma);
+    checkpoint.read(lastConjugateGradientTauEpsilon);
+}
+
 template class KITGPI::Optimization::ConjugateGradient<double>;
 template class KITGPI::Optimization::ConjugateGradient<float>;
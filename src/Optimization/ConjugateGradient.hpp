@@ -23,6 +23,8 @@ namespace KITGPI
             
             void init(scai::dmemo::DistributionPtr dist);
             void apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config);          
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint);
 
         private:
             
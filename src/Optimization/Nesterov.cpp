@@ -0,0 +1,92 @@
+#include "Nesterov.hpp"
+
+/*! \brief Constructor
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+KITGPI::Optimization::Nesterov<ValueType>::Nesterov(scai::dmemo::DistributionPtr dist)
+{
+    this->init(dist);
+}
+
+/*! \brief Initialize the velocities with zeros
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Nesterov<ValueType>::init(scai::dmemo::DistributionPtr dist)
+{
+    velocity.assign(this->numParameters, scai::lama::DenseVector<ValueType>());
+    for (auto &parameterVelocity : velocity) {
+        parameterVelocity.setSameValue(dist, 0);
+    }
+}
+
+/*! \brief Calculate the Nesterov momentum direction for all used parameters
+ \param gradient In- and output
+ \param workflow To check which parameter class is inverted for
+ \param model Model to scale the direction
+ \param config Configuration (momentum)
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Nesterov<ValueType>::apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config)
+{
+    ValueType momentum = config.getAndCatch("momentum", ValueType(0.9));
+    SCAI_ASSERT_ERROR(momentum >= 0 && momentum < 1, "momentum = " << momentum);
+
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        if (!this->isInverted(workflow, parameterInd))
+            continue;
+        scai::lama::DenseVector<ValueType> parameterGradient = this->getParameter(gradient, parameterInd);
+        ValueType gradientMax = parameterGradient.maxNorm();
+        if (gradientMax != 0)
+            parameterGradient *= 1 / gradientMax;
+        if (workflow.iteration == 0)
+            velocity[parameterInd].setSameValue(parameterGradient.getDistributionPtr(), 0);
+
+        scai::lama::DenseVector<ValueType> direction;
+        calcDirection(direction, velocity[parameterInd], parameterGradient, momentum);
+        this->setParameter(gradient, parameterInd, direction);
+    }
+
+    gradient.scale(model, workflow, config);
+}
+
+/*! \brief Update the velocity and calculate the Nesterov direction of one parameter
+ \param direction Direction g + momentum * v (output)
+ \param velocity Velocity v which is updated to momentum * v + g (in- and output)
+ \param gradient Gradient g
+ \param momentum Momentum coefficient
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Nesterov<ValueType>::calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &velocity, scai::lama::DenseVector<ValueType> const &gradient, ValueType momentum)
+{
+    velocity = momentum * velocity + gradient;
+    direction = gradient + momentum * velocity;
+}
+
+/*! \brief Write the velocities to a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Nesterov<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    for (auto const &parameterVelocity : velocity) {
+        checkpoint.write(parameterVelocity);
+    }
+}
+
+/*! \brief Read the velocities from a checkpoint
+ *
+ * The vectors have to be initialized with the same distribution as when the checkpoint was written.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Nesterov<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    for (auto &parameterVelocity : velocity) {
+        checkpoint.read(parameterVelocity);
+    }
+}
+
+template class KITGPI::Optimization::Nesterov<double>;
+template class KITGPI::Optimization::Nesterov<float>;
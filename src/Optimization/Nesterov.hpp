@@ -0,0 +1,40 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include "./Optimization.hpp"
+
+namespace KITGPI
+{
+    //! \brief Optimization namespace
+    namespace Optimization
+    {
+        /*! \brief Class to calculate the Nesterov momentum direction
+         *
+         * The gradient of each parameter is normalized by its maximum norm, so the momentum of mini-batch iterations with different shots has the same scale.
+         * The velocity v of the last iterations is updated by v = momentum * v + g and the direction is the look-ahead step g + momentum * v.
+         * The velocity is reset in the first iteration of a workflow stage.
+         */
+        template <typename ValueType>
+        class Nesterov : public Optimization<ValueType>
+        {
+
+          public:
+            /* Default constructor and destructor */
+            Nesterov(){};
+            ~Nesterov(){};
+
+            Nesterov(scai::dmemo::DistributionPtr dist);
+
+            void init(scai::dmemo::DistributionPtr dist);
+            void apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config);
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint);
+
+            static void calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> &velocity, scai::lama::DenseVector<ValueType> const &gradient, ValueType momentum);
+
+          private:
+            std::vector<scai::lama::DenseVector<ValueType>> velocity; // velocity per parameter (numbering see Optimization::isInverted)
+        };
+    }
+}
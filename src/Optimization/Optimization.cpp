@@ -1,4 +1,193 @@
 #include "Optimization.hpp"
 
+#include <cmath>
+
+template <typename ValueType>
+scai::IndexType const KITGPI::Optimization::Optimization<ValueType>::numParameters;
+
+/*! \brief Return true if the gradient of the next iteration has to be calculated for all shots (default: false)
+ \param config Configuration
+ \param workflow Workflow
+ */
+template <typename ValueType>
+bool KITGPI::Optimization::Optimization<ValueType>::isFullBatch(KITGPI::Configuration::Configuration const & /*config*/, KITGPI::Workflow::Workflow<ValueType> const & /*workflow*/) const
+{
+    return false;
+}
+
+/*! \brief Start the gradient calculation of an iteration (default: nothing to do)
+ *
+ * Has to be called before the loop over the shots.
+ \param config Configuration
+ \param workflow Workflow
+ \param batchSize Number of shots of the iteration
+ \param numShots Number of all shots
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Optimization<ValueType>::startBatch(KITGPI::Configuration::Configuration const & /*config*/, KITGPI::Workflow::Workflow<ValueType> const & /*workflow*/, scai::IndexType /*batchSize*/, scai::IndexType /*numShots*/)
+{
+}
+
+/*! \brief Modify the gradient of one shot before it is added to the gradient (default: nothing to do)
+ \param gradientPerShot Gradient of the shot (in- and output)
+ \param shotNumber Shot number
+ \param workflow Workflow
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Optimization<ValueType>::applyPerShot(KITGPI::Gradient::Gradient<ValueType> & /*gradientPerShot*/, scai::IndexType /*shotNumber*/, KITGPI::Workflow::Workflow<ValueType> const & /*workflow*/)
+{
+}
+
+/*! \brief Return the step length of a fixed step length schedule, 0 if the step length search is used
+ *
+ * steplengthSchedule = 0: step length search (default)
+ * steplengthSchedule = 1: constant step length steplengthFixed
+ * steplengthSchedule = 2: steplengthFixed / (1 + steplengthDecay * iteration)
+ * steplengthSchedule = 3: steplengthFixed * steplengthDecay^iteration
+ \param config Configuration
+ \param iteration Iteration of the workflow stage
+ */
+template <typename ValueType>
+ValueType KITGPI::Optimization::Optimization<ValueType>::getScheduledSteplength(KITGPI::Configuration::Configuration const &config, scai::IndexType iteration)
+{
+    scai::IndexType steplengthSchedule = config.getAndCatch("steplengthSchedule", 0);
+    SCAI_ASSERT_ERROR(steplengthSchedule >= 0 && steplengthSchedule <= 3, "steplengthSchedule = " << steplengthSchedule);
+    if (steplengthSchedule == 0)
+        return 0;
+
+    ValueType steplengthFixed = config.getAndCatch("steplengthFixed", config.get<ValueType>("steplengthInit"));
+    ValueType steplengthDecay = config.getAndCatch("steplengthDecay", ValueType(steplengthSchedule == 2 ? 0.1 : 0.9));
+    SCAI_ASSERT_ERROR(steplengthFixed > 0, "steplengthFixed = " << steplengthFixed);
+    SCAI_ASSERT_ERROR(steplengthDecay > 0, "steplengthDecay = " << steplengthDecay);
+    if (steplengthSchedule == 2)
+        return steplengthFixed / (1 + steplengthDecay * iteration);
+    if (steplengthSchedule == 3)
+        return steplengthFixed * std::pow(steplengthDecay, ValueType(iteration));
+    return steplengthFixed;
+}
+
+/*! \brief Return true if a parameter is inverted for
+ *
+ * The parameters are numbered 0 vp, 1 vs, 2 density, 3 sigma, 4 epsilon, 5 tauSigma, 6 tauEpsilon, 7 porosity, 8 saturation, 9 reflectivity.
+ \param workflow Workflow
+ \param parameterInd Index of the parameter
+ */
+template <typename ValueType>
+bool KITGPI::Optimization::Optimization<ValueType>::isInverted(KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType parameterInd)
+{
+    switch (parameterInd) {
+    case 0:
+        return workflow.isSeismic && workflow.getInvertForVp();
+    case 1:
+        return workflow.isSeismic && workflow.getInvertForVs();
+    case 2:
+        return workflow.isSeismic && workflow.getInvertForDensity();
+    case 3:
+        return !workflow.isSeismic && workflow.getInvertForSigma();
+    case 4:
+        return !workflow.isSeismic && workflow.getInvertForEpsilon();
+    case 5:
+        return !workflow.isSeismic && workflow.getInvertForTauSigma();
+    case 6:
+        return !workflow.isSeismic && workflow.getInvertForTauEpsilon();
+    case 7:
+        return workflow.getInvertForPorosity();
+    case 8:
+        return workflow.getInvertForSaturation();
+    case 9:
+        return workflow.getInvertForReflectivity();
+    }
+    COMMON_THROWEXCEPTION("Unknown parameter index " << parameterInd);
+    return false;
+}
+
+/*! \brief Get one parameter of a gradient (numbering see isInverted)
+ \param gradient Gradient
+ \param parameterInd Index of the parameter
+ */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> KITGPI::Optimization::Optimization<ValueType>::getParameter(KITGPI::Gradient::Gradient<ValueType> const &gradient, scai::IndexType parameterInd)
+{
+    switch (parameterInd) {
+    case 0:
+        return scai::lama::DenseVector<ValueType>(gradient.getVelocityP());
+    case 1:
+        return scai::lama::DenseVector<ValueType>(gradient.getVelocityS());
+    case 2:
+        return scai::lama::DenseVector<ValueType>(gradient.getDensity());
+    case 3:
+        return scai::lama::DenseVector<ValueType>(gradient.getElectricConductivity());
+    case 4:
+        return scai::lama::DenseVector<ValueType>(gradient.getDielectricPermittivity());
+    case 5:
+        return scai::lama::DenseVector<ValueType>(gradient.getTauElectricConductivity());
+    case 6:
+        return scai::lama::DenseVector<ValueType>(gradient.getTauDielectricPermittivity());
+    case 7:
+        return scai::lama::DenseVector<ValueType>(gradient.getPorosity());
+    case 8:
+        return scai::lama::DenseVector<ValueType>(gradient.getSaturation());
+    case 9:
+        return scai::lama::DenseVector<ValueType>(gradient.getReflectivity());
+    }
+    COMMON_THROWEXCEPTION("Unknown parameter index " << parameterInd);
+    return scai::lama::DenseVector<ValueType>();
+}
+
+/*! \brief Set one parameter of a gradient (numbering see isInverted)
+ \param gradient Gradient (output)
+ \param parameterInd Index of the parameter
+ \param parameter New values of the parameter
+ */
+template <typename ValueType>
+void KITGPI::Optimization::Optimization<ValueType>::setParameter(KITGPI::Gradient::Gradient<ValueType> &gradient, scai::IndexType parameterInd, scai::lama::DenseVector<ValueType> const &parameter)
+{
+    switch (parameterInd) {
+    case 0:
+        gradient.setVelocityP(parameter);
+        break;
+    case 1:
+        gradient.setVelocityS(parameter);
+        break;
+    case 2:
+        gradient.setDensity(parameter);
+        break;
+    case 3:
+        gradient.setElectricConductivity(parameter);
+        break;
+    case 4:
+        gradient.setDielectricPermittivity(parameter);
+        break;
+    case 5:
+        gradient.setTauElectricConductivity(parameter);
+        break;
+    case 6:
+        gradient.setTauDielectricPermittivity(parameter);
+        break;
+    case 7:
+        gradient.setPorosity(parameter);
+        break;
+    case 8:
+        gradient.setSaturation(parameter);
+        break;
+    case 9:
+        gradient.setReflectivity(parameter);
+        break;
+    default:
+        COMMON_THROWEXCEPTION("Unknown parameter index " << parameterInd);
+    }
+}
+
+/*! \brief Get the file name suffix of one parameter (numbering see isInverted)
+ \param parameterInd Index of the parameter
+ */
+template <typename ValueType>
+std::string KITGPI::Optimization::Optimization<ValueType>::getParameterName(scai::IndexType parameterInd)
+{
+    std::vector<std::string> parameterNames{"vp", "vs", "density", "sigma", "epsilonr", "tauSigma", "tauEpsilon", "porosity", "saturation", "reflectivity"};
+    SCAI_ASSERT_ERROR(parameterInd >= 0 && parameterInd < numParameters, "Unknown parameter index " << parameterInd);
+    return parameterNames[parameterInd];
+}
+
 template class KITGPI::Optimization::Optimization<float>;
 template class KITGPI::Optimization::Optimization<double>;
@@ -2,6 +2,7 @@
 
 #include <scai/lama.hpp>
 #include <Modelparameter/ModelparameterFactory.hpp>
+#include "../Common/Checkpoint.hpp"
 #include "../Gradient/GradientFactory.hpp"
 #include "../Workflow/Workflow.hpp"
 #include <Configuration/Configuration.hpp>
@@ -27,12 +28,27 @@ namespace KITGPI
             
               virtual void init(scai::dmemo::DistributionPtr dist) = 0;
               virtual void apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config) = 0;
+              virtual void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const = 0;
+              virtual void readCheckpoint(KITGPI::Checkpoint &checkpoint) = 0;
+
+              virtual bool isFullBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow) const;
+              virtual void startBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType batchSize, scai::IndexType numShots);
+              virtual void applyPerShot(KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, scai::IndexType shotNumber, KITGPI::Workflow::Workflow<ValueType> const &workflow);
+
+              static ValueType getScheduledSteplength(KITGPI::Configuration::Configuration const &config, scai::IndexType iteration);
+
+              static scai::IndexType const numParameters = 10; //!< Number of parameters which can be inverted for (see isInverted)
+              static bool isInverted(KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType parameterInd);
+              static scai::lama::DenseVector<ValueType> getParameter(KITGPI::Gradient::Gradient<ValueType> const &gradient, scai::IndexType parameterInd);
+              static void setParameter(KITGPI::Gradient::Gradient<ValueType> &gradient, scai::IndexType parameterInd, scai::lama::DenseVector<ValueType> const &parameter);
+              static std::string getParameterName(scai::IndexType parameterInd);
 	    
           protected:
               
               //! Default constructor and destructor.
               Optimization(){};
               ~Optimization(){};
+
                             
         };
     }
@@ -8,7 +8,7 @@ typename KITGPI::Optimization::Optimization<ValueType>::OptimizationPtr KITGPI::
     std::transform(type.begin(), type.end(), type.begin(), ::tolower);
 
     // Assert correctness of input values
-    SCAI_ASSERT_ERROR(type.compare("steepestdescent") == 0 || type.compare("conjugategradient") == 0 || type.compare("lbfgs") == 0 || type.compare("truncatednewton") == 0, "Unknown type");
+    SCAI_ASSERT_ERROR(type.compare("steepestdescent") == 0 || type.compare("conjugategradient") == 0 || type.compare("lbfgs") == 0 || type.compare("truncatednewton") == 0 || type.compare("nesterov") == 0 || type.compare("adam") == 0 || type.compare("adagrad") == 0 || type.compare("svrg") == 0, "Unknown type");
 
     if (type.compare("steepestdescent") == 0) {
         return OptimizationPtr(new SteepestDescent<ValueType>);
@@ -16,6 +16,18 @@ typename KITGPI::Optimization::Optimization<ValueType>::OptimizationPtr KITGPI::
     if (type.compare("conjugategradient") == 0) {
         return OptimizationPtr(new ConjugateGradient<ValueType>);
     }
+    if (type.compare("nesterov") == 0) {
+        return OptimizationPtr(new Nesterov<ValueType>);
+    }
+    if (type.compare("adam") == 0) {
+        return OptimizationPtr(new Adam<ValueType>(false));
+    }
+    if (type.compare("adagrad") == 0) {
+        return OptimizationPtr(new Adam<ValueType>(true));
+    }
+    if (type.compare("svrg") == 0) {
+        return OptimizationPtr(new SVRG<ValueType>);
+    }
     if (type.compare("lbfgs") == 0) {
         //     return OptimizationPtr(new LBFGS<ValueType>);
         COMMON_THROWEXCEPTION("No LBFGS implemented");
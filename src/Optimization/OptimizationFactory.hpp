@@ -5,6 +5,9 @@
 #include "./Optimization.hpp"
 #include "./SteepestDescent.hpp"
 #include "./ConjugateGradient.hpp"
+#include "./Nesterov.hpp"
+#include "./Adam.hpp"
+#include "./SVRG.hpp"
 
 namespace KITGPI
 {
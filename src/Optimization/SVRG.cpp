@@ -0,0 +1,150 @@
+#include "SVRG.hpp"
+
+/*! \brief Constructor
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+KITGPI::Optimization::SVRG<ValueType>::SVRG(scai::dmemo::DistributionPtr dist) : isRefresh(false), batchSize(0), numShots(0), fileFormat(1)
+{
+    this->init(dist);
+}
+
+/*! \brief Initialize the full gradient with zeros
+ \param dist Distribution of the gradient
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::init(scai::dmemo::DistributionPtr dist)
+{
+    fullGradient.assign(this->numParameters, scai::lama::DenseVector<ValueType>());
+    for (auto &parameterGradient : fullGradient) {
+        parameterGradient.setSameValue(dist, 0);
+    }
+}
+
+/*! \brief Return true if the snapshot is refreshed, i.e. the gradient of the iteration has to be calculated for all shots
+ \param config Configuration (svrgInterval)
+ \param workflow Workflow
+ */
+template <typename ValueType>
+bool KITGPI::Optimization::SVRG<ValueType>::isFullBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow) const
+{
+    scai::IndexType svrgInterval = config.getAndCatch("svrgInterval", 5);
+    SCAI_ASSERT_ERROR(svrgInterval > 0, "svrgInterval = " << svrgInterval);
+    return workflow.iteration % svrgInterval == 0;
+}
+
+/*! \brief Start the gradient calculation of an iteration
+ \param config Configuration
+ \param workflow Workflow
+ \param setBatchSize Number of shots of the iteration
+ \param setNumShots Number of all shots
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::startBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType setBatchSize, scai::IndexType setNumShots)
+{
+    SCAI_ASSERT_ERROR(config.getAndCatch("useSourceEncode", 0) == 0, "optimizationType = svrg is not compatible with useSourceEncode");
+    SCAI_ASSERT_ERROR(!config.getAndCatch("useStreamConfig", false), "optimizationType = svrg is not compatible with useStreamConfig");
+    SCAI_ASSERT_ERROR(config.getAndCatch("useAdaptiveBatch", 0) == 0, "optimizationType = svrg is not compatible with useAdaptiveBatch");
+    SCAI_ASSERT_ERROR(config.get<scai::IndexType>("stablizingFunctionalType") == 0, "optimizationType = svrg is not compatible with stablizingFunctionalType, the regularization normalizes the gradient");
+
+    filename = config.getAndCatch("svrgFilename", config.get<std::string>("gradientFilename") + ".svrg");
+    fileFormat = config.get<scai::IndexType>("FileFormat");
+    batchSize = setBatchSize;
+    numShots = setNumShots;
+    isRefresh = isFullBatch(config, workflow);
+    SCAI_ASSERT_ERROR(!isRefresh || batchSize == numShots, "The snapshot of SVRG needs all " << numShots << " shots, batch size = " << batchSize);
+}
+
+/*! \brief Write the gradient of a shot at a new snapshot or subtract the snapshot gradient of the shot
+ \param gradientPerShot Gradient of the shot (in- and output)
+ \param shotNumber Shot number
+ \param workflow To check which parameter class is inverted for
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::applyPerShot(KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, scai::IndexType shotNumber, KITGPI::Workflow::Workflow<ValueType> const &workflow)
+{
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        if (!this->isInverted(workflow, parameterInd))
+            continue;
+        std::string parameterFilename = filename + ".shot_" + std::to_string(shotNumber) + "." + this->getParameterName(parameterInd);
+        scai::lama::DenseVector<ValueType> parameterGradient = this->getParameter(gradientPerShot, parameterInd);
+        if (isRefresh) {
+            IO::writeVector(parameterGradient, parameterFilename, fileFormat);
+        } else {
+            scai::lama::DenseVector<ValueType> snapshotGradient;
+            IO::readVector(snapshotGradient, parameterFilename, fileFormat);
+            snapshotGradient.redistribute(parameterGradient.getDistributionPtr());
+            parameterGradient -= snapshotGradient;
+            this->setParameter(gradientPerShot, parameterInd, parameterGradient);
+        }
+    }
+}
+
+/*! \brief Calculate the SVRG direction for all used parameters
+ *
+ * At a new snapshot the gradient is the full gradient, which is stored and written to disk.
+ \param gradient Sum of the (corrected) gradients of the shots, in- and output
+ \param workflow To check which parameter class is inverted for
+ \param model Model to scale the direction
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config)
+{
+    for (scai::IndexType parameterInd = 0; parameterInd < this->numParameters; parameterInd++) {
+        if (!this->isInverted(workflow, parameterInd))
+            continue;
+        scai::lama::DenseVector<ValueType> parameterGradient = this->getParameter(gradient, parameterInd);
+        if (isRefresh) {
+            fullGradient[parameterInd] = parameterGradient;
+            IO::writeVector(parameterGradient, filename + ".full." + this->getParameterName(parameterInd), fileFormat);
+        } else {
+            scai::lama::DenseVector<ValueType> direction;
+            calcDirection(direction, parameterGradient, fullGradient[parameterInd], batchSize, numShots);
+            this->setParameter(gradient, parameterInd, direction);
+        }
+    }
+
+    gradient.scale(model, workflow, config);
+}
+
+/*! \brief Calculate the SVRG direction of one parameter
+ \param direction numShots / batchSize * gradientCorrected + fullGradient (output)
+ \param gradientCorrected Sum of g_i - g_i(snapshot) over the shots of the batch
+ \param fullGradient Full gradient at the snapshot
+ \param batchSize Number of shots of the batch
+ \param numShots Number of all shots
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> const &gradientCorrected, scai::lama::DenseVector<ValueType> const &fullGradient, scai::IndexType batchSize, scai::IndexType numShots)
+{
+    SCAI_ASSERT_ERROR(batchSize > 0, "batchSize = " << batchSize);
+    direction = ValueType(numShots) / ValueType(batchSize) * gradientCorrected + fullGradient;
+}
+
+/*! \brief Write the full gradient of the snapshot to a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    for (auto const &parameterGradient : fullGradient) {
+        checkpoint.write(parameterGradient);
+    }
+}
+
+/*! \brief Read the full gradient of the snapshot from a checkpoint
+ *
+ * The vectors have to be initialized with the same distribution as when the checkpoint was written. The gradients of the shots are read from svrgFilename.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SVRG<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    for (auto &parameterGradient : fullGradient) {
+        checkpoint.read(parameterGradient);
+    }
+}
+
+template class KITGPI::Optimization::SVRG<double>;
+template class KITGPI::Optimization::SVRG<float>;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <IO/IO.hpp>
+#include <string>
+
+#include "./Optimization.hpp"
+
+namespace KITGPI
+{
+    //! \brief Optimization namespace
+    namespace Optimization
+    {
+        /*! \brief Class to calculate the stochastic variance reduced gradient (SVRG) direction for mini-batch inversions
+         *
+         * Every svrgInterval iterations the gradient is calculated for all shots (see isFullBatch). The gradients of the shots and the full gradient mu at this snapshot model are written to svrgFilename.
+         * In the iterations in between, the snapshot gradient of each shot of the random batch is read and subtracted from its current gradient (see applyPerShot),
+         * and the direction is numShots / batchSize * sum_batch (g_i - g_i(snapshot)) + mu. It is an unbiased estimate of the full gradient whose variance decreases as the model approaches the snapshot model.
+         * The snapshot gradients are not recalculated at the current model, so no additional forward or adjoint solves are needed.
+         */
+        template <typename ValueType>
+        class SVRG : public Optimization<ValueType>
+        {
+
+          public:
+            /* Default constructor and destructor */
+            SVRG() : isRefresh(false), batchSize(0), numShots(0), fileFormat(1){};
+            ~SVRG(){};
+
+            SVRG(scai::dmemo::DistributionPtr dist);
+
+            void init(scai::dmemo::DistributionPtr dist);
+            void apply(KITGPI::Gradient::Gradient<ValueType> &gradient, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Configuration::Configuration config);
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint);
+
+            bool isFullBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow) const override;
+            void startBatch(KITGPI::Configuration::Configuration const &config, KITGPI::Workflow::Workflow<ValueType> const &workflow, scai::IndexType setBatchSize, scai::IndexType setNumShots) override;
+            void applyPerShot(KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, scai::IndexType shotNumber, KITGPI::Workflow::Workflow<ValueType> const &workflow) override;
+
+            static void calcDirection(scai::lama::DenseVector<ValueType> &direction, scai::lama::DenseVector<ValueType> const &gradientCorrected, scai::lama::DenseVector<ValueType> const &fullGradient, scai::IndexType batchSize, scai::IndexType numShots);
+
+          private:
+            bool isRefresh;            // the gradient of the current iteration is the full gradient of a new snapshot
+            scai::IndexType batchSize; // number of shots of the current iteration
+            scai::IndexType numShots;
+            scai::IndexType fileFormat;
+            std::string filename;
+            std::vector<scai::lama::DenseVector<ValueType>> fullGradient; // full gradient at the snapshot model per parameter (numbering see Optimization::isInverted)
+        };
+    }
+}
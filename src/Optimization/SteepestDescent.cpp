@@ -34,5 +34,23 @@ void KITGPI::Optimization::SteepestDescent<ValueType>::apply(KITGPI::Gradient::G
     gradient.scale(model, workflow, config);   
 }
 
+/*! \brief Write the optimizer history to a checkpoint (steepest descent has no history)
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SteepestDescent<ValueType>::writeCheckpoint(KITGPI::Checkpoint & /*checkpoint*/) const
+{
+
+}
+
+/*! \brief Read the optimizer history from a checkpoint (steepest descent has no history)
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::Optimization::SteepestDescent<ValueType>::readCheckpoint(KITGPI::Checkpoint & /*checkpoint*/)
+{
+
+}
+
 template class KITGPI::Optimization::SteepestDescent<double>;
 template class KITGPI::Optimization::SteepestDescent<float>;
@@ -1,4 +1,11 @@
 #include "EnergyPreconditioning.hpp"
+#include "../Common/HostPrint.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 
 /*! \brief Initialize private members of the object
  *
@@ -21,94 +28,125 @@ void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::init(scai::dmemo
         std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower);
         isSeismic = Common::checkEquationType<ValueType>(equationType);
         
+        // the SH and TMEM wavefields only have the z component
+        bool isTransverse = (equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0 || equationType.compare("tmem") == 0 || equationType.compare("viscotmem") == 0);
+        useComponentX = !isTransverse;
+        useComponentY = !isTransverse;
+        useComponentZ = (dimension.compare("3d") == 0 || isTransverse);
+        
+        hessianInterval = config.getAndCatch("energyPreconditioningInterval", 1);
+        timeDecimation = config.getAndCatch("energyPreconditioningTimeDecimation", 1);
+        SCAI_ASSERT_ERROR(hessianInterval >= 1, "energyPreconditioningInterval = " << hessianInterval);
+        SCAI_ASSERT_ERROR(timeDecimation >= 1, "energyPreconditioningTimeDecimation = " << timeDecimation);
+        if (hessianInterval > 1) {
+            std::string logFilenameInversion = config.get<std::string>("logFilename");
+            logFilename = logFilenameInversion.substr(0, logFilenameInversion.length() - 4) + ".energyPreconditioning" + logFilenameInversion.substr(logFilenameInversion.length() - 4, 4);
+        }
+        
+        distHessian = dist;
+        storedApproxHessian.clear(); // reinitialization for a new run or inversion grid
+        currentStage = -1;
         approxHessian.setSameValue(dist, 0);
         if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)
             approxHessianAdjoint.setSameValue(dist, 0);
-
-        wavefieldX.setSameValue(dist, 0);
-        wavefieldY.setSameValue(dist, 0);
-        wavefieldZ.setSameValue(dist, 0);
     }
 }
 
 /*! \brief Calculate the approximation of the diagonal of the inverse of the Hessian for one shot
  *
- *
+ * The squared components of the wavefield are added in a single pass without temporary vectors. 
+ * Nothing is integrated if the stored approximated Hessian of the shot is reused, with energyPreconditioningTimeDecimation = n only every n-th call is integrated (with n * DT).
  \param wavefield Wavefield of one time step
  \param DT temporal sampling interval
+ \param isAdjoint Integrate into the approximated Hessian of the adjoint wavefield
+ \param activeRanges Local index ranges outside of which the wavefield is zero, nullptr for all grid points (see WavefieldActivity)
  */
 template <typename ValueType>
-void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::intSquaredWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefield, ValueType DT, bool isAdjoint)
-{
-    if (isSeismic && ((!isAdjoint && (useEnergyPreconditioning == 1 || useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)) || (isAdjoint && (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)))) {               
-        if(equationType.compare("sh") != 0 && equationType.compare("viscosh") != 0){
-            wavefieldX = wavefield.getRefVX();
-            wavefieldX *= wavefieldX;
-            wavefieldX *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldX;  
-            } else {
-                approxHessianAdjoint += wavefieldX; 
-            }
-        }
-            
-        if(equationType.compare("sh") != 0 && equationType.compare("viscosh") != 0){
-            wavefieldY = wavefield.getRefVY();
-            wavefieldY *= wavefieldY;
-            wavefieldY *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldY;  
-            } else {
-                approxHessianAdjoint += wavefieldY; 
-            }      
-        }
-        
-        if(dimension.compare("3d") == 0 || equationType.compare("sh") == 0 || equationType.compare("viscosh") == 0){
-            wavefieldZ = wavefield.getRefVZ();
-            wavefieldZ *= wavefieldZ;
-            wavefieldZ *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldZ;  
-            } else {
-                approxHessianAdjoint += wavefieldZ; 
-            }
-        }    
-    } else if (!isSeismic && ((!isAdjoint && (useEnergyPreconditioning == 1 || useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)) || (isAdjoint && (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)))) {   
-        if(equationType.compare("tmem") != 0 && equationType.compare("viscotmem") != 0){
-            wavefieldX = wavefield.getRefEX();
-            wavefieldX *= wavefieldX;
-            wavefieldX *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldX;  
-            } else {
-                approxHessianAdjoint += wavefieldX; 
-            }
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::intSquaredWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefield, ValueType DT, bool isAdjoint, IndexRanges const *activeRanges)
+{
+    if (!calculateHessian || useEnergyPreconditioning == 0 || useEnergyPreconditioning == 3 || (isAdjoint && useEnergyPreconditioning == 1))
+        return;
+    
+    scai::IndexType &timeStep = isAdjoint ? numTimeStepsAdjoint : numTimeSteps;
+    if (timeStep++ % timeDecimation != 0)
+        return;
+    
+    scai::lama::DenseVector<ValueType> &sum = isAdjoint ? approxHessianAdjoint : approxHessian;
+    if (isSeismic) {
+        accumulateSquared(sum, useComponentX ? &wavefield.getRefVX() : nullptr, useComponentY ? &wavefield.getRefVY() : nullptr, useComponentZ ? &wavefield.getRefVZ() : nullptr, DT * timeDecimation, activeRanges);
+    } else {
+        accumulateSquared(sum, useComponentX ? &wavefield.getRefEX() : nullptr, useComponentY ? &wavefield.getRefEY() : nullptr, useComponentZ ? &wavefield.getRefEZ() : nullptr, DT * timeDecimation, activeRanges);
+    }
+}
+
+/*! \brief Add the scaled sum of the squared components to a vector: sum += scale * (x^2 + y^2 + z^2)
+ *
+ * All vectors have to have the same distribution, a component is skipped if its pointer is nullptr.
+ \param sum Vector the squares are added to
+ \param componentX First component
+ \param componentY Second component
+ \param componentZ Third component
+ \param scale Scaling factor, e.g. DT
+ \param activeRanges Local index ranges the sum is restricted to, nullptr for all local values
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::accumulateSquared(scai::lama::DenseVector<ValueType> &sum, scai::lama::DenseVector<ValueType> const *componentX, scai::lama::DenseVector<ValueType> const *componentY, scai::lama::DenseVector<ValueType> const *componentZ, ValueType scale, IndexRanges const *activeRanges)
+{
+    scai::hmemo::ContextPtr hostCtx = scai::hmemo::Context::getHostPtr();
+    scai::IndexType numLocalValues = sum.getLocalValues().size();
+    
+    std::unique_ptr<scai::hmemo::ReadAccess<ValueType>> readComponents[3];
+    const ValueType *values[3] = {nullptr, nullptr, nullptr};
+    scai::IndexType numComponents = 0;
+    for (auto component : {componentX, componentY, componentZ}) {
+        if (component != nullptr) {
+            SCAI_ASSERT_ERROR(component->getLocalValues().size() == numLocalValues, "component has " << component->getLocalValues().size() << " local values instead of " << numLocalValues);
+            readComponents[numComponents].reset(new scai::hmemo::ReadAccess<ValueType>(component->getLocalValues(), hostCtx));
+            values[numComponents] = readComponents[numComponents]->get();
+            numComponents++;
         }
-            
-        if(equationType.compare("tmem") != 0 && equationType.compare("viscotmem") != 0){
-            wavefieldY = wavefield.getRefEY();
-            wavefieldY *= wavefieldY;
-            wavefieldY *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldY;  
-            } else {
-                approxHessianAdjoint += wavefieldY; 
-            }
+    }
+    
+    scai::hmemo::WriteAccess<ValueType> writeSum(sum.getLocalValues(), hostCtx);
+    ValueType *sumValues = writeSum.get();
+    IndexRanges const allValues(1, std::make_pair(scai::IndexType(0), numLocalValues));
+    for (auto const &range : activeRanges == nullptr ? allValues : *activeRanges) {
+        switch (numComponents) {
+        case 1:
+            for (scai::IndexType i = range.first; i < range.second; i++)
+                sumValues[i] += scale * values[0][i] * values[0][i];
+            break;
+        case 2:
+            for (scai::IndexType i = range.first; i < range.second; i++)
+                sumValues[i] += scale * (values[0][i] * values[0][i] + values[1][i] * values[1][i]);
+            break;
+        case 3:
+            for (scai::IndexType i = range.first; i < range.second; i++)
+                sumValues[i] += scale * (values[0][i] * values[0][i] + values[1][i] * values[1][i] + values[2][i] * values[2][i]);
+            break;
         }
-        
-        if(dimension.compare("3d") == 0 || equationType.compare("tmem") == 0 || equationType.compare("viscotmem") == 0){
-            wavefieldZ = wavefield.getRefEZ();
-            wavefieldZ *= wavefieldZ;
-            wavefieldZ *= DT;
-            if (!isAdjoint) {
-                approxHessian += wavefieldZ;  
-            } else {
-                approxHessianAdjoint += wavefieldZ; 
-            }          
-        } 
     }
 }
 
+/*! \brief Start a new iteration of the reuse policy
+ *
+ * The stored approximated Hessians are removed at the beginning of a new workflow stage because the frequency content of the wavefields changes.
+ \param workflowStage Workflow stage
+ \param iteration Iteration in the workflow stage
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::startIteration(scai::IndexType workflowStage, scai::IndexType iteration)
+{
+    if (workflowStage != currentStage) {
+        storedApproxHessian.clear();
+        currentStage = workflowStage;
+    }
+    currentIteration = iteration;
+    numCalculated = 0;
+    numReused = 0;
+    staleness = 0;
+}
+
 /*! \brief Apply the approximation of the diagonal of the inverse of the Hessian for one shot
  *
  \param gradientPerShot 
@@ -120,13 +158,30 @@ void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::apply(KITGPI::Gr
     if (useEnergyPreconditioning != 0 && useEnergyPreconditioning != 3) {  
     //     sqrt(approxHessian) missing because of |u_i| (see IFOS2D)?
     
-        /* Stabilize Hessian for inversion (of diagonal matrix) and normalize Hessian */
-        if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4) {
-            approxHessian *= approxHessianAdjoint;
-            approxHessian = scai::lama::sqrt(approxHessian);
+        if (calculateHessian) {
+            /* Stabilize Hessian for inversion (of diagonal matrix) and normalize Hessian */
+            if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4) {
+                approxHessian *= approxHessianAdjoint;
+                approxHessian = scai::lama::sqrt(approxHessian);
+            }
+            approxHessian += epsilonHessian*approxHessian.maxNorm(); 
+            approxHessian *= 1 / approxHessian.maxNorm();   
+            
+            if (hessianInterval > 1) {
+                /* the relative change to the reused approximated Hessian estimates its staleness */
+                auto stored = storedApproxHessian.find(shotNumber);
+                if (stored != storedApproxHessian.end()) {
+                    scai::lama::DenseVector<ValueType> difference;
+                    difference = approxHessian - stored->second;
+                    staleness = std::max(staleness, ValueType(difference.l2Norm() / approxHessian.l2Norm()));
+                }
+                storedApproxHessian[shotNumber] = approxHessian;
+            }
+            numCalculated++;
+        } else {
+            approxHessian = storedApproxHessian[shotNumber];
+            numReused++;
         }
-        approxHessian += epsilonHessian*approxHessian.maxNorm(); 
-        approxHessian *= 1 / approxHessian.maxNorm();   
         
         if(saveApproxHessian){
             IO::writeVector(approxHessian, approxHessianName + ".shot_" + std::to_string(shotNumber), fileFormat);        
@@ -143,16 +198,21 @@ void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::apply(KITGPI::Gr
     }
 }
 
-/*! \brief Reset approxHessian
+/*! \brief Reset approxHessian before the forward modelling of a shot
  *
+ * With energyPreconditioningInterval = k > 1 the approximated Hessian is only calculated in every k-th iteration or if no approximated Hessian of the shot is stored.
+ \param shotNumber Shot number of the stored approximated Hessian
  */
 template <typename ValueType>
-void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::resetApproxHessian()
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::resetApproxHessian(scai::IndexType shotNumber)
 {
     if (useEnergyPreconditioning != 0) {
-        approxHessian.setSameValue(wavefieldX.getDistributionPtr(), 0); // does not change size/distribution
+        calculateHessian = (hessianInterval == 1 || currentIteration % hessianInterval == 0 || storedApproxHessian.count(shotNumber) == 0);
+        numTimeSteps = 0;
+        numTimeStepsAdjoint = 0;
+        approxHessian.setSameValue(distHessian, 0); // does not change size/distribution
         if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)
-            approxHessianAdjoint.setSameValue(wavefieldX.getDistributionPtr(), 0);
+            approxHessianAdjoint.setSameValue(distHessian, 0);
     }
 }
 
@@ -162,12 +222,156 @@ void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::resetApproxHessi
 template <typename ValueType>
 void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::applyTransform(scai::lama::Matrix<ValueType> const &lhs)
 {
-    if (useEnergyPreconditioning != 0) {
+    if (useEnergyPreconditioning != 0 && calculateHessian) {
         approxHessian = lhs * approxHessian;   // change size/distribution
         if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)
             approxHessianAdjoint = lhs * approxHessianAdjoint; 
     }
 }
 
+/*! \brief Average and recover the approximated Hessian on the inversion grid after the accumulation (restriction after accumulation)
+ \param blockAverage Block average of the inversion grid
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::applyBlockAverage(KITGPI::Taper::BlockAverage<ValueType> const &blockAverage)
+{
+    if (useEnergyPreconditioning != 0 && calculateHessian) {
+        blockAverage.apply(approxHessian);
+        if (useEnergyPreconditioning == 2 || useEnergyPreconditioning == 4)
+            blockAverage.apply(approxHessianAdjoint);
+    }
+}
+
+/*! \brief Append the statistics of the reuse policy of the last iteration to the log file
+ *
+ * The staleness is the maximum over all shots of the relative l2 difference between a recalculated approximated Hessian and the one reused before.
+ \param commAll Communicator of all processes
+ \param stage Workflow stage (starting at 1)
+ \param iteration Iteration
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::writeToLogFile(scai::dmemo::CommunicatorPtr commAll, scai::IndexType stage, scai::IndexType iteration)
+{
+    staleness = commAll->max(staleness);
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream logFile;
+        if (!logFileInitialized) {
+            logFile.open(logFilename, std::ios::trunc);
+            logFile << "# Energy preconditioning records during inversion (shot domain 0)\n";
+            logFile << "# energyPreconditioningInterval = " << hessianInterval << ", energyPreconditioningTimeDecimation = " << timeDecimation << "\n";
+            logFile << "# Stage | Iteration | calculated Hessians | reused Hessians | staleness (maximum relative change of a recalculated Hessian)\n";
+        } else {
+            logFile.open(logFilename, std::ios::app);
+        }
+        logFile << std::setw(5) << stage << std::setw(10) << iteration + 1 << std::setw(10) << numCalculated << std::setw(10) << numReused << std::scientific << std::setprecision(6) << std::setw(18) << staleness << "\n";
+    }
+    logFileInitialized = true;
+}
+
+/*! \brief Write the state of the reuse policy to a checkpoint
+ *
+ * The state consists of the current workflow stage, the stored approximated Hessians of the shots of this shot domain and the log file.
+ \param checkpoint Checkpoint
+ \param commAll Communicator of all processes
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll) const
+{
+    checkpoint.write(currentStage);
+    checkpoint.write(scai::IndexType(storedApproxHessian.size()));
+    for (auto const &stored : storedApproxHessian) {
+        checkpoint.write(stored.first);
+        checkpoint.write(stored.second);
+    }
+
+    checkpoint.write(logFileInitialized);
+    std::string logFileContent;
+    if (logFileInitialized && commAll->getRank() == MASTERGPI) {
+        std::ifstream logFile(logFilename);
+        std::stringstream logStream;
+        logStream << logFile.rdbuf();
+        logFileContent = logStream.str();
+    }
+    checkpoint.write(logFileContent);
+}
+
+/*! \brief Read the state of the reuse policy from a checkpoint
+ *
+ * The stored approximated Hessians are normalized on the grid of the gradient per shot, so they are read with its distribution.
+ \param checkpoint Checkpoint
+ \param commAll Communicator of all processes
+ \param distGradient Distribution of the gradient per shot
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr distGradient)
+{
+    checkpoint.read(currentStage);
+    scai::IndexType numStored = 0;
+    checkpoint.read(numStored);
+    SCAI_ASSERT_ERROR(numStored == 0 || hessianInterval > 1, "Checkpoint contains approximated Hessians but energyPreconditioningInterval = " << hessianInterval);
+    storedApproxHessian.clear();
+    for (scai::IndexType i = 0; i < numStored; i++) {
+        scai::IndexType shotNumber = 0;
+        checkpoint.read(shotNumber);
+        scai::lama::DenseVector<ValueType> stored(distGradient, 0);
+        checkpoint.read(stored);
+        storedApproxHessian[shotNumber] = std::move(stored);
+    }
+
+    checkpoint.read(logFileInitialized);
+    std::string logFileContent;
+    checkpoint.read(logFileContent);
+    if (logFileInitialized && commAll->getRank() == MASTERGPI) {
+        std::ofstream logFile(logFilename, std::ios::trunc);
+        logFile << logFileContent;
+    }
+}
+
+/*! \brief Return true if the approximated Hessians are reused in between iterations */
+template <typename ValueType>
+bool KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::isReuseActive() const
+{
+    return useEnergyPreconditioning != 0 && useEnergyPreconditioning != 3 && hessianInterval > 1;
+}
+
+/*! \brief Return the number of shots of this iteration whose approximated Hessian has been calculated */
+template <typename ValueType>
+scai::IndexType KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::getNumCalculated() const
+{
+    return numCalculated;
+}
+
+/*! \brief Return the number of shots of this iteration whose stored approximated Hessian has been reused */
+template <typename ValueType>
+scai::IndexType KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::getNumReused() const
+{
+    return numReused;
+}
+
+/*! \brief Return the maximum relative change of a recalculated approximated Hessian in this iteration */
+template <typename ValueType>
+ValueType KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::getStaleness() const
+{
+    return staleness;
+}
+
+/*! \brief Return the memory of the stored approximated Hessians in MB (local values of this process) */
+template <typename ValueType>
+double KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::getMemory() const
+{
+    double memory = 0;
+    for (auto const &stored : storedApproxHessian) {
+        memory += double(stored.second.getLocalValues().size()) * sizeof(ValueType) / (1024.0 * 1024.0);
+    }
+    return memory;
+}
+
+/*! \brief Return the approximated Hessian integrated since the last reset */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> const &KITGPI::Preconditioning::EnergyPreconditioning<ValueType>::getApproxHessian() const
+{
+    return approxHessian;
+}
+
 template class KITGPI::Preconditioning::EnergyPreconditioning<double>;
 template class KITGPI::Preconditioning::EnergyPreconditioning<float>;
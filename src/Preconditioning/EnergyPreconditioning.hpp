@@ -2,9 +2,14 @@
 
 #include <scai/lama.hpp>
 #include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
 
 #include <IO/IO.hpp>
+#include "../Common/Checkpoint.hpp"
 #include "../Gradient/Gradient.hpp"
+#include "../Taper/BlockAverage.hpp"
 #include <Acquisition/Receivers.hpp>
 #include <Wavefields/Wavefields.hpp>
 
@@ -20,37 +25,73 @@ namespace KITGPI
          *  For this, the forward propagated velocity wavefield (all components available) is squared and integrated for all time steps.
          *  If applied to the gradient, source artifacts will be reduced and badly illuminated model parts will be enhanced. 
          *  In the current implementation, the preconditioning can only be applied to a single shot!
+         *  With energyPreconditioningInterval = k > 1 the approximated Hessian of a shot is only calculated in every k-th iteration of a stage and reused in between.
+         *  With energyPreconditioningTimeDecimation = n > 1 only every n-th stored time step is integrated.
          */
         template <typename ValueType>
         class EnergyPreconditioning
         {
 
         public:            
+            //! \brief Local index ranges [first, second) the integration is restricted to
+            typedef std::vector<std::pair<scai::IndexType, scai::IndexType>> IndexRanges;
+
             /* Default constructor and destructor */
             EnergyPreconditioning(){};
             ~EnergyPreconditioning(){};
 
             void init(scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config);
-            void intSquaredWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefield, ValueType DT, bool isAdjoint = false); //!< Integrate squared wavefields 
+            void intSquaredWavefields(KITGPI::Wavefields::Wavefields<ValueType> &wavefield, ValueType DT, bool isAdjoint = false, IndexRanges const *activeRanges = nullptr); //!< Integrate squared wavefields 
             
-            void resetApproxHessian();
+            void startIteration(scai::IndexType workflowStage, scai::IndexType iteration);
+            void resetApproxHessian(scai::IndexType shotNumber = -1);
             
             void apply(KITGPI::Gradient::Gradient<ValueType> &gradientPerShot, scai::IndexType shotNumber, scai::IndexType fileFormat);
             void applyTransform(scai::lama::Matrix<ValueType> const &lhs);
+            void applyBlockAverage(KITGPI::Taper::BlockAverage<ValueType> const &blockAverage);
+
+            void writeToLogFile(scai::dmemo::CommunicatorPtr commAll, scai::IndexType stage, scai::IndexType iteration);
+
+            void writeCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll) const;
+            void readCheckpoint(KITGPI::Checkpoint &checkpoint, scai::dmemo::CommunicatorPtr commAll, scai::dmemo::DistributionPtr distGradient);
+
+            bool isReuseActive() const;
+            scai::IndexType getNumCalculated() const;
+            scai::IndexType getNumReused() const;
+            ValueType getStaleness() const;
+            double getMemory() const;
+            scai::lama::DenseVector<ValueType> const &getApproxHessian() const;
+
+            static void accumulateSquared(scai::lama::DenseVector<ValueType> &sum, scai::lama::DenseVector<ValueType> const *componentX, scai::lama::DenseVector<ValueType> const *componentY, scai::lama::DenseVector<ValueType> const *componentZ, ValueType scale, IndexRanges const *activeRanges = nullptr);
             
         private:
             scai::lama::DenseVector<ValueType> approxHessian;            // approximation of the diagonal of the inverse of the Hessian 
             scai::lama::DenseVector<ValueType> approxHessianAdjoint; 
-            scai::lama::DenseVector<ValueType> wavefieldX;
-            scai::lama::DenseVector<ValueType> wavefieldY;
-            scai::lama::DenseVector<ValueType> wavefieldZ;
-            scai::IndexType useEnergyPreconditioning;
+            scai::dmemo::DistributionPtr distHessian;
+            scai::IndexType useEnergyPreconditioning = 0;
             bool saveApproxHessian;
             std::string approxHessianName;
             std::string dimension; 
             std::string equationType;
             ValueType epsilonHessian;     
             bool isSeismic = true;
+            bool useComponentX = false; // wavefield components which are integrated, resolved once from dimension and equationType
+            bool useComponentY = false;
+            bool useComponentZ = false;
+
+            scai::IndexType hessianInterval = 1;
+            scai::IndexType timeDecimation = 1;
+            bool calculateHessian = true;  // false if the stored approximated Hessian of the current shot is reused
+            scai::IndexType numTimeSteps = 0;
+            scai::IndexType numTimeStepsAdjoint = 0;
+            scai::IndexType currentStage = -1;
+            scai::IndexType currentIteration = 0;
+            scai::IndexType numCalculated = 0;
+            scai::IndexType numReused = 0;
+            ValueType staleness = 0;     // maximum relative change of a recalculated approximated Hessian in this iteration
+            std::map<scai::IndexType, scai::lama::DenseVector<ValueType>> storedApproxHessian; // normalized approximated Hessian of each shot
+            std::string logFilename;
+            bool logFileInitialized = false;
         };
     }
 }
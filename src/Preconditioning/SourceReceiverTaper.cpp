@@ -33,6 +33,18 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::stack(scai::lama::
     taper *= taperSingle;
 }
 
+/*! \brief Set the tapers, e.g. from the cache
+ *
+ \param taper_in taper
+ \param taperEncode_in tapers of the constituent shots of a supershot
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::setTaper(scai::lama::SparseVector<ValueType> const &taper_in, std::vector<scai::lama::SparseVector<ValueType>> const &taperEncode_in)
+{   
+    taper = taper_in;
+    taperEncode = taperEncode_in;
+}
+
 /*! \brief apply taper on gradient
  *
  \param gradient gradient
@@ -43,6 +55,23 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::apply(KITGPI::Grad
     gradient *= taper;
 }
 
+/*! \brief Get the index of a cell of the spatial index of the sources or receivers
+ *
+ \param cellX Cell number in x direction
+ \param cellY Cell number in y direction
+ \param cellZ Cell number in z direction
+ \param modelCoordinates Coordinate class, which eg. maps 3D coordinates to 1D model indices
+ \param radius radius of the taper = size of a cell
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::getCellIndex(scai::IndexType cellX, scai::IndexType cellY, scai::IndexType cellZ, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::IndexType radius)
+{
+    // one more cell than needed per direction, so the neighbours of the last cell have valid indices
+    IndexType numCellsX = modelCoordinates.getNX() / radius + 2;
+    IndexType numCellsY = modelCoordinates.getNY() / radius + 2;
+    return cellX + numCellsX * (cellY + numCellsY * cellZ);
+}
+
 /*! \brief Init taper
  *
  \param dist_wavefield Distribution of the wavefields
@@ -75,7 +104,17 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::
     auto rAcquisition1DCoordinates = scai::hmemo::hostReadAccess(acquisition1DCoordinates.getLocalValues());
 
     if(radius>0 && taperType>0){
-        //loop over all gridpoint -> this is costly maybe there is a better alternative because the size of the taper is known
+        // spatial index: the sources or receivers are sorted by cells of size radius, so each grid point only checks the cells around it
+        std::vector<std::pair<IndexType, IndexType>> cellPoints; // (cell index, 1D coordinate)
+        for (IndexType srcRecNum = 0; srcRecNum < acquisition1DCoordinates.size(); srcRecNum++) {
+            SourceCoordinate = rAcquisition1DCoordinates[srcRecNum];
+            KITGPI::Acquisition::coordinate3D centerCoord = modelCoordinates.index2coordinate(SourceCoordinate);
+            cellPoints.push_back(std::make_pair(getCellIndex(centerCoord.x / radius, centerCoord.y / radius, centerCoord.z / radius, modelCoordinates, radius), SourceCoordinate));
+        }
+        // several components at the same position are only checked once
+        std::sort(cellPoints.begin(), cellPoints.end());
+        cellPoints.erase(std::unique(cellPoints.begin(), cellPoints.end()), cellPoints.end());
+
         for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)){
             ValueType valueTemp=1;
             ValueType value=1;
@@ -83,44 +122,54 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::
             KITGPI::Acquisition::coordinate3D coord;
             // get 3D coordinate of current ownedIndex
             coord = modelCoordinates.index2coordinate(ownedIndex);
-                
-            //loop over all shots or receivers
-            for (IndexType srcRecNum = 0; srcRecNum < acquisition1DCoordinates.size(); srcRecNum++) {
-                // get 1D coordinate
-                SourceCoordinate = rAcquisition1DCoordinates[srcRecNum];
+            IndexType cellX = coord.x / radius;
+            IndexType cellY = coord.y / radius;
+            IndexType cellZ = coord.z / radius;
 
-                // get 3D coordinate of source or receiver position
-                KITGPI::Acquisition::coordinate3D centerCoord = modelCoordinates.index2coordinate(SourceCoordinate);
-                
-                ValueType distance;
+            //loop over the shots or receivers in the neighbouring cells
+            for (IndexType iz = std::max(cellZ - 1, IndexType(0)); iz <= cellZ + 1; iz++) {
+                for (IndexType iy = std::max(cellY - 1, IndexType(0)); iy <= cellY + 1; iy++) {
+                    for (IndexType ix = std::max(cellX - 1, IndexType(0)); ix <= cellX + 1; ix++) {
+                        IndexType cellIndex = getCellIndex(ix, iy, iz, modelCoordinates, radius);
+                        auto cellBegin = std::lower_bound(cellPoints.begin(), cellPoints.end(), std::make_pair(cellIndex, IndexType(0)));
+                        for (auto cellPoint = cellBegin; cellPoint != cellPoints.end() && cellPoint->first == cellIndex; cellPoint++) {
+                            // get 3D coordinate of source or receiver position
+                            KITGPI::Acquisition::coordinate3D centerCoord = modelCoordinates.index2coordinate(cellPoint->second);
+                            
+                            ValueType distance;
 
-                // distance between src/rec position and current local gridpoint
-                distance = sqrt((centerCoord.x - coord.x) * (centerCoord.x - coord.x) + (centerCoord.y - coord.y) * (centerCoord.y - coord.y) + (centerCoord.z - coord.z) * (centerCoord.z - coord.z));
-            
-                // taper area:
-                if (distance <= radius) {
-                    if (distance >= 1) {
-                        //-1 is needed because sparseVector=Densevector sets zero element to 0 for (grad * taper) the zero element should be 1 -> sparsevector+1  
-                        switch (taperType) {
-                            case 1:
-                                //normalized logarithmic function : log(i)/log(max) for log(i)>1 
-                                valueTemp=std::log(distance) / std::log(radius);
-                                
-                                break;
-                            case 2:
-                                //cos^2 function : cos(i*pi/(2*max))^2
-                                valueTemp=common::Math::pow<ValueType>(common::Math::sin<ValueType>(distance * M_PI / (2.0 * radius)), 2.0);
-                        }
+                            // distance between src/rec position and current local gridpoint
+                            distance = sqrt((centerCoord.x - coord.x) * (centerCoord.x - coord.x) + (centerCoord.y - coord.y) * (centerCoord.y - coord.y) + (centerCoord.z - coord.z) * (centerCoord.z - coord.z));
                         
-                        if (valueTemp < value){
-                            value=valueTemp;
+                            // taper area:
+                            if (distance <= radius) {
+                                if (distance >= 1) {
+                                    switch (taperType) {
+                                        case 1:
+                                            //normalized logarithmic function : log(i)/log(max) for log(i)>1 
+                                            valueTemp=std::log(distance) / std::log(radius);
+                                            
+                                            break;
+                                        case 2:
+                                            //cos^2 function : cos(i*pi/(2*max))^2
+                                            valueTemp=common::Math::pow<ValueType>(common::Math::sin<ValueType>(distance * M_PI / (2.0 * radius)), 2.0);
+                                    }
+                                    
+                                    if (valueTemp < value){
+                                        value=valueTemp;
+                                    }
+                                } else {
+                                    value=0;
+                                }                    
+                            }
                         }
-                    } else {
-                        value=0;
-                    }                    
+                    }
                 }
             }
-            assembly.push(ownedIndex, value);
+            // the zero element of the taper is 1, so only the tapered points are stored
+            if (value < 1) {
+                assembly.push(ownedIndex, value);
+            }
         }
     }
 
@@ -197,10 +246,12 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::
  \param receivers receivers
  \param config Configuration class, which is used to derive all required parameters
  \param modelCoordinates Coordinate class, which eg. maps 3D coordinates to 1D model indices
- \param radius radius of the taper. 0=not apply taper.
+ \param sourceSettingsEncode source settings of the current encoding
+ \param shotNumberEncode number of the supershot
+ \param taperCache cache of the tapers of the constituent shots
  */
 template <typename ValueType>
-void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::CommunicatorPtr commShot, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, scai::IndexType shotNumberEncode)
+void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::CommunicatorPtr commShot, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, scai::IndexType shotNumberEncode, SourceReceiverTaperCache<ValueType> &taperCache)
 {
     IndexType useSourceEncode = config.getAndCatch("useSourceEncode", 0);
     IndexType gradientDomain = config.getAndCatch("gradientDomain", 0);
@@ -234,15 +285,20 @@ void KITGPI::Preconditioning::SourceReceiverTaper<ValueType>::init(scai::dmemo::
         for (scai::IndexType shotInd = 0; shotInd < numshotsIncr; shotInd++) {
             if (std::abs(sourceSettingsEncode[shotInd].sourceNo) == shotNumberEncode) {
                 IndexType shotNumber = uniqueShotNos[sourceSettingsEncode[shotInd].row];                 
-                std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsShot;
-                Acquisition::createSettingsForShot(sourceSettingsShot, sourceSettings, shotNumber);
-                sources.init(sourceSettingsShot, config, modelCoordinates, ctx, dist);
-                
-                if (config.get<IndexType>("useReceiversPerShot") != 0) {
-                    receivers.init(config, modelCoordinates, ctx, dist, shotNumber, sourceSettingsEncodeTemp);
+                std::vector<IndexType> key = SourceReceiverTaperCache<ValueType>::getKey(shotNumber, SourceReceiverTaperCache<ValueType>::CONSTITUENT);
+                std::vector<scai::lama::SparseVector<ValueType>> taperEncodeTemp; // constituent shots have no encoded tapers
+                if (!taperCache.restore(key, taper, taperEncodeTemp)) {
+                    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsShot;
+                    Acquisition::createSettingsForShot(sourceSettingsShot, sourceSettings, shotNumber);
+                    sources.init(sourceSettingsShot, config, modelCoordinates, ctx, dist);
+                    
+                    if (config.get<IndexType>("useReceiversPerShot") != 0) {
+                        receivers.init(config, modelCoordinates, ctx, dist, shotNumber, sourceSettingsEncodeTemp);
+                    }
+                    
+                    init(dist, ctx, sources, receivers, config, modelCoordinates);  
+                    taperCache.store(key, taper, taperEncodeTemp);
                 }
-                
-                init(dist, ctx, sources, receivers, config, modelCoordinates);  
                 taperEncode.push_back(taper);
             }
         }
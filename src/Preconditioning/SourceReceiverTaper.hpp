@@ -8,10 +8,15 @@
 #include <scai/lama/GridWriteAccess.hpp>
 #include <scai/lama/GridReadAccess.hpp>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include <Acquisition/AcquisitionGeometry.hpp>
 #include <Configuration/Configuration.hpp>
 
 #include "../Gradient/GradientFactory.hpp"
+#include "SourceReceiverTaperCache.hpp"
 
 namespace KITGPI
 {
@@ -36,12 +41,15 @@ namespace KITGPI
             std::vector<scai::lama::SparseVector<ValueType>> getTaperEncode();
             void init(scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Acquisition::AcquisitionGeometry<ValueType> const &Acquisition, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::IndexType radius);            
             void init(scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Acquisition::AcquisitionGeometry<ValueType> const &sources, KITGPI::Acquisition::AcquisitionGeometry<ValueType> const &receivers, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates);      
-            void init(scai::dmemo::CommunicatorPtr commShot, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, scai::IndexType shotNumberEncode);
+            void init(scai::dmemo::CommunicatorPtr commShot, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, scai::IndexType shotNumberEncode, SourceReceiverTaperCache<ValueType> &taperCache);
             
             void apply(KITGPI::Gradient::Gradient<ValueType> &gradient);
             void stack(scai::lama::SparseVector<ValueType> taperSingle);
+            void setTaper(scai::lama::SparseVector<ValueType> const &taper_in, std::vector<scai::lama::SparseVector<ValueType>> const &taperEncode_in);
                         
         private:
+            static scai::IndexType getCellIndex(scai::IndexType cellX, scai::IndexType cellY, scai::IndexType cellZ, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::IndexType radius);
+
             scai::lama::SparseVector<ValueType> taper;
             std::vector<scai::lama::SparseVector<ValueType>> taperEncode;
         };
@@ -0,0 +1,146 @@
+#include "SourceReceiverTaperCache.hpp"
+
+#include <cstdlib>
+
+using namespace scai;
+
+/*! \brief Initialize the cache from the configuration
+ *
+ * The cache is used with useSourceReceiverTaperCache = 1 and limited to sourceReceiverTaperCacheMemory MB per process.
+ \param config Configuration
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::init(KITGPI::Configuration::Configuration const &config)
+{
+    useCache = config.getAndCatch("useSourceReceiverTaperCache", 0);
+    maxMemory = config.getAndCatch("sourceReceiverTaperCacheMemory", 1024.0);
+    numReads = 0;
+    numHits = 0;
+    clear();
+}
+
+/*! \brief Copy the cached tapers of a shot
+ \param key Key of the shot (see getKey)
+ \param taper Taper of the shot
+ \param taperEncode Tapers of the constituent shots
+ \return false if the shot is not cached
+ */
+template <typename ValueType>
+bool KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::restore(std::vector<IndexType> const &key, scai::lama::SparseVector<ValueType> &taper, std::vector<scai::lama::SparseVector<ValueType>> &taperEncode)
+{
+    if (useCache == 0) {
+        return false;
+    }
+    auto entry = entries.find(key);
+    if (entry == entries.end()) {
+        numReads++;
+        return false;
+    }
+    taper = entry->second.taper;
+    taperEncode = entry->second.taperEncode;
+    numHits++;
+    return true;
+}
+
+/*! \brief Add the tapers of a shot to the cache if the memory limit allows it
+ \param key Key of the shot (see getKey)
+ \param taper Taper of the shot
+ \param taperEncode Tapers of the constituent shots
+ */
+template <typename ValueType>
+void KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::store(std::vector<IndexType> const &key, scai::lama::SparseVector<ValueType> const &taper, std::vector<scai::lama::SparseVector<ValueType>> const &taperEncode)
+{
+    if (useCache == 0 || entries.count(key) != 0) {
+        return;
+    }
+    double memoryEntry = calcMemory(taper);
+    for (auto const &taperShot : taperEncode) {
+        memoryEntry += calcMemory(taperShot);
+    }
+    // all processes of a shot domain have to cache the same shots, otherwise they would calculate the tapers collectively for different shots
+    memoryEntry = taper.getDistributionPtr()->getCommunicatorPtr()->max(memoryEntry);
+    if (memory + memoryEntry > maxMemory) {
+        return;
+    }
+    Entry &entry = entries[key];
+    entry.taper = taper;
+    entry.taperEncode = taperEncode;
+    memory += memoryEntry;
+}
+
+/*! \brief Remove all tapers from the cache */
+template <typename ValueType>
+void KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::clear()
+{
+    entries.clear();
+    memory = 0;
+}
+
+/*! \brief Return the key of a shot or of a constituent shot of a supershot
+ \param shotNumber Shot number
+ \param keyType SHOT or CONSTITUENT
+ */
+template <typename ValueType>
+std::vector<IndexType> KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(IndexType shotNumber, KeyType keyType)
+{
+    return {IndexType(keyType), shotNumber};
+}
+
+/*! \brief Return the key of a supershot, i.e. its number and its encoding
+ *
+ * The tapers of a supershot depend on the rows and the signed source numbers of its constituent shots.
+ \param sourceSettingsEncode Source settings of the current encoding
+ \param shotNumberEncode Number of the supershot
+ */
+template <typename ValueType>
+std::vector<IndexType> KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode, IndexType shotNumberEncode)
+{
+    std::vector<IndexType> key = {IndexType(SUPERSHOT), shotNumberEncode};
+    for (auto const &sourceSetting : sourceSettingsEncode) {
+        if (std::abs(sourceSetting.sourceNo) == shotNumberEncode) {
+            key.push_back(sourceSetting.row);
+            key.push_back(sourceSetting.sourceNo);
+        }
+    }
+    return key;
+}
+
+/*! \brief Return true if the cache is used */
+template <typename ValueType>
+bool KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::isActive() const
+{
+    return useCache != 0;
+}
+
+/*! \brief Return the number of shots whose tapers have been calculated */
+template <typename ValueType>
+IndexType KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::getNumReads() const
+{
+    return numReads;
+}
+
+/*! \brief Return the number of shots whose tapers have been taken from the cache */
+template <typename ValueType>
+IndexType KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::getNumHits() const
+{
+    return numHits;
+}
+
+/*! \brief Return the memory of the cached tapers in MB (maximum over the processes of the shot domain) */
+template <typename ValueType>
+double KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::getMemory() const
+{
+    return memory;
+}
+
+/*! \brief Return the memory of the local non-zero values of a sparse taper in MB
+ \param taper Taper
+ */
+template <typename ValueType>
+double KITGPI::Preconditioning::SourceReceiverTaperCache<ValueType>::calcMemory(scai::lama::SparseVector<ValueType> const &taper)
+{
+    return double(taper.getNonZeroIndexes().size()) * (sizeof(ValueType) + sizeof(IndexType)) / (1024.0 * 1024.0);
+}
+
+template class KITGPI::Preconditioning::SourceReceiverTaperCache<double>;
+template class KITGPI::Preconditioning::SourceReceiverTaperCache<float>;
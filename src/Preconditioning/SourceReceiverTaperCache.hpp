@@ -0,0 +1,68 @@
+#pragma once
+
+#include <scai/lama.hpp>
+#include <scai/lama/SparseVector.hpp>
+
+#include <Acquisition/Acquisition.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <map>
+#include <vector>
+
+namespace KITGPI
+{
+
+    //! \brief Gradient preconditioning namespace
+    namespace Preconditioning
+    {
+
+        /*! \brief Cache of the source and receiver tapers of the shots
+         *
+         * The source and receiver tapers of a shot only depend on its acquisition, so they are calculated once and reused in all iterations and stages.
+         * A supershot of source encoding is cached with its encoding, the tapers of its constituent shots are cached separately, so a new encoding only stacks cached tapers.
+         * Tapers are only added as long as the memory of the cache stays below sourceReceiverTaperCacheMemory (MB per process, the maximum over the processes of a shot domain).
+         */
+        template <typename ValueType>
+        class SourceReceiverTaperCache
+        {
+          public:
+            //! \brief Type of a cached taper
+            enum KeyType { SHOT = 0,        //!< stacked tapers of a shot
+                           SUPERSHOT = 1,   //!< stacked tapers of a supershot with its encoding
+                           CONSTITUENT = 2 }; //!< source receiver taper of a constituent shot of a supershot
+
+            SourceReceiverTaperCache() : useCache(0), maxMemory(0), memory(0), numReads(0), numHits(0){};
+            ~SourceReceiverTaperCache(){};
+
+            void init(KITGPI::Configuration::Configuration const &config);
+
+            bool restore(std::vector<scai::IndexType> const &key, scai::lama::SparseVector<ValueType> &taper, std::vector<scai::lama::SparseVector<ValueType>> &taperEncode);
+            void store(std::vector<scai::IndexType> const &key, scai::lama::SparseVector<ValueType> const &taper, std::vector<scai::lama::SparseVector<ValueType>> const &taperEncode);
+            void clear();
+
+            static std::vector<scai::IndexType> getKey(scai::IndexType shotNumber, KeyType keyType);
+            static std::vector<scai::IndexType> getKey(std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> const &sourceSettingsEncode, scai::IndexType shotNumberEncode);
+
+            bool isActive() const;
+            scai::IndexType getNumReads() const;
+            scai::IndexType getNumHits() const;
+            double getMemory() const;
+
+          private:
+            static double calcMemory(scai::lama::SparseVector<ValueType> const &taper);
+
+            /*! \brief Tapers of one shot */
+            struct Entry {
+                scai::lama::SparseVector<ValueType> taper;
+                std::vector<scai::lama::SparseVector<ValueType>> taperEncode;
+            };
+
+            scai::IndexType useCache;
+            double maxMemory;
+            double memory;
+            scai::IndexType numReads;
+            scai::IndexType numHits;
+            std::map<std::vector<scai::IndexType>, Entry> entries;
+        };
+    }
+}
@@ -155,12 +155,9 @@ void KITGPI::SourceEstimation<ValueType>::applyFilter(KITGPI::Acquisition::Sourc
     auto sourceType = Acquisition::SeismogramType(sourcesEncode.getSeismogramTypes().getValue(0) - 1);
     seismo = sourcesEncode.getSeismogramHandler().getSeismogram(sourceType).getData();
     lama::DenseMatrix<ComplexValueType> seismoTrans;
-    seismoTrans = lama::cast<ComplexValueType>(seismo);
-    // scale to power of two
-    seismoTrans.resize(seismo.getRowDistributionPtr(), filter.getColDistributionPtr());
-
     // apply filter in frequency domain
-    lama::fft<ComplexValueType>(seismoTrans, 1);
+    traceFFT.init(seismo.getNumColumns(), nFFT);
+    traceFFT.forward(seismo, seismoTrans);
 
     lama::DenseVector<ComplexValueType> filterTmp;
     lama::DenseVector<ComplexValueType> signalTmp;
@@ -169,6 +166,8 @@ void KITGPI::SourceEstimation<ValueType>::applyFilter(KITGPI::Acquisition::Sourc
         if (std::abs(sourceSettingsEncode[shotInd].sourceNo) == shotNumberEncode) {  
             filter.getRow(filterTmp, shotInd);
             SCAI_ASSERT_ERROR(filterTmp.l2Norm() != 0, "filterTmp.l2Norm() == 0 when shotInd = " + std::to_string(shotInd));
+            // the filter is Hermitian, the non-negative frequencies are sufficient
+            filterTmp.resize(seismoTrans.getColDistributionPtr());
             seismoTrans.getRow(signalTmp, count);
             signalTmp *= filterTmp;
             seismoTrans.setRow(signalTmp, count, common::BinaryOp::COPY);
@@ -176,16 +175,69 @@ void KITGPI::SourceEstimation<ValueType>::applyFilter(KITGPI::Acquisition::Sourc
         }
     }
 
-    lama::ifft<ComplexValueType>(seismoTrans, 1);
-    seismoTrans *= 1.0 / nFFT;
-
     // return to time domain
-    seismoTrans.resize(seismo.getRowDistributionPtr(), seismo.getColDistributionPtr());
-    seismo = lama::real(seismoTrans);
+    traceFFT.inverse(seismoTrans, seismo);
     
     sourcesEncode.getSeismogramHandler().getSeismogram(sourceType).getData() = seismo;
 }
 
+/*! \brief Apply the Wiener filter to synthetic seismograms
+ *
+ * The wavefield is linear in the source, so convolving the synthetics of the uncorrected source with the filter gives the synthetics of the corrected source without another forward solve.
+ \param receivers Synthetic receivers (in- and output)
+ \param shotInd Shot index of source
+ */
+template <typename ValueType>
+void KITGPI::SourceEstimation<ValueType>::applyFilter(KITGPI::Acquisition::Receivers<ValueType> &receivers, scai::IndexType shotInd) const
+{
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (receivers.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            convolveFilter(receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent)).getData(), shotInd, false);
+        }
+    }
+}
+
+/*! \brief Apply the adjoint of the Wiener filter to adjoint sources
+ *
+ * Correlating the adjoint sources with the filter makes the zero-lag cross-correlation with a forward wavefield of the uncorrected source equal to the one with the corrected source.
+ \param adjointSources Adjoint sources (in- and output)
+ \param shotInd Shot index of source
+ */
+template <typename ValueType>
+void KITGPI::SourceEstimation<ValueType>::applyFilterAdjoint(KITGPI::Acquisition::Receivers<ValueType> &adjointSources, scai::IndexType shotInd) const
+{
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        if (adjointSources.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent)) != 0) {
+            convolveFilter(adjointSources.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType(iComponent)).getData(), shotInd, true);
+        }
+    }
+}
+
+/*! \brief Convolve (or correlate) all traces of a seismogram with the Wiener filter of one shot
+ \param seismo Seismogram data (in- and output)
+ \param shotInd Shot index of source
+ \param correlate if true the complex conjugate of the filter is used
+ */
+template <typename ValueType>
+void KITGPI::SourceEstimation<ValueType>::convolveFilter(lama::DenseMatrix<ValueType> &seismo, scai::IndexType shotInd, bool correlate) const
+{
+    lama::DenseVector<ComplexValueType> filterTmp;
+    filter.getRow(filterTmp, shotInd);
+    SCAI_ASSERT_ERROR(filterTmp.l2Norm() != 0, "filterTmp.l2Norm() == 0 when shotInd = " + std::to_string(shotInd));
+    if (correlate)
+        filterTmp = lama::conj(filterTmp);
+
+    lama::DenseMatrix<ComplexValueType> seismoTrans;
+    // apply filter in frequency domain
+    traceFFT.init(seismo.getNumColumns(), nFFT);
+    traceFFT.forward(seismo, seismoTrans);
+    filterTmp.resize(seismoTrans.getColDistributionPtr());
+    seismoTrans.scaleColumns(filterTmp);
+
+    // return to time domain
+    traceFFT.inverse(seismoTrans, seismo);
+}
+
 /*! \brief Correlate the rows of two matrices.
  \param prod Result
  \param A First matrix
@@ -197,24 +249,21 @@ void KITGPI::SourceEstimation<ValueType>::matCorr(scai::lama::DenseVector<Comple
     lama::DenseMatrix<ComplexValueType> ATmp;
     lama::DenseMatrix<ComplexValueType> BTmp;
 
-    ATmp = lama::cast<ComplexValueType>(A);
-    BTmp = lama::cast<ComplexValueType>(B);
-
-    auto colDist = std::make_shared<dmemo::NoDistribution>(nFFT);
-    ATmp.resize(A.getRowDistributionPtr(), colDist);
-    BTmp.resize(A.getRowDistributionPtr(), colDist);
-
-    lama::fft<ComplexValueType>(ATmp, 1);
-    lama::fft<ComplexValueType>(BTmp, 1);
+    // the correlation of real traces is Hermitian, so only the non-negative frequencies are calculated
+    traceFFT.init(A.getNumColumns(), nFFT);
+    traceFFT.forward(A, ATmp);
+    traceFFT.forward(B, BTmp);
     ATmp.conj();
     ATmp.binaryOp(ATmp, common::BinaryOp::MULT, BTmp);
 
     if (useOffsetMutes) {
-        ATmp.redistribute(mutes[shotInd].getDistributionPtr(), colDist);
+        ATmp.redistribute(mutes[shotInd].getDistributionPtr(), ATmp.getColDistributionPtr());
         ATmp.scaleRows(lama::eval<lama::DenseVector<ComplexValueType>>(lama::cast<ComplexValueType>(mutes[shotInd])));
     }
 
-    ATmp.reduce(prod, 1, common::BinaryOp::ADD, common::UnaryOp::COPY);
+    lama::DenseVector<ComplexValueType> prodHalf;
+    ATmp.reduce(prodHalf, 1, common::BinaryOp::ADD, common::UnaryOp::COPY);
+    TraceFFT<ValueType>::expandSpectrum(prodHalf, prod, nFFT);
 }
 
 /*! \brief Correlate and sum all components of two receivers.
@@ -567,5 +616,25 @@ void KITGPI::SourceEstimation<ValueType>::setRefTracesToSource(KITGPI::Acquisiti
     sources.getSeismogramHandler().getSeismogram(sourceType).getData() = data;
 }
 
+/*! \brief Write the Wiener filters to a checkpoint
+ *
+ * The filters are estimated in the first iteration of a stage and reused in the following iterations.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::SourceEstimation<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    checkpoint.write(filter);
+}
+
+/*! \brief Read the Wiener filters from a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::SourceEstimation<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    checkpoint.read(filter);
+}
+
 template class KITGPI::SourceEstimation<double>;
 template class KITGPI::SourceEstimation<float>;
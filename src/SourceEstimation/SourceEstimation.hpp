@@ -16,7 +16,9 @@
 #include <scai/common/Complex.hpp>
 #include <scai/lama/fft.hpp>
 
+#include "../Common/Checkpoint.hpp"
 #include "../Common/Common.hpp"
+#include "../Common/TraceFFT.hpp"
 #include "../Taper/Taper1D.hpp"
 #include "../Taper/Taper2D.hpp"
 #include "../Workflow/Workflow.hpp"
@@ -42,6 +44,8 @@ namespace KITGPI
 
         void estimateSourceSignal(KITGPI::Acquisition::Receivers<ValueType> const &receivers, KITGPI::Acquisition::Receivers<ValueType> const &receiversTrue, scai::IndexType shotInd, scai::IndexType shotNumber);
         void applyFilter(KITGPI::Acquisition::Sources<ValueType> &sourcesEncode, IndexType shotNumberEncode, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode) const;
+        void applyFilter(KITGPI::Acquisition::Receivers<ValueType> &receivers, scai::IndexType shotInd) const;
+        void applyFilterAdjoint(KITGPI::Acquisition::Receivers<ValueType> &adjointSources, scai::IndexType shotInd) const;
         
         void estimateSourceSignalEncode(scai::dmemo::CommunicatorPtr commShot, scai::IndexType shotNumberEncode, KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, KITGPI::Acquisition::Receivers<ValueType> const &receivers, KITGPI::Acquisition::Receivers<ValueType> const &receiversTrue);
         
@@ -53,6 +57,9 @@ namespace KITGPI
         void calcRefTracesEncode(scai::dmemo::CommunicatorPtr commShot, scai::IndexType shotNumberEncode, KITGPI::Configuration::Configuration const &config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, KITGPI::Acquisition::Receivers<ValueType> &receiversEncode, Taper::Taper1D<ValueType> const &sourceSignalTaper);
         void applyOffsetMuteEncode(scai::dmemo::CommunicatorPtr commShot, scai::IndexType shotNumberEncode, KITGPI::Configuration::Configuration const &config, std::vector<KITGPI::Acquisition::sourceSettings<ValueType>> sourceSettingsEncode, KITGPI::Acquisition::Receivers<ValueType> &receiversEncode);
         
+        void writeCheckpoint(KITGPI::Checkpoint &checkpoint) const;
+        void readCheckpoint(KITGPI::Checkpoint &checkpoint);
+        
       private:
         ValueType waterLevel;
         scai::IndexType nFFT; // filter length
@@ -67,7 +74,9 @@ namespace KITGPI
         std::vector<scai::lama::DenseMatrix<ValueType>> refTraces;
         bool readTaper;
         std::string taperName;
+        mutable KITGPI::TraceFFT<ValueType> traceFFT; // work buffer of the trace transforms
 
+        void convolveFilter(scai::lama::DenseMatrix<ValueType> &seismo, scai::IndexType shotInd, bool correlate) const;
         void matCorr(scai::lama::DenseVector<ComplexValueType> &prod, scai::lama::DenseMatrix<ValueType> const &A, scai::lama::DenseMatrix<ValueType> const &B, scai::IndexType shotInd);
         void addComponents(scai::lama::DenseVector<ComplexValueType> &sum, KITGPI::Acquisition::Receivers<ValueType> const &receiversA, KITGPI::Acquisition::Receivers<ValueType> const &receiversB, scai::IndexType shotInd, scai::IndexType shotNumber);
     };
@@ -18,18 +18,22 @@ using scai::IndexType;
  \param scaledGradient Misfit gradient 
  \param steplengthInit Initial steplength
  \param currentMisfit Current misfit
+ \param encodedDataCache Cache of the encoded observed data
  */
 template <typename ValueType>
-void KITGPI::StepLengthSearch<ValueType>::run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper)
+void KITGPI::StepLengthSearch<ValueType>::run(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
 {
+    PhaseTimer::Scope timerLineSearch("lineSearch");
     scaledGradient.printInvertForParameters(commAll);
     if (steplengthType == 0) {
         HOST_PRINT(commAll, "Constant steplength: " << steplengthInit << " \n");
         steplengthOptimum = steplengthInit;
     } else if (steplengthType == 1) {
-        this->runLineSearch(commAll, solver, derivatives, sources, receivers, receiversTrue, model, dist, config, modelCoordinates, scaledGradient, steplengthInit, currentMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+        this->runLineSearch(commAll, solver, derivatives, sources, receivers, receiversTrue, model, dist, config, modelCoordinates, scaledGradient, steplengthInit, currentMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
     } else if (steplengthType == 2) {
-        this->runParabolicSearch(commAll, solver, derivatives, sources, receivers, receiversTrue, model, dist, config, modelCoordinates, scaledGradient, steplengthInit, currentMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+        this->runParabolicSearch(commAll, solver, derivatives, sources, receivers, receiversTrue, model, dist, config, modelCoordinates, scaledGradient, steplengthInit, currentMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
+    } else if (steplengthType == 3) {
+        this->runSubspaceSearch(commAll, solver, derivatives, sources, receivers, receiversTrue, model, dist, config, modelCoordinates, scaledGradient, steplengthInit, currentMisfit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
     }
 }
 
@@ -48,7 +52,7 @@ void KITGPI::StepLengthSearch<ValueType>::run(scai::dmemo::CommunicatorPtr commA
  \param currentMisfit Current misfit
  */
 template <typename ValueType>
-void KITGPI::StepLengthSearch<ValueType>::runLineSearch(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper)
+void KITGPI::StepLengthSearch<ValueType>::runLineSearch(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
 {
     double start_t, end_t; /* For timing */
 
@@ -68,7 +72,9 @@ void KITGPI::StepLengthSearch<ValueType>::runLineSearch(scai::dmemo::Communicato
         numshots = numShotDomains;
     }
     std::shared_ptr<const dmemo::BlockDistribution> shotDist;
-    if (config.getAndCatch("useRandomSource", 0) != 0) {  
+    if (!uniqueShotIndsBatch.empty()) {
+        shotDist = dmemo::blockDistribution(uniqueShotIndsBatch.size(), commInterShot);
+    } else if (config.getAndCatch("useRandomSource", 0) != 0) {  
         shotDist = dmemo::blockDistribution(numShotDomains, commInterShot);
     } else {
         shotDist = dmemo::blockDistribution(numshots, commInterShot);
@@ -105,7 +111,7 @@ void KITGPI::StepLengthSearch<ValueType>::runLineSearch(scai::dmemo::Communicato
     start_t = scai::common::Walltime::get();
 
     HOST_PRINT(commAll, "\nEstimation of steplength by line search\n");
-    misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplengthInit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+    misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplengthInit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
     HOST_PRINT(commAll, "\nOptimum step length in line search: " << steplengthOptimum << "\n");
 
     steplengthGuess = steplengthInit;
@@ -155,7 +161,7 @@ void KITGPI::StepLengthSearch<ValueType>::runLineSearch(scai::dmemo::Communicato
  \param currentMisfit Current misfit
  */
 template <typename ValueType>
-void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper)
+void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
 {
     double start_t, end_t; /* For timing */
 
@@ -175,7 +181,9 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
         numshots = numShotDomains;
     }
     std::shared_ptr<const dmemo::BlockDistribution> shotDist;
-    if (config.getAndCatch("useRandomSource", 0) != 0) {  
+    if (!uniqueShotIndsBatch.empty()) {
+        shotDist = dmemo::blockDistribution(uniqueShotIndsBatch.size(), commInterShot);
+    } else if (config.getAndCatch("useRandomSource", 0) != 0) {  
         shotDist = dmemo::blockDistribution(numShotDomains, commInterShot);
     } else {
         shotDist = dmemo::blockDistribution(numshots, commInterShot);
@@ -231,6 +239,9 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
 
     /* --- Save first step length (steplength=0 is used to save computational time) --- */
     std::vector<IndexType> uniqueShotInds = sources.getUniqueShotInds();
+    if (!uniqueShotIndsBatch.empty()) {
+        uniqueShotInds = uniqueShotIndsBatch;
+    }
     misfitTestSum = 0; 
     IndexType shotIndTrue = 0;  
     for (IndexType shotInd = shotDist->lb(); shotInd < shotDist->ub(); shotInd += testShotIncr) {
@@ -243,7 +254,7 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
 
     /* --- Save second step length (initial step length) in any case --- */
     HOST_PRINT(commAll, "\nEstimation of 2nd steplength, forward test run no. " << stepCalcCount << " of maximum " << maxStepCalc << "\n");
-    misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplengthInit, workflow, freqFilter, sourceEst, sourceSignalTaper);
+    misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplengthInit, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
     steplengthParabola.setValue(1, steplengthInit);
     misfitParabola.setValue(1, misfitTestSum);
     if (misfitParabola.getValue(0) > misfitParabola.getValue(1)) {
@@ -255,7 +266,7 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
     while (step2ok == true && stepCalcCount < maxStepCalc) {
         HOST_PRINT(commAll, "\nEstimation of 3rd steplength, forward test run no. " << stepCalcCount + 1 << " of maximum " << maxStepCalc << "\n");
         steplength *= scalingFactor;
-        misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplength, workflow, freqFilter, sourceEst, sourceSignalTaper);
+        misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplength, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
         steplengthParabola.setValue(2, steplength);
         misfitParabola.setValue(2, misfitTestSum);
         if (misfitTestSum > misfitParabola.getValue(1)) {
@@ -272,7 +283,7 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
     while (step2ok == false && stepCalcCount < maxStepCalc) {
         HOST_PRINT(commAll, "Estimation of 3rd steplength, forward test run no. " << stepCalcCount + 1 << " of maximum " << maxStepCalc << "\n");
         steplength /= scalingFactor;
-        misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplength, workflow, freqFilter, sourceEst, sourceSignalTaper);
+        misfitTestSum = this->calcMisfit(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplength, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
         steplengthParabola.setValue(2, steplength);
         misfitParabola.setValue(2, misfitTestSum);
         if (misfitTestSum < misfitParabola.getValue(0)) {
@@ -320,11 +331,146 @@ void KITGPI::StepLengthSearch<ValueType>::runParabolicSearch(scai::dmemo::Commun
         steplengthOptimum = steplengthMin;
 
     HOST_PRINT(commAll, "\nOptimum step length: " << steplengthOptimum << "\n");
+    forwardHistoryCache.accept(steplengthOptimum);
+    if (forwardHistoryCache.isActive() && forwardHistoryCache.getNumShots() > 0) {
+        HOST_PRINT(commAll, "Forward history of the last trial is kept for the next gradient calculation\n");
+    }
 
     end_t = scai::common::Walltime::get();
     HOST_PRINT(commAll, "\nFinished step length search in " << end_t - start_t << " sec.\n\n\n");
 }
 
+/*! \brief Find the optimal steplengths of all inverted parameters together
+ *
+ * One test model is calculated for each inverted parameter with the step length steplengthInit along the search direction of this parameter, i.e. the test models and the current model form a simplex in the subspace of the search directions.
+ * The data perturbations of the test models predict the data of any combination of the step lengths. The quadratic model of the L2 data residual in this subspace is minimized for all step lengths at once by subspaceFit,
+ * so the coupling of the parameters is taken into account. The test shots, the observed data and the synthetic data of the current model are prepared once for all test models.
+ * The search is restricted to the L2 misfit. The bounds of the step length are applied to the largest step length of the parameters, which is the optimum step length of the search, and all step lengths are scaled by the same factor.
+ *
+ \param solver Forward solver
+ \param derivatives Derivatives matrices
+ \param receivers Receivers
+ \param sources Sources 
+ \param model Model for the finite-difference simulation
+ \param dist Distribution
+ \param config Configuration
+ \param scaledGradient Misfit gradient 
+ \param steplengthInit Initial steplength
+ \param currentMisfit Current misfit
+ \param encodedDataCache Cache of the encoded observed data
+ */
+template <typename ValueType>
+void KITGPI::StepLengthSearch<ValueType>::runSubspaceSearch(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, scai::dmemo::DistributionPtr dist, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, ValueType steplengthInit, KITGPI::Misfit::Misfit<ValueType> &currentMisfit, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
+{
+    double start_t, end_t; /* For timing */
+
+    /* ------------------------------------------- */
+    /* Get distribution, communication and context */
+    /* ------------------------------------------- */
+    scai::hmemo::ContextPtr ctx = scai::hmemo::Context::getContextPtr(); // default context, set by environment variable SCAI_CONTEXT
+    std::string dimension = config.get<std::string>("dimension");
+    std::string equationType = config.get<std::string>("equationType");
+    std::transform(dimension.begin(), dimension.end(), dimension.begin(), ::tolower);   
+    std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower); 
+
+    scai::IndexType numRelaxationMechanisms = config.get<IndexType>("numRelaxationMechanisms");
+    typename KITGPI::Wavefields::Wavefields<ValueType>::WavefieldPtr wavefields(KITGPI::Wavefields::Factory<ValueType>::Create(dimension, equationType));
+    wavefields->init(ctx, dist, numRelaxationMechanisms);
+
+    typename KITGPI::Misfit::Misfit<ValueType>::MisfitPtr dataMisfit(KITGPI::Misfit::Factory<ValueType>::Create(config.get<std::string>("misfitType")));
+    *dataMisfit = currentMisfit;
+
+    /* ------------------------------------------- */
+    /* Set values for step length search           */
+    /* ------------------------------------------- */
+    ValueType scalingFactor = config.get<ValueType>("scalingFactor");
+    ValueType steplengthMin = config.get<ValueType>("steplengthMin");
+    ValueType steplengthMax = config.get<ValueType>("steplengthMax");
+
+    /* The quadratic model of the subspace fit is the L2 data residual, it is not the misfit of the other misfit types */
+    std::string misfitType = config.get<std::string>("misfitType");
+    std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
+    SCAI_ASSERT_ERROR(misfitType.compare("l2") == 0, "The subspace step length search (steplengthType = 3) fits the L2 data residual, misfitType = " << misfitType << " is not supported");
+
+    /* One search direction for each inverted parameter, the same parameters as in the line search of each parameter (steplengthType 1) */
+    std::vector<bool> invertForParameters = scaledGradient.getInvertForParameters();
+    std::vector<std::vector<bool>> testParameters;
+    std::vector<IndexType> parameterInds;
+    for (unsigned i = 0; i < invertForParameters.size() - 1; i++) {
+        if (invertForParameters[i]) {
+            std::vector<bool> invertForParametersTemp(invertForParameters.size(), false);
+            invertForParametersTemp[i] = invertForParameters[i];
+            testParameters.push_back(invertForParametersTemp);
+            parameterInds.push_back(i);
+        }
+    }
+    SCAI_ASSERT_ERROR(!testParameters.empty(), "No inverted parameter for the subspace step length search");
+
+    start_t = scai::common::Walltime::get();
+
+    HOST_PRINT(commAll, "\nEstimation of the steplengths of " << testParameters.size() << " parameters by a subspace search\n");
+    scai::lama::DenseVector<ValueType> misfitTests = this->calcMisfits(commAll, solver, derivatives, sources, receivers, receiversTrue, model, *wavefields, config, modelCoordinates, scaledGradient, *dataMisfit, steplengthInit, testParameters, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
+    stepCalcCount = testParameters.size();
+
+    scai::lama::DenseVector<ValueType> coefficients;
+    if (subspaceFit(subspaceMatrix, subspaceVector, coefficients)) {
+        HOST_PRINT(commAll, "\nApply subspace fit");
+    } else {
+        HOST_PRINT(commAll, "\nSearch directions are almost linearly dependent, apply line fit of each parameter");
+    }
+
+    /* The bounds are applied to the combined step length, i.e. the largest step length of the parameters, and all step lengths are scaled by the same factor,
+       so the update keeps the direction of the fit in the subspace. The combined step length is the optimum step length of the search. */
+    steplengthGuess = steplengthInit;
+    ValueType steplengthCombined = 0;
+    for (unsigned testInd = 0; testInd < parameterInds.size(); testInd++) {
+        steplengthCombined = std::max(steplengthCombined, steplengthInit * coefficients.getValue(testInd));
+    }
+    ValueType steplengthScale = 1;
+    if (std::isnan(steplengthCombined) || steplengthCombined <= 0) {
+        /* no descent in the subspace, every parameter is updated with steplengthMin */
+        HOST_PRINT(commAll, "\nNo descent found by the subspace search, variable steplengthMin used to update all parameters");
+        for (unsigned testInd = 0; testInd < parameterInds.size(); testInd++) {
+            coefficients.setValue(testInd, 1);
+        }
+        steplengthCombined = steplengthMin;
+        steplengthScale = steplengthMin / steplengthInit;
+    } else {
+        ValueType steplength = steplengthCombined;
+        /* Check if accepted step length is smaller than maximally allowed step length */
+        if (steplength > steplengthMax) {
+            steplength = steplengthMax;
+            HOST_PRINT(commAll, "\nVariable steplengthMax used to update all parameters");
+        } else if (steplength < steplengthMin) {
+            steplength = steplengthMin;
+            HOST_PRINT(commAll, "\nVariable steplengthMin used to update all parameters");
+        }
+        if (steplength > steplengthGuess * scalingFactor) {
+            steplength = steplengthGuess * scalingFactor;
+            HOST_PRINT(commAll, "\nVariable steplengthInit and scalingFactor used to update all parameters");
+        }
+        steplengthScale = steplength / steplengthCombined;
+        steplengthCombined = steplength;
+    }
+    steplengthOptimum = steplengthCombined;
+
+    for (unsigned testInd = 0; testInd < parameterInds.size(); testInd++) {
+        ValueType steplength = steplengthInit * coefficients.getValue(testInd) * steplengthScale;
+        if (std::isnan(steplength))
+            steplength = steplengthMin;
+
+        steplengthLine.setValue(parameterInds[testInd], steplength);
+        misfitLine.setValue(parameterInds[testInd], misfitTests.getValue(testInd));
+
+        /* Output of the test step length, the corresponding misfit and the optimum step length of each parameter */
+        HOST_PRINT(commAll, "\nParameter " << parameterInds[testInd] + 1 << ": steplength " << steplengthGuess << ", corresponding misfit: " << misfitLine.getValue(parameterInds[testInd]) << ", optimum step length: " << steplength);
+    }
+    HOST_PRINT(commAll, "\nCombined optimum step length: " << steplengthOptimum);
+
+    end_t = scai::common::Walltime::get();
+    HOST_PRINT(commAll, "\nFinished step length search with " << stepCalcCount << " test forward calculations in " << end_t - start_t << " sec.\n\n\n");
+}
+
 /*! \brief Parabolic fit
  *
  *
@@ -355,6 +501,75 @@ ValueType KITGPI::StepLengthSearch<ValueType>::parabolicFit(scai::lama::DenseVec
     return steplengthExtremum;
 }
 
+/*! \brief Minimize a quadratic model of the misfit in the subspace of the search directions
+ *
+ * The misfit of the coefficients c of the search directions is modelled by 0.5 * c^T A c - b^T c, where A contains the inner products of the data perturbations of the directions and b the inner products of the data residual with the data perturbations.
+ * The coupled system A c = b is solved with a Cholesky decomposition of A scaled to a unit diagonal. If a pivot is too small, i.e. two directions change the data almost in the same way,
+ * the coefficients b_i / A_ii of the line fit of each direction are returned.
+ *
+ \param matrix Symmetric matrix A
+ \param rightHandSide Vector b
+ \param coefficients Coefficients c of the minimum (output)
+ \return true if the coupled system has been solved, false if the coefficients of the line fits are returned
+ */
+template <typename ValueType>
+bool KITGPI::StepLengthSearch<ValueType>::subspaceFit(scai::lama::DenseMatrix<ValueType> const &matrix, scai::lama::DenseVector<ValueType> const &rightHandSide, scai::lama::DenseVector<ValueType> &coefficients)
+{
+    IndexType n = rightHandSide.size();
+    SCAI_ASSERT_ERROR(matrix.getNumRows() == n && matrix.getNumColumns() == n, "The subspace matrix must be a square matrix of the size of the right hand side");
+    ValueType const pivotMin = 1e-4; // smallest squared pivot of the scaled matrix
+
+    std::vector<ValueType> diagonal(n);
+    std::vector<ValueType> scaledRightHandSide(n, 0);
+    coefficients.setSameValue(n, 0);
+    for (IndexType i = 0; i < n; i++) {
+        diagonal[i] = matrix.getValue(i, i);
+        if (diagonal[i] > 0) {
+            coefficients.setValue(i, rightHandSide.getValue(i) / diagonal[i]);
+            scaledRightHandSide[i] = rightHandSide.getValue(i) / std::sqrt(diagonal[i]);
+        }
+    }
+
+    /* Cholesky decomposition L L^T of the scaled matrix D^-1/2 A D^-1/2 */
+    std::vector<ValueType> lower(n * n, 0);
+    for (IndexType i = 0; i < n; i++) {
+        if (!(diagonal[i] > 0))
+            return false;
+        for (IndexType j = 0; j <= i; j++) {
+            ValueType sum = matrix.getValue(i, j) / std::sqrt(diagonal[i] * diagonal[j]);
+            for (IndexType k = 0; k < j; k++) {
+                sum -= lower[i * n + k] * lower[j * n + k];
+            }
+            if (i == j) {
+                if (!(sum > pivotMin))
+                    return false;
+                lower[i * n + i] = std::sqrt(sum);
+            } else {
+                lower[i * n + j] = sum / lower[j * n + j];
+            }
+        }
+    }
+
+    /* Forward and backward substitution, the coefficients are scaled back with D^-1/2 */
+    std::vector<ValueType> solution(scaledRightHandSide);
+    for (IndexType i = 0; i < n; i++) {
+        for (IndexType k = 0; k < i; k++) {
+            solution[i] -= lower[i * n + k] * solution[k];
+        }
+        solution[i] /= lower[i * n + i];
+    }
+    for (IndexType i = n - 1; i >= 0; i--) {
+        for (IndexType k = i + 1; k < n; k++) {
+            solution[i] -= lower[k * n + i] * solution[k];
+        }
+        solution[i] /= lower[i * n + i];
+    }
+    for (IndexType i = 0; i < n; i++) {
+        coefficients.setValue(i, solution[i] / std::sqrt(diagonal[i]));
+    }
+    return true;
+}
+
 /*! \brief Calculate misfit 
  *
  *
@@ -367,10 +582,36 @@ ValueType KITGPI::StepLengthSearch<ValueType>::parabolicFit(scai::lama::DenseVec
  \param config Configuration
  \param scaledGradient Misfit gradient 
  \param steplength Steplength
+ \param encodedDataCache Cache of the encoded observed data
  */
 template <typename ValueType>
-ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, ValueType steplength, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper)
+ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, ValueType steplength, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
 {
+    std::vector<std::vector<bool>> testParameters{scaledGradient.getInvertForParameters()};
+    scai::lama::DenseVector<ValueType> misfitTests = this->calcMisfits(commAll, solver, derivatives, sources, receivers, receiversTrue, model, wavefields, config, modelCoordinates, scaledGradient, dataMisfit, steplength, testParameters, workflow, freqFilter, sourceEst, sourceSignalTaper, encodedDataCache);
+    return misfitTests.getValue(0);
+}
+
+/*! \brief Calculate the misfit of several test models which share the test shots
+ *
+ * Every test model is updated with the parameters of one entry of testParameters. The observed data, the synthetic data of the current model and the tapers of a shot are prepared once for all test models.
+ * With steplengthType 3 the inner products of the data perturbations of the test models are summed for the subspace fit.
+ \param solver Forward solver
+ \param derivatives Derivatives matrices
+ \param receivers Receivers
+ \param sources Sources 
+ \param model Model for the finite-difference simulation
+ \param wavefields Wavefields
+ \param config Configuration
+ \param scaledGradient Misfit gradient 
+ \param steplength Steplength
+ \param testParameters Inverted parameters of each test model
+ \param encodedDataCache Cache of the encoded observed data
+ */
+template <typename ValueType>
+scai::lama::DenseVector<ValueType> KITGPI::StepLengthSearch<ValueType>::calcMisfits(scai::dmemo::CommunicatorPtr commAll, KITGPI::ForwardSolver::ForwardSolver<ValueType> &solver, KITGPI::ForwardSolver::Derivatives::Derivatives<ValueType> &derivatives, KITGPI::Acquisition::Sources<ValueType> sources, KITGPI::Acquisition::Receivers<ValueType> &receivers, KITGPI::Acquisition::Receivers<ValueType> &receiversTrue, KITGPI::Modelparameter::Modelparameter<ValueType> const &model, KITGPI::Wavefields::Wavefields<ValueType> &wavefields, KITGPI::Configuration::Configuration config, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Gradient::Gradient<ValueType> &scaledGradient, KITGPI::Misfit::Misfit<ValueType> &dataMisfit, ValueType steplength, std::vector<std::vector<bool>> const &testParameters, KITGPI::Workflow::Workflow<ValueType> const &workflow, KITGPI::Filter::Filter<ValueType> const &freqFilter, KITGPI::SourceEstimation<ValueType> sourceEst, KITGPI::Taper::Taper1D<ValueType> sourceSignalTaper, KITGPI::EncodedDataCache<ValueType> &encodedDataCache)
+{
+    PhaseTimer::Scope timerTrial("trial");
     /* ------------------------------------------- */
     /* Get distribution, communication and context */
     /* ------------------------------------------- */
@@ -427,7 +668,9 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
     }
     
     std::shared_ptr<const dmemo::BlockDistribution> shotDist;
-    if (config.getAndCatch("useRandomSource", 0) != 0) {  
+    if (!uniqueShotIndsBatch.empty()) {
+        shotDist = dmemo::blockDistribution(uniqueShotIndsBatch.size(), commInterShot);
+    } else if (config.getAndCatch("useRandomSource", 0) != 0) {  
         shotDist = dmemo::blockDistribution(numShotDomains, commInterShot);
     } else {
         shotDist = dmemo::blockDistribution(numshots, commInterShot);
@@ -445,47 +688,68 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
 
     int testShotIncr = config.get<int>("testShotIncr");
 
-    scai::lama::DenseVector<ValueType> misfitTest(numshots, 0, ctx);
+    IndexType numTests = testParameters.size();
+    std::vector<scai::lama::DenseVector<ValueType>> misfitTests(numTests, scai::lama::DenseVector<ValueType>(numshots, 0, ctx));
+
+    // the forward history of a trial of the parabolic search is recorded for the gradient calculation of the next iteration
+    bool recordForwardHistory = forwardHistoryCache.isActive() && steplengthType == 2 && numTests == 1;
 
     // Implement a (virtual) copy constructor in the abstract base class to simplify the following code -> virtual constructor idiom!
-    typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr testmodel(KITGPI::Modelparameter::Factory<ValueType>::Create(equationType));
-    *testmodel = model;
-    testmodel->prepareForInversion(config, commShot);
-    
-    typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr testmodelPerShot(KITGPI::Modelparameter::Factory<ValueType>::Create(equationType));
-    
-    typename KITGPI::Gradient::Gradient<ValueType>::GradientPtr testgradient(KITGPI::Gradient::Factory<ValueType>::Create(equationType));
-    *testgradient = scaledGradient;
-    std::vector<bool> invertForParameters = scaledGradient.getInvertForParameters();
-    testgradient->setInvertForParameters(invertForParameters);
+    std::vector<typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr> testmodels;
+    for (IndexType testInd = 0; testInd < numTests; testInd++) {
+        typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr testmodel(KITGPI::Modelparameter::Factory<ValueType>::Create(equationType));
+        *testmodel = model;
+        testmodel->prepareForInversion(config, commShot);
+        
+        typename KITGPI::Gradient::Gradient<ValueType>::GradientPtr testgradient(KITGPI::Gradient::Factory<ValueType>::Create(equationType));
+        *testgradient = scaledGradient;
+        testgradient->setInvertForParameters(testParameters[testInd]);
 
-    /* Update model */
-    *testgradient *= steplength;
-    *testmodel -= *testgradient;
-    
-    if (config.get<bool>("useModelThresholds"))
-        testmodel->applyThresholds(config);
+        /* Update model */
+        *testgradient *= steplength;
+        *testmodel -= *testgradient;
+        
+        if (config.get<bool>("useModelThresholds"))
+            testmodel->applyThresholds(config);
 
-    if (testmodel->getParameterisation() == 2 || testmodel->getParameterisation() == 1) {
-        HOST_PRINT(commAll, "\n======= calcWaveModulusFromPetrophysics test =====\n");  
-        testmodel->calcWaveModulusFromPetrophysics();  
-    }
-    
-    if (config.get<bool>("useModelThresholds"))
-        testmodel->applyThresholds(config); 
+        if (testmodel->getParameterisation() == 2 || testmodel->getParameterisation() == 1) {
+            HOST_PRINT(commAll, "\n======= calcWaveModulusFromPetrophysics test =====\n");  
+            testmodel->calcWaveModulusFromPetrophysics();  
+        }
+        
+        if (config.get<bool>("useModelThresholds"))
+            testmodel->applyThresholds(config); 
 
-    if (!useStreamConfig) {
-        testmodel->prepareForModelling(modelCoordinates, ctx, dist, commShot);
-        solver.prepareForModelling(*testmodel, config.get<ValueType>("DT"));
+        if (recordForwardHistory) {
+            forwardHistoryCache.startTrial(ModelPerShotCache<ValueType>::getParameters(*testmodel, equationType), steplength, workflow.workflowStage, workflow.skipDT);
+        }
+
+        if (!useStreamConfig) {
+            testmodel->prepareForModelling(modelCoordinates, ctx, dist, commShot);
+        }
+        testmodels.push_back(testmodel);
     }
+    // a single test model is prepared once, several test models are prepared before each forward run
+    if (!useStreamConfig && numTests == 1) {
+        solver.prepareForModelling(*testmodels[0], config.get<ValueType>("DT"));
+    }
+    
+    typename KITGPI::Modelparameter::Modelparameter<ValueType>::ModelparameterPtr testmodelPerShot(KITGPI::Modelparameter::Factory<ValueType>::Create(equationType));
 
     std::vector<IndexType> uniqueShotInds = sources.getUniqueShotInds();
+    if (!uniqueShotIndsBatch.empty()) {
+        uniqueShotInds = uniqueShotIndsBatch;
+    }
     std::vector<IndexType> shotIndsIncr = sources.getShotIndsIncr();
+    if (!uniqueShotIndsBatch.empty()) {
+        shotIndsIncr = uniqueShotIndsBatch;
+    }
     IndexType shotNumber;  
     IndexType shotIndTrue = 0;  
     IndexType shotIndIncr = 0;  
     ValueType numerator = 0;
     ValueType denominator = 0;
+    std::vector<ValueType> subspaceSums(numTests * (numTests + 1), 0); // inner products of the data perturbations followed by the inner products with the residual
     // later it should be possible to select only a subset of shots for the step length search
     for (IndexType shotInd = shotDist->lb(); shotInd < shotDist->ub(); shotInd += testShotIncr) {
         shotIndTrue = uniqueShotInds[shotInd];
@@ -501,23 +765,6 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
         }                    
         sources.init(sourceSettingsShot, config, modelCoordinates, ctx, dist);
 
-        if (!useStreamConfig) {
-            CheckParameter::checkNumericalArtefactsAndInstabilities<ValueType>(config, sourceSettingsShot, *testmodel, modelCoordinates, shotNumber);
-        } else {
-            HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << commInterShot->getRank() << ", index " << shotIndTrue + 1 << " of " << numshots << "): Switch to model subset\n");
-            IndexType shotIndPerShot = shotIndTrue;
-            if (useSourceEncode == 3) {
-                Acquisition::getuniqueShotInd(shotIndPerShot, sourceSettingsEncode, shotNumber);
-            }
-            testmodel->getModelPerShot(*testmodelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinates.at(shotIndPerShot));    
-            testmodelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot); 
-            solver.prepareForModelling(*testmodelPerShot, config.get<ValueType>("DT"));
-            
-            CheckParameter::checkNumericalArtefactsAndInstabilities<ValueType>(config, sourceSettingsShot, *testmodelPerShot, modelCoordinates, shotNumber);
-        }
-
-        HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << commInterShot->getRank() << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start Test Forward\n");
-        
         if (config.get<IndexType>("useReceiversPerShot") != 0) {
             receivers.init(config, modelCoordinates, ctx, dist, shotNumber, sourceSettingsEncode);
             receiversTrue.init(config, modelCoordinates, ctx, dist, shotNumber, sourceSettingsEncode);
@@ -530,7 +777,7 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
         if (useSourceEncode == 0) {
             receiversTrue.getSeismogramHandler().read(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("fieldSeisName") + ".shot_" + std::to_string(shotNumber), 1);
         } else {
-            receiversTrue.encode(config, config.get<std::string>("fieldSeisName"), shotNumber, sourceSettingsEncode, 1);
+            encodedDataCache.encode(receiversTrue, config, shotNumber, sourceSettingsEncode);
         }
         if (useSourceEncode == 0 || receivers.getNumTracesGlobal() == numShotPerSuperShot) {
             receiversLast.getSeismogramHandler().read(config.get<IndexType>("SeismogramFormat"), config.get<std::string>("SeismogramFilename") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".It_" + std::to_string(workflow.iteration) + ".shot_" + std::to_string(shotNumber));
@@ -580,6 +827,13 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
         }
         seismogramTaper1D.apply(receiversTrue.getSeismogramHandler());
 
+        /* Normalize observed data */
+        if (config.get<IndexType>("normalizeTraces") == 3 || dataMisfit.getMisfitTypeShots().getValue(shotIndTrue) == 6) {
+            // to read inverseAGC matrix.
+            receiversTrue.getSeismogramHandler().read(5, config.get<std::string>("fieldSeisName") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".shot_" + std::to_string(shotNumber));      
+        }
+        receiversTrue.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
+
         if (config.get<IndexType>("useSourceSignalInversion") != 0) {
             if (useSourceEncode == 0) {
                 sourceEst.applyFilter(sources, shotNumber, sourceSettings);
@@ -594,97 +848,176 @@ ValueType KITGPI::StepLengthSearch<ValueType>::calcMisfit(scai::dmemo::Communica
             }
         }
 
-        wavefields.resetWavefields();
+        std::vector<KITGPI::Acquisition::SeismogramHandler<ValueType>> seismoHandlersSyn(numTests);
+        for (IndexType testInd = 0; testInd < numTests; testInd++) {
+            if (!useStreamConfig) {
+                if (numTests > 1) {
+                    solver.prepareForModelling(*testmodels[testInd], config.get<ValueType>("DT"));
+                }
+                CheckParameter::checkNumericalArtefactsAndInstabilities<ValueType>(config, sourceSettingsShot, *testmodels[testInd], modelCoordinates, shotNumber);
+            } else {
+                HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << commInterShot->getRank() << ", index " << shotIndTrue + 1 << " of " << numshots << "): Switch to model subset\n");
+                IndexType shotIndPerShot = shotIndTrue;
+                if (useSourceEncode == 3) {
+                    Acquisition::getuniqueShotInd(shotIndPerShot, sourceSettingsEncode, shotNumber);
+                }
+                testmodels[testInd]->getModelPerShot(*testmodelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinates.at(shotIndPerShot));    
+                testmodelPerShot->prepareForModelling(modelCoordinates, ctx, dist, commShot); 
+                solver.prepareForModelling(*testmodelPerShot, config.get<ValueType>("DT"));
+                
+                CheckParameter::checkNumericalArtefactsAndInstabilities<ValueType>(config, sourceSettingsShot, *testmodelPerShot, modelCoordinates, shotNumber);
+            }
+
+            HOST_PRINT(commShot, "Shot number " << shotNumber << " (" << "domain " << commInterShot->getRank() << ", index " << shotIndTrue + 1 << " of " << numshots << "): Start Test Forward " << testInd + 1 << " of " << numTests << "\n");
+            
+            bool recordShot;
+            {
+                PhaseTimer::Scope timerForward("forward");
+                wavefields.resetWavefields();
+                recordShot = recordForwardHistory && forwardHistoryCache.startShot(shotIndTrue, wavefields, dist, tStepEnd);
         
-        if (!useStreamConfig) {
-            for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
-                solver.run(receivers, sources, *testmodel, wavefields, derivatives, tStep);
+                if (!useStreamConfig) {
+                    for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
+                        solver.run(receivers, sources, *testmodels[testInd], wavefields, derivatives, tStep);
+                        if (recordShot && tStep % workflow.skipDT == 0)
+                            forwardHistoryCache.storeStep(tStep, wavefields);
+                    }
+                } else {
+                    for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
+                        solver.run(receivers, sources, *testmodelPerShot, wavefields, derivatives, tStep);
+                        if (recordShot && tStep % workflow.skipDT == 0)
+                            forwardHistoryCache.storeStep(tStep, wavefields);
+                    }
+                }
+                solver.resetCPML();
             }
-        } else {
-            for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
-                solver.run(receivers, sources, *testmodelPerShot, wavefields, derivatives, tStep);
+            if (recordShot)
+                forwardHistoryCache.finishShot(receivers);
+
+            // check wavefield and seismogram for NaNs or infinite values
+            if ((commShot->any(!wavefields.isFinite(dist)) || commShot->any(!receivers.getSeismogramHandler().isFinite())) && (commInterShot->getRank() == 0)){ // if any processor returns isfinite=false, write model and break
+                testmodels[testInd]->write("model_crash", config.get<IndexType>("FileFormat"));
+                COMMON_THROWEXCEPTION("Infinite or NaN value in seismogram or/and velocity wavefield for model in steplength search, output model as model_crash.FILE_EXTENSION!");
+            }
+            if (useSourceEncode == 0) {
+                sourceEst.applyOffsetMute(config, shotIndTrue, receivers);
+            } else {
+                receivers.decode(config, "", shotNumber, sourceSettingsEncode, 0);
+                sourceEst.applyOffsetMuteEncode(commShot, shotNumber, config, sourceSettingsEncode, receivers);
+            }
+            if (dataMisfit.getMisfitTypeShots().getValue(shotIndTrue) == 3) {
+                if (useSourceEncode == 0) {
+                    sourceEst.calcRefTraces(config, shotIndTrue, receivers, sourceSignalTaper);
+                } else {
+                    sourceEst.calcRefTracesEncode(commShot, shotNumber, config, modelCoordinates, ctx, dist, sourceSettingsEncode, receivers, sourceSignalTaper);
+                }
             }
-        }
-        solver.resetCPML();
 
-        // check wavefield and seismogram for NaNs or infinite values
-        if ((commShot->any(!wavefields.isFinite(dist)) || commShot->any(!receivers.getSeismogramHandler().isFinite())) && (commInterShot->getRank() == 0)){ // if any processor returns isfinite=false, write model and break
-            testmodel->write("model_crash", config.get<IndexType>("FileFormat"));
-            COMMON_THROWEXCEPTION("Infinite or NaN value in seismogram or/and velocity wavefield for model in steplength search, output model as model_crash.FILE_EXTENSION!");
-        }
-        if (useSourceEncode == 0) {
-            sourceEst.applyOffsetMute(config, shotIndTrue, receivers);
-        } else {
+            if (config.get<IndexType>("useSeismogramTaper") > 1) {                                                   
+                seismogramTaper2D.apply(receivers.getSeismogramHandler()); 
+            }
+            seismogramTaper1D.apply(receivers.getSeismogramHandler());
+
+            /* Normalize synthetic data */
+            if (config.get<IndexType>("normalizeTraces") == 3 || dataMisfit.getMisfitTypeShots().getValue(shotIndTrue) == 6) {
+                receivers.getSeismogramHandler().setInverseAGC(receiversTrue.getSeismogramHandler());      
+            }
+            receivers.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
             receivers.decode(config, "", shotNumber, sourceSettingsEncode, 0);
-            sourceEst.applyOffsetMuteEncode(commShot, shotNumber, config, sourceSettingsEncode, receivers);
-        }
-        if (dataMisfit.getMisfitTypeShots().getValue(shotIndTrue) == 3) {
+            receivers.encode(config, "", shotNumber, sourceSettingsEncode, 0);
+
             if (useSourceEncode == 0) {
-                sourceEst.calcRefTraces(config, shotIndTrue, receivers, sourceSignalTaper);
+                /* Calculate misfit of one shot */
+                misfitTests[testInd].setValue(shotIndTrue, dataMisfit.calc(receivers, receiversTrue, shotIndTrue));
             } else {
-                sourceEst.calcRefTracesEncode(commShot, shotNumber, config, modelCoordinates, ctx, dist, sourceSettingsEncode, receivers, sourceSignalTaper);
+                /* Calculate misfit and write adjoint sources */
+                KITGPI::Acquisition::Receivers<ValueType> adjointSources;
+                IndexType seedtimeTemp;
+                dataMisfit.calcMisfitAndAdjointSources(commShot, misfitTests[testInd], adjointSources, receivers, receiversTrue, shotIndTrue, shotNumber, config, modelCoordinates, ctx, dist, sourceSettingsEncode, testmodels[testInd]->getVmin(), seedtimeTemp);
             }
-        }
 
-        if (config.get<IndexType>("useSeismogramTaper") > 1) {                                                   
-            seismogramTaper2D.apply(receivers.getSeismogramHandler()); 
-        }
-        seismogramTaper1D.apply(receivers.getSeismogramHandler());
-
-        /* Normalize observed and synthetic data */
-        if (config.get<IndexType>("normalizeTraces") == 3 || dataMisfit.getMisfitTypeShots().getValue(shotIndTrue) == 6) {
-            // to read inverseAGC matrix.
-            receiversTrue.getSeismogramHandler().read(5, config.get<std::string>("fieldSeisName") + ".stage_" + std::to_string(workflow.workflowStage + 1) + ".shot_" + std::to_string(shotNumber));      
-            receivers.getSeismogramHandler().setInverseAGC(receiversTrue.getSeismogramHandler());      
+            if (steplengthType == 1) {    
+                KITGPI::Acquisition::Seismogram<ValueType> seismogramSyn;
+                KITGPI::Acquisition::Seismogram<ValueType> seismogramSynLast;
+                KITGPI::Acquisition::Seismogram<ValueType> seismogramObs;    
+                KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerSyn;
+                KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerSynLast;
+                KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerObs;
+                seismoHandlerSyn = receivers.getSeismogramHandler();
+                seismoHandlerSynLast = receiversLast.getSeismogramHandler();
+                seismoHandlerObs = receiversTrue.getSeismogramHandler();
+                for (int i=0; i<KITGPI::Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; i++) {
+                    seismogramSyn = seismoHandlerSyn.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                    seismogramSynLast = seismoHandlerSynLast.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                    seismogramObs = seismoHandlerObs.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                    seismogramObs -= seismogramSynLast;
+                    seismogramSyn -= seismogramSynLast;
+                    denominator += seismogramSyn.getData().l2Norm() * seismogramSyn.getData().l2Norm();
+                    seismogramObs *= seismogramSyn;
+                    scai::lama::DenseVector<ValueType> traceSum = seismogramObs.getTraceSum();
+                    numerator += traceSum.sum();
+                }  
+            }
+            
+            if (steplengthType == 3) {
+                seismoHandlersSyn[testInd] = receivers.getSeismogramHandler();
+            }
         }
-        receivers.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
-        receiversTrue.getSeismogramHandler().normalize(config.get<IndexType>("normalizeTraces"));
-        receivers.decode(config, "", shotNumber, sourceSettingsEncode, 0);
-        receivers.encode(config, "", shotNumber, sourceSettingsEncode, 0);
 
-        if (useSourceEncode == 0) {
-            /* Calculate misfit of one shot */
-            misfitTest.setValue(shotIndTrue, dataMisfit.calc(receivers, receiversTrue, shotIndTrue));
-        } else {
-            /* Calculate misfit and write adjoint sources */
-            KITGPI::Acquisition::Receivers<ValueType> adjointSources;
-            IndexType seedtimeTemp;
-            dataMisfit.calcMisfitAndAdjointSources(commShot, misfitTest, adjointSources, receivers, receiversTrue, shotIndTrue, shotNumber, config, modelCoordinates, ctx, dist, sourceSettingsEncode, testmodel->getVmin(), seedtimeTemp);
-        }
-        
-        if (steplengthType == 1) {    
-            KITGPI::Acquisition::Seismogram<ValueType> seismogramSyn;
+        if (steplengthType == 3) {
+            /* Inner products of the data perturbations of the test models relative to the synthetic data of the current model */
             KITGPI::Acquisition::Seismogram<ValueType> seismogramSynLast;
-            KITGPI::Acquisition::Seismogram<ValueType> seismogramObs;    
-            KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerSyn;
-            KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerSynLast;
-            KITGPI::Acquisition::SeismogramHandler<ValueType> seismoHandlerObs;
-            seismoHandlerSyn = receivers.getSeismogramHandler();
-            seismoHandlerSynLast = receiversLast.getSeismogramHandler();
-            seismoHandlerObs = receiversTrue.getSeismogramHandler();
+            KITGPI::Acquisition::Seismogram<ValueType> seismogramObs;
+            KITGPI::Acquisition::Seismogram<ValueType> seismogramProduct;
+            std::vector<KITGPI::Acquisition::Seismogram<ValueType>> seismogramsSyn(numTests);
             for (int i=0; i<KITGPI::Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; i++) {
-                seismogramSyn = seismoHandlerSyn.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
-                seismogramSynLast = seismoHandlerSynLast.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
-                seismogramObs = seismoHandlerObs.getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                seismogramSynLast = receiversLast.getSeismogramHandler().getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                seismogramObs = receiversTrue.getSeismogramHandler().getSeismogram(static_cast<Acquisition::SeismogramType>(i));
                 seismogramObs -= seismogramSynLast;
-                seismogramSyn -= seismogramSynLast;
-                denominator += seismogramSyn.getData().l2Norm() * seismogramSyn.getData().l2Norm();
-                seismogramObs *= seismogramSyn;
-                scai::lama::DenseVector<ValueType> traceSum = seismogramObs.getTraceSum();
-                numerator += traceSum.sum();
-            }  
+                for (IndexType testInd = 0; testInd < numTests; testInd++) {
+                    seismogramsSyn[testInd] = seismoHandlersSyn[testInd].getSeismogram(static_cast<Acquisition::SeismogramType>(i));
+                    seismogramsSyn[testInd] -= seismogramSynLast;
+                }
+                for (IndexType testInd = 0; testInd < numTests; testInd++) {
+                    for (IndexType testInd2 = 0; testInd2 <= testInd; testInd2++) {
+                        seismogramProduct = seismogramsSyn[testInd];
+                        seismogramProduct *= seismogramsSyn[testInd2];
+                        subspaceSums[testInd * numTests + testInd2] += seismogramProduct.getTraceSum().sum();
+                    }
+                    seismogramProduct = seismogramObs;
+                    seismogramProduct *= seismogramsSyn[testInd];
+                    subspaceSums[numTests * numTests + testInd] += seismogramProduct.getTraceSum().sum();
+                }
+            }
         }
     }
     if (steplengthType == 1) {    
         steplengthOptimum = steplength * numerator / denominator;
     }
+    if (steplengthType == 3) {
+        scai::lama::DenseMatrix<ValueType> subspaceMatrixTemp(numTests, numTests);
+        subspaceMatrix = subspaceMatrixTemp;
+        subspaceVector.setSameValue(numTests, 0);
+        for (IndexType testInd = 0; testInd < numTests; testInd++) {
+            for (IndexType testInd2 = 0; testInd2 <= testInd; testInd2++) {
+                ValueType product = commInterShot->sum(subspaceSums[testInd * numTests + testInd2]);
+                subspaceMatrix.setValue(testInd, testInd2, product);
+                subspaceMatrix.setValue(testInd2, testInd, product);
+            }
+            subspaceVector.setValue(testInd, commInterShot->sum(subspaceSums[numTests * numTests + testInd]));
+        }
+    }
 
-    commInterShot->sumArray(misfitTest.getLocalValues());
+    scai::lama::DenseVector<ValueType> misfitSums(numTests, 0, ctx);
+    for (IndexType testInd = 0; testInd < numTests; testInd++) {
+        commInterShot->sumArray(misfitTests[testInd].getLocalValues());
+        misfitSums.setValue(testInd, misfitTests[testInd].sum());
+    }
 
     HOST_PRINT(commAll, "\n======== Finished loop over test shots =========");
     HOST_PRINT(commAll, "\n================================================\n");
 
-    return misfitTest.sum();
+    return misfitSums;
 }
 
 /*! \brief Initialize log-file
@@ -705,7 +1038,7 @@ void KITGPI::StepLengthSearch<ValueType>::initLogFile(scai::dmemo::CommunicatorP
         logFile << "# Step length log file  \n";
         logFile << "# MisfitType = " << misfitType << "\n";
         logFile << "# Iteration 0 shows misfit of initial model of each workflow stage (only first two columns and last column is meaningful here)\n";
-        if (steplengthType == 1) {
+        if (steplengthType == 1 || steplengthType == 3) {
             logFile << "# Stage | Iteration";
             for (int i = 0; i < invertNumber; i++) {
                 logFile << " | optimum step length " << i+1;                
@@ -740,7 +1073,7 @@ template <typename ValueType>
 void KITGPI::StepLengthSearch<ValueType>::appendToLogFile(scai::dmemo::CommunicatorPtr comm, IndexType workflowStage, scai::IndexType iteration, std::string logFilename, ValueType misfitSum, ValueType crossGradientMisfit)
 {
     int myRank = comm->getRank();
-    if (myRank == MASTERGPI && steplengthType == 1) {
+    if (myRank == MASTERGPI && (steplengthType == 1 || steplengthType == 3)) {
         if (iteration == 0) {
             std::string filename(logFilename);
             logFile.open(filename, std::ios_base::app);
@@ -842,6 +1175,32 @@ ValueType const &KITGPI::StepLengthSearch<ValueType>::getSteplength()
     return (steplengthOptimum);
 }
 
+/*! \brief Get optimum steplength of one parameter (steplengthType 1 and 3)
+ \param parameterInd Index of the parameter in the inverted parameters of the workflow
+ */
+template <typename ValueType>
+ValueType KITGPI::StepLengthSearch<ValueType>::getSteplength(scai::IndexType parameterInd)
+{
+    return steplengthLine.getValue(parameterInd);
+}
+
+/*! \brief Set the shots of an adaptive batch which are used instead of the shots selected by the sources
+ \param setUniqueShotInds Indices of the shots
+ */
+template <typename ValueType>
+void KITGPI::StepLengthSearch<ValueType>::setUniqueShotInds(std::vector<scai::IndexType> const &setUniqueShotInds)
+{
+    uniqueShotIndsBatch = setUniqueShotInds;
+}
+
+/*! \brief Get the forward history of the trials of the parabolic search
+ */
+template <typename ValueType>
+KITGPI::ForwardHistoryCache<ValueType> &KITGPI::StepLengthSearch<ValueType>::getForwardHistoryCache()
+{
+    return forwardHistoryCache;
+}
+
 /*! \brief Initialize steplength and misfit vectors
  *
  *
@@ -849,7 +1208,7 @@ ValueType const &KITGPI::StepLengthSearch<ValueType>::getSteplength()
 template <typename ValueType>
 void KITGPI::StepLengthSearch<ValueType>::init()
 {
-    if (steplengthType == 1) {
+    if (steplengthType == 1 || steplengthType == 3) {
         scai::lama::DenseVector<ValueType> steplengthLineTemp(invertNumber, 0);
         scai::lama::DenseVector<ValueType> misfitLineTemp(invertNumber, 0);
         steplengthLine = steplengthLineTemp;
@@ -857,5 +1216,52 @@ void KITGPI::StepLengthSearch<ValueType>::init()
     }
 }
 
+/*! \brief Set the step length of a fixed step length schedule instead of running the search
+ *
+ * The trials of the log file are set to zero and the step length is logged as optimum step length.
+ \param steplength Step length of the schedule
+ */
+template <typename ValueType>
+void KITGPI::StepLengthSearch<ValueType>::setFixedSteplength(ValueType steplength)
+{
+    steplengthOptimum = steplength;
+    stepCalcCount = 0;
+    steplengthParabola.setSameValue(3, 0);
+    misfitParabola.setSameValue(3, 0);
+    if (steplengthType == 1 || steplengthType == 3) {
+        steplengthLine.setSameValue(invertNumber, steplength);
+        misfitLine.setSameValue(invertNumber, 0);
+    }
+    forwardHistoryCache.clear();
+}
+
+/*! \brief Write the result of the last step length search to a checkpoint
+ *
+ * All other members are reinitialized at the beginning of each step length search.
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::StepLengthSearch<ValueType>::writeCheckpoint(KITGPI::Checkpoint &checkpoint) const
+{
+    checkpoint.write(step2ok);
+    checkpoint.write(step3ok);
+    checkpoint.write(stepCalcCount);
+    checkpoint.write(steplengthOptimum);
+    checkpoint.write(steplengthGuess);
+}
+
+/*! \brief Read the result of the last step length search from a checkpoint
+ \param checkpoint Checkpoint
+ */
+template <typename ValueType>
+void KITGPI::StepLengthSearch<ValueType>::readCheckpoint(KITGPI::Checkpoint &checkpoint)
+{
+    checkpoint.read(step2ok);
+    checkpoint.read(step3ok);
+    checkpoint.read(stepCalcCount);
+    checkpoint.read(steplengthOptimum);
+    checkpoint.read(steplengthGuess);
+}
+
 template class KITGPI::StepLengthSearch<double>;
 template class KITGPI::StepLengthSearch<float>;
@@ -0,0 +1,347 @@
+
+#include <scai/lama.hpp>
+
+#include <scai/common/Settings.hpp>
+#include <scai/common/Walltime.hpp>
+#include <scai/dmemo/CommunicatorStack.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ValueType.hpp>
+#include <Common/Common.hpp>
+
+#include <ForwardSolver/Derivatives/DerivativesFactory.hpp>
+#include <Modelparameter/ModelparameterFactory.hpp>
+
+#include "Misfit/Misfit.hpp"
+#include "Misfit/MisfitFactory.hpp"
+#include "StepLengthSearch/StepLengthSearch.hpp"
+#include "Taper/Taper2D.hpp"
+
+#include "Workflow/Workflow.hpp"
+
+#include <Common/HostPrint.hpp>
+#include "Common/InversionSingle.hpp"
+
+using namespace scai;
+using namespace KITGPI;
+
+bool verbose; // global variable definition
+
+/*! \brief Parameters of one run of the parameter sweep which differ from the base configuration */
+struct SweepVariant {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> overrides;
+};
+
+/*! \brief Read the variants of the parameter sweep
+ *
+ * Each line contains the name of a variant followed by the parameters which differ from the base configuration, e.g. "smooth200 smoothGradient=1 smoothGradientLength=200".
+ * A line with a name only runs the base configuration. Empty lines and lines starting with # are ignored.
+ \param filename Name of the sweep file
+ */
+std::vector<SweepVariant> readSweepFile(std::string const &filename)
+{
+    // parameters which are read again for every variant by InversionSingle::initVariant and the objects it initializes, by the workflow or during the iterations,
+    // all other parameters are used to set up the partitioning, derivative matrices, acquisition, wavefields, tapers and data only once
+    std::set<std::string> const variantParameters = {
+        // misfit, output and optimization (initVariant)
+        "misfittype", "multimisfittype", "gradientfilename", "logfilename", "modelfilename", "seismogramfilename", "sourceseismogramfilename", "maxiterations", "optimizationtype", "steplengthinit", "steplengthtype", "steplengthmin", "steplengthmax", "maxstepcalc", "scalingfactor", "steplengthdecay", "steplengthfixed", "steplengthschedule", "adambeta1", "adambeta2", "optimizerepsilon", "momentum", "svrgfilename", "svrginterval",
+        // workflow (Workflow::init and changeStage)
+        "workflowfilename", "dtinversion", "dhinversionperstage", "dhinversionpointsperwavelength", "dhinversionmax",
+        // gradient and energy preconditioning (calcGaussianKernel, prepareForInversion and EnergyPreconditioning::init)
+        "smoothgradient", "scalegradient", "normalizegradient", "weightgradient", "focusingparameter", "stablizingfunctionaltype", "usegradienttaper", "gradienttapername", "useenergypreconditioning", "epsilonhessian", "energypreconditioninginterval", "energypreconditioningtimedecimation", "saveapproxhessian", "approxhessianname",
+        // model thresholds and bound constraints (BoundConstraint::init)
+        "usemodelthresholds", "useboundconstraint", "boundtolerance", "lowervpth", "uppervpth", "lowervsth", "uppervsth", "lowerdensityth", "upperdensityth", "lowerporosityth", "upperporosityth", "lowersaturationth", "uppersaturationth", "lowerreflectivityth", "upperreflectivityth",
+        // caches, batches and time windows (their init functions in initVariant)
+        "usesourcereceivertapercache", "sourcereceivertapercachememory", "usemodelpershotcache", "modelpershotcachememory", "compensation", "usetimewindowtruncation", "usetracecompaction", "useseismogramdecimation", "decimationoversampling", "useadaptivebatch", "batchsizeinit", "batchvariancetheta", "batchseed", "usetrialforwardhistory", "trialforwardhistorymemory"};
+
+    std::ifstream file(filename);
+    SCAI_ASSERT_ERROR(file.good(), "Cannot open sweep file " << filename);
+    std::vector<SweepVariant> variants;
+    std::set<std::string> names;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        SweepVariant variant;
+        if (!(words >> variant.name))
+            continue;
+        SCAI_ASSERT_ERROR(variant.name.find('=') == std::string::npos, "Line of sweep file " << filename << " does not start with the name of the variant: " << line);
+        SCAI_ASSERT_ERROR(names.insert(variant.name).second, "Variant " << variant.name << " is defined twice in " << filename);
+        std::string word;
+        while (words >> word) {
+            std::size_t pos = word.find('=');
+            SCAI_ASSERT_ERROR(pos != std::string::npos && pos > 0, "Parameter " << word << " of variant " << variant.name << " is not given as name=value");
+            std::string key = word.substr(0, pos);
+            std::string keyLower = key;
+            std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(), ::tolower);
+            if (variantParameters.count(keyLower) == 0) {
+                COMMON_THROWEXCEPTION("Parameter " << key << " of variant " << variant.name << " is not read again for every variant or changes the setup which is shared by all variants, use separate inversions instead");
+            }
+            variant.overrides.push_back(std::make_pair(key, word.substr(pos + 1)));
+        }
+        variants.push_back(variant);
+    }
+    SCAI_ASSERT_ERROR(!variants.empty(), "No variants in sweep file " << filename);
+    return variants;
+}
+
+/*! \brief Write the parameters of a variant which differ from the base configuration
+ *
+ * The output files of the variant (log, models, gradients, seismograms, Hessian) get the name of the variant appended, if they are not set explicitly.
+ \param filename Name of the file
+ \param variant Variant
+ \param config Base configuration
+ \param logFilename Name of the log file of the variant
+ */
+void writeVariantFile(std::string const &filename, SweepVariant const &variant, KITGPI::Configuration::Configuration const &config, std::string const &logFilename)
+{
+    std::vector<std::pair<std::string, std::string>> outputs = {{"logFilename", logFilename}};
+    for (std::string key : {"ModelFilename", "gradientFilename", "SeismogramFilename", "approxHessianName", "sourceSeismogramFilename"}) {
+        std::string basename = config.getAndCatch<std::string>(key, "");
+        if (!basename.empty())
+            outputs.push_back(std::make_pair(key, basename + "." + variant.name));
+    }
+
+    std::ofstream file(filename);
+    SCAI_ASSERT_ERROR(file.good(), "Cannot write " << filename);
+    file << "# parameters of variant " << variant.name << " of the parameter sweep\n";
+    for (auto const &output : outputs) {
+        // parameter names are not case sensitive
+        bool isOverridden = std::any_of(variant.overrides.begin(), variant.overrides.end(), [&output](std::pair<std::string, std::string> const &override) { return override.first.size() == output.first.size() && std::equal(override.first.begin(), override.first.end(), output.first.begin(), [](char a, char b) { return ::tolower(a) == ::tolower(b); }); });
+        if (!isOverridden)
+            file << output.first << "=" << output.second << "\n";
+    }
+    for (auto const &override : variant.overrides)
+        file << override.first << "=" << override.second << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    double globalStart_t, globalEnd_t; /* For timing */
+    globalStart_t = common::Walltime::get();
+    IndexType seedtime = (int)time(0);
+
+    if (argc != 3) {
+        std::cout << "\n\nUsage: Sweep <base configuration> <sweep file>\n\n" << std::endl;
+        return (2);
+    }
+
+    /* --------------------------------------- */
+    /* Read configuration from file            */
+    /* --------------------------------------- */
+    Configuration::Configuration config;
+    config.readFromFile(argv[1], true);
+    std::string sweepFilename = argv[2];
+    std::vector<SweepVariant> variants = readSweepFile(sweepFilename);
+    IndexType numVariants = variants.size();
+
+    verbose = config.get<bool>("verbose");
+
+    /* Only single inversions can be swept, the inactive second inversion of Inversion.cpp is left out */
+    IndexType inversionType = config.getAndCatch("inversionType", 1);
+    SCAI_ASSERT_ERROR(inversionType == 1, "Sweep only supports single inversions (inversionType = 1)");
+    SCAI_ASSERT_ERROR(config.get<IndexType>("breakLoopType") == 0, "breakLoopType != 0");
+
+    std::string dimension = config.get<std::string>("dimension");
+    std::string equationType = config.get<std::string>("equationType");
+    std::transform(dimension.begin(), dimension.end(), dimension.begin(), ::tolower);
+    std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower);
+    bool useStreamConfig = config.getAndCatch("useStreamConfig", false);
+    IndexType maxiterations = config.get<IndexType>("maxIterations");
+
+    std::string logFilename = config.get<std::string>("logFilename");
+    std::string logPrefix = logFilename.substr(0, logFilename.length() - 4);
+    std::string logExtension = logFilename.substr(logFilename.length() - 4, 4);
+    std::string summaryFilename = config.getAndCatch<std::string>("sweepSummaryFilename", logPrefix + ".sweep" + logExtension);
+
+    /* inter node communicator */
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr(); // default communicator, set by environment variable SCAI_COMMUNICATOR
+    common::Settings::setRank(commAll->getNodeRank());
+    std::string settingsFilename; // filename for processor specific settings
+    if (common::Settings::getEnvironment(settingsFilename, "SCAI_SETTINGS")) {
+        // each processor reads line of settings file that matches its node name and node rank
+        common::Settings::readSettingsFile(settingsFilename.c_str(), commAll->getNodeName(), commAll->getNodeRank());
+    }
+    // all variants use the same random numbers
+    seedtime = commAll->max(seedtime);
+
+    /* --------------------------------------- */
+    /* Groups of processes                     */
+    /* --------------------------------------- */
+    // sweepGroups groups of contiguous processes run the variants concurrently, each group sets up the inversion once
+    IndexType numGroups = config.getAndCatch("sweepGroups", 1);
+    SCAI_ASSERT_ERROR(numGroups >= 1 && commAll->getSize() % numGroups == 0, "sweepGroups = " << numGroups << " does not divide the number of processes " << commAll->getSize());
+    numGroups = std::min(numGroups, numVariants);
+    while (commAll->getSize() % numGroups != 0)
+        numGroups--;
+    IndexType group = commAll->getRank() / (commAll->getSize() / numGroups);
+    dmemo::CommunicatorPtr commGroup = commAll->split(group);
+
+    HOST_PRINT(commAll, "\n WAVE-Inversion parameter sweep: " << numVariants << " variants of " << argv[1] << " in " << numGroups << " groups of " << commGroup->getSize() << " mpi processes\n");
+
+    /* --------------------------------------- */
+    /* Setup, shared by all variants           */
+    /* --------------------------------------- */
+    InversionSingle<ValueType> inversionSingle(config, inversionType);
+    inversionSingle.printConfig(commGroup, config, inversionType, 1);
+
+    /* execution context */
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr(); // default context, set by environment variable SCAI_CONTEXT
+
+    dmemo::DistributionPtr dist = nullptr;
+    dmemo::DistributionPtr distBig = nullptr;
+    Acquisition::Coordinates<ValueType> modelCoordinates;
+    Acquisition::Coordinates<ValueType> modelCoordinatesBig;
+
+    Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model(Modelparameter::Factory<ValueType>::Create(equationType));
+    Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelStart(Modelparameter::Factory<ValueType>::Create(equationType));
+    Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelEM(Modelparameter::Factory<ValueType>::Create(equationType));
+    ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr derivativesInversion(ForwardSolver::Derivatives::Factory<ValueType>::Create(dimension));
+    ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr derivativesInversionEM(ForwardSolver::Derivatives::Factory<ValueType>::Create(dimension));
+    typename Gradient::Gradient<ValueType>::GradientPtr crossGradientDerivative(Gradient::Factory<ValueType>::Create(equationType));
+    typename Gradient::Gradient<ValueType>::GradientPtr crossGradientDerivativeEM(Gradient::Factory<ValueType>::Create(equationType));
+    Taper::Taper2D<ValueType> modelTaper2DJoint;
+
+    Workflow::Workflow<ValueType> workflowSetup;
+    workflowSetup.init(config);
+    StepLengthSearch<ValueType> SLsearchSetup;
+
+    inversionSingle.init(commGroup, config, inversionType, 1, modelCoordinates, modelCoordinatesBig, ctx, dist, distBig, maxiterations, model, workflowSetup, crossGradientDerivative, derivativesInversion, SLsearchSetup);
+    inversionSingle.estimateMemory(commGroup, config, inversionType, 1, dist, modelCoordinates, model);
+
+    *modelStart = *model;
+    *modelEM = *model;
+    *derivativesInversionEM = *derivativesInversion;
+    Acquisition::Coordinates<ValueType> modelCoordinatesEM = modelCoordinates;
+    if (config.getAndCatch("saveCrossGradientMisfit", 0)) {
+        if (!useStreamConfig) {
+            modelTaper2DJoint.initTransformMatrix(dist, dist, ctx);
+            modelTaper2DJoint.calcTransformMatrices(config, config, modelCoordinates, modelCoordinates);
+        } else {
+            modelTaper2DJoint.initTransformMatrix(distBig, distBig, ctx);
+            modelTaper2DJoint.calcTransformMatrices(config, config, modelCoordinatesBig, modelCoordinatesBig);
+        }
+    }
+
+    double setupEnd_t = common::Walltime::get();
+    double setupTime = commAll->max(setupEnd_t - globalStart_t);
+    HOST_PRINT(commAll, "\nFinished setup of the parameter sweep in " << setupTime << " sec.\n");
+
+    /* --------------------------------------- */
+    /*        Loop over variants               */
+    /* --------------------------------------- */
+    std::vector<ValueType> finalMisfits(numVariants, 0);
+    std::vector<double> runtimes(numVariants, 0);
+    std::vector<IndexType> numIterations(numVariants, 0);
+
+    for (IndexType iVariant = group; iVariant < numVariants; iVariant += numGroups) {
+        double start_t = common::Walltime::get();
+        SweepVariant const &variant = variants[iVariant];
+
+        std::string logFilenameVariant = logPrefix + "." + variant.name + logExtension;
+        std::string variantFilename = logPrefix + "." + variant.name + ".parameters.txt";
+        if (commGroup->getRank() == MASTERGPI) {
+            writeVariantFile(variantFilename, variant, config, logFilenameVariant);
+        }
+        commGroup->synchronize();
+        Configuration::Configuration configVariant = config;
+        configVariant.readFromFile(variantFilename, true);
+        logFilenameVariant = configVariant.get<std::string>("logFilename");
+        HOST_PRINT(commGroup, "\n================ Start variant " << variant.name << " (" << iVariant + 1 << " of " << numVariants << ") with " << variantFilename << " ================\n");
+
+        std::string misfitType = configVariant.get<std::string>("misfitType");
+        std::transform(misfitType.begin(), misfitType.end(), misfitType.begin(), ::tolower);
+        IndexType maxiterationsVariant = configVariant.get<IndexType>("maxIterations");
+
+        /* every variant starts from the same model with a new misfit, workflow and step length search */
+        *model = *modelStart;
+        *modelEM = *modelStart;
+        Misfit::Misfit<ValueType>::MisfitPtr dataMisfit(Misfit::Factory<ValueType>::Create(misfitType));
+        Misfit::Misfit<ValueType>::MisfitPtr dataMisfitEM(Misfit::Factory<ValueType>::Create(misfitType));
+        Workflow::Workflow<ValueType> workflow;
+        Workflow::Workflow<ValueType> workflowEM;
+        workflowEM.init(configVariant);
+        StepLengthSearch<ValueType> SLsearch;
+        inversionSingle.initVariant(commGroup, configVariant, inversionType, ctx, dist, distBig, *model, workflow, crossGradientDerivative, SLsearch);
+        IndexType seedtimeVariant = seedtime;
+
+        bool breakLoop = false;
+        bool breakLoopEM = false;
+        for (workflow.workflowStage = 0; workflow.workflowStage < workflow.maxStage; workflow.workflowStage++) {
+            workflowEM.workflowStage = workflow.workflowStage;
+            IndexType useRTM = 0;
+            // the abort criterion ends the iterations of a stage only (see Inversion.cpp for inversionType = 1)
+            breakLoop = false;
+            breakLoopEM = false;
+            inversionSingle.initStage(commGroup, configVariant, inversionType, 1, ctx, workflow, dataMisfit, breakLoop, dist, breakLoopEM, *model);
+
+            for (workflow.iteration = 0; workflow.iteration < maxiterationsVariant; workflow.iteration++) {
+                workflowEM.iteration = workflow.iteration;
+                inversionSingle.calcGradient(commGroup, dist, model, configVariant, modelCoordinates, modelCoordinatesBig, workflow, dataMisfit, crossGradientDerivative, derivativesInversion, SLsearch, modelTaper2DJoint, maxiterationsVariant, useRTM, breakLoop, ctx, seedtimeVariant, inversionType, 1, breakLoopEM, modelEM, configVariant, modelCoordinatesEM, workflowEM, dataMisfitEM, crossGradientDerivativeEM, derivativesInversionEM);
+                if (useRTM == 1) {
+                    HOST_PRINT(commGroup, "\nFinish inverse time migration after stage " << workflow.workflowStage + 1 << " of variant " << variant.name << "\n");
+                    break;
+                }
+                finalMisfits[iVariant] = dataMisfit->getMisfitSum(workflow.iteration);
+                numIterations[iVariant]++;
+                // the remaining iterations of the stage would not change the model
+                if (breakLoop == true)
+                    break;
+
+                inversionSingle.updateModel(commGroup, dist, model, configVariant, modelCoordinates, workflow, dataMisfit, SLsearch, useRTM, breakLoop, inversionType, 1);
+                inversionSingle.runExtraModelling(commGroup, dist, model, configVariant, modelCoordinates, modelCoordinatesBig, workflow, dataMisfit, crossGradientDerivative, derivativesInversion, SLsearch, modelTaper2DJoint, maxiterationsVariant, useRTM, breakLoop, ctx, seedtimeVariant, inversionType, 1, breakLoopEM, modelEM, configVariant, modelCoordinatesEM, workflowEM, dataMisfitEM, crossGradientDerivativeEM, derivativesInversionEM);
+                if (workflow.iteration == maxiterationsVariant - 1 || useRTM == 1) {
+                    // misfit of the final model of the stage
+                    finalMisfits[iVariant] = dataMisfit->getMisfitSum(maxiterationsVariant);
+                }
+            }
+        }
+
+        double end_t = common::Walltime::get();
+        runtimes[iVariant] = end_t - start_t;
+        SLsearch.appendRunTimeToLogFile(commGroup, logFilenameVariant, runtimes[iVariant]);
+        HOST_PRINT(commGroup, "\nFinished variant " << variant.name << " in " << runtimes[iVariant] << " sec., final misfit " << finalMisfits[iVariant] << "\n");
+        if (commGroup->getRank() != MASTERGPI) {
+            // only the master of the group contributes to the summary
+            finalMisfits[iVariant] = 0;
+            runtimes[iVariant] = 0;
+            numIterations[iVariant] = 0;
+        }
+    }
+
+    /* --------------------------------------- */
+    /*        Summary                          */
+    /* --------------------------------------- */
+    for (IndexType iVariant = 0; iVariant < numVariants; iVariant++) {
+        finalMisfits[iVariant] = commAll->sum(finalMisfits[iVariant]);
+        runtimes[iVariant] = commAll->sum(runtimes[iVariant]);
+        numIterations[iVariant] = commAll->sum(numIterations[iVariant]);
+    }
+    globalEnd_t = common::Walltime::get();
+
+    if (commAll->getRank() == MASTERGPI) {
+        std::ostringstream summary;
+        summary << "# Parameter sweep " << sweepFilename << " of " << argv[1] << "\n";
+        summary << "# Setup " << setupTime << " sec. (once per group), total runtime " << globalEnd_t - globalStart_t << " sec.\n";
+        summary << "# " << std::left << std::setw(22) << "variant" << std::right << std::setw(6) << "group" << std::setw(11) << "iterations" << std::setw(16) << "final misfit" << std::setw(14) << "runtime (s)" << "\n";
+        for (IndexType iVariant = 0; iVariant < numVariants; iVariant++) {
+            summary << "  " << std::left << std::setw(22) << variants[iVariant].name << std::right << std::setw(6) << iVariant % numGroups << std::setw(11) << numIterations[iVariant] << std::setw(16) << std::scientific << std::setprecision(6) << finalMisfits[iVariant] << std::setw(14) << std::fixed << std::setprecision(2) << runtimes[iVariant] << "\n";
+        }
+        std::cout << "\n" << summary.str() << std::endl;
+        std::ofstream summaryFile(summaryFilename);
+        summaryFile << summary.str();
+    }
+    HOST_PRINT(commAll, "\nSummary of the parameter sweep written to " << summaryFilename << "\nTotal runtime of WAVE-Inversion parameter sweep: " << globalEnd_t - globalStart_t << " sec.\n\n");
+    return 0;
+}
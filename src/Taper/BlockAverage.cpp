@@ -0,0 +1,262 @@
+#include "BlockAverage.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace scai;
+
+/*! \brief Calculate the block of every local point of the modelling grid and the blocks which cross the partition boundaries
+ *
+ * A block crosses a partition boundary if not all of its points are local. The lists of these blocks are gathered once, their length is proportional to the boundaries of the partitions.
+ \param modelCoordinates coordinates of the modelling grid
+ \param modelCoordinatesInversion coordinates of the inversion grid
+ \param distIn distribution of the vectors on the modelling grid
+ */
+template <typename ValueType>
+void KITGPI::Taper::BlockAverage<ValueType>::init(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, scai::dmemo::DistributionPtr distIn)
+{
+    // the same factor as Taper2D::calcAverageMatrix
+    dist = distIn;
+    DHInversion = modelCoordinates.getNX() / modelCoordinatesInversion.getNX();
+    SCAI_ASSERT_ERROR(DHInversion >= 1, "the inversion grid is finer than the modelling grid");
+    numBlocks = modelCoordinatesInversion.getNGridpoints();
+    IndexType blockSize = (modelCoordinates.getNZ() > 1) ? DHInversion * DHInversion * DHInversion : DHInversion * DHInversion;
+    blockWeight = 1.0 / blockSize;
+
+    /* Index of the inversion grid of every local point and number of local points per block */
+    hmemo::HArray<IndexType> ownedIndexes;
+    dist->getOwnedIndexes(ownedIndexes);
+    std::map<IndexType, IndexType> numLocalPoints;
+    blocks.resize(ownedIndexes.size());
+    {
+        auto blocksWrite = hmemo::hostWriteAccess(blocks);
+        IndexType localIndex = 0;
+        for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+            KITGPI::Acquisition::coordinate3D coordinate = modelCoordinates.index2coordinate(ownedIndex);
+            IndexType blockX = coordinate.x / DHInversion;
+            IndexType blockY = coordinate.y / DHInversion;
+            IndexType blockZ = coordinate.z / DHInversion;
+            if (blockX < modelCoordinatesInversion.getNX() && blockY < modelCoordinatesInversion.getNY() && blockZ < modelCoordinatesInversion.getNZ()) {
+                blocksWrite[localIndex] = modelCoordinatesInversion.coordinate2index(blockX, blockY, blockZ);
+                numLocalPoints[blocksWrite[localIndex]]++;
+            } else {
+                blocksWrite[localIndex] = -1;
+            }
+            localIndex++;
+        }
+    }
+
+    /* Local blocks, the blocks with points on other processes are shared */
+    std::vector<IndexType> sharedBlocksLocal;
+    std::map<IndexType, IndexType> localBlockPositions;
+    localBlocks.resize(numLocalPoints.size());
+    {
+        auto localBlocksWrite = hmemo::hostWriteAccess(localBlocks);
+        IndexType localBlock = 0;
+        for (auto const &block : numLocalPoints) {
+            localBlocksWrite[localBlock] = block.first;
+            localBlockPositions[block.first] = localBlock;
+            if (block.second < blockSize)
+                sharedBlocksLocal.push_back(block.first);
+            localBlock++;
+        }
+    }
+    {
+        auto blocksWrite = hmemo::hostWriteAccess(blocks);
+        for (IndexType i = 0; i < blocks.size(); i++) {
+            if (blocksWrite[i] >= 0)
+                blocksWrite[i] = localBlockPositions[blocksWrite[i]];
+        }
+    }
+
+    /* Union of the shared blocks of all processes */
+    dmemo::Communicator const &comm = dist->getCommunicator();
+    IndexType numProcesses = comm.getSize();
+    IndexType rank = comm.getRank();
+    std::vector<IndexType> sharedBlocks(sharedBlocksLocal);
+    if (numProcesses > 1) {
+        hmemo::HArray<IndexType> numSharedPerProcess(numProcesses, IndexType(0));
+        hmemo::hostWriteAccess(numSharedPerProcess)[rank] = sharedBlocksLocal.size();
+        comm.sumArray(numSharedPerProcess);
+        IndexType offset = 0;
+        IndexType numSharedAll = 0;
+        for (IndexType iProcess = 0; iProcess < numProcesses; iProcess++) {
+            IndexType numShared = hmemo::hostReadAccess(numSharedPerProcess)[iProcess];
+            if (iProcess < rank)
+                offset += numShared;
+            numSharedAll += numShared;
+        }
+        hmemo::HArray<IndexType> sharedBlocksAll(numSharedAll, IndexType(0));
+        {
+            auto sharedWrite = hmemo::hostWriteAccess(sharedBlocksAll);
+            for (IndexType i = 0; i < IndexType(sharedBlocksLocal.size()); i++)
+                sharedWrite[offset + i] = sharedBlocksLocal[i];
+        }
+        comm.sumArray(sharedBlocksAll);
+        auto sharedRead = hmemo::hostReadAccess(sharedBlocksAll);
+        sharedBlocks.assign(sharedRead.begin(), sharedRead.end());
+        std::sort(sharedBlocks.begin(), sharedBlocks.end());
+        sharedBlocks.erase(std::unique(sharedBlocks.begin(), sharedBlocks.end()), sharedBlocks.end());
+    }
+    numSharedBlocks = sharedBlocks.size();
+    sharedPositions.resize(localBlocks.size());
+    auto positionsWrite = hmemo::hostWriteAccess(sharedPositions);
+    auto localBlocksRead = hmemo::hostReadAccess(localBlocks);
+    for (IndexType localBlock = 0; localBlock < localBlocks.size(); localBlock++) {
+        auto shared = std::lower_bound(sharedBlocks.begin(), sharedBlocks.end(), localBlocksRead[localBlock]);
+        positionsWrite[localBlock] = (shared != sharedBlocks.end() && *shared == localBlocksRead[localBlock]) ? IndexType(shared - sharedBlocks.begin()) : -1;
+    }
+}
+
+/*! \brief Sum of the local points of every local block
+ \param vector vector on the modelling grid
+ \param localSums sums of the local blocks (output)
+ */
+template <typename ValueType>
+void KITGPI::Taper::BlockAverage<ValueType>::calcLocalSums(scai::lama::DenseVector<ValueType> const &vector, scai::hmemo::HArray<ValueType> &localSums) const
+{
+    SCAI_ASSERT_ERROR(vector.getDistribution() == *dist, "the vector is not distributed as the modelling grid of the block average");
+    localSums.setSameValue(localBlocks.size(), ValueType(0));
+    auto sumsWrite = hmemo::hostWriteAccess(localSums);
+    auto values = hmemo::hostReadAccess(vector.getLocalValues());
+    auto blocksRead = hmemo::hostReadAccess(blocks);
+    for (IndexType i = 0; i < blocksRead.size(); i++) {
+        if (blocksRead[i] >= 0)
+            sumsWrite[blocksRead[i]] += values[i];
+    }
+}
+
+/*! \brief Complete the sums of the local blocks which cross the partition boundaries by the partial sums of the other processes
+ \param localSums sums of the local blocks (in- and output)
+ */
+template <typename ValueType>
+void KITGPI::Taper::BlockAverage<ValueType>::sumSharedBlocks(scai::hmemo::HArray<ValueType> &localSums) const
+{
+    if (numSharedBlocks == 0)
+        return;
+    hmemo::HArray<ValueType> sharedSums(numSharedBlocks, ValueType(0));
+    auto positionsRead = hmemo::hostReadAccess(sharedPositions);
+    {
+        auto sharedWrite = hmemo::hostWriteAccess(sharedSums);
+        auto sumsRead = hmemo::hostReadAccess(localSums);
+        for (IndexType localBlock = 0; localBlock < positionsRead.size(); localBlock++) {
+            if (positionsRead[localBlock] >= 0)
+                sharedWrite[positionsRead[localBlock]] = sumsRead[localBlock];
+        }
+    }
+    dist->getCommunicator().sumArray(sharedSums);
+    auto sharedRead = hmemo::hostReadAccess(sharedSums);
+    auto sumsWrite = hmemo::hostWriteAccess(localSums);
+    for (IndexType localBlock = 0; localBlock < positionsRead.size(); localBlock++) {
+        if (positionsRead[localBlock] >= 0)
+            sumsWrite[localBlock] = sharedRead[positionsRead[localBlock]];
+    }
+}
+
+/*! \brief Average a vector of the modelling grid to the inversion grid, equal to getAverageMatrix() * vector
+ *
+ * If every process owns points of all blocks of distInversion it owns, only the shared blocks are exchanged. Otherwise, e.g. for a replicated inversion grid, the block sums are summed over all processes.
+ \param vector vector on the modelling grid
+ \param vectorInversion vector on the inversion grid (output)
+ \param distInversion distribution of the inversion grid
+ */
+template <typename ValueType>
+void KITGPI::Taper::BlockAverage<ValueType>::average(scai::lama::DenseVector<ValueType> const &vector, scai::lama::DenseVector<ValueType> &vectorInversion, scai::dmemo::DistributionPtr distInversion) const
+{
+    SCAI_ASSERT_ERROR(distInversion->getGlobalSize() == numBlocks, "the distribution does not match the inversion grid");
+    hmemo::HArray<ValueType> localSums;
+    calcLocalSums(vector, localSums);
+
+    hmemo::HArray<IndexType> ownedIndexes;
+    distInversion->getOwnedIndexes(ownedIndexes);
+    std::vector<IndexType> ownedLocalBlocks(ownedIndexes.size(), -1);
+    IndexType isLocal = 1;
+    {
+        auto localBlocksRead = hmemo::hostReadAccess(localBlocks);
+        IndexType localIndex = 0;
+        for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+            auto localBlock = std::lower_bound(localBlocksRead.begin(), localBlocksRead.end(), ownedIndex);
+            if (localBlock != localBlocksRead.end() && *localBlock == ownedIndex) {
+                ownedLocalBlocks[localIndex] = localBlock - localBlocksRead.begin();
+            } else {
+                isLocal = 0;
+            }
+            localIndex++;
+        }
+    }
+
+    vectorInversion.allocate(distInversion);
+    auto valuesWrite = hmemo::hostWriteAccess(vectorInversion.getLocalValues());
+    if (dist->getCommunicator().min(isLocal) == 1) {
+        sumSharedBlocks(localSums);
+        auto sumsRead = hmemo::hostReadAccess(localSums);
+        for (IndexType localIndex = 0; localIndex < IndexType(ownedLocalBlocks.size()); localIndex++) {
+            valuesWrite[localIndex] = blockWeight * sumsRead[ownedLocalBlocks[localIndex]];
+        }
+    } else {
+        hmemo::HArray<ValueType> blockSums(numBlocks, ValueType(0));
+        {
+            auto blockSumsWrite = hmemo::hostWriteAccess(blockSums);
+            auto sumsRead = hmemo::hostReadAccess(localSums);
+            auto localBlocksRead = hmemo::hostReadAccess(localBlocks);
+            for (IndexType localBlock = 0; localBlock < localBlocksRead.size(); localBlock++)
+                blockSumsWrite[localBlocksRead[localBlock]] = sumsRead[localBlock];
+        }
+        if (dist->getCommunicator().getSize() > 1)
+            dist->getCommunicator().sumArray(blockSums);
+        auto sumsRead = hmemo::hostReadAccess(blockSums);
+        IndexType localIndex = 0;
+        for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+            valuesWrite[localIndex] = blockWeight * sumsRead[ownedIndex];
+            localIndex++;
+        }
+    }
+}
+
+/*! \brief Average and recover a vector of the modelling grid in place, equal to getRecoverMatrix() * getAverageMatrix() * vector
+ *
+ * Points outside of the inversion grid are set to zero like by the recover matrix.
+ \param vector vector on the modelling grid
+ */
+template <typename ValueType>
+void KITGPI::Taper::BlockAverage<ValueType>::apply(scai::lama::DenseVector<ValueType> &vector) const
+{
+    hmemo::HArray<ValueType> localSums;
+    calcLocalSums(vector, localSums);
+    sumSharedBlocks(localSums);
+
+    auto valuesWrite = hmemo::hostWriteAccess(vector.getLocalValues());
+    auto sumsRead = hmemo::hostReadAccess(localSums);
+    auto blocksRead = hmemo::hostReadAccess(blocks);
+    for (IndexType i = 0; i < blocksRead.size(); i++) {
+        valuesWrite[i] = (blocksRead[i] >= 0) ? blockWeight * sumsRead[blocksRead[i]] : ValueType(0);
+    }
+}
+
+/*! \brief Get the factor of the grid spacing of the inversion grid
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Taper::BlockAverage<ValueType>::getDHInversion() const
+{
+    return DHInversion;
+}
+
+/*! \brief Get the number of points of the inversion grid
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Taper::BlockAverage<ValueType>::getNumBlocks() const
+{
+    return numBlocks;
+}
+
+/*! \brief Get the distribution of the modelling grid
+ */
+template <typename ValueType>
+scai::dmemo::DistributionPtr KITGPI::Taper::BlockAverage<ValueType>::getDistributionPtr() const
+{
+    return dist;
+}
+
+template class KITGPI::Taper::BlockAverage<double>;
+template class KITGPI::Taper::BlockAverage<float>;
@@ -0,0 +1,53 @@
+#pragma once
+#include <scai/lama.hpp>
+#include <scai/hmemo/HArray.hpp>
+#include <Acquisition/Coordinates.hpp>
+
+namespace KITGPI
+{
+
+    namespace Taper
+    {
+
+        /*! \brief Matrix-free block average of the inversion grid (DHInversion)
+         *
+         * The operator is the same as the average and recover matrices of Taper2D::calcAverageMatrix: a point of the inversion grid is the sum of the DHInversion^d points of its block on the modelling grid divided by DHInversion^d,
+         * the recovered value of a point of the modelling grid is the value of its block. The block of every local point is calculated once, so no matrix has to be assembled.
+         * Every process sums the blocks of its local points. Only the partial sums of the blocks which cross the boundaries of the partitions are summed over the processes of the distribution.
+         * The grids must not be variable grids (useVariableGrid=0).
+         */
+        template <typename ValueType>
+        class BlockAverage
+        {
+
+          public:
+            //! Default constructor
+            BlockAverage() : numSharedBlocks(0), numBlocks(0), DHInversion(1), blockWeight(1){};
+
+            //! Default destructor
+            ~BlockAverage(){};
+
+            void init(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, scai::dmemo::DistributionPtr dist);
+
+            void average(scai::lama::DenseVector<ValueType> const &vector, scai::lama::DenseVector<ValueType> &vectorInversion, scai::dmemo::DistributionPtr distInversion) const;
+            void apply(scai::lama::DenseVector<ValueType> &vector) const;
+
+            scai::IndexType getDHInversion() const;
+            scai::IndexType getNumBlocks() const;
+            scai::dmemo::DistributionPtr getDistributionPtr() const;
+
+          private:
+            void calcLocalSums(scai::lama::DenseVector<ValueType> const &vector, scai::hmemo::HArray<ValueType> &localSums) const;
+            void sumSharedBlocks(scai::hmemo::HArray<ValueType> &localSums) const;
+
+            scai::dmemo::DistributionPtr dist;             //!< distribution of the modelling grid
+            scai::hmemo::HArray<IndexType> blocks;         //!< local block of every local point, -1 outside of the inversion grid
+            scai::hmemo::HArray<IndexType> localBlocks;    //!< index of the inversion grid of every local block, sorted
+            scai::hmemo::HArray<IndexType> sharedPositions; //!< position of every local block in the blocks which cross the partition boundaries, -1 if all its points are local
+            scai::IndexType numSharedBlocks;               //!< number of blocks which cross the partition boundaries of any process
+            scai::IndexType numBlocks;                     //!< number of points of the inversion grid
+            scai::IndexType DHInversion;
+            ValueType blockWeight; //!< 1 / DHInversion^d
+        };
+    }
+}
@@ -0,0 +1,218 @@
+#include "GridTransfer.hpp"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+using namespace scai;
+
+/*! \brief Calculate the interpolation weights along one axis
+ *
+ * For every point of the row grid along the axis the indices and weights of the column grid points are returned. Points outside of the column grid get no weights.
+ \param numPointsRow Number of grid points of the row grid along the axis
+ \param DHRow Grid spacing of the row grid
+ \param originRow Origin of the row grid along the axis
+ \param numPointsColumn Number of grid points of the column grid along the axis
+ \param DHColumn Grid spacing of the column grid
+ \param originColumn Origin of the column grid along the axis
+ \param interpolation Interpolation type (0 = inverse distance, 1 = trilinear, 2 = averaging)
+ */
+template <typename ValueType>
+std::vector<typename KITGPI::Taper::GridTransfer<ValueType>::AxisWeights> KITGPI::Taper::GridTransfer<ValueType>::calcAxisWeights(IndexType numPointsRow, ValueType DHRow, ValueType originRow, IndexType numPointsColumn, ValueType DHColumn, ValueType originColumn, IndexType interpolation)
+{
+    SCAI_ASSERT_ERROR(interpolation >= INVERSEDISTANCE && interpolation <= AVERAGING, "Unknown interpolation " << interpolation << " of the grid transfer");
+    std::vector<AxisWeights> axisWeights(numPointsRow);
+
+    // 2D grids have no third dimension to interpolate
+    if (numPointsRow == 1 && numPointsColumn == 1) {
+        axisWeights[0].indices.push_back(0);
+        axisWeights[0].weights.push_back(1);
+        axisWeights[0].position = 0;
+        return axisWeights;
+    }
+
+    ValueType tolerance = 1e-4;
+    ValueType halfWidth = 0.5 * DHRow / DHColumn; // half a cell of the row grid in units of the column grid
+    for (IndexType i = 0; i < numPointsRow; i++) {
+        AxisWeights &weights = axisWeights[i];
+        ValueType position = (i * DHRow + originRow - originColumn) / DHColumn;
+        if (std::abs(position - std::round(position)) < tolerance) {
+            position = std::round(position);
+        }
+        weights.position = position;
+
+        if (interpolation == AVERAGING && halfWidth > 0.5) {
+            ValueType sumWeights = 0;
+            IndexType jStart = std::max(IndexType(std::ceil(position - halfWidth - tolerance)), IndexType(0));
+            IndexType jEnd = std::min(IndexType(std::floor(position + halfWidth + tolerance)), numPointsColumn - 1);
+            for (IndexType j = jStart; j <= jEnd; j++) {
+                // points on the cell face are shared with the neighbouring cell
+                ValueType weight = (std::abs(std::abs(j - position) - halfWidth) < tolerance) ? 0.5 : 1.0;
+                weights.indices.push_back(j);
+                weights.weights.push_back(weight);
+                sumWeights += weight;
+            }
+            for (auto &weight : weights.weights) {
+                weight /= sumWeights;
+            }
+        } else if (position >= 0 && position <= numPointsColumn - 1) {
+            IndexType jLower = IndexType(std::floor(position));
+            ValueType fraction = position - jLower;
+            weights.indices.push_back(jLower);
+            weights.weights.push_back(1 - fraction);
+            if (fraction > 0) {
+                weights.indices.push_back(jLower + 1);
+                weights.weights.push_back(fraction);
+            }
+        }
+    }
+    return axisWeights;
+}
+
+/*! \brief Calculate the transfer matrix from the column grid to the row grid
+ *
+ * Only the rows owned by this process are calculated, so the matrix has the row distribution distRow and replicated columns.
+ \param transferMatrix Transfer matrix
+ \param coordinatesRow Coordinates of the row grid (target)
+ \param coordinatesColumn Coordinates of the column grid (source)
+ \param distRow Row distribution, any distribution of the row grid
+ \param interpolation Interpolation type (0 = inverse distance, 1 = trilinear, 2 = averaging)
+ */
+template <typename ValueType>
+void KITGPI::Taper::GridTransfer<ValueType>::calcTransferMatrix(scai::lama::CSRSparseMatrix<ValueType> &transferMatrix, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, scai::dmemo::DistributionPtr distRow, IndexType interpolation)
+{
+    SCAI_ASSERT_ERROR(distRow->getGlobalSize() == coordinatesRow.getNGridpoints(), "Row distribution (" << distRow->getGlobalSize() << ") does not match the row grid (" << coordinatesRow.getNGridpoints() << ")");
+
+    std::vector<AxisWeights> weightsX = calcAxisWeights(coordinatesRow.getNX(), coordinatesRow.getDH(), coordinatesRow.getX0(), coordinatesColumn.getNX(), coordinatesColumn.getDH(), coordinatesColumn.getX0(), interpolation);
+    std::vector<AxisWeights> weightsY = calcAxisWeights(coordinatesRow.getNY(), coordinatesRow.getDH(), coordinatesRow.getY0(), coordinatesColumn.getNY(), coordinatesColumn.getDH(), coordinatesColumn.getY0(), interpolation);
+    std::vector<AxisWeights> weightsZ = calcAxisWeights(coordinatesRow.getNZ(), coordinatesRow.getDH(), coordinatesRow.getZ0(), coordinatesColumn.getNZ(), coordinatesColumn.getDH(), coordinatesColumn.getZ0(), interpolation);
+
+    hmemo::HArray<IndexType> ownedIndexes; // all (global) points owned by this process
+    distRow->getOwnedIndexes(ownedIndexes);
+    IndexType numLocalRows = ownedIndexes.size();
+
+    std::vector<IndexType> ia(numLocalRows + 1, 0);
+    std::vector<IndexType> ja;
+    std::vector<ValueType> values;
+    ja.reserve(8 * numLocalRows);
+    values.reserve(8 * numLocalRows);
+
+    KITGPI::Acquisition::coordinate3D coordinate;
+    IndexType localRow = 0;
+    for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+        coordinate = coordinatesRow.index2coordinate(ownedIndex);
+        AxisWeights const &wx = weightsX[coordinate.x];
+        AxisWeights const &wy = weightsY[coordinate.y];
+        AxisWeights const &wz = weightsZ[coordinate.z];
+
+        // inverse distance weights (Taper2D::calcTransformMatrix) if the point lies inside a cell and not on a grid line
+        IndexType numInside = (wx.indices.size() == 2) + (wy.indices.size() == 2) + (wz.indices.size() == 2);
+        bool inverseDistance = (interpolation == INVERSEDISTANCE && numInside > 1);
+        IndexType rowStart = ja.size();
+        ValueType sumWeights = 0;
+        for (unsigned iz = 0; iz < wz.indices.size(); iz++) {
+            for (unsigned iy = 0; iy < wy.indices.size(); iy++) {
+                for (unsigned ix = 0; ix < wx.indices.size(); ix++) {
+                    ValueType weight;
+                    if (inverseDistance) {
+                        ValueType distance = 0;
+                        distance += (wx.indices.size() == 2) ? (wx.position - wx.indices[ix]) * (wx.position - wx.indices[ix]) : 0;
+                        distance += (wy.indices.size() == 2) ? (wy.position - wy.indices[iy]) * (wy.position - wy.indices[iy]) : 0;
+                        distance += (wz.indices.size() == 2) ? (wz.position - wz.indices[iz]) * (wz.position - wz.indices[iz]) : 0;
+                        weight = 1 / std::sqrt(distance);
+                    } else {
+                        weight = wx.weights[ix] * wy.weights[iy] * wz.weights[iz];
+                    }
+                    ja.push_back(coordinatesColumn.coordinate2index(wx.indices[ix], wy.indices[iy], wz.indices[iz]));
+                    values.push_back(weight);
+                    sumWeights += weight;
+                }
+            }
+        }
+        if (inverseDistance) {
+            for (IndexType i = rowStart; i < IndexType(values.size()); i++) {
+                values[i] /= sumWeights;
+            }
+        }
+        localRow++;
+        ia[localRow] = ja.size();
+    }
+
+    hmemo::HArray<IndexType> csrIA(ia.size(), ia.data());
+    hmemo::HArray<IndexType> csrJA(ja.size(), ja.data());
+    hmemo::HArray<ValueType> csrValues(values.size(), values.data());
+    lama::CSRStorage<ValueType> localStorage(numLocalRows, coordinatesColumn.getNGridpoints(), std::move(csrIA), std::move(csrJA), std::move(csrValues));
+    transferMatrix = lama::CSRSparseMatrix<ValueType>(distRow, std::move(localStorage));
+}
+
+/*! \brief Calculate a replicated transfer matrix from the column grid to the row grid
+ *
+ * Every process calculates only its own rows which are replicated afterwards. If a cache directory is given, the matrix is read from the cache file if it exists or written to it otherwise.
+ \param transferMatrix Transfer matrix
+ \param coordinatesRow Coordinates of the row grid (target)
+ \param coordinatesColumn Coordinates of the column grid (source)
+ \param distRow Row distribution used to calculate the matrix
+ \param interpolation Interpolation type (0 = inverse distance, 1 = trilinear, 2 = averaging)
+ \param cacheDirectory Directory of the cache files, empty for no caching
+ */
+template <typename ValueType>
+void KITGPI::Taper::GridTransfer<ValueType>::calcTransferMatrixReplicated(scai::lama::CSRSparseMatrix<ValueType> &transferMatrix, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, scai::dmemo::DistributionPtr distRow, IndexType interpolation, std::string const &cacheDirectory)
+{
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    std::string filename;
+    IndexType isCached = 0;
+    if (!cacheDirectory.empty()) {
+        filename = getCacheFilename(cacheDirectory, coordinatesRow, coordinatesColumn, interpolation);
+        if (commAll->getRank() == MASTERGPI) {
+            std::ifstream file(filename);
+            isCached = file.good();
+        }
+        commAll->bcast(&isCached, 1, MASTERGPI);
+    }
+
+    if (isCached) {
+        lama::CSRStorage<ValueType> storage;
+        storage.readFromFile(filename);
+        SCAI_ASSERT_ERROR(storage.getNumRows() == coordinatesRow.getNGridpoints() && storage.getNumColumns() == coordinatesColumn.getNGridpoints(), "Cached transfer matrix " << filename << " does not match the grids");
+        transferMatrix = lama::CSRSparseMatrix<ValueType>(std::move(storage));
+        HOST_PRINT(commAll, "Transfer matrix read from " << filename << "\n");
+    } else {
+        calcTransferMatrix(transferMatrix, coordinatesRow, coordinatesColumn, distRow, interpolation);
+        dmemo::DistributionPtr no_distRow(new scai::dmemo::NoDistribution(coordinatesRow.getNGridpoints()));
+        dmemo::DistributionPtr no_distColumn(new scai::dmemo::NoDistribution(coordinatesColumn.getNGridpoints()));
+        transferMatrix.redistribute(no_distRow, no_distColumn);
+        if (!filename.empty()) {
+            if (commAll->getRank() == MASTERGPI) {
+                transferMatrix.getLocalStorage().writeToFile(filename);
+            }
+            HOST_PRINT(commAll, "Transfer matrix written to " << filename << "\n");
+        }
+    }
+}
+
+/*! \brief Get the name of the cache file of a transfer matrix
+ *
+ * The name contains the definitions of both grids and the interpolation type, so a changed grid never reads an outdated matrix.
+ \param cacheDirectory Directory of the cache files
+ \param coordinatesRow Coordinates of the row grid
+ \param coordinatesColumn Coordinates of the column grid
+ \param interpolation Interpolation type
+ */
+template <typename ValueType>
+std::string KITGPI::Taper::GridTransfer<ValueType>::getCacheFilename(std::string const &cacheDirectory, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, IndexType interpolation)
+{
+    return cacheDirectory + "/transfer." + getGridKey(coordinatesRow) + ".from." + getGridKey(coordinatesColumn) + ".interpolation_" + std::to_string(interpolation) + ".mtx";
+}
+
+/*! \brief Get a key which identifies a grid
+ \param coordinates Coordinates of the grid
+ */
+template <typename ValueType>
+std::string KITGPI::Taper::GridTransfer<ValueType>::getGridKey(KITGPI::Acquisition::Coordinates<ValueType> const &coordinates)
+{
+    std::ostringstream key;
+    key << std::setprecision(10) << coordinates.getNX() << "x" << coordinates.getNY() << "x" << coordinates.getNZ() << "_DH" << coordinates.getDH() << "_X" << coordinates.getX0() << "_Y" << coordinates.getY0() << "_Z" << coordinates.getZ0();
+    return key.str();
+}
+
+template class KITGPI::Taper::GridTransfer<double>;
+template class KITGPI::Taper::GridTransfer<float>;
@@ -0,0 +1,59 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include <vector>
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/CSRSparseMatrix.hpp>
+#include <scai/lama/storage/CSRStorage.hpp>
+#include <scai/dmemo/NoDistribution.hpp>
+#include <Acquisition/Coordinates.hpp>
+
+#include <Common/HostPrint.hpp>
+
+namespace KITGPI
+{
+
+    namespace Taper
+    {
+
+        /*! \brief Transfer operator between two regular grids (e.g. the seismic and the EM grid of a joint inversion)
+         *
+         * The operator is built directly in CSR format for the rows owned by the process, i.e. it works for any row distribution (block, grid or Geographer graph partitioning) without a global matrix assembly.
+         * The weights are separable along x, y and z, so they are calculated once per grid line and not per grid point. Optionally the operator is cached on disk, the cache file is keyed by both grid definitions.
+         * The grids must not be variable grids (useVariableGrid=0).
+         */
+        template <typename ValueType>
+        class GridTransfer
+        {
+
+          public:
+            //! \brief Interpolation of the transfer operator
+            enum InterpolationType { INVERSEDISTANCE = 0, //!< bilinear along grid lines, inverse distance weights inside a cell (as Taper2D::calcTransformMatrix)
+                                     TRILINEAR = 1,       //!< separable trilinear interpolation
+                                     AVERAGING = 2 };     //!< average of all points of the column grid inside a cell of the row grid (trilinear if the row grid is finer)
+
+            //! \brief Weights of one grid line of the row grid along one axis of the column grid
+            struct AxisWeights {
+                std::vector<IndexType> indices; //!< indices of the column grid along the axis
+                std::vector<ValueType> weights; //!< weights of these indices
+                ValueType position;             //!< position of the row grid point in units of the column grid
+            };
+
+            //! Default constructor
+            GridTransfer(){};
+
+            //! Default destructor
+            ~GridTransfer(){};
+
+            static std::vector<AxisWeights> calcAxisWeights(IndexType numPointsRow, ValueType DHRow, ValueType originRow, IndexType numPointsColumn, ValueType DHColumn, ValueType originColumn, IndexType interpolation);
+
+            static void calcTransferMatrix(scai::lama::CSRSparseMatrix<ValueType> &transferMatrix, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, scai::dmemo::DistributionPtr distRow, IndexType interpolation);
+            static void calcTransferMatrixReplicated(scai::lama::CSRSparseMatrix<ValueType> &transferMatrix, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, scai::dmemo::DistributionPtr distRow, IndexType interpolation, std::string const &cacheDirectory);
+
+            static std::string getCacheFilename(std::string const &cacheDirectory, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesRow, KITGPI::Acquisition::Coordinates<ValueType> const &coordinatesColumn, IndexType interpolation);
+
+          private:
+            static std::string getGridKey(KITGPI::Acquisition::Coordinates<ValueType> const &coordinates);
+        };
+    }
+}
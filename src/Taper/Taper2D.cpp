@@ -1,5 +1,6 @@
 #include "Taper2D.hpp"
 #include <IO/IO.hpp>
+#include <scai/dmemo/GeneralDistribution.hpp>
 
 using namespace scai;
 
@@ -118,6 +119,13 @@ void KITGPI::Taper::Taper2D<ValueType>::apply(KITGPI::Acquisition::SeismogramHan
     }
 }
 
+/*! \brief Return the taper of the seismograms (traces x time samples) */
+template <typename ValueType>
+scai::lama::DenseMatrix<ValueType> const &KITGPI::Taper::Taper2D<ValueType>::getData() const
+{
+    return data;
+}
+
 /*! \brief Apply taper to a single seismogram
  \param seismogram Seismogram
  */
@@ -382,6 +390,30 @@ void KITGPI::Taper::Taper2D<ValueType>::calcTransformMatrix(KITGPI::Acquisition:
     }
 }
 
+/*! \brief calculate the matrices to transform model1 to model2 and model2 to model1
+ *
+ * Unlike calcTransformMatrix the matrices are built with GridTransfer, i.e. for 2D and 3D models and any model distribution.
+ * transferInterpolation selects the interpolation (0 = inverse distance weights as calcTransformMatrix, 1 = trilinear, 2 = averaging), transferCacheDirectory the directory of the cached matrices.
+ * Both models must not use the variable grid.
+ * \param config1 Configuration of model1, which contains transferInterpolation and transferCacheDirectory
+ * \param config2 Configuration of model2
+ * \param modelCoordinates1 coordinates of model1 (distribution dist1)
+ * \param modelCoordinates2 coordinates of model2 (distribution dist2)
+ */
+template <typename ValueType>
+void KITGPI::Taper::Taper2D<ValueType>::calcTransformMatrices(KITGPI::Configuration::Configuration const &config1, KITGPI::Configuration::Configuration const &config2, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates1, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates2)
+{
+    SCAI_ASSERT_ERROR(!config1.getAndCatch("useVariableGrid", false) && !config2.getAndCatch("useVariableGrid", false), "The transform matrices are not available for the variable grid");
+    IndexType transferInterpolation = config1.getAndCatch("transferInterpolation", 0);
+    std::string transferCacheDirectory = config1.getAndCatch<std::string>("transferCacheDirectory", "");
+    hmemo::ContextPtr ctx = transformMatrix2to1.getContextPtr();
+
+    GridTransfer<ValueType>::calcTransferMatrixReplicated(transformMatrix2to1, modelCoordinates1, modelCoordinates2, dist1, transferInterpolation, transferCacheDirectory);
+    GridTransfer<ValueType>::calcTransferMatrixReplicated(transformMatrix1to2, modelCoordinates2, modelCoordinates1, dist2, transferInterpolation, transferCacheDirectory);
+    transformMatrix2to1.setContextPtr(ctx);
+    transformMatrix1to2.setContextPtr(ctx);
+}
+
 /*! \brief exchange porosity and saturation from EM to seismic or from seismic to EM
  * \param model1 Seismic model1
  * \param model2 EM model1
@@ -630,6 +662,39 @@ void KITGPI::Taper::Taper2D<ValueType>::initAverageMatrix(KITGPI::Configuration:
     recoverMatrix.setContextPtr(ctx);
 }
 
+/*! \brief Calculate the distribution of an inversion grid from the grid partition of the modelling grid
+ *
+ * A point of the inversion grid belongs to the process which owns the first point of its block on the modelling grid, so the average and recover matrices of a stage with another DHInversion keep the partition boundaries of the configuration.
+ \param modelCoordinates coordinates of the modelling grid
+ \param modelCoordinatesInversion coordinates of the inversion grid
+ \param dist distribution of the modelling grid
+ */
+template <typename ValueType>
+dmemo::DistributionPtr KITGPI::Taper::Taper2D<ValueType>::calcDistInversion(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, dmemo::DistributionPtr dist)
+{
+    // the same factor as calcAverageMatrix
+    IndexType DHInversion = modelCoordinates.getNX() / modelCoordinatesInversion.getNX();
+    SCAI_ASSERT_ERROR(DHInversion >= 1, "the inversion grid is finer than the modelling grid");
+
+    hmemo::HArray<IndexType> ownedIndexes;
+    dist->getOwnedIndexes(ownedIndexes);
+    std::vector<IndexType> ownedIndexesInversion;
+    for (IndexType ownedIndex : hmemo::hostReadAccess(ownedIndexes)) {
+        KITGPI::Acquisition::coordinate3D coordinate = modelCoordinates.index2coordinate(ownedIndex);
+        if (coordinate.x % DHInversion == 0 && coordinate.y % DHInversion == 0 && coordinate.z % DHInversion == 0) {
+            IndexType blockX = coordinate.x / DHInversion;
+            IndexType blockY = coordinate.y / DHInversion;
+            IndexType blockZ = coordinate.z / DHInversion;
+            if (blockX < modelCoordinatesInversion.getNX() && blockY < modelCoordinatesInversion.getNY() && blockZ < modelCoordinatesInversion.getNZ())
+                ownedIndexesInversion.push_back(modelCoordinatesInversion.coordinate2index(blockX, blockY, blockZ));
+        }
+    }
+    std::sort(ownedIndexesInversion.begin(), ownedIndexesInversion.end());
+
+    hmemo::HArray<IndexType> myGlobalIndexes(ownedIndexesInversion.size(), ownedIndexesInversion.data());
+    return std::make_shared<dmemo::GeneralDistribution>(modelCoordinatesInversion.getNGridpoints(), std::move(myGlobalIndexes), true, dist->getCommunicatorPtr());
+}
+
 /*! \brief calculate a matrix for averaging inversion
  * \param modelCoordinates coordinates of the original model1
  * \param modelCoordinatesInversion coordinates of the averaged model1
@@ -701,5 +766,24 @@ scai::lama::Matrix<ValueType> const &KITGPI::Taper::Taper2D<ValueType>::getRecov
     return recoverMatrix;
 }
 
+/*! \brief Calculate the matrix-free block average of the inversion grid, the same operator as the average and recover matrices
+ * \param modelCoordinates coordinates of the original model
+ * \param modelCoordinatesInversion coordinates of the averaged model
+ * \param dist distribution of the original model
+ */
+template <typename ValueType>
+void KITGPI::Taper::Taper2D<ValueType>::calcBlockAverage(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, scai::dmemo::DistributionPtr dist)
+{
+    blockAverage.init(modelCoordinates, modelCoordinatesInversion, dist);
+}
+
+/*! \brief Get the block average
+ */
+template <typename ValueType>
+KITGPI::Taper::BlockAverage<ValueType> const &KITGPI::Taper::Taper2D<ValueType>::getBlockAverage() const
+{
+    return blockAverage;
+}
+
 template class KITGPI::Taper::Taper2D<double>;
 template class KITGPI::Taper::Taper2D<float>;
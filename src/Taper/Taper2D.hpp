@@ -9,6 +9,8 @@
 #include <scai/dmemo/SingleDistribution.hpp>
 
 #include <Common/HostPrint.hpp>
+#include "BlockAverage.hpp"
+#include "GridTransfer.hpp"
 
 namespace KITGPI
 {
@@ -45,14 +47,19 @@ namespace KITGPI
 
             void read(std::string filename);
             void calcTransformMatrix(KITGPI::Acquisition::Coordinates<ValueType> modelCoordinates2, KITGPI::Acquisition::Coordinates<ValueType> modelCoordinates1, IndexType equationInd);
+            void calcTransformMatrices(KITGPI::Configuration::Configuration const &config1, KITGPI::Configuration::Configuration const &config2, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates1, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates2);
             
             void exchangePetrophysics(scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> const &model2, KITGPI::Configuration::Configuration config2, KITGPI::Modelparameter::Modelparameter<ValueType> &model1, KITGPI::Configuration::Configuration config1, IndexType equationInd);
             void exchangeModelparameters(scai::dmemo::CommunicatorPtr commAll, KITGPI::Modelparameter::Modelparameter<ValueType> const &model2, KITGPI::Configuration::Configuration config2, KITGPI::Modelparameter::Modelparameter<ValueType> &model1, KITGPI::Configuration::Configuration config1, IndexType equationInd);
             
             void initAverageMatrix(KITGPI::Configuration::Configuration config, scai::dmemo::DistributionPtr distInversion, scai::dmemo::DistributionPtr dist, scai::hmemo::ContextPtr ctx);
+            static scai::dmemo::DistributionPtr calcDistInversion(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, scai::dmemo::DistributionPtr dist);
             void calcAverageMatrix(KITGPI::Acquisition::Coordinates<ValueType> modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> modelCoordinatesInversion);
             scai::lama::Matrix<ValueType> const &getAverageMatrix();
             scai::lama::Matrix<ValueType> const &getRecoverMatrix();
+            void calcBlockAverage(KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinatesInversion, scai::dmemo::DistributionPtr dist);
+            KITGPI::Taper::BlockAverage<ValueType> const &getBlockAverage() const;
+            scai::lama::DenseMatrix<ValueType> const &getData() const;
             
             typedef scai::lama::CSRSparseMatrix<ValueType> SparseFormat; //!< Define sparse format as CSRSparseMatrix
             SparseFormat averageMatrix;
@@ -60,6 +67,7 @@ namespace KITGPI
             
           private:
             scai::lama::DenseMatrix<ValueType> data;
+            KITGPI::Taper::BlockAverage<ValueType> blockAverage;
             SparseFormat transformMatrix1to2;
             SparseFormat transformMatrix2to1;     
             scai::dmemo::DistributionPtr dist1;
@@ -0,0 +1,577 @@
+#include <scai/lama.hpp>
+
+#include <scai/common/Walltime.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ValueType.hpp>
+#include <Common/Common.hpp>
+#include <Partitioning/Partitioning.hpp>
+#include <Acquisition/Receivers.hpp>
+#include <Modelparameter/ModelparameterFactory.hpp>
+#include <Wavefields/WavefieldsFactory.hpp>
+
+#include "../../Common/FK.hpp"
+#include "../../Common/HostPrint.hpp"
+#include "../../Common/TraceFFT.hpp"
+#include "../../Common/WavefieldActivity.hpp"
+#include "../../Common/WavefieldCompensation.hpp"
+#include "../../Gradient/GradientFactory.hpp"
+#include "../../Misfit/MisfitL2.hpp"
+#include "../../Preconditioning/EnergyPreconditioning.hpp"
+#include "../../Preconditioning/SourceReceiverTaper.hpp"
+#include "../../Taper/Taper1D.hpp"
+#include "../../Taper/GridTransfer.hpp"
+#include "../../Taper/Taper2D.hpp"
+#include "../../Workflow/Workflow.hpp"
+#include "../../ZeroLagCrossCorrelation/ZeroLagXcorrFactory.hpp"
+
+using namespace scai;
+using namespace KITGPI;
+
+bool verbose; // global variable definition
+
+/*! \brief Timing statistics of one kernel
+ *
+ * All times are the maximum over the processes of one repetition in seconds.
+ */
+struct BenchmarkResult {
+    std::string name;
+    std::string equationType;
+    std::string valueType;
+    IndexType repetitions;
+    double min;
+    double median;
+    double mean;
+    double max;
+    double stddev;
+};
+
+/*! \brief Time a kernel after some warm-up runs
+ *
+ * The reset function is called before every run and is not timed, so kernels which modify their input (e.g. tapers) always see the same data.
+ \param commAll Communicator of all processes
+ \param name Name of the kernel
+ \param equationType Equation type of the kernel
+ \param valueType Value type of the kernel (float or double)
+ \param numWarmup Number of untimed runs
+ \param numRepetitions Number of timed runs
+ \param reset Function which restores the input of the kernel
+ \param kernel Function which runs the kernel once
+ */
+template <typename ResetFunction, typename KernelFunction>
+BenchmarkResult runBenchmark(dmemo::CommunicatorPtr commAll, std::string const &name, std::string const &equationType, std::string const &valueType, IndexType numWarmup, IndexType numRepetitions, ResetFunction reset, KernelFunction kernel)
+{
+    for (IndexType i = 0; i < numWarmup; i++) {
+        reset();
+        kernel();
+    }
+
+    std::vector<double> times;
+    for (IndexType i = 0; i < numRepetitions; i++) {
+        reset();
+        commAll->synchronize();
+        double start_t = common::Walltime::get();
+        kernel();
+        double end_t = common::Walltime::get();
+        times.push_back(commAll->max(end_t - start_t));
+    }
+
+    BenchmarkResult result;
+    result.name = name;
+    result.equationType = equationType;
+    result.valueType = valueType;
+    result.repetitions = numRepetitions;
+    std::sort(times.begin(), times.end());
+    result.min = times.front();
+    result.max = times.back();
+    result.median = (numRepetitions % 2 == 1) ? times[numRepetitions / 2] : (times[numRepetitions / 2 - 1] + times[numRepetitions / 2]) / 2;
+    result.mean = 0.0;
+    for (double time : times)
+        result.mean += time;
+    result.mean /= numRepetitions;
+    result.stddev = 0.0;
+    for (double time : times)
+        result.stddev += (time - result.mean) * (time - result.mean);
+    result.stddev = std::sqrt(result.stddev / numRepetitions);
+
+    HOST_PRINT(commAll, " " << std::left << std::setw(42) << name << std::setw(14) << equationType << std::setw(8) << valueType << std::right << std::scientific << std::setprecision(3) << std::setw(12) << result.median << std::setw(12) << result.min << std::setw(12) << result.stddev << std::defaultfloat << "\n");
+    return result;
+}
+
+/*! \brief Kernel without an input to restore
+ */
+void noReset()
+{
+}
+
+/*! \brief Fill all traces of a seismogram with scaled sine waves
+ \param data Seismogram data (traces x time samples)
+ \param DT Temporal sampling
+ \param frequency Frequency of the sine waves
+ \param phase Phase of the sine waves
+ */
+template <typename ValueType>
+void fillTraces(lama::DenseMatrix<ValueType> &data, ValueType DT, ValueType frequency, ValueType phase)
+{
+    lama::DenseVector<ValueType> trace = lama::linearDenseVector<ValueType>(data.getNumColumns(), phase, 2 * M_PI * frequency * DT);
+    trace.unaryOp(trace, common::UnaryOp::SIN);
+    lama::DenseVector<ValueType> traceScaled;
+    for (IndexType iTrace = 0; iTrace < data.getNumRows(); iTrace++) {
+        traceScaled = trace;
+        traceScaled *= 1.0 + ValueType(iTrace) / data.getNumRows();
+        data.setRow(traceScaled, iTrace, common::BinaryOp::COPY);
+    }
+}
+
+/*! \brief Return the equation types which are benchmarked
+ *
+ * By default all equation types of the wave class (seismic or EM) and dimension of the configuration are benchmarked.
+ * The workflow file has to invert for parameters of this wave class.
+ \param config Configuration
+ \param dimension Dimension (2d or 3d)
+ \param isSeismic true for seismic, false for EM
+ */
+std::vector<std::string> getEquationTypes(Configuration::Configuration config, std::string const &dimension, bool isSeismic)
+{
+    std::vector<std::string> equationTypes;
+    std::string typeList = config.getAndCatch<std::string>("benchmarkEquationTypes", "");
+    std::transform(typeList.begin(), typeList.end(), typeList.begin(), ::tolower);
+    if (!typeList.empty()) {
+        std::stringstream typeStream(typeList);
+        std::string type;
+        while (std::getline(typeStream, type, ','))
+            equationTypes.push_back(type);
+    } else if (isSeismic && dimension.compare("3d") == 0) {
+        equationTypes = {"acoustic", "elastic", "viscoelastic"};
+    } else if (isSeismic) {
+        equationTypes = {"acoustic", "elastic", "viscoelastic", "sh", "viscosh"};
+    } else {
+        equationTypes = {"emem", "tmem", "viscoemem", "viscotmem"};
+    }
+    return equationTypes;
+}
+
+/*! \brief Run all kernel benchmarks for one value type
+ \param config Configuration
+ \param commAll Communicator of all processes
+ \param commShot Communicator of the shot domain
+ \param commInterShot Communicator between the shot domains
+ \param ctx Context
+ \param valueType Name of the value type
+ \param results Vector the results are appended to
+ */
+template <typename ValueType>
+void benchmarkAll(Configuration::Configuration config, dmemo::CommunicatorPtr commAll, dmemo::CommunicatorPtr commShot, dmemo::CommunicatorPtr commInterShot, hmemo::ContextPtr ctx, std::string const &valueType, std::vector<BenchmarkResult> &results)
+{
+    std::string dimension = config.get<std::string>("dimension");
+    std::string equationType = config.get<std::string>("equationType");
+    std::transform(dimension.begin(), dimension.end(), dimension.begin(), ::tolower);
+    std::transform(equationType.begin(), equationType.end(), equationType.begin(), ::tolower);
+    bool isSeismic = Common::checkEquationType<ValueType>(equationType);
+
+    ValueType DT = config.get<ValueType>("DT");
+    ValueType FC = config.get<ValueType>("CenterFrequencyCPML");
+    IndexType NT = static_cast<IndexType>((config.get<ValueType>("T") / DT) + 0.5);
+    IndexType numWarmup = config.getAndCatch("benchmarkWarmup", 2);
+    IndexType numRepetitions = config.getAndCatch("benchmarkRepetitions", 10);
+    IndexType numShotPerSuperShot = config.getAndCatch("numShotPerSuperShot", 1);
+    IndexType numRelaxationMechanisms = std::max(config.getAndCatch("numRelaxationMechanisms", 1), 1);
+    SCAI_ASSERT_ERROR(numRepetitions > 0, "benchmarkRepetitions has to be positive");
+
+    /* --------------------------------------- */
+    /* Synthetic model, data and workflow      */
+    /* --------------------------------------- */
+    Acquisition::Coordinates<ValueType> modelCoordinates(config, 1, config.get<IndexType>("NX"));
+    dmemo::DistributionPtr dist = std::make_shared<dmemo::BlockDistribution>(modelCoordinates.getNGridpoints(), commShot);
+
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model(Modelparameter::Factory<ValueType>::Create(equationType));
+    model->prepareForInversion(config, commShot);
+    model->init(config, ctx, dist, modelCoordinates);
+
+    Misfit::MisfitL2<ValueType> misfitL2;
+    std::string misfitType = config.get<std::string>("misfitType");
+    std::vector<IndexType> misfitTypeHistory(std::max(IndexType(misfitType.length()) - 2, IndexType(0)), 0);
+    IndexType seedtime = 0;
+    misfitL2.init(config, misfitTypeHistory, 1, 0, model->getVmin(), seedtime);
+
+    Workflow::Workflow<ValueType> workflow;
+    workflow.init(config);
+    ValueType steplengthInit = 0;
+    workflow.changeStage(config, misfitL2, steplengthInit);
+
+    Acquisition::Receivers<ValueType> receivers;
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receivers.init(config, modelCoordinates, ctx, dist);
+    receiversTrue.init(config, modelCoordinates, ctx, dist);
+
+    Acquisition::SeismogramType seismogramType = Acquisition::SeismogramType(0);
+    IndexType numTraces = 0;
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        numTraces = receivers.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType(iComponent));
+        if (numTraces != 0) {
+            seismogramType = Acquisition::SeismogramType(iComponent);
+            break;
+        }
+    }
+    SCAI_ASSERT_ERROR(numTraces != 0, "The receiver configuration contains no traces");
+
+    Acquisition::Seismogram<ValueType> &seismogramSynRef = receivers.getSeismogramHandler().getSeismogram(seismogramType);
+    Acquisition::Seismogram<ValueType> &seismogramObsRef = receiversTrue.getSeismogramHandler().getSeismogram(seismogramType);
+    fillTraces(seismogramSynRef.getData(), DT, FC, ValueType(0));
+    fillTraces(seismogramObsRef.getData(), DT, FC, ValueType(0.5));
+
+    // offsets for the FK misfit and the 2D taper, reference traces for the convolved misfit and the inverse AGC
+    lama::DenseVector<ValueType> offset;
+    Common::calcOffsets(offset, 0, seismogramObsRef.get1DCoordinates(), modelCoordinates);
+    std::vector<lama::DenseVector<ValueType>> offsets(1, offset);
+    seismogramSynRef.setOffsets(offsets);
+    seismogramObsRef.setOffsets(offsets);
+
+    lama::DenseMatrix<ValueType> refTraces;
+    lama::DenseVector<ValueType> refTrace;
+    refTraces.allocate(std::make_shared<dmemo::NoDistribution>(1), std::make_shared<dmemo::NoDistribution>(NT));
+    seismogramSynRef.getData().getRow(refTrace, 0);
+    refTraces.setRow(refTrace, 0, common::BinaryOp::COPY);
+    seismogramSynRef.getRefTraces() = refTraces;
+    seismogramObsRef.getData().getRow(refTrace, 0);
+    refTraces.setRow(refTrace, 0, common::BinaryOp::COPY);
+    seismogramObsRef.getRefTraces() = refTraces;
+
+    receiversTrue.getSeismogramHandler().setFrequencyAGC(FC);
+    receiversTrue.getSeismogramHandler().calcInverseAGC();
+    receivers.getSeismogramHandler().setInverseAGC(receiversTrue.getSeismogramHandler());
+
+    Acquisition::Seismogram<ValueType> seismogramSyn = receivers.getSeismogramHandler().getSeismogram(seismogramType);
+    Acquisition::Seismogram<ValueType> seismogramObs = receiversTrue.getSeismogramHandler().getSeismogram(seismogramType);
+    Acquisition::Seismogram<ValueType> seismogramAdj = seismogramSyn;
+
+    HOST_PRINT(commAll, "\n================ Benchmark " << valueType << ": NT = " << NT << ", traces = " << numTraces << ", grid points = " << modelCoordinates.getNGridpoints() << " ================\n\n");
+    HOST_PRINT(commAll, " " << std::left << std::setw(42) << "kernel" << std::setw(14) << "equationType" << std::setw(8) << "type" << std::right << std::setw(12) << "median [s]" << std::setw(12) << "min [s]" << std::setw(12) << "stddev [s]" << "\n");
+
+    /* --------------------------------------- */
+    /* Misfit functions and adjoint sources    */
+    /* --------------------------------------- */
+    typedef ValueType (Misfit::MisfitL2<ValueType>::*MisfitFunction)(Acquisition::Seismogram<ValueType> const &, Acquisition::Seismogram<ValueType> const &);
+    typedef void (Misfit::MisfitL2<ValueType>::*AdjointFunction)(Acquisition::Seismogram<ValueType> &, Acquisition::Seismogram<ValueType> const &, Acquisition::Seismogram<ValueType> const &);
+    std::vector<std::string> misfitNames = {"l2", "l3", "l4", "l5", "l6", "l7", "l8", "l9"};
+    std::vector<MisfitFunction> misfitFunctions = {&Misfit::MisfitL2<ValueType>::calcL2, &Misfit::MisfitL2<ValueType>::calcL2Convolved, &Misfit::MisfitL2<ValueType>::calcL2FK, &Misfit::MisfitL2<ValueType>::calcL2EnvelopeWeighted, &Misfit::MisfitL2<ValueType>::calcL2AGC, &Misfit::MisfitL2<ValueType>::calcL2Normalized, &Misfit::MisfitL2<ValueType>::calcL2Envelope, &Misfit::MisfitL2<ValueType>::calcL2InstantaneousPhase};
+    std::vector<AdjointFunction> adjointFunctions = {&Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2Convolved, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2FK, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2EnvelopeWeighted, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2AGC, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2Normalized, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2Envelope, &Misfit::MisfitL2<ValueType>::calcAdjointSeismogramL2InstantaneousPhase};
+    for (unsigned iMisfit = 0; iMisfit < misfitNames.size(); iMisfit++) {
+        MisfitFunction misfitFunction = misfitFunctions[iMisfit];
+        AdjointFunction adjointFunction = adjointFunctions[iMisfit];
+        results.push_back(runBenchmark(commAll, "misfit/" + misfitNames[iMisfit], equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { (misfitL2.*misfitFunction)(seismogramSyn, seismogramObs); }));
+        results.push_back(runBenchmark(commAll, "adjointSource/" + misfitNames[iMisfit], equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { (misfitL2.*adjointFunction)(seismogramAdj, seismogramSyn, seismogramObs); }));
+    }
+
+    /* --------------------------------------- */
+    /* FK transforms                           */
+    /* --------------------------------------- */
+    FK<ValueType> fkHandler;
+    fkHandler.init(DT, NT, FC, model->getVmin());
+    lama::DenseMatrix<typename FK<ValueType>::ComplexValueType> fk;
+    lama::DenseMatrix<ValueType> signal = seismogramSyn.getData();
+    results.push_back(runBenchmark(commAll, "FK/forward", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { fkHandler.FKTransform(seismogramSyn.getData(), fk, offset); }));
+    results.push_back(runBenchmark(commAll, "FK/inverse", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { fkHandler.inverseFKTransform(signal, fk, offset); }));
+
+    /* --------------------------------------- */
+    /* Trace transforms of one shot            */
+    /* --------------------------------------- */
+    // forward and inverse transform of all traces as in the convolved misfit: complex path (lama::fft) and real-to-complex transform (TraceFFT)
+    std::string traceNumberList = config.getAndCatch<std::string>("benchmarkTraceFFTNumTraces", "1000,5000,20000");
+    std::stringstream traceNumberStream(traceNumberList);
+    std::string traceNumber;
+    IndexType nFFT = Common::calcNextPowTwo<ValueType>(NT - 1);
+    while (std::getline(traceNumberStream, traceNumber, ',')) {
+        IndexType numTracesFFT = std::stoi(traceNumber);
+        lama::DenseMatrix<ValueType> tracesFFT(std::make_shared<dmemo::BlockDistribution>(numTracesFFT, commShot), std::make_shared<dmemo::NoDistribution>(NT));
+        fillTraces(tracesFFT, DT, FC, ValueType(0));
+        lama::DenseMatrix<ValueType> tracesResult;
+        lama::DenseMatrix<typename TraceFFT<ValueType>::ComplexValueType> spectra;
+        results.push_back(runBenchmark(commAll, "TraceFFT/complex/" + traceNumber, equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+            spectra = lama::cast<typename TraceFFT<ValueType>::ComplexValueType>(tracesFFT);
+            spectra.resize(tracesFFT.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(nFFT));
+            lama::fft<typename TraceFFT<ValueType>::ComplexValueType>(spectra, 1);
+            spectra *= (1.0 / ValueType(nFFT));
+            lama::ifft<typename TraceFFT<ValueType>::ComplexValueType>(spectra, 1);
+            spectra.resize(tracesFFT.getRowDistributionPtr(), tracesFFT.getColDistributionPtr());
+            tracesResult = lama::real(spectra);
+        }));
+        TraceFFT<ValueType> traceFFT;
+        traceFFT.init(NT, nFFT);
+        results.push_back(runBenchmark(commAll, "TraceFFT/realToComplex/" + traceNumber, equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+            traceFFT.forward(tracesFFT, spectra);
+            traceFFT.inverse(spectra, tracesResult);
+        }));
+    }
+
+    /* --------------------------------------- */
+    /* Seismogram tapers                       */
+    /* --------------------------------------- */
+    lama::DenseMatrix<ValueType> taperData;
+    auto resetTaperData = [&]() { taperData = seismogramSyn.getData(); };
+
+    Taper::Taper1D<ValueType> taper1D;
+    taper1D.init(std::make_shared<dmemo::NoDistribution>(NT), ctx, 1);
+    taper1D.calcCosineTaper(0, NT / 10, NT - NT / 10, NT - 1, false);
+    taper1D.calcTimeDampingTaper(ValueType(1.0), DT);
+    results.push_back(runBenchmark(commAll, "Taper1D/apply", equationType, valueType, numWarmup, numRepetitions, resetTaperData, [&]() { taper1D.apply(taperData); }));
+
+    Taper::Taper2D<ValueType> taper2D;
+    taper2D.init(receiversTrue.getSeismogramHandler());
+    taper2D.calcCosineTaper(receiversTrue.getSeismogramHandler(), FC, FC, config, 0, ctx);
+    results.push_back(runBenchmark(commAll, "Taper2D/apply", equationType, valueType, numWarmup, numRepetitions, resetTaperData, [&]() { taper2D.apply(taperData); }));
+
+    /* --------------------------------------- */
+    /* Receiver taper of the gradient          */
+    /* --------------------------------------- */
+    Preconditioning::SourceReceiverTaper<ValueType> receiverTaper;
+    IndexType receiverTaperRadius = config.getAndCatch("receiverTaperRadius", 0);
+    results.push_back(runBenchmark(commAll, "SourceReceiverTaper/initReceivers", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { receiverTaper.init(dist, ctx, receivers, config, modelCoordinates, receiverTaperRadius); }));
+
+    /* --------------------------------------- */
+    /* Grid transfer of the joint inversion    */
+    /* --------------------------------------- */
+    IndexType NZCoarse = (modelCoordinates.getNZ() > 1) ? (modelCoordinates.getNZ() - 1) / 2 + 1 : 1;
+    Acquisition::Coordinates<ValueType> modelCoordinatesCoarse((modelCoordinates.getNX() - 1) / 2 + 1, (modelCoordinates.getNY() - 1) / 2 + 1, NZCoarse, 2 * modelCoordinates.getDH());
+    dmemo::DistributionPtr distCoarse = std::make_shared<dmemo::BlockDistribution>(modelCoordinatesCoarse.getNGridpoints(), commShot);
+    Taper::Taper2D<ValueType> taperJoint;
+    taperJoint.initTransformMatrix(dist, distCoarse, ctx);
+    if (modelCoordinates.getNZ() == 1) {
+        results.push_back(runBenchmark(commAll, "GridTransfer/setupAssembly", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+            taperJoint.calcTransformMatrix(modelCoordinates, modelCoordinatesCoarse, 2);
+            taperJoint.calcTransformMatrix(modelCoordinatesCoarse, modelCoordinates, 1);
+        }));
+    }
+    lama::CSRSparseMatrix<ValueType> transferMatrix;
+    results.push_back(runBenchmark(commAll, "GridTransfer/setupCSR", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+        Taper::GridTransfer<ValueType>::calcTransferMatrixReplicated(transferMatrix, modelCoordinates, modelCoordinatesCoarse, dist, 0, "");
+        Taper::GridTransfer<ValueType>::calcTransferMatrixReplicated(transferMatrix, modelCoordinatesCoarse, modelCoordinates, distCoarse, 0, "");
+    }));
+
+    /* --------------------------------------- */
+    /* Gradient smoothing and summation        */
+    /* --------------------------------------- */
+    typename Gradient::Gradient<ValueType>::GradientPtr gradient(Gradient::Factory<ValueType>::Create(equationType));
+    gradient->init(ctx, dist);
+    gradient->setInvertForParameters(workflow.getInvertForParameters());
+    gradient->calcGaussianKernel(commAll, *model, config);
+    gradient->prepareForInversion(config);
+    results.push_back(runBenchmark(commAll, "Gradient/smooth", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { gradient->smooth(commAll, config); }));
+    results.push_back(runBenchmark(commAll, "Gradient/sumShotDomain", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { gradient->sumShotDomain(commInterShot); }));
+
+    /* --------------------------------------- */
+    /* Energy preconditioning                  */
+    /* --------------------------------------- */
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefields(Wavefields::Factory<ValueType>::Create(dimension, equationType));
+    wavefields->init(ctx, dist, numRelaxationMechanisms);
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
+    energyPrecond.init(dist, config);
+    results.push_back(runBenchmark(commAll, "EnergyPreconditioning/intSquaredWavefields", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() { energyPrecond.intSquaredWavefields(*wavefields, DT); }));
+    // integration over the stored time steps of a forward modelling and application to the gradient of the shot
+    results.push_back(runBenchmark(commAll, "EnergyPreconditioning/shot", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+        energyPrecond.resetApproxHessian();
+        for (IndexType tStep = 0; tStep < NT; tStep += std::max(workflow.skipDT, IndexType(1))) {
+            energyPrecond.intSquaredWavefields(*wavefields, DT);
+        }
+        energyPrecond.apply(*gradient, 0, config.getAndCatch("FileFormat", 1));
+    }));
+
+    /* --------------------------------------- */
+    /* Compensation of the stored wavefields   */
+    /* --------------------------------------- */
+    if (!isSeismic) {
+        // storage of the wavefields of all stored time steps of a forward modelling without compensation, with the advanced factor and with the factor of the model in every stored time step
+        typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefieldsInversion(Wavefields::Factory<ValueType>::Create(dimension, equationType));
+        wavefieldsInversion->init(ctx, dist, numRelaxationMechanisms);
+        lama::CSRSparseMatrix<ValueType> identity;
+        identity.setIdentity(dist);
+        IndexType skipDT = std::max(workflow.skipDT, IndexType(1));
+        results.push_back(runBenchmark(commAll, "Compensation/storeShot/off", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+            for (IndexType tStep = 0; tStep < NT; tStep += skipDT) {
+                *wavefieldsInversion = *wavefields;
+            }
+        }));
+        WavefieldCompensation<ValueType> wavefieldCompensation;
+        wavefieldCompensation.init(config);
+        if (wavefieldCompensation.isActive()) {
+            results.push_back(runBenchmark(commAll, "Compensation/storeShot/advanced", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+                wavefieldCompensation.initShot(*model);
+                for (IndexType tStep = 0; tStep < NT; tStep += skipDT) {
+                    wavefieldCompensation.storeWavefields(*wavefieldsInversion, *wavefields, tStep, identity, false);
+                }
+            }));
+        }
+        results.push_back(runBenchmark(commAll, "Compensation/storeShot/getCompensation", equationType, valueType, numWarmup, numRepetitions, noReset, [&]() {
+            for (IndexType tStep = 0; tStep < NT; tStep += skipDT) {
+                *wavefieldsInversion = *wavefields;
+                *wavefieldsInversion *= model->getCompensation(DT, tStep);
+            }
+        }));
+    }
+
+    /* --------------------------------------- */
+    /* Zero lag cross correlation              */
+    /* --------------------------------------- */
+    IndexType gradientKernel = config.getAndCatch("gradientKernel", 0);
+    lama::DenseVector<ValueType> sourceFC(numShotPerSuperShot, FC, ctx);
+    std::vector<lama::SparseVector<ValueType>> taperEncode;
+    // point source and point receiver in the center of the model for the wavefield activity
+    WavefieldActivity<ValueType> wavefieldActivity;
+    wavefieldActivity.init(config, modelCoordinates, dist, 1);
+    IndexType centerIndex = modelCoordinates.getNX() / 2 + modelCoordinates.getNX() * (modelCoordinates.getNY() / 2 + modelCoordinates.getNY() * (modelCoordinates.getNZ() / 2));
+    lama::DenseVector<IndexType> pointSource(1, centerIndex);
+    for (auto const &xcorrType : getEquationTypes(config, dimension, isSeismic)) {
+        typename Wavefields::Wavefields<ValueType>::WavefieldPtr forwardWavefield(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+        typename Wavefields::Wavefields<ValueType>::WavefieldPtr forwardDerivative(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+        typename Wavefields::Wavefields<ValueType>::WavefieldPtr adjointWavefield(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+        forwardWavefield->init(ctx, dist, numRelaxationMechanisms);
+        forwardDerivative->init(ctx, dist, numRelaxationMechanisms);
+        adjointWavefield->init(ctx, dist, numRelaxationMechanisms);
+
+        typename ZeroLagXcorr::ZeroLagXcorr<ValueType>::ZeroLagXcorrPtr xcorr(ZeroLagXcorr::Factory<ValueType>::Create(dimension, xcorrType));
+        xcorr->init(ctx, dist, workflow, config, numShotPerSuperShot);
+        xcorr->prepareForInversion(gradientKernel, config);
+
+        results.push_back(runBenchmark(commAll, "ZeroLagXcorr/update", xcorrType, valueType, numWarmup, numRepetitions, noReset, [&]() { xcorr->update(*forwardDerivative, *forwardWavefield, *adjointWavefield, workflow); }));
+        if (wavefieldActivity.isActive()) {
+            // cross correlation of the adjoint time stepping of a shot with and without the active blocks
+            auto correlateShot = [&](bool useActivity) {
+                wavefieldActivity.initForward(pointSource, *model, DT);
+                wavefieldActivity.initAdjoint(pointSource, NT - 1);
+                for (IndexType tStep = NT - 1; tStep > 0; tStep--) {
+                    if (tStep % std::max(workflow.skipDT, IndexType(1)) == 0) {
+                        auto const *activeRanges = wavefieldActivity.getCorrelationRanges(tStep);
+                        xcorr->setActiveRanges(useActivity ? activeRanges : nullptr);
+                        if (!useActivity || activeRanges == nullptr || !activeRanges->empty())
+                            xcorr->update(*forwardDerivative, *forwardWavefield, *adjointWavefield, workflow);
+                    }
+                }
+                xcorr->setActiveRanges(nullptr);
+            };
+            results.push_back(runBenchmark(commAll, "ZeroLagXcorr/shot", xcorrType, valueType, numWarmup, numRepetitions, noReset, [&]() { correlateShot(false); }));
+            wavefieldActivity.resetStatistics();
+            results.push_back(runBenchmark(commAll, "WavefieldActivity/shot", xcorrType, valueType, numWarmup, numRepetitions, noReset, [&]() { correlateShot(true); }));
+            HOST_PRINT(commAll, " " << std::left << std::setw(42) << "  skipped cross correlation [%]" << std::right << std::setw(12) << 100 * wavefieldActivity.getSkippedFractionCorrelation() << "\n");
+        }
+        if (dimension.compare("2d") == 0) {
+            // cross correlation of the stored time steps of a shot on the inversion grid: restriction of the forward and adjoint wavefields of every time step (CSR average matrix)
+            // or correlation on the modelling grid and matrix-free block average of the accumulated cross correlation (DHInversionRestriction)
+            IndexType skipDT = std::max(workflow.skipDT, IndexType(1));
+            for (IndexType DHInversion : {2, 4}) {
+                Acquisition::Coordinates<ValueType> modelCoordinatesInversion(config, DHInversion, config.get<IndexType>("NX"));
+                dmemo::DistributionPtr distInversion = std::make_shared<dmemo::BlockDistribution>(modelCoordinatesInversion.getNGridpoints(), commShot);
+                Taper::Taper2D<ValueType> taperInversion;
+                taperInversion.initAverageMatrix(config, distInversion, dist, ctx);
+                taperInversion.calcAverageMatrix(modelCoordinates, modelCoordinatesInversion);
+                taperInversion.calcBlockAverage(modelCoordinates, modelCoordinatesInversion, dist);
+                typename Wavefields::Wavefields<ValueType>::WavefieldPtr forwardInversion(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+                typename Wavefields::Wavefields<ValueType>::WavefieldPtr derivativeInversion(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+                typename Wavefields::Wavefields<ValueType>::WavefieldPtr adjointInversion(Wavefields::Factory<ValueType>::Create(dimension, xcorrType));
+                forwardInversion->init(ctx, distInversion, numRelaxationMechanisms);
+                derivativeInversion->init(ctx, distInversion, numRelaxationMechanisms);
+                adjointInversion->init(ctx, distInversion, numRelaxationMechanisms);
+                typename ZeroLagXcorr::ZeroLagXcorr<ValueType>::ZeroLagXcorrPtr xcorrInversion(ZeroLagXcorr::Factory<ValueType>::Create(dimension, xcorrType));
+                auto resetXcorrInversion = [&]() {
+                    xcorrInversion->init(ctx, distInversion, workflow, config, numShotPerSuperShot);
+                    xcorrInversion->prepareForInversion(gradientKernel, config);
+                };
+                std::string name = "DHInversion/" + std::to_string(DHInversion) + "/";
+                results.push_back(runBenchmark(commAll, name + "restrictPerStep", xcorrType, valueType, numWarmup, numRepetitions, resetXcorrInversion, [&]() {
+                    for (IndexType tStep = 0; tStep < NT; tStep += skipDT) {
+                        forwardInversion->applyTransform(taperInversion.getAverageMatrix(), *forwardWavefield);
+                        adjointInversion->applyTransform(taperInversion.getAverageMatrix(), *adjointWavefield);
+                        xcorrInversion->update(*derivativeInversion, *forwardInversion, *adjointInversion, workflow);
+                    }
+                    xcorrInversion->applyTransform(taperInversion.getRecoverMatrix(), workflow);
+                }));
+                results.push_back(runBenchmark(commAll, name + "restrictAfterAccumulation", xcorrType, valueType, numWarmup, numRepetitions, [&]() { xcorr->resetXcorr(workflow); }, [&]() {
+                    for (IndexType tStep = 0; tStep < NT; tStep += skipDT) {
+                        xcorr->update(*forwardDerivative, *forwardWavefield, *adjointWavefield, workflow);
+                    }
+                    xcorr->applyBlockAverage(taperInversion.getBlockAverage());
+                }));
+                ValueType memStorage = ceil(ValueType(NT) / skipDT) * forwardWavefield->estimateMemory(dist, numRelaxationMechanisms) / dist->getNumPartitions();
+                HOST_PRINT(commAll, " " << std::left << std::setw(42) << "  stored wavefields per step/after [MB]" << std::right << std::setw(12) << memStorage / (DHInversion * DHInversion) << std::setw(12) << memStorage << "\n");
+            }
+        }
+        IndexType tStep = 0;
+        results.push_back(runBenchmark(commAll, "ZeroLagXcorr/gatherWavefields", xcorrType, valueType, numWarmup, numRepetitions, noReset, [&]() { xcorr->gatherWavefields(*forwardWavefield, sourceFC, workflow, tStep, DT, false); }));
+        results.push_back(runBenchmark(commAll, "ZeroLagXcorr/sumWavefields", xcorrType, valueType, numWarmup, numRepetitions, noReset, [&]() { xcorr->sumWavefields(commShot, "", 0, workflow, sourceFC, DT, 0, taperEncode); }));
+    }
+}
+
+/*! \brief Write the benchmark results as JSON
+ *
+ * Each result is written in one line, so that a baseline file can be compared with a diff or a small script.
+ \param commAll Communicator of all processes
+ \param commInterShot Communicator between the shot domains
+ \param config Configuration
+ \param filename Name of the JSON file
+ \param results Benchmark results
+ */
+void writeResults(dmemo::CommunicatorPtr commAll, dmemo::CommunicatorPtr commInterShot, Configuration::Configuration config, std::string const &filename, std::vector<BenchmarkResult> const &results)
+{
+    IndexType numShotDomains = commInterShot->getSize();
+    if (commAll->getRank() == MASTERGPI) {
+        std::ofstream outputFile(filename);
+        outputFile << std::scientific << std::setprecision(6);
+        outputFile << "{\n";
+        outputFile << "  \"numProcesses\": " << commAll->getSize() << ",\n";
+        outputFile << "  \"numShotDomains\": " << numShotDomains << ",\n";
+        outputFile << "  \"NX\": " << config.get<IndexType>("NX") << ",\n";
+        outputFile << "  \"NY\": " << config.get<IndexType>("NY") << ",\n";
+        outputFile << "  \"NZ\": " << config.get<IndexType>("NZ") << ",\n";
+        outputFile << "  \"NT\": " << static_cast<IndexType>((config.get<double>("T") / config.get<double>("DT")) + 0.5) << ",\n";
+        outputFile << "  \"results\": [\n";
+        for (unsigned i = 0; i < results.size(); i++) {
+            BenchmarkResult const &result = results[i];
+            outputFile << "    {\"name\": \"" << result.name << "\", \"equationType\": \"" << result.equationType << "\", \"valueType\": \"" << result.valueType << "\", \"repetitions\": " << result.repetitions;
+            outputFile << ", \"min\": " << result.min << ", \"median\": " << result.median << ", \"mean\": " << result.mean << ", \"max\": " << result.max << ", \"stddev\": " << result.stddev << "}";
+            outputFile << ((i + 1 < results.size()) ? ",\n" : "\n");
+        }
+        outputFile << "  ]\n";
+        outputFile << "}\n";
+        outputFile.close();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cout << "\n\nNo configuration file given!\n\n"
+                  << std::endl;
+        return (2);
+    }
+
+    Configuration::Configuration config(argv[1]);
+    verbose = config.getAndCatch("verbose", false);
+
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr(); // default communicator, set by environment variable SCAI_COMMUNICATOR
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();                     // default context, set by environment variable SCAI_CONTEXT
+
+    IndexType shotDomain = Partitioning::getShotDomain(config, commAll);
+    dmemo::CommunicatorPtr commShot = commAll->split(shotDomain);
+    dmemo::CommunicatorPtr commInterShot = commAll->split(commShot->getRank());
+    SCAI_DMEMO_TASK(commShot)
+
+    std::vector<BenchmarkResult> results;
+    benchmarkAll<double>(config, commAll, commShot, commInterShot, ctx, "double", results);
+    benchmarkAll<float>(config, commAll, commShot, commInterShot, ctx, "float", results);
+
+    std::string filename = config.getAndCatch<std::string>("benchmarkFilename", "benchmark.json");
+    writeResults(commAll, commInterShot, config, filename, results);
+    HOST_PRINT(commAll, "\nBenchmark results written to " << filename << "\n\n");
+
+    return 0;
+}
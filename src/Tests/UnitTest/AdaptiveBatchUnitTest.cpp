@@ -0,0 +1,86 @@
+#include "../../Common/AdaptiveBatch.hpp"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(AdaptiveBatchTest, TestDrawShots)
+{
+    std::vector<IndexType> shotHistory = {1, 0, 1, 0, 0, 1, 0, 1};
+    std::vector<IndexType> shots = AdaptiveBatch<ValueType>::drawShots(shotHistory, 3, 42);
+    // the same seed gives the same shots
+    EXPECT_EQ(shots, AdaptiveBatch<ValueType>::drawShots(shotHistory, 3, 42));
+    ASSERT_EQ(shots.size(), 3);
+    EXPECT_EQ(std::set<IndexType>(shots.begin(), shots.end()).size(), 3);
+    // only unused shots are drawn
+    for (auto shot : shots) {
+        EXPECT_EQ(shotHistory[shot], 0);
+    }
+    // the batch is limited to the survey
+    EXPECT_EQ(AdaptiveBatch<ValueType>::drawShots(shotHistory, 20, 42).size(), shotHistory.size());
+}
+
+TEST(AdaptiveBatchTest, TestNormTest)
+{
+    // two shot gradients with |g_1|^2 + |g_2|^2 = 10 and |g_1 + g_2|^2 = 16: variance = 2, |mean|^2 = 4
+    EXPECT_DOUBLE_EQ(AdaptiveBatch<ValueType>::calcVariance(10.0, 16.0, 2), 2.0);
+    EXPECT_EQ(AdaptiveBatch<ValueType>::calcBatchSize(2.0, 16.0, 2, 0.5, 100, 1), 2);
+    EXPECT_EQ(AdaptiveBatch<ValueType>::calcBatchSize(2.0, 16.0, 2, 0.4, 100, 1), 4);
+    // rounded up to the number of shot domains and limited to the survey
+    EXPECT_EQ(AdaptiveBatch<ValueType>::calcBatchSize(2.0, 16.0, 2, 0.4, 100, 3), 6);
+    EXPECT_EQ(AdaptiveBatch<ValueType>::calcBatchSize(2.0, 16.0, 2, 0.4, 5, 3), 5);
+}
+
+TEST(AdaptiveBatchTest, TestNoisyQuadratic)
+{
+    // per-shot gradients of a noisy quadratic, g_i = x + noise_i: the batch grows when x approaches the minimum and the noise dominates
+    IndexType numshots = 64;
+    IndexType numParameters = 10;
+    std::mt19937 generator(7);
+    std::normal_distribution<ValueType> noise(0.0, 1.0);
+    std::vector<std::vector<ValueType>> noiseShots(numshots, std::vector<ValueType>(numParameters));
+    for (auto &noiseShot : noiseShots) {
+        for (auto &value : noiseShot) {
+            value = noise(generator);
+        }
+    }
+
+    std::vector<IndexType> shotHistory(numshots, 0);
+    IndexType batchSize = 2;
+    IndexType lastBatchSize = batchSize;
+    ValueType x = 10.0;
+    for (IndexType iteration = 0; iteration < 30; iteration++) {
+        std::vector<IndexType> shots = AdaptiveBatch<ValueType>::drawShots(shotHistory, batchSize, 11 + iteration);
+        ValueType sumNormSquared = 0;
+        std::vector<ValueType> batchGradient(numParameters, 0.0);
+        for (auto shot : shots) {
+            shotHistory[shot]++;
+            for (IndexType i = 0; i < numParameters; i++) {
+                ValueType gradient = x + noiseShots[shot][i];
+                sumNormSquared += gradient * gradient;
+                batchGradient[i] += gradient;
+            }
+        }
+        ValueType batchNormSquared = 0;
+        ValueType meanGradient = 0;
+        for (auto value : batchGradient) {
+            batchNormSquared += value * value;
+            meanGradient += value / (batchSize * numParameters);
+        }
+        ValueType variance = AdaptiveBatch<ValueType>::calcVariance(sumNormSquared, batchNormSquared, batchSize);
+        batchSize = AdaptiveBatch<ValueType>::calcBatchSize(variance, batchNormSquared, batchSize, 0.5, numshots, 2);
+        EXPECT_GE(batchSize, lastBatchSize);
+        EXPECT_LE(batchSize, numshots);
+        EXPECT_EQ(batchSize % 2, 0);
+        lastBatchSize = batchSize;
+        x -= 0.5 * meanGradient;
+    }
+    // few shots far from the minimum, the full survey close to it
+    EXPECT_EQ(batchSize, numshots);
+    EXPECT_LT(std::abs(x), 0.5);
+}
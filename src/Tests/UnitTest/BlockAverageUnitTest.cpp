@@ -0,0 +1,132 @@
+#include "../../Taper/BlockAverage.hpp"
+#include "../../Taper/Taper2D.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+#include <scai/dmemo/BlockDistribution.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(BlockAverageTest, TestMatchesAverageMatrix)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceTimeInversion_config.txt");
+
+    // the last column and row of the modelling grid are not part of a block
+    Acquisition::Coordinates<ValueType> modelCoordinates(21, 17, 1, 1.0);
+    Acquisition::Coordinates<ValueType> modelCoordinatesInversion(10, 8, 1, 2.0);
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(modelCoordinates.getNGridpoints()));
+    dmemo::DistributionPtr distInversion(new dmemo::NoDistribution(modelCoordinatesInversion.getNGridpoints()));
+
+    Taper::Taper2D<ValueType> taper;
+    taper.initAverageMatrix(testConfig, distInversion, dist, ctx);
+    taper.calcAverageMatrix(modelCoordinates, modelCoordinatesInversion);
+    taper.calcBlockAverage(modelCoordinates, modelCoordinatesInversion, dist);
+    Taper::BlockAverage<ValueType> const &blockAverage = taper.getBlockAverage();
+    EXPECT_EQ(blockAverage.getDHInversion(), 2);
+    EXPECT_EQ(blockAverage.getNumBlocks(), modelCoordinatesInversion.getNGridpoints());
+
+    lama::DenseVector<ValueType> vector = lama::linearDenseVector<ValueType>(dist, 1.0, 0.37);
+    vector.unaryOp(vector, common::UnaryOp::SIN);
+    lama::DenseVector<ValueType> vectorInversion;
+    lama::DenseVector<ValueType> vectorInversionReference;
+    vectorInversionReference = taper.getAverageMatrix() * vector;
+    blockAverage.average(vector, vectorInversion, distInversion);
+    lama::DenseVector<ValueType> difference;
+    difference = vectorInversion - vectorInversionReference;
+    EXPECT_LT(difference.maxNorm(), 1e-14 * vectorInversionReference.maxNorm());
+
+    lama::DenseVector<ValueType> vectorReference;
+    vectorReference = taper.getRecoverMatrix() * vectorInversionReference;
+    blockAverage.apply(vector);
+    difference = vector - vectorReference;
+    EXPECT_LT(difference.maxNorm(), 1e-14 * vectorReference.maxNorm());
+}
+
+TEST(BlockAverageTest, TestRestrictionAfterAccumulation)
+{
+    // forward and adjoint wavefield of a wavelength of 32 grid points, i.e. 16 and 8 grid points per wavelength on the inversion grids
+    Acquisition::Coordinates<ValueType> modelCoordinates(64, 48, 1, 1.0);
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(modelCoordinates.getNGridpoints()));
+    lama::DenseVector<ValueType> forward(dist, 0.0);
+    lama::DenseVector<ValueType> adjoint(dist, 0.0);
+    ValueType wavenumber = 2 * M_PI / 32;
+    for (IndexType i = 0; i < modelCoordinates.getNGridpoints(); i++) {
+        Acquisition::coordinate3D coordinate = modelCoordinates.index2coordinate(i);
+        forward.setValue(i, sin(wavenumber * coordinate.x + 0.3) * cos(wavenumber * coordinate.y));
+        adjoint.setValue(i, sin(wavenumber * coordinate.x + 1.1) * cos(wavenumber * coordinate.y + 0.5));
+    }
+    lama::DenseVector<ValueType> product;
+    product = forward * adjoint;
+
+    // relative l2 difference between the restriction of the wavefields of every time step and the restriction of the accumulated product
+    std::vector<IndexType> DHInversions = {2, 4};
+    std::vector<ValueType> differenceMin = {0.005, 0.03};
+    std::vector<ValueType> differenceMax = {0.03, 0.12};
+    for (IndexType iDH = 0; iDH < 2; iDH++) {
+        IndexType DHInversion = DHInversions[iDH];
+        Acquisition::Coordinates<ValueType> modelCoordinatesInversion(64 / DHInversion, 48 / DHInversion, 1, DHInversion);
+        dmemo::DistributionPtr distInversion(new dmemo::NoDistribution(modelCoordinatesInversion.getNGridpoints()));
+        Taper::BlockAverage<ValueType> blockAverage;
+        blockAverage.init(modelCoordinates, modelCoordinatesInversion, dist);
+
+        lama::DenseVector<ValueType> forwardInversion;
+        lama::DenseVector<ValueType> adjointInversion;
+        lama::DenseVector<ValueType> productInversion;
+        blockAverage.average(forward, forwardInversion, distInversion);
+        blockAverage.average(adjoint, adjointInversion, distInversion);
+        blockAverage.average(product, productInversion, distInversion);
+        lama::DenseVector<ValueType> difference;
+        difference = forwardInversion * adjointInversion;
+        difference -= productInversion;
+        ValueType relativeDifference = difference.l2Norm() / productInversion.l2Norm();
+        EXPECT_GT(relativeDifference, differenceMin[iDH]);
+        EXPECT_LT(relativeDifference, differenceMax[iDH]);
+
+        // both strategies agree for wavefields which are constant in every block
+        lama::DenseVector<ValueType> forwardConstant = forward;
+        blockAverage.apply(forwardConstant);
+        lama::DenseVector<ValueType> productConstant;
+        productConstant = forwardConstant * forwardConstant;
+        blockAverage.average(productConstant, productInversion, distInversion);
+        difference = forwardInversion * forwardInversion;
+        difference -= productInversion;
+        EXPECT_LT(difference.maxNorm(), 1e-14);
+    }
+}
+
+TEST(BlockAverageTest, TestDistributedMatchesReplicated)
+{
+    // the blocks of 3 x 3 points cross the boundaries of the block distribution of the rows
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    Acquisition::Coordinates<ValueType> modelCoordinates(31, 23, 1, 1.0);
+    Acquisition::Coordinates<ValueType> modelCoordinatesInversion(10, 7, 1, 3.0);
+    dmemo::DistributionPtr distReplicated(new dmemo::NoDistribution(modelCoordinates.getNGridpoints()));
+    dmemo::DistributionPtr dist(new dmemo::BlockDistribution(modelCoordinates.getNGridpoints(), commAll));
+    dmemo::DistributionPtr distInversion(new dmemo::NoDistribution(modelCoordinatesInversion.getNGridpoints()));
+
+    Taper::BlockAverage<ValueType> blockAverageReplicated;
+    Taper::BlockAverage<ValueType> blockAverage;
+    blockAverageReplicated.init(modelCoordinates, modelCoordinatesInversion, distReplicated);
+    blockAverage.init(modelCoordinates, modelCoordinatesInversion, dist);
+
+    lama::DenseVector<ValueType> vectorReplicated = lama::linearDenseVector<ValueType>(distReplicated, 1.0, 0.37);
+    vectorReplicated.unaryOp(vectorReplicated, common::UnaryOp::SIN);
+    lama::DenseVector<ValueType> vector(vectorReplicated);
+    vector.redistribute(dist);
+
+    lama::DenseVector<ValueType> vectorInversionReference;
+    lama::DenseVector<ValueType> vectorInversion;
+    blockAverageReplicated.average(vectorReplicated, vectorInversionReference, distInversion);
+    blockAverage.average(vector, vectorInversion, distInversion);
+    lama::DenseVector<ValueType> difference;
+    difference = vectorInversion - vectorInversionReference;
+    EXPECT_LT(difference.maxNorm(), 1e-14 * vectorInversionReference.maxNorm());
+
+    blockAverageReplicated.apply(vectorReplicated);
+    blockAverage.apply(vector);
+    vector.redistribute(distReplicated);
+    difference = vector - vectorReplicated;
+    EXPECT_LT(difference.maxNorm(), 1e-14 * vectorReplicated.maxNorm());
+}
@@ -0,0 +1,60 @@
+#include "../../Optimization/BoundConstraint.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+/* Vector with the given values */
+lama::DenseVector<ValueType> createVector(std::vector<ValueType> const &values)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(values.size()));
+    lama::DenseVector<ValueType> vector;
+    vector.setSameValue(dist, 0);
+    for (std::size_t i = 0; i < values.size(); i++) {
+        vector.setValue(i, values[i]);
+    }
+    return vector;
+}
+
+/* Minimize 0.5 * |x - c|^2 on the box [0, 1] with normalized descent directions and a decaying step length, the model is clipped to the box after every update (model thresholds) */
+ValueType solveBoundedQuadratic(bool useBoundConstraint)
+{
+    lama::DenseVector<ValueType> minimum = createVector({0.5, 0.2, 5.0, -4.0});
+    lama::DenseVector<ValueType> x = createVector({0.0, 1.0, 1.0, 0.0});
+    lama::DenseVector<ValueType> direction;
+    for (IndexType iteration = 0; iteration < 60; iteration++) {
+        direction = x - minimum;
+        if (useBoundConstraint)
+            Optimization::BoundConstraint<ValueType>::projectDirection(direction, x, 0.0, 1.0, 1e-9);
+        direction *= 0.2 * std::pow(0.9, ValueType(iteration)) / direction.maxNorm();
+        x -= direction;
+        for (IndexType i = 0; i < x.size(); i++) {
+            x.setValue(i, std::min(std::max(x.getValue(i), ValueType(0)), ValueType(1)));
+        }
+    }
+    lama::DenseVector<ValueType> error = createVector({0.5, 0.2, 1.0, 0.0});
+    error -= x;
+    return error.maxNorm();
+}
+
+TEST(BoundConstraintTest, TestProjectDirection)
+{
+    lama::DenseVector<ValueType> parameter = createVector({1500.0, 1500.0, 2000.0, 3000.0, 3000.0});
+    lama::DenseVector<ValueType> direction = createVector({1.0, -1.0, 1.0, 1.0, -1.0});
+
+    // the update is parameter - s * direction, only the directions out of the box are removed
+    EXPECT_EQ(Optimization::BoundConstraint<ValueType>::projectDirection(direction, parameter, 1500.0, 3000.0, 1e-3), 2);
+    std::vector<ValueType> projected{0.0, -1.0, 1.0, 1.0, 0.0};
+    for (IndexType i = 0; i < 5; i++) {
+        EXPECT_EQ(direction.getValue(i), projected[i]);
+    }
+}
+
+TEST(BoundConstraintTest, TestBoundedQuadratic)
+{
+    // the cells on the bounds dominate the normalization of the clipped descent direction, so the free cells hardly move
+    EXPECT_LT(solveBoundedQuadratic(true), 1e-3);
+    EXPECT_GT(solveBoundedQuadratic(false), 0.1);
+}
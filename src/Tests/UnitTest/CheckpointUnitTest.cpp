@@ -0,0 +1,119 @@
+#include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/lama.hpp>
+
+#include "Checkpoint.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace scai;
+using namespace KITGPI;
+
+TEST(CheckpointTest, TestWriteAndRead)
+{
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    dmemo::DistributionPtr dist = std::make_shared<dmemo::BlockDistribution>(23, commAll);
+    std::string filename = "checkpointUnitTest";
+
+    lama::DenseVector<double> distributedVector = lama::linearDenseVector<double>(dist, 1.0, 0.5);
+    lama::DenseVector<double> replicatedVector = lama::linearDenseVector<double>(7, -1.0, 0.25);
+    lama::DenseVector<double> emptyVector;
+    std::vector<lama::DenseVector<double>> vectors = {replicatedVector, emptyVector};
+    std::vector<IndexType> history = {0, 2, 1};
+
+    Checkpoint checkpoint;
+    checkpoint.openWrite(commAll, filename, sizeof(double));
+    checkpoint.write(IndexType(3));
+    checkpoint.write(0.98);
+    checkpoint.write(true);
+    checkpoint.write(std::string("l2"));
+    checkpoint.write(history);
+    checkpoint.write(distributedVector);
+    checkpoint.write(vectors);
+    checkpoint.commit();
+
+    IndexType iteration = 0;
+    double steplength = 0.0;
+    bool breakLoop = false;
+    std::string misfitType;
+    std::vector<IndexType> historyRead;
+    lama::DenseVector<double> distributedVectorRead(dist, 0.0);
+    std::vector<lama::DenseVector<double>> vectorsRead;
+
+    checkpoint.openRead(commAll, filename, sizeof(double));
+    checkpoint.read(iteration);
+    checkpoint.read(steplength);
+    checkpoint.read(breakLoop);
+    checkpoint.read(misfitType);
+    checkpoint.read(historyRead);
+    checkpoint.read(distributedVectorRead);
+    checkpoint.read(vectorsRead);
+    checkpoint.close();
+
+    EXPECT_EQ(iteration, 3);
+    EXPECT_EQ(steplength, 0.98);
+    EXPECT_TRUE(breakLoop);
+    EXPECT_EQ(misfitType, "l2");
+    EXPECT_EQ(historyRead, history);
+    // the values have to be restored bitwise
+    lama::DenseVector<double> difference;
+    difference = distributedVectorRead - distributedVector;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+    ASSERT_EQ(vectorsRead.size(), vectors.size());
+    EXPECT_EQ(vectorsRead[0].size(), replicatedVector.size());
+    difference = vectorsRead[0] - replicatedVector;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+    EXPECT_EQ(vectorsRead[1].size(), 0);
+
+    // a checkpoint written with another ValueType is rejected
+    Checkpoint checkpointFloat;
+    EXPECT_ANY_THROW(checkpointFloat.openRead(commAll, filename, sizeof(float)));
+    checkpointFloat.close();
+
+    commAll->synchronize();
+    std::remove(Checkpoint::getFilename(filename, Checkpoint::readManifest(commAll, filename), commAll->getRank()).c_str());
+    if (commAll->getRank() == 0)
+        std::remove(Checkpoint::getManifestFilename(filename).c_str());
+}
+
+TEST(CheckpointTest, TestInterruptedWriteKeepsLastCheckpoint)
+{
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    std::string filename = "checkpointUnitTestVersion";
+    EXPECT_EQ(Checkpoint::readManifest(commAll, filename), 0);
+
+    for (IndexType iteration = 1; iteration <= 2; iteration++) {
+        Checkpoint checkpoint;
+        checkpoint.openWrite(commAll, filename, sizeof(double));
+        checkpoint.write(iteration);
+        checkpoint.commit();
+        EXPECT_EQ(Checkpoint::readManifest(commAll, filename), iteration);
+    }
+    // the files of the previous checkpoint are removed after the manifest has been replaced
+    std::ifstream previousFile(Checkpoint::getFilename(filename, 1, commAll->getRank()));
+    EXPECT_FALSE(previousFile.is_open());
+
+    // a checkpoint which is not committed does not replace the last complete checkpoint
+    Checkpoint checkpointInterrupted;
+    checkpointInterrupted.openWrite(commAll, filename, sizeof(double));
+    checkpointInterrupted.write(IndexType(3));
+    checkpointInterrupted.close();
+    commAll->synchronize();
+
+    IndexType iteration = 0;
+    Checkpoint checkpoint;
+    checkpoint.openRead(commAll, filename, sizeof(double));
+    checkpoint.read(iteration);
+    checkpoint.close();
+    EXPECT_EQ(iteration, 2);
+
+    commAll->synchronize();
+    std::remove(Checkpoint::getFilename(filename, 2, commAll->getRank()).c_str());
+    std::remove(Checkpoint::getFilename(filename, 3, commAll->getRank()).c_str());
+    if (commAll->getRank() == 0)
+        std::remove(Checkpoint::getManifestFilename(filename).c_str());
+}
@@ -0,0 +1,156 @@
+#include "../../Common/EncodedDataCache.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(EncodedDataCacheTest, TestStoreAndRestore)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceTimeInversion_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    // encoded observed data of supershot 1 as it is returned by Receivers::encode: the sum of two shots with opposite polarity
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Seismogram<ValueType> &seismogram = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P);
+    lama::DenseMatrix<ValueType> shot0;
+    lama::DenseMatrix<ValueType> shot1;
+    shot0.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    shot1.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    seismogram.getData() = shot0 - shot1;
+    seismogram.getDataDecode() = {shot0, shot1};
+    lama::DenseMatrix<ValueType> encodedData = seismogram.getData();
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsEncode(3);
+    sourceSettingsEncode[0].sourceNo = 1;
+    sourceSettingsEncode[0].row = 0;
+    sourceSettingsEncode[1].sourceNo = -1;
+    sourceSettingsEncode[1].row = 1;
+    sourceSettingsEncode[2].sourceNo = 2;
+    sourceSettingsEncode[2].row = 2;
+
+    EncodedDataCache<ValueType> cache;
+    EXPECT_FALSE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+    cache.store(receiversTrue, 1, sourceSettingsEncode);
+    EXPECT_GT(cache.getMemory(), 0.0);
+
+    // the restored data equals the encoded data also after the receivers have been filtered or muted
+    seismogram.getData() *= 0.5;
+    seismogram.getDataDecode()[0] *= 0.0;
+    EXPECT_TRUE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+    lama::DenseMatrix<ValueType> difference;
+    difference = seismogram.getData() - encodedData;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+    ASSERT_EQ(seismogram.getDataDecode().size(), 2);
+    difference = seismogram.getDataDecode()[0] - shot0;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+
+    // supershots which are not cached or whose encoding has changed have to be encoded again
+    EXPECT_FALSE(cache.restore(receiversTrue, 2, sourceSettingsEncode));
+    sourceSettingsEncode[1].sourceNo = 1;
+    EXPECT_FALSE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+    sourceSettingsEncode[1].sourceNo = -1;
+    sourceSettingsEncode[1].row = 2;
+    sourceSettingsEncode[2].row = 1;
+    EXPECT_FALSE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+
+    cache.clear();
+    EXPECT_EQ(cache.getMemory(), 0.0);
+}
+
+TEST(EncodedDataCacheTest, TestCachedSupershotEqualsEncode)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testEncodedDataCache_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    // supershot 0 consists of shot 0 of the field data
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsEncode(1);
+    sourceSettingsEncode[0].sourceNo = 0;
+    sourceSettingsEncode[0].row = 0;
+
+    Acquisition::Receivers<ValueType> receiversEncode;
+    receiversEncode.init(testConfig, modelCoordinates, ctx, dist);
+    receiversEncode.encode(testConfig, testConfig.get<std::string>("fieldSeisName"), 0, sourceSettingsEncode, 1);
+    lama::DenseMatrix<ValueType> encodedData = receiversEncode.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+
+    EncodedDataCache<ValueType> cache;
+    cache.init(testConfig);
+    ASSERT_TRUE(cache.isActive());
+
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Seismogram<ValueType> &seismogram = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P);
+    lama::DenseMatrix<ValueType> difference;
+    for (IndexType iRun = 0; iRun < 2; iRun++) {
+        cache.encode(receiversTrue, testConfig, 0, sourceSettingsEncode);
+        difference = seismogram.getData() - encodedData;
+        EXPECT_EQ(difference.maxNorm(), 0.0);
+        // the receivers are filtered or muted after encoding
+        seismogram.getData() *= 0.5;
+    }
+    EXPECT_EQ(cache.getNumReads(), 1);
+    EXPECT_EQ(cache.getNumHits(), 1);
+
+    // the cache is cleared at the beginning of every workflow stage
+    cache.clear();
+    cache.encode(receiversTrue, testConfig, 0, sourceSettingsEncode);
+    EXPECT_EQ(cache.getNumReads(), 2);
+}
+
+TEST(EncodedDataCacheTest, TestMemoryLimit)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testEncodedDataCache_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> shot0;
+    shot0.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData() = shot0;
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsEncode(3);
+    for (IndexType iShot = 0; iShot < 3; iShot++) {
+        sourceSettingsEncode[iShot].sourceNo = iShot;
+        sourceSettingsEncode[iShot].row = iShot;
+    }
+
+    EncodedDataCache<ValueType> cache;
+    cache.init(testConfig);
+    cache.store(receiversTrue, 0, sourceSettingsEncode);
+    double memoryShot = cache.getMemory();
+
+    // the limit of encodedDataCacheMemory = 0.2 MB is exceeded by the third supershot
+    Configuration::Configuration limitConfig("../src/Tests/Testfiles/testEncodedDataCache_limit_config.txt");
+    double memoryLimit = limitConfig.get<double>("encodedDataCacheMemory");
+    ASSERT_LE(2 * memoryShot, memoryLimit);
+    ASSERT_GT(3 * memoryShot, memoryLimit);
+    cache.init(limitConfig);
+    cache.store(receiversTrue, 0, sourceSettingsEncode);
+    cache.store(receiversTrue, 1, sourceSettingsEncode);
+    EXPECT_TRUE(cache.restore(receiversTrue, 0, sourceSettingsEncode));
+
+    // supershot 1 is the least recently used one and is removed
+    cache.store(receiversTrue, 2, sourceSettingsEncode);
+    EXPECT_LE(cache.getMemory(), memoryLimit);
+    EXPECT_TRUE(cache.restore(receiversTrue, 0, sourceSettingsEncode));
+    EXPECT_FALSE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+    EXPECT_TRUE(cache.restore(receiversTrue, 2, sourceSettingsEncode));
+
+    // a supershot which exceeds the limit alone is not stored
+    receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getDataDecode() = {shot0, shot0, shot0};
+    cache.store(receiversTrue, 1, sourceSettingsEncode);
+    EXPECT_FALSE(cache.restore(receiversTrue, 1, sourceSettingsEncode));
+    EXPECT_TRUE(cache.restore(receiversTrue, 0, sourceSettingsEncode));
+}
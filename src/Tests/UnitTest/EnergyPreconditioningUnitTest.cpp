@@ -0,0 +1,145 @@
+#include "../../Common/Checkpoint.hpp"
+#include "../../Gradient/GradientFactory.hpp"
+#include "../../Preconditioning/EnergyPreconditioning.hpp"
+#include <Wavefields/WavefieldsFactory.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+#include <cstdio>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(EnergyPreconditioningTest, TestFusedAccumulation)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(1000));
+    ValueType DT = 2e-3;
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testEnergyPreconditioning_config.txt");
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
+    energyPrecond.init(dist, testConfig);
+    energyPrecond.resetApproxHessian();
+
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefield(Wavefields::Factory<ValueType>::Create("2D", "elastic"));
+    wavefield->init(ctx, dist, 1);
+
+    // accumulation of the copied, squared and scaled components as before
+    lama::DenseVector<ValueType> approxHessianReference(dist, 0.0);
+    lama::DenseVector<ValueType> component;
+    for (IndexType tStep = 0; tStep < 5; tStep++) {
+        wavefield->getRefVX() = lama::linearDenseVector<ValueType>(dist, 0.1 * tStep, 0.01);
+        wavefield->getRefVY() = lama::linearDenseVector<ValueType>(dist, -1.0, 0.002 * tStep);
+        energyPrecond.intSquaredWavefields(*wavefield, DT);
+
+        component = wavefield->getRefVX();
+        component *= component;
+        component *= DT;
+        approxHessianReference += component;
+        component = wavefield->getRefVY();
+        component *= component;
+        component *= DT;
+        approxHessianReference += component;
+    }
+
+    lama::DenseVector<ValueType> difference;
+    difference = energyPrecond.getApproxHessian() - approxHessianReference;
+    EXPECT_LT(difference.maxNorm(), 1e-12 * approxHessianReference.maxNorm());
+
+    // the z component is not part of the 2D elastic approximated Hessian
+    lama::DenseVector<ValueType> ones(dist, 1.0);
+    lama::DenseVector<ValueType> sum(dist, 0.0);
+    Preconditioning::EnergyPreconditioning<ValueType>::accumulateSquared(sum, &ones, nullptr, &ones, 0.5);
+    EXPECT_DOUBLE_EQ(sum.getValue(17), 1.0);
+}
+
+TEST(EnergyPreconditioningTest, TestReuse)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(100));
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testEnergyPreconditioning_config.txt");
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
+    energyPrecond.init(dist, testConfig);
+    ASSERT_TRUE(energyPrecond.isReuseActive());
+
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefield(Wavefields::Factory<ValueType>::Create("2D", "elastic"));
+    wavefield->init(ctx, dist, 1);
+    wavefield->getRefVX() = lama::linearDenseVector<ValueType>(dist, 1.0, 0.1);
+    wavefield->getRefVY() = lama::linearDenseVector<ValueType>(dist, 2.0, -0.01);
+
+    for (IndexType iteration = 0; iteration < 4; iteration++) {
+        energyPrecond.startIteration(0, iteration);
+        energyPrecond.resetApproxHessian(5);
+        energyPrecond.intSquaredWavefields(*wavefield, 1e-3);
+        energyPrecond.intSquaredWavefields(*wavefield, 1e-3, true);
+        // the stored approximated Hessian of the shot is reused in iterations 1 and 2
+        bool isCalculated = (iteration % 3 == 0);
+        EXPECT_EQ(energyPrecond.getApproxHessian().maxNorm() > 0, isCalculated) << "iteration " << iteration;
+
+        typename Gradient::Gradient<ValueType>::GradientPtr gradient(Gradient::Factory<ValueType>::Create("elastic"));
+        gradient->init(ctx, dist);
+        energyPrecond.apply(*gradient, 5, 1);
+        EXPECT_EQ(energyPrecond.getNumCalculated(), isCalculated ? 1 : 0);
+        EXPECT_EQ(energyPrecond.getNumReused(), isCalculated ? 0 : 1);
+        // the wavefield does not change, so the recalculated Hessian is the reused one
+        EXPECT_LT(energyPrecond.getStaleness(), 1e-12);
+    }
+    EXPECT_GT(energyPrecond.getMemory(), 0.0);
+
+    // a new stage removes the stored approximated Hessians
+    energyPrecond.startIteration(1, 1);
+    energyPrecond.resetApproxHessian(5);
+    energyPrecond.intSquaredWavefields(*wavefield, 1e-3);
+    EXPECT_GT(energyPrecond.getApproxHessian().maxNorm(), 0.0);
+}
+
+TEST(EnergyPreconditioningTest, TestReuseAfterCheckpoint)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(100));
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testEnergyPreconditioning_config.txt");
+    std::string filename = "energyPreconditioningUnitTest";
+
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefield(Wavefields::Factory<ValueType>::Create("2D", "elastic"));
+    wavefield->init(ctx, dist, 1);
+    wavefield->getRefVX() = lama::linearDenseVector<ValueType>(dist, 1.0, 0.1);
+    wavefield->getRefVY() = lama::linearDenseVector<ValueType>(dist, 2.0, -0.01);
+    typename Gradient::Gradient<ValueType>::GradientPtr gradient(Gradient::Factory<ValueType>::Create("elastic"));
+    gradient->init(ctx, dist);
+
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
+    energyPrecond.init(dist, testConfig);
+    energyPrecond.startIteration(0, 0);
+    energyPrecond.resetApproxHessian(5);
+    energyPrecond.intSquaredWavefields(*wavefield, 1e-3);
+    energyPrecond.intSquaredWavefields(*wavefield, 1e-3, true);
+    energyPrecond.apply(*gradient, 5, 1);
+
+    Checkpoint checkpoint;
+    checkpoint.openWrite(commAll, filename, sizeof(ValueType));
+    energyPrecond.writeCheckpoint(checkpoint, commAll);
+    checkpoint.commit();
+
+    // a resumed run reuses the stored approximated Hessian in the next iteration of the stage
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecondResumed;
+    energyPrecondResumed.init(dist, testConfig);
+    checkpoint.openRead(commAll, filename, sizeof(ValueType));
+    energyPrecondResumed.readCheckpoint(checkpoint, commAll, dist);
+    checkpoint.close();
+    EXPECT_EQ(energyPrecondResumed.getMemory(), energyPrecond.getMemory());
+
+    energyPrecondResumed.startIteration(0, 1);
+    energyPrecondResumed.resetApproxHessian(5);
+    energyPrecondResumed.intSquaredWavefields(*wavefield, 1e-3);
+    EXPECT_EQ(energyPrecondResumed.getApproxHessian().maxNorm(), 0.0);
+    energyPrecondResumed.apply(*gradient, 5, 1);
+    EXPECT_EQ(energyPrecondResumed.getNumCalculated(), 0);
+    EXPECT_EQ(energyPrecondResumed.getNumReused(), 1);
+
+    commAll->synchronize();
+    std::remove(Checkpoint::getFilename(filename, Checkpoint::readManifest(commAll, filename), commAll->getRank()).c_str());
+    if (commAll->getRank() == 0)
+        std::remove(Checkpoint::getManifestFilename(filename).c_str());
+}
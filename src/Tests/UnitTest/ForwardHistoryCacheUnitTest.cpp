@@ -0,0 +1,92 @@
+#include "../../Common/ForwardHistoryCache.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <Wavefields/WavefieldsFactory.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+/* Record a trial with one shot whose pressure wavefield and seismogram depend on the time step */
+void recordTrial(ForwardHistoryCache<ValueType> &cache, std::vector<lama::DenseVector<ValueType>> const &parameters, ValueType steplength, Wavefields::Wavefields<ValueType> &wavefield, Acquisition::Receivers<ValueType> &receivers, dmemo::DistributionPtr dist, IndexType shotInd)
+{
+    IndexType skipDT = 2;
+    IndexType tStepEnd = 7;
+    cache.startTrial(parameters, steplength, 0, skipDT);
+    ASSERT_TRUE(cache.startShot(shotInd, wavefield, dist, tStepEnd));
+    for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
+        wavefield.getRefP() = lama::linearDenseVector<ValueType>(dist, 0.1 * tStep, 0.01);
+        if (tStep % skipDT == 0)
+            cache.storeStep(tStep, wavefield);
+    }
+    cache.finishShot(receivers);
+}
+
+TEST(ForwardHistoryCacheTest, TestReplayOfAcceptedTrial)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testForwardHistory_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &data = receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    data.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    lama::DenseMatrix<ValueType> dataTrial = data;
+
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefield(Wavefields::Factory<ValueType>::Create("2D", "acoustic"));
+    wavefield->init(ctx, dist, 0);
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefieldReplay(Wavefields::Factory<ValueType>::Create("2D", "acoustic"));
+    wavefieldReplay->init(ctx, dist, 0);
+
+    ForwardHistoryCache<ValueType> cache;
+    cache.init(testConfig);
+    ASSERT_TRUE(cache.isActive());
+    std::vector<lama::DenseVector<ValueType>> parameters = {lama::linearDenseVector<ValueType>(dist, 1500.0, 0.1), lama::fill<lama::DenseVector<ValueType>>(dist, 2000.0)};
+
+    // the history is only used after the step length of the trial has been accepted
+    recordTrial(cache, parameters, 0.03, *wavefield, receivers, dist, 5);
+    EXPECT_FALSE(cache.find(5));
+    cache.accept(0.03);
+    cache.update(parameters, 0, 2);
+    EXPECT_TRUE(cache.find(5));
+    EXPECT_FALSE(cache.find(4));
+    EXPECT_EQ(cache.getNumSaved(), 1);
+    EXPECT_GT(cache.getMemory(), 0.0);
+
+    // the replayed wavefields and seismograms of the gradient calculation are bitwise identical to the ones of the trial
+    lama::DenseVector<ValueType> difference;
+    for (IndexType tStep = 0; tStep < 7; tStep += 2) {
+        cache.restoreStep(5, tStep, *wavefieldReplay);
+        difference = wavefieldReplay->getRefP() - lama::linearDenseVector<ValueType>(dist, 0.1 * tStep, 0.01);
+        EXPECT_EQ(difference.maxNorm(), 0.0);
+    }
+    data *= 0.5;
+    cache.restoreSeismograms(5, receivers);
+    lama::DenseMatrix<ValueType> dataDifference;
+    dataDifference = data - dataTrial;
+    EXPECT_EQ(dataDifference.maxNorm(), 0.0);
+
+    // another accepted step length discards the history
+    recordTrial(cache, parameters, 0.03, *wavefield, receivers, dist, 5);
+    cache.accept(0.05);
+    cache.update(parameters, 0, 2);
+    EXPECT_FALSE(cache.find(5));
+    EXPECT_EQ(cache.getNumShots(), 0);
+
+    // a model which differs at one grid point or another workflow stage invalidates the history
+    recordTrial(cache, parameters, 0.03, *wavefield, receivers, dist, 5);
+    cache.accept(0.03);
+    std::vector<lama::DenseVector<ValueType>> parametersChanged = parameters;
+    parametersChanged[1].setValue(1234, 2000.5);
+    cache.update(parametersChanged, 0, 2);
+    EXPECT_FALSE(cache.find(5));
+
+    recordTrial(cache, parameters, 0.03, *wavefield, receivers, dist, 5);
+    cache.accept(0.03);
+    cache.update(parameters, 1, 2);
+    EXPECT_FALSE(cache.find(5));
+    EXPECT_EQ(cache.getNumSaved(), 1);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <scai/lama.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../../Gradient/GradientCalculation.hpp"
+
+/* Gradient of the shot of a test configuration calculated with GradientCalculation::run like InversionSingle::calcGradient
+ *
+ * The forward modelling runs up to tStepForwardEnd and stores the wavefields of every skipDT-th time step with storeWavefields(wavefieldsInversion, wavefields, tStep).
+ * The adjoint sources are the synthetic seismograms multiplied by the seismogram taper if it is given, which are the L2 adjoint sources of zero observed data without their scaling.
+ * wavefieldCompensation and timeWindow have to be initialized by the test, calcForwardEnd of the time window has to be called before.
+ */
+template <typename ValueType, typename StoreFunction>
+typename KITGPI::Gradient::Gradient<ValueType>::GradientPtr calcGradientPerShot(KITGPI::Configuration::Configuration const &config, KITGPI::Modelparameter::Modelparameter<ValueType> &model, KITGPI::Acquisition::Coordinates<ValueType> const &modelCoordinates, scai::dmemo::DistributionPtr dist, scai::IndexType tStepForwardEnd, KITGPI::Taper::Taper2D<ValueType> const *seismogramTaper2D, KITGPI::TimeWindow<ValueType> &timeWindow, KITGPI::WavefieldCompensation<ValueType> &wavefieldCompensation, StoreFunction storeWavefields)
+{
+    using namespace scai;
+    using namespace KITGPI;
+    typedef typename Wavefields::Wavefields<ValueType>::WavefieldPtr WavefieldPtr;
+
+    dmemo::CommunicatorPtr commAll = dist->getCommunicatorPtr();
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    std::string dimension = config.get<std::string>("dimension");
+    std::string equationType = config.get<std::string>("equationType");
+    ValueType DT = config.get<ValueType>("DT");
+    IndexType tStepEnd = static_cast<IndexType>((config.get<ValueType>("T") / DT) + 0.5);
+    IndexType numRelaxationMechanisms = config.get<IndexType>("numRelaxationMechanisms");
+
+    typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr derivatives(ForwardSolver::Derivatives::Factory<ValueType>::Create(dimension));
+    derivatives->init(dist, ctx, config, modelCoordinates, commAll);
+    WavefieldPtr wavefields(Wavefields::Factory<ValueType>::Create(dimension, equationType));
+    wavefields->init(ctx, dist, numRelaxationMechanisms);
+    typename ForwardSolver::ForwardSolver<ValueType>::ForwardSolverPtr solver(ForwardSolver::Factory<ValueType>::Create(dimension, equationType));
+    solver->initForwardSolver(config, *derivatives, *wavefields, model, modelCoordinates, ctx, DT);
+    solver->prepareForModelling(model, DT);
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettings;
+    Acquisition::readAllSettings<ValueType>(sourceSettings, config.get<std::string>("SourceFilename") + ".txt");
+    Acquisition::Sources<ValueType> sources;
+    sources.init(sourceSettings, config, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(config, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> adjointSources;
+    adjointSources.init(config, modelCoordinates, ctx, dist);
+
+    IndexType seedtime = 0;
+    typename Misfit::Misfit<ValueType>::MisfitPtr dataMisfit(Misfit::Factory<ValueType>::Create(config.get<std::string>("misfitType")));
+    dataMisfit->init(config, std::vector<IndexType>(), 1, 0, model.getVmin(), seedtime);
+    Workflow::Workflow<ValueType> workflow;
+    workflow.init(config);
+    ValueType steplengthInit = 0;
+    workflow.changeStage(config, *dataMisfit, steplengthInit);
+
+    typename Gradient::Gradient<ValueType>::GradientPtr gradientPerShot(Gradient::Factory<ValueType>::Create(equationType));
+    gradientPerShot->init(ctx, dist);
+    gradientPerShot->prepareForInversion(config);
+    gradientPerShot->setInvertForParameters(workflow.getInvertForParameters());
+
+    GradientCalculation<ValueType> gradientCalculation;
+    gradientCalculation.allocate(config, dist, dist, ctx, workflow, 1);
+    gradientCalculation.prepareForModelling(config, *derivatives, model, modelCoordinates, ctx, true);
+    std::vector<WavefieldPtr> wavefieldrecord;
+    std::vector<WavefieldPtr> wavefieldrecordReflect;
+    for (IndexType tStep = 0; tStep < tStepEnd; tStep += workflow.skipDT) {
+        WavefieldPtr wavefieldsRecord(Wavefields::Factory<ValueType>::Create(dimension, equationType));
+        wavefieldsRecord->init(ctx, dist, numRelaxationMechanisms);
+        wavefieldrecord.push_back(wavefieldsRecord);
+    }
+    WavefieldPtr wavefieldsInversion(Wavefields::Factory<ValueType>::Create(dimension, equationType));
+    wavefieldsInversion->init(ctx, dist, numRelaxationMechanisms);
+
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecond;
+    Preconditioning::EnergyPreconditioning<ValueType> energyPrecondReflect;
+    energyPrecond.init(dist, config);
+    energyPrecondReflect.init(dist, config);
+    Preconditioning::SourceReceiverTaperCache<ValueType> taperCache;
+    taperCache.init(config);
+    WavefieldActivity<ValueType> wavefieldActivity;
+    wavefieldActivity.init(config, modelCoordinates, dist);
+    Taper::Taper2D<ValueType> wavefieldTaper2D;
+
+    wavefields->resetWavefields();
+    wavefieldActivity.initForward(sources.get1DCoordinates(), model, DT);
+    wavefieldCompensation.initShot(model);
+    for (IndexType tStep = 0; tStep < tStepForwardEnd; tStep++) {
+        solver->run(receivers, sources, model, *wavefields, *derivatives, tStep);
+        if (tStep % workflow.skipDT == 0) {
+            storeWavefields(*wavefieldsInversion, *wavefields, tStep);
+            *wavefieldrecord[floor(tStep / workflow.skipDT + 0.5)] = *wavefieldsInversion;
+        }
+    }
+    solver->resetCPML();
+
+    for (IndexType iComponent = 0; iComponent < Acquisition::NUM_ELEMENTS_SEISMOGRAMTYPE; iComponent++) {
+        Acquisition::SeismogramType seismogramType = Acquisition::SeismogramType(iComponent);
+        if (receivers.getSeismogramHandler().getNumTracesGlobal(seismogramType) != 0)
+            adjointSources.getSeismogramHandler().getSeismogram(seismogramType).getData() = receivers.getSeismogramHandler().getSeismogram(seismogramType).getData();
+    }
+    if (seismogramTaper2D != nullptr)
+        seismogramTaper2D->apply(adjointSources.getSeismogramHandler());
+
+    gradientCalculation.run(commAll, *solver, *derivatives, receivers, sources, adjointSources, model, *gradientPerShot, wavefieldrecord, config, modelCoordinates, 0, 0, workflow, wavefieldTaper2D, wavefieldrecordReflect, *dataMisfit, energyPrecond, energyPrecondReflect, sourceSettings, taperCache, timeWindow, wavefieldActivity, wavefieldCompensation);
+    return gradientPerShot;
+}
@@ -0,0 +1,89 @@
+#include "../../Taper/GridTransfer.hpp"
+#include "../../Taper/Taper2D.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(GridTransferTest, TestMatchesTaper2D)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceTimeInversion_config.txt");
+
+    // seismic grid and a coarser EM grid whose points are not all on seismic grid lines
+    Acquisition::Coordinates<ValueType> modelCoordinates1(31, 25, 1, 1.0);
+    Acquisition::Coordinates<ValueType> modelCoordinates2(11, 9, 1, 3.0);
+    dmemo::DistributionPtr dist1(new dmemo::NoDistribution(modelCoordinates1.getNGridpoints()));
+    dmemo::DistributionPtr dist2(new dmemo::NoDistribution(modelCoordinates2.getNGridpoints()));
+
+    Taper::Taper2D<ValueType> taperReference;
+    taperReference.initTransformMatrix(dist1, dist2, ctx);
+    taperReference.calcTransformMatrix(modelCoordinates1, modelCoordinates2, 2);
+    taperReference.calcTransformMatrix(modelCoordinates2, modelCoordinates1, 1);
+
+    Taper::Taper2D<ValueType> taper;
+    taper.initTransformMatrix(dist1, dist2, ctx);
+    taper.calcTransformMatrices(testConfig, testConfig, modelCoordinates1, modelCoordinates2);
+
+    lama::DenseVector<ValueType> parameter1 = lama::linearDenseVector<ValueType>(dist1, 1.0, 0.5);
+    lama::DenseVector<ValueType> parameter2 = lama::linearDenseVector<ValueType>(dist2, 2.0, 0.25);
+    lama::DenseVector<ValueType> result;
+    lama::DenseVector<ValueType> resultReference;
+    lama::DenseVector<ValueType> difference;
+
+    taperReference.applyGradientTransform1to2(parameter1, resultReference);
+    taper.applyGradientTransform1to2(parameter1, result);
+    difference = result - resultReference;
+    EXPECT_LT(difference.maxNorm(), 1e-10 * resultReference.maxNorm());
+
+    // inverse distance weights inside the cells of the EM grid
+    taperReference.applyGradientTransform2to1(resultReference, parameter2);
+    taper.applyGradientTransform2to1(result, parameter2);
+    difference = result - resultReference;
+    EXPECT_LT(difference.maxNorm(), 1e-10 * resultReference.maxNorm());
+}
+
+TEST(GridTransferTest, TestTrilinearAndAveraging3D)
+{
+    Acquisition::Coordinates<ValueType> coordinatesFine(10, 8, 6, 1.0);
+    Acquisition::Coordinates<ValueType> coordinatesCoarse(5, 4, 3, 2.0);
+    dmemo::DistributionPtr distFine(new dmemo::NoDistribution(coordinatesFine.getNGridpoints()));
+    dmemo::DistributionPtr distCoarse(new dmemo::NoDistribution(coordinatesCoarse.getNGridpoints()));
+
+    // a linear function is interpolated exactly from the coarse to the fine grid
+    lama::DenseVector<ValueType> linearCoarse(distCoarse, 0.0);
+    for (IndexType i = 0; i < coordinatesCoarse.getNGridpoints(); i++) {
+        Acquisition::coordinate3D coordinate = coordinatesCoarse.index2coordinate(i);
+        linearCoarse.setValue(i, 2.0 * (coordinate.x + 2 * coordinate.y + 3 * coordinate.z));
+    }
+    lama::CSRSparseMatrix<ValueType> transferMatrix;
+    Taper::GridTransfer<ValueType>::calcTransferMatrix(transferMatrix, coordinatesFine, coordinatesCoarse, distFine, Taper::GridTransfer<ValueType>::TRILINEAR);
+    lama::DenseVector<ValueType> linearFine;
+    linearFine = transferMatrix * linearCoarse;
+    for (IndexType i = 0; i < coordinatesFine.getNGridpoints(); i++) {
+        Acquisition::coordinate3D coordinate = coordinatesFine.index2coordinate(i);
+        if (coordinate.x <= 8 && coordinate.y <= 6 && coordinate.z <= 4) {
+            EXPECT_NEAR(linearFine.getValue(i), coordinate.x + 2 * coordinate.y + 3 * coordinate.z, 1e-10);
+        } else {
+            // outside of the coarse grid
+            EXPECT_EQ(linearFine.getValue(i), 0.0);
+        }
+    }
+
+    // averaging from the fine to the coarse grid conserves a constant
+    lama::DenseVector<ValueType> onesFine(distFine, 1.0);
+    Taper::GridTransfer<ValueType>::calcTransferMatrix(transferMatrix, coordinatesCoarse, coordinatesFine, distCoarse, Taper::GridTransfer<ValueType>::AVERAGING);
+    lama::DenseVector<ValueType> onesCoarse;
+    onesCoarse = transferMatrix * onesFine;
+    onesCoarse -= 1.0;
+    EXPECT_LT(onesCoarse.maxNorm(), 1e-10);
+
+    // the weights of an interior point of the coarse grid cover the fine points of its cell with half weights on the faces
+    std::vector<Taper::GridTransfer<ValueType>::AxisWeights> weights = Taper::GridTransfer<ValueType>::calcAxisWeights(5, 2.0, 0.0, 10, 1.0, 0.0, Taper::GridTransfer<ValueType>::AVERAGING);
+    ASSERT_EQ(weights[2].indices.size(), 3);
+    EXPECT_EQ(weights[2].indices[0], 3);
+    EXPECT_DOUBLE_EQ(weights[2].weights[0], 0.25);
+    EXPECT_DOUBLE_EQ(weights[2].weights[1], 0.5);
+}
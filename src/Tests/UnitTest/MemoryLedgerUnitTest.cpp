@@ -0,0 +1,77 @@
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/lama.hpp>
+
+#include "MemoryLedger.hpp"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace scai;
+using namespace KITGPI;
+
+TEST(MemoryLedgerTest, TestCurrentAndPeak)
+{
+    double start = MemoryLedger::getCurrent();
+    MemoryLedger::set("test storage", 100.0);
+    MemoryLedger::set("test xcorr", 20.0);
+    EXPECT_DOUBLE_EQ(MemoryLedger::getCurrent() - start, 120.0);
+
+    // replacing an allocation changes the current but not the peak
+    MemoryLedger::set("test storage", 50.0);
+    EXPECT_DOUBLE_EQ(MemoryLedger::getCurrent() - start, 70.0);
+    EXPECT_GE(MemoryLedger::getPeak() - start, 120.0);
+
+    // the prediction replaces the registered sizes
+    std::vector<std::pair<std::string, double>> newSizes = {{"test storage", 80.0}, {"test new", 5.0}};
+    EXPECT_DOUBLE_EQ(MemoryLedger::predict(newSizes) - start, 105.0);
+
+    MemoryLedger::release("test storage");
+    MemoryLedger::release("test xcorr");
+    EXPECT_DOUBLE_EQ(MemoryLedger::getSize("test storage"), 0.0);
+    EXPECT_DOUBLE_EQ(MemoryLedger::getCurrent(), start);
+
+    MemoryLedger::resetPeak();
+    EXPECT_DOUBLE_EQ(MemoryLedger::getPeak(), MemoryLedger::getCurrent());
+}
+
+TEST(MemoryLedgerTest, TestLedgerAgainstResidentSetSize)
+{
+    double rssStart = MemoryLedger::getResidentSetSize();
+    if (rssStart == 0.0)
+        return; // /proc/self/status is not available
+
+    // a registered and touched allocation has to show up in the resident set size
+    double megaBytes = 64;
+    std::vector<double> buffer(megaBytes * 1024 * 1024 / sizeof(double), 1.0);
+    MemoryLedger::set("test buffer", buffer.size() * sizeof(double) / (1024.0 * 1024.0));
+    double rssIncrease = MemoryLedger::getResidentSetSize() - rssStart;
+    EXPECT_NEAR(rssIncrease, MemoryLedger::getSize("test buffer"), 0.25 * megaBytes);
+    EXPECT_GE(MemoryLedger::getPeakResidentSetSize(), MemoryLedger::getResidentSetSize());
+
+    buffer[buffer.size() - 1] = 2.0; // keep the buffer alive until here
+    EXPECT_EQ(buffer[0], 1.0);
+    MemoryLedger::release("test buffer");
+}
+
+TEST(MemoryLedgerTest, TestAllocatedArray)
+{
+    // the allocation of a LAMA array is measured exactly, also if the heap reuses freed memory
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    IndexType size = 1024 * 1024;
+    for (IndexType repetition = 0; repetition < 2; repetition++) {
+        double allocatedStart = MemoryLedger::getAllocated(ctx);
+        {
+            lama::DenseVector<double> vector(size, 1.0, ctx);
+            EXPECT_NEAR(MemoryLedger::getAllocated(ctx) - allocatedStart, size * sizeof(double) / (1024.0 * 1024.0), 1e-3);
+        }
+        EXPECT_NEAR(MemoryLedger::getAllocated(ctx), allocatedStart, 1e-3);
+    }
+}
+
+TEST(MemoryLedgerTest, TestCheckLimit)
+{
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    EXPECT_NO_THROW(MemoryLedger::checkLimit(commAll, "test", 100.0, 0.0));
+    EXPECT_NO_THROW(MemoryLedger::checkLimit(commAll, "test", 100.0, 200.0));
+    EXPECT_ANY_THROW(MemoryLedger::checkLimit(commAll, "test", 300.0, 200.0));
+}
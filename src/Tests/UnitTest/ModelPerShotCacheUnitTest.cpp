@@ -0,0 +1,158 @@
+#include "../../Common/ModelPerShotCache.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <Acquisition/Sources.hpp>
+#include <ForwardSolver/Derivatives/DerivativesFactory.hpp>
+#include <ForwardSolver/ForwardSolverFactory.hpp>
+#include <Modelparameter/ModelparameterFactory.hpp>
+#include <Wavefields/WavefieldsFactory.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(ModelPerShotCacheTest, TestChangedBox)
+{
+    IndexType NX = 10;
+    IndexType NY = 8;
+    IndexType NZ = 1;
+    Acquisition::Coordinates<ValueType> modelCoordinatesBig(NX, NY, NZ, 1.0);
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(NX * NY * NZ));
+
+    lama::DenseVector<ValueType> parameterOld(dist, 1.0);
+    lama::DenseVector<ValueType> parameterNew(parameterOld);
+    EXPECT_TRUE(ModelPerShotCache<ValueType>::isEmpty(ModelPerShotCache<ValueType>::calcChangedBox(parameterOld, parameterNew, modelCoordinatesBig)));
+
+    parameterNew.setValue(modelCoordinatesBig.coordinate2index(2, 3, 0), 2.0);
+    parameterNew.setValue(modelCoordinatesBig.coordinate2index(5, 1, 0), 2.0);
+    ModelPerShotCache<ValueType>::Box box = ModelPerShotCache<ValueType>::calcChangedBox(parameterOld, parameterNew, modelCoordinatesBig);
+    ASSERT_FALSE(ModelPerShotCache<ValueType>::isEmpty(box));
+    EXPECT_EQ(box.first.x, 2);
+    EXPECT_EQ(box.last.x, 5);
+    EXPECT_EQ(box.first.y, 1);
+    EXPECT_EQ(box.last.y, 3);
+    EXPECT_EQ(box.first.z, 0);
+    EXPECT_EQ(box.last.z, 0);
+
+    // the cut-outs of 3 x 8 grid points starting at x = 0, 3, 6
+    Acquisition::Coordinates<ValueType> modelCoordinates(3, NY, NZ, 1.0);
+    Acquisition::coordinate3D cutCoordinate;
+    cutCoordinate.y = 0;
+    cutCoordinate.z = 0;
+    cutCoordinate.x = 0;
+    EXPECT_TRUE(ModelPerShotCache<ValueType>::intersects(box, cutCoordinate, modelCoordinates));
+    cutCoordinate.x = 3;
+    EXPECT_TRUE(ModelPerShotCache<ValueType>::intersects(box, cutCoordinate, modelCoordinates));
+    cutCoordinate.x = 6;
+    EXPECT_FALSE(ModelPerShotCache<ValueType>::intersects(box, cutCoordinate, modelCoordinates));
+
+    ModelPerShotCache<ValueType>::Box emptyBox;
+    emptyBox.first.x = 1;
+    emptyBox.last.x = 0;
+    cutCoordinate.x = 0;
+    EXPECT_FALSE(ModelPerShotCache<ValueType>::intersects(emptyBox, cutCoordinate, modelCoordinates));
+    ModelPerShotCache<ValueType>::Box unitedBox = ModelPerShotCache<ValueType>::unite(emptyBox, box);
+    EXPECT_EQ(unitedBox.first.x, box.first.x);
+    EXPECT_EQ(unitedBox.last.y, box.last.y);
+}
+
+/* Cut the model of a shot out of the big model and prepare it for the modelling like InversionSingle::prepareModelPerShot */
+typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr prepareModelPerShot(Configuration::Configuration const &config, Modelparameter::Modelparameter<ValueType> &modelBig, Acquisition::Coordinates<ValueType> const &modelCoordinates, Acquisition::Coordinates<ValueType> const &modelCoordinatesBig, Acquisition::coordinate3D cutCoordinate, dmemo::DistributionPtr dist, hmemo::ContextPtr ctx)
+{
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShot(Modelparameter::Factory<ValueType>::Create("acoustic"));
+    modelPerShot->prepareForInversion(config, dist->getCommunicatorPtr());
+    modelBig.getModelPerShot(*modelPerShot, dist, modelCoordinates, modelCoordinatesBig, cutCoordinate);
+    modelPerShot->prepareForModelling(modelCoordinates, ctx, dist, dist->getCommunicatorPtr());
+    return modelPerShot;
+}
+
+/* Forward modelling of the shot of the test configuration, returns the pressure seismogram */
+lama::DenseMatrix<ValueType> runForward(Configuration::Configuration const &config, Modelparameter::Modelparameter<ValueType> &modelPerShot, Acquisition::Coordinates<ValueType> const &modelCoordinates, dmemo::DistributionPtr dist, hmemo::ContextPtr ctx)
+{
+    ValueType DT = config.get<ValueType>("DT");
+    IndexType tStepEnd = static_cast<IndexType>((config.get<ValueType>("T") / DT) + 0.5);
+
+    typename ForwardSolver::Derivatives::Derivatives<ValueType>::DerivativesPtr derivatives(ForwardSolver::Derivatives::Factory<ValueType>::Create("2D"));
+    derivatives->init(dist, ctx, config, modelCoordinates, dist->getCommunicatorPtr());
+    typename Wavefields::Wavefields<ValueType>::WavefieldPtr wavefields(Wavefields::Factory<ValueType>::Create("2D", "acoustic"));
+    wavefields->init(ctx, dist, 0);
+    typename ForwardSolver::ForwardSolver<ValueType>::ForwardSolverPtr solver(ForwardSolver::Factory<ValueType>::Create("2D", "acoustic"));
+    solver->initForwardSolver(config, *derivatives, *wavefields, modelPerShot, modelCoordinates, ctx, DT);
+    solver->prepareForModelling(modelPerShot, DT);
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettings;
+    Acquisition::readAllSettings<ValueType>(sourceSettings, config.get<std::string>("SourceFilename") + ".txt");
+    Acquisition::Sources<ValueType> sources;
+    sources.init(sourceSettings, config, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(config, modelCoordinates, ctx, dist);
+
+    wavefields->resetWavefields();
+    for (IndexType tStep = 0; tStep < tStepEnd; tStep++) {
+        solver->run(receivers, sources, modelPerShot, *wavefields, *derivatives, tStep);
+    }
+    solver->resetCPML();
+    return receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+}
+
+TEST(ModelPerShotCacheTest, TestSeismogramsWithCache)
+{
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testModelPerShotCache_config.txt");
+    IndexType NX = testConfig.get<IndexType>("NX");
+    IndexType NY = testConfig.get<IndexType>("NY");
+    ValueType DH = testConfig.get<ValueType>("DH");
+
+    // three cut-outs of NX x NY grid points side by side in the big model
+    Acquisition::Coordinates<ValueType> modelCoordinates(NX, NY, 1, DH);
+    Acquisition::Coordinates<ValueType> modelCoordinatesBig(3 * NX, NY, 1, DH);
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(NX * NY));
+    dmemo::DistributionPtr distBig(new dmemo::NoDistribution(3 * NX * NY));
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelBig(Modelparameter::Factory<ValueType>::Create("acoustic"));
+    modelBig->prepareForInversion(testConfig, distBig->getCommunicatorPtr());
+    modelBig->init(testConfig, ctx, distBig, modelCoordinatesBig);
+
+    std::vector<Acquisition::coordinate3D> cutCoordinates(3);
+    for (IndexType shotInd = 0; shotInd < 3; shotInd++) {
+        cutCoordinates[shotInd].x = shotInd * NX;
+        cutCoordinates[shotInd].y = 0;
+        cutCoordinates[shotInd].z = 0;
+    }
+
+    ModelPerShotCache<ValueType> cache;
+    cache.init(testConfig, "acoustic");
+    ASSERT_TRUE(cache.isActive());
+    cache.update(*modelBig, modelCoordinatesBig);
+    for (IndexType shotInd = 0; shotInd < 3; shotInd++) {
+        cache.store(shotInd, prepareModelPerShot(testConfig, *modelBig, modelCoordinates, modelCoordinatesBig, cutCoordinates[shotInd], dist, ctx), cutCoordinates[shotInd], modelCoordinates, 0.0);
+    }
+
+    // local changes of the velocity in the first and of the density in the last cut-out keep the cut-out in between
+    lama::DenseVector<ValueType> velocityP = modelBig->getVelocityP();
+    velocityP.setValue(modelCoordinatesBig.coordinate2index(5, 15, 0), 2500.0);
+    modelBig->setVelocityP(velocityP);
+    lama::DenseVector<ValueType> density = modelBig->getDensity();
+    density.setValue(modelCoordinatesBig.coordinate2index(2 * NX + 5, 15, 0), 2500.0);
+    modelBig->setDensity(density);
+    cache.update(*modelBig, modelCoordinatesBig);
+    EXPECT_FALSE(cache.find(0));
+    EXPECT_FALSE(cache.find(2));
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShotCached = cache.find(1);
+    ASSERT_TRUE(modelPerShotCached);
+
+    // the seismograms of the cached model are identical to the ones of a new cut-out
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr modelPerShot = prepareModelPerShot(testConfig, *modelBig, modelCoordinates, modelCoordinatesBig, cutCoordinates[1], dist, ctx);
+    lama::DenseMatrix<ValueType> seismogramCached = runForward(testConfig, *modelPerShotCached, modelCoordinates, dist, ctx);
+    lama::DenseMatrix<ValueType> seismogram = runForward(testConfig, *modelPerShot, modelCoordinates, dist, ctx);
+    ASSERT_GT(seismogram.maxNorm(), 0.0);
+    lama::DenseMatrix<ValueType> difference;
+    difference = seismogramCached - seismogram;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+
+    // the removed cut-out is prepared again with the changed velocity
+    modelPerShot = prepareModelPerShot(testConfig, *modelBig, modelCoordinates, modelCoordinatesBig, cutCoordinates[0], dist, ctx);
+    cache.store(0, modelPerShot, cutCoordinates[0], modelCoordinates, 0.0);
+    EXPECT_EQ(cache.find(0), modelPerShot);
+    EXPECT_EQ(modelPerShot->getVelocityP().max(), 2500.0);
+}
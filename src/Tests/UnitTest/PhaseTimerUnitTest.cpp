@@ -0,0 +1,93 @@
+#include <scai/common/Walltime.hpp>
+#include <scai/dmemo/Communicator.hpp>
+
+#include "PhaseTimer.hpp"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+using namespace scai;
+using namespace KITGPI;
+
+void busyWait(double seconds)
+{
+    double start_t = common::Walltime::get();
+    while (common::Walltime::get() - start_t < seconds) {
+    }
+}
+
+TEST(PhaseTimerTest, TestReport)
+{
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    dmemo::CommunicatorPtr commShot = commAll;
+    dmemo::CommunicatorPtr commInterShot = commAll->split(commShot->getRank());
+
+    PhaseTimer::setEnabled(false);
+    {
+        PhaseTimer::Scope timer("disabled");
+    }
+    EXPECT_EQ(PhaseTimer::getCalls("disabled"), 0);
+
+    PhaseTimer::setEnabled(true);
+    for (int shot = 0; shot < 3; shot++) {
+        PhaseTimer::Scope timer("calcGradient");
+        {
+            PhaseTimer::Scope timerForward("forward");
+            busyWait(0.002);
+        }
+        {
+            PhaseTimer::Scope timerAdjoint("adjoint");
+            for (int tStep = 0; tStep < 2; tStep++) {
+                PhaseTimer::Scope timerXcorr("xcorr");
+                busyWait(0.001);
+            }
+        }
+    }
+    EXPECT_EQ(PhaseTimer::getCalls("calcGradient"), 3);
+    EXPECT_EQ(PhaseTimer::getCalls("calcGradient/adjoint/xcorr"), 6);
+
+    std::string filename = "phaseTimerUnitTest";
+    PhaseTimer::writeReport(commAll, commShot, commInterShot, filename, 1, 1);
+    PhaseTimer::setEnabled(false);
+    EXPECT_EQ(PhaseTimer::getTime("calcGradient"), 0.0);
+
+    if (commAll->getRank() != 0)
+        return;
+
+    std::ifstream inputFile(filename + ".stage_1.It_1.json");
+    ASSERT_TRUE(inputFile.good());
+    std::stringstream buffer;
+    buffer << inputFile.rdbuf();
+    std::string report = buffer.str();
+
+    std::regex phaseRegex("\\{\"name\": \"([^\"]*)\", \"parent\": \"([^\"]*)\", \"calls\": ([0-9]+), \"process\": \\{\"min\": ([^,]+), \"mean\": ([^,]+), \"max\": ([^}]+)\\}, \"shotDomain\": \\{\"min\": ([^,]+), \"mean\": ([^,]+), \"max\": ([^}]+)\\}\\}");
+    std::map<std::string, double> meanTime;
+    std::map<std::string, double> childSum;
+    std::map<std::string, int> calls;
+    for (std::sregex_iterator it(report.begin(), report.end(), phaseRegex); it != std::sregex_iterator(); ++it) {
+        std::smatch match = *it;
+        double processMin = std::stod(match[4]);
+        double processMean = std::stod(match[5]);
+        double processMax = std::stod(match[6]);
+        EXPECT_LE(processMin, processMean);
+        EXPECT_LE(processMean, processMax);
+        meanTime[match[1]] = processMean;
+        calls[match[1]] = std::stoi(match[3]);
+        if (match[2].length() > 0)
+            childSum[match[2]] += processMean;
+    }
+
+    ASSERT_EQ(meanTime.size(), 4u);
+    EXPECT_EQ(calls["calcGradient"], 3);
+    EXPECT_EQ(calls["calcGradient/forward"], 3);
+    EXPECT_EQ(calls["calcGradient/adjoint/xcorr"], 6);
+    EXPECT_GE(meanTime["calcGradient/forward"], 0.006);
+    // the time of a phase includes the time of its children
+    for (auto const &parent : childSum) {
+        EXPECT_GE(meanTime[parent.first] * (1 + 1e-5), parent.second);
+    }
+    EXPECT_EQ(report.find("disabled"), std::string::npos);
+}
@@ -0,0 +1,36 @@
+#include "../../Misfit/MisfitFactory.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(ReflectSourcesTest, TestTimeStepsMatchAllTimeSteps)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testForwardHistory_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+    Acquisition::Receivers<ValueType> sourcesReflect;
+    sourcesReflect.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &data = sourcesReflect.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    data.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    Acquisition::Receivers<ValueType> sourcesReflectPerStep;
+    sourcesReflectPerStep.init(testConfig, modelCoordinates, ctx, dist);
+    sourcesReflectPerStep.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    lama::DenseVector<ValueType> reflectivity = lama::linearDenseVector<ValueType>(data.getRowDistributionPtr(), -0.3, 0.07);
+
+    // the single pass of the adjoint wavefields scales the samples of every time step when they are gathered
+    typename Misfit::Misfit<ValueType>::MisfitPtr misfit(Misfit::Factory<ValueType>::Create("l2"));
+    misfit->calcReflectSources(sourcesReflect, reflectivity);
+    for (IndexType tStep = data.getNumColumns() - 1; tStep >= 0; tStep--) {
+        misfit->calcReflectSources(sourcesReflectPerStep, reflectivity, tStep);
+    }
+    lama::DenseMatrix<ValueType> difference;
+    difference = sourcesReflect.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData() - sourcesReflectPerStep.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+    EXPECT_GT(data.maxNorm(), 0.0);
+}
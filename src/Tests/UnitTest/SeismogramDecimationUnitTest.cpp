@@ -0,0 +1,142 @@
+#include "../../Common/SeismogramDecimation.hpp"
+#include "../../Common/TimeWindow.hpp"
+#include "../../Misfit/MisfitFactory.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+/* Ricker wavelets with the peak frequency fp, trace i is delayed by i * delayPerTrace and scaled by amplitude */
+void fillRicker(lama::DenseMatrix<ValueType> &data, ValueType DT, ValueType fp, ValueType delayPerTrace, ValueType amplitude)
+{
+    for (IndexType iRow = 0; iRow < data.getNumRows(); iRow++) {
+        ValueType t0 = 0.2 + iRow * delayPerTrace;
+        for (IndexType tStep = 0; tStep < data.getNumColumns(); tStep++) {
+            ValueType tau = M_PI * fp * (tStep * DT - t0);
+            data.setValue(iRow, tStep, amplitude * (1 - 2 * tau * tau) * std::exp(-tau * tau));
+        }
+    }
+}
+
+TEST(SeismogramDecimationTest, TestDecimateInterpolate)
+{
+    IndexType nt = 500;
+    ValueType DT = 1e-3;
+    IndexType factor = SeismogramDecimation<ValueType>::calcFactor(DT, 10, 2, nt);
+    // Nyquist frequency of 500 Hz / factor >= 20 Hz
+    EXPECT_EQ(factor, 16);
+    EXPECT_EQ(SeismogramDecimation<ValueType>::calcFactor(DT, 0, 2, nt), 1);
+    EXPECT_EQ(SeismogramDecimation<ValueType>::calcFactor(DT, 200, 2, nt), 1);
+
+    lama::DenseMatrix<ValueType> data(std::make_shared<dmemo::NoDistribution>(5), std::make_shared<dmemo::NoDistribution>(nt));
+    fillRicker(data, DT, 5, 0.02, 1);
+
+    lama::DenseMatrix<ValueType> dataDecimated;
+    SeismogramDecimation<ValueType>::decimateTraces(data, dataDecimated, factor);
+    ASSERT_EQ(dataDecimated.getNumColumns(), (nt + factor - 1) / factor);
+    for (IndexType iRow = 0; iRow < data.getNumRows(); iRow++) {
+        for (IndexType tStep = 0; tStep < dataDecimated.getNumColumns(); tStep++) {
+            EXPECT_NEAR(dataDecimated.getValue(iRow, tStep), data.getValue(iRow, tStep * factor), 1e-3);
+        }
+    }
+
+    // a band-limited trace is recovered by the interpolation, the wavelets are truncated at the ends of the traces
+    lama::DenseMatrix<ValueType> dataInterpolated;
+    SeismogramDecimation<ValueType>::interpolateTraces(dataDecimated, dataInterpolated, nt, factor);
+    lama::DenseMatrix<ValueType> difference;
+    difference = data - dataInterpolated;
+    EXPECT_LT(difference.maxNorm(), 1e-3 * data.maxNorm());
+}
+
+TEST(SeismogramDecimationTest, TestAdjointSourcesMatchDT)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    IndexType seedtime = 0;
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSeismogramDecimation_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+    ValueType DT = testConfig.get<ValueType>("DT");
+
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> adjointSources;
+    adjointSources.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> adjointSourcesDecimated;
+    adjointSourcesDecimated.init(testConfig, modelCoordinates, ctx, dist);
+
+    lama::DenseMatrix<ValueType> &dataSyn = receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    lama::DenseMatrix<ValueType> &dataObs = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    IndexType nt = static_cast<IndexType>((testConfig.get<ValueType>("T") / DT) + 0.5);
+    dataSyn.allocate(dataSyn.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(nt));
+    dataObs.allocate(dataObs.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(nt));
+    fillRicker(dataSyn, DT, 5, 0.004, 1);
+    fillRicker(dataObs, DT, 5, 0.005, 0.8);
+
+    typename Misfit::Misfit<ValueType>::MisfitPtr misfit(Misfit::Factory<ValueType>::Create("l2"));
+    misfit->init(testConfig, std::vector<IndexType>(), 1, 0, 1500, seedtime);
+    ValueType misfitRef = misfit->calc(receivers, receiversTrue, 0);
+    misfit->calcAdjointSources(adjointSources, receivers, receiversTrue, 0);
+
+    SeismogramDecimation<ValueType> seismogramDecimation;
+    seismogramDecimation.init(testConfig);
+    EXPECT_TRUE(seismogramDecimation.setStage(10));
+    ASSERT_TRUE(seismogramDecimation.isActive());
+    EXPECT_EQ(seismogramDecimation.getFactor(), 16);
+
+    typename Misfit::Misfit<ValueType>::MisfitPtr misfitDecimated(Misfit::Factory<ValueType>::Create("l2"));
+    misfitDecimated->init(testConfig, std::vector<IndexType>(), 1, 0, 1500, seedtime);
+    misfitDecimated->setSeismogramDecimation(&seismogramDecimation);
+    ValueType misfitDecimatedValue = misfitDecimated->calc(receivers, receiversTrue, 0);
+    misfitDecimated->calcAdjointSources(adjointSourcesDecimated, receivers, receiversTrue, 0);
+
+    EXPECT_GT(misfitRef, 0.0);
+    EXPECT_NEAR(misfitDecimatedValue, misfitRef, 1e-3 * misfitRef);
+
+    lama::DenseMatrix<ValueType> const &adjoint = adjointSources.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    lama::DenseMatrix<ValueType> const &adjointDecimated = adjointSourcesDecimated.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    ASSERT_EQ(adjointDecimated.getNumColumns(), nt);
+    lama::DenseMatrix<ValueType> difference;
+    difference = adjoint - adjointDecimated;
+    EXPECT_LT(difference.maxNorm(), 1e-3 * adjoint.maxNorm());
+}
+
+TEST(SeismogramDecimationTest, TestTaperedAdjointSourcesWithTimeWindow)
+{
+    IndexType nt = 500;
+    IndexType lastTaperSample = 300;
+    ValueType DT = 1e-3;
+    IndexType factor = SeismogramDecimation<ValueType>::calcFactor(DT, 10, 2, nt);
+
+    // residual of tapered synthetic and observed data, the seismogram taper mutes the samples after lastTaperSample
+    lama::DenseMatrix<ValueType> residual(std::make_shared<dmemo::NoDistribution>(5), std::make_shared<dmemo::NoDistribution>(nt));
+    fillRicker(residual, DT, 5, 0.02, 1);
+    lama::DenseMatrix<ValueType> taper(residual.getRowDistributionPtr(), residual.getColDistributionPtr());
+    for (IndexType iRow = 0; iRow < taper.getNumRows(); iRow++) {
+        for (IndexType tStep = 0; tStep <= lastTaperSample; tStep++) {
+            taper.setValue(iRow, tStep, 1.0);
+        }
+    }
+    residual.binaryOp(residual, common::BinaryOp::MULT, taper);
+    IndexType tStepForwardEnd = TimeWindow<ValueType>::calcForwardEnd(TimeWindow<ValueType>::calcLastNonZeroSample(taper), nt);
+    ASSERT_LT(tStepForwardEnd, nt);
+
+    // the interpolated adjoint sources reach beyond the forward modelling of the time window
+    lama::DenseMatrix<ValueType> residualDecimated;
+    lama::DenseMatrix<ValueType> adjointSources;
+    SeismogramDecimation<ValueType>::decimateTraces(residual, residualDecimated, factor);
+    SeismogramDecimation<ValueType>::interpolateTraces(residualDecimated, adjointSources, nt, factor);
+    EXPECT_GE(TimeWindow<ValueType>::calcAdjointStart(TimeWindow<ValueType>::calcLastNonZeroSample(adjointSources), nt), tStepForwardEnd);
+
+    // the seismogram taper of the adjoint sources keeps them within the forward modelling
+    adjointSources.binaryOp(adjointSources, common::BinaryOp::MULT, taper);
+    EXPECT_LT(TimeWindow<ValueType>::calcAdjointStart(TimeWindow<ValueType>::calcLastNonZeroSample(adjointSources), nt), tStepForwardEnd);
+}
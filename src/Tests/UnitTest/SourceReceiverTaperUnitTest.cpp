@@ -0,0 +1,94 @@
+#include "../../Preconditioning/SourceReceiverTaper.hpp"
+#include "../../Preconditioning/SourceReceiverTaperCache.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(SourceReceiverTaperTest, TestIdenticalTaper)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceReceiverTaper_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    // a dense and a sparse receiver line
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    auto receivers1DCoordinates = receivers.get1DCoordinates();
+    receivers1DCoordinates.replicate();
+
+    for (IndexType radius : {2, 5, 12}) {
+        Preconditioning::SourceReceiverTaper<ValueType> receiverTaper;
+        receiverTaper.init(dist, ctx, receivers, testConfig, modelCoordinates, radius);
+        lama::DenseVector<ValueType> taper;
+        taper = receiverTaper.getTaper();
+
+        // logarithmic taper of the nearest receiver, calculated for all receivers
+        for (IndexType index = 0; index < modelCoordinates.getNGridpoints(); index++) {
+            Acquisition::coordinate3D coord = modelCoordinates.index2coordinate(index);
+            ValueType value = 1;
+            for (IndexType iReceiver = 0; iReceiver < receivers1DCoordinates.size(); iReceiver++) {
+                Acquisition::coordinate3D centerCoord = modelCoordinates.index2coordinate(receivers1DCoordinates.getValue(iReceiver));
+                ValueType distance = std::sqrt(ValueType((centerCoord.x - coord.x) * (centerCoord.x - coord.x) + (centerCoord.y - coord.y) * (centerCoord.y - coord.y)));
+                if (distance < 1) {
+                    value = 0;
+                } else if (distance <= radius) {
+                    value = std::min(value, ValueType(std::log(distance) / std::log(radius)));
+                }
+            }
+            ASSERT_EQ(taper.getValue(index), value) << "radius " << radius << ", grid point " << index;
+        }
+    }
+}
+
+TEST(SourceReceiverTaperTest, TestCache)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceReceiverTaper_config.txt");
+
+    Preconditioning::SourceReceiverTaperCache<ValueType> cache;
+    cache.init(testConfig);
+    ASSERT_TRUE(cache.isActive());
+
+    lama::SparseVector<ValueType> taper;
+    taper.setSameValue(dist, 1.0);
+    taper.setValue(17, 0.5);
+    std::vector<lama::SparseVector<ValueType>> taperEncode(2, taper);
+    std::vector<IndexType> key = Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(3, Preconditioning::SourceReceiverTaperCache<ValueType>::SHOT);
+
+    lama::SparseVector<ValueType> taperRestored;
+    std::vector<lama::SparseVector<ValueType>> taperEncodeRestored;
+    EXPECT_FALSE(cache.restore(key, taperRestored, taperEncodeRestored));
+    cache.store(key, taper, taperEncode);
+    EXPECT_TRUE(cache.restore(key, taperRestored, taperEncodeRestored));
+    EXPECT_EQ(taperRestored.getValue(17), 0.5);
+    EXPECT_EQ(taperRestored.getValue(18), 1.0);
+    EXPECT_EQ(taperEncodeRestored.size(), 2);
+    EXPECT_EQ(cache.getNumHits(), 1);
+
+    // a constituent shot of a supershot and another encoding of a supershot are different entries
+    EXPECT_FALSE(cache.restore(Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(3, Preconditioning::SourceReceiverTaperCache<ValueType>::CONSTITUENT), taperRestored, taperEncodeRestored));
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettingsEncode(2);
+    sourceSettingsEncode[0].sourceNo = 1;
+    sourceSettingsEncode[0].row = 0;
+    sourceSettingsEncode[1].sourceNo = -1;
+    sourceSettingsEncode[1].row = 1;
+    std::vector<IndexType> keyEncode = Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(sourceSettingsEncode, 1);
+    sourceSettingsEncode[1].sourceNo = 1;
+    EXPECT_NE(keyEncode, Preconditioning::SourceReceiverTaperCache<ValueType>::getKey(sourceSettingsEncode, 1));
+
+    // no taper is added beyond the memory limit (1 MB)
+    lama::DenseVector<ValueType> taperDense(std::make_shared<dmemo::NoDistribution>(100000), 0.5);
+    lama::SparseVector<ValueType> taperLarge(taperDense);
+    cache.store(keyEncode, taperLarge, std::vector<lama::SparseVector<ValueType>>());
+    EXPECT_FALSE(cache.restore(keyEncode, taperRestored, taperEncodeRestored));
+    EXPECT_LT(cache.getMemory(), 1.0);
+}
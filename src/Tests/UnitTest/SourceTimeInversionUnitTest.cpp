@@ -52,3 +52,139 @@ TEST(SourceTimeInversionTest, TestSourceEstimation)
     sourceSignalRef -= sourceSignalInv;
     EXPECT_LT(sourceSignalRef.l2Norm(), 0.4);
 }
+
+/* Delay a signal by two samples per trace, i.e. a wave propagation with pure delays as Green's functions */
+void delayTraces(lama::DenseMatrix<ValueType> &data, lama::DenseVector<ValueType> const &signal)
+{
+    IndexType NT = signal.size();
+    for (IndexType ir = 0; ir < data.getNumRows(); ir++) {
+        lama::DenseVector<ValueType> trace(NT, 0.0);
+        for (IndexType it = 2 * ir; it < NT; it++) {
+            trace.setValue(it, signal.getValue(it - 2 * ir));
+        }
+        data.setRow(trace, ir, common::BinaryOp::COPY);
+    }
+}
+
+TEST(SourceTimeInversionTest, TestSourceEstimationSingleSolve)
+{
+    SourceEstimation<ValueType> sourceEst;
+
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceTimeInversion_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettings;
+    Acquisition::readAllSettings<ValueType>(sourceSettings, testConfig.get<std::string>("SourceFilename") + ".txt");
+    Acquisition::Sources<ValueType> sources;
+    sources.init(sourceSettings, testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &sourcesData = sources.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    sourcesData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_sourceSignal.mtx");
+
+    lama::DenseMatrix<ValueType> trueSignalData;
+    trueSignalData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_referenceSourceSignal.mtx");
+    lama::DenseVector<ValueType> sourceSignal;
+    lama::DenseVector<ValueType> trueSignal;
+    sourcesData.getRow(sourceSignal, 0);
+    trueSignalData.getRow(trueSignal, 0);
+
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &receiversData = receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    receiversData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    delayTraces(receiversData, sourceSignal);
+
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &receiversTrueData = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    receiversTrueData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    delayTraces(receiversTrueData, trueSignal);
+
+    sourceEst.init(500, sources.get1DCoordinates().getDistributionPtr(), 1.0e-10);
+    sourceEst.estimateSourceSignal(receivers, receiversTrue, 0, 0);
+
+    // two solves: filter the source and propagate it again
+    sourceEst.applyFilter(sources, 0, sourceSettings);
+    lama::DenseVector<ValueType> sourceSignalInv;
+    sourcesData.getRow(sourceSignalInv, 0);
+    lama::DenseMatrix<ValueType> synTwoSolves(receiversData);
+    delayTraces(synTwoSolves, sourceSignalInv);
+
+    // single solve: filter the synthetics of the uncorrected source
+    Acquisition::Receivers<ValueType> receiversSingleSolve = receivers;
+    sourceEst.applyFilter(receiversSingleSolve, 0);
+    lama::DenseMatrix<ValueType> synSingleSolve = receiversSingleSolve.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+
+    lama::DenseMatrix<ValueType> residualTwoSolves(synTwoSolves);
+    residualTwoSolves -= receiversTrueData;
+    lama::DenseMatrix<ValueType> residualSingleSolve(synSingleSolve);
+    residualSingleSolve -= receiversTrueData;
+    ValueType misfitTwoSolves = 0.5 * residualTwoSolves.l2Norm();
+    ValueType misfitSingleSolve = 0.5 * residualSingleSolve.l2Norm();
+
+    synSingleSolve -= synTwoSolves;
+    EXPECT_LT(synSingleSolve.l2Norm() / synTwoSolves.l2Norm(), 0.05);
+    EXPECT_NEAR(misfitSingleSolve, misfitTwoSolves, 0.05 * synTwoSolves.l2Norm());
+}
+
+TEST(SourceTimeInversionTest, TestSingleSolveEstimateMatchesDedicatedSolve)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testSourceTimeInversion_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    std::vector<Acquisition::sourceSettings<ValueType>> sourceSettings;
+    Acquisition::readAllSettings<ValueType>(sourceSettings, testConfig.get<std::string>("SourceFilename") + ".txt");
+    Acquisition::Sources<ValueType> sourcesDedicated;
+    sourcesDedicated.init(sourceSettings, testConfig, modelCoordinates, ctx, dist);
+    sourcesDedicated.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_sourceSignal.mtx");
+    Acquisition::Sources<ValueType> sourcesSingleSolve;
+    sourcesSingleSolve.init(sourceSettings, testConfig, modelCoordinates, ctx, dist);
+    sourcesSingleSolve.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_sourceSignal.mtx");
+    lama::DenseVector<ValueType> sourceSignal;
+    sourcesDedicated.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().getRow(sourceSignal, 0);
+
+    lama::DenseMatrix<ValueType> trueSignalData;
+    trueSignalData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_referenceSourceSignal.mtx");
+    lama::DenseVector<ValueType> trueSignal;
+    trueSignalData.getRow(trueSignal, 0);
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &receiversTrueData = receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    receiversTrueData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    delayTraces(receiversTrueData, trueSignal);
+
+    // dedicated solve: an extra forward run of the uncorrected source before the regular forward run
+    Acquisition::Receivers<ValueType> receiversDedicated;
+    receiversDedicated.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &receiversDedicatedData = receiversDedicated.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    receiversDedicatedData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    delayTraces(receiversDedicatedData, sourceSignal);
+    SourceEstimation<ValueType> sourceEstDedicated;
+    sourceEstDedicated.init(500, sourcesDedicated.get1DCoordinates().getDistributionPtr(), 1.0e-10);
+    sourceEstDedicated.estimateSourceSignal(receiversDedicated, receiversTrue, 0, 0);
+    sourceEstDedicated.applyFilter(sourcesDedicated, 0, sourceSettings);
+
+    // single solve: the receivers of the regular forward run of the uncorrected source
+    Acquisition::Receivers<ValueType> receiversForward;
+    receiversForward.init(testConfig, modelCoordinates, ctx, dist);
+    lama::DenseMatrix<ValueType> &receiversForwardData = receiversForward.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    receiversForwardData.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    delayTraces(receiversForwardData, sourceSignal);
+    Acquisition::Receivers<ValueType> receiversTrueSourceEst = receiversTrue;
+    SourceEstimation<ValueType> sourceEstSingleSolve;
+    sourceEstSingleSolve.init(500, sourcesSingleSolve.get1DCoordinates().getDistributionPtr(), 1.0e-10);
+    sourceEstSingleSolve.estimateSourceSignal(receiversForward, receiversTrueSourceEst, 0, 0);
+    sourceEstSingleSolve.applyFilter(sourcesSingleSolve, 0, sourceSettings);
+
+    // both paths estimate the same Wiener filter from the same data
+    lama::DenseMatrix<ValueType> const &sourceDedicated = sourcesDedicated.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    lama::DenseMatrix<ValueType> difference(sourcesSingleSolve.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData());
+    difference -= sourceDedicated;
+    EXPECT_GT(sourceDedicated.l2Norm(), 0.0);
+    EXPECT_LT(difference.l2Norm(), 1e-10 * sourceDedicated.l2Norm());
+}
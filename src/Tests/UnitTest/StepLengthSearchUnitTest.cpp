@@ -34,3 +34,74 @@ EXPECT_ANY_THROW(SLsearch.parabolicFit(xValues,testValues));
 }
 
 
+TEST(StepLengthSearchTest, TestSubspaceFit)
+{
+    // data perturbations of three search directions, the first two directions are coupled
+    IndexType numDirections = 3;
+    IndexType numSamples = 40;
+    std::vector<std::vector<ValueType>> perturbations(numDirections, std::vector<ValueType>(numSamples));
+    for (IndexType k = 0; k < numSamples; k++) {
+        perturbations[0][k] = sin(0.3 * k);
+        perturbations[1][k] = sin(0.3 * k) + 0.5 * cos(0.7 * k);
+        perturbations[2][k] = cos(0.2 * k + 0.4);
+    }
+    // the data residual is a combination of the perturbations, i.e. the misfit is a quadratic function of the coefficients
+    std::vector<ValueType> solution{0.8, -0.3, 1.5};
+    std::vector<ValueType> residual(numSamples, 0);
+    for (IndexType i = 0; i < numDirections; i++) {
+        for (IndexType k = 0; k < numSamples; k++) {
+            residual[k] += solution[i] * perturbations[i][k];
+        }
+    }
+
+    lama::DenseMatrix<ValueType> matrix(numDirections, numDirections);
+    lama::DenseVector<ValueType> rightHandSide(numDirections, 0);
+    for (IndexType i = 0; i < numDirections; i++) {
+        ValueType product = 0;
+        for (IndexType k = 0; k < numSamples; k++) {
+            product += residual[k] * perturbations[i][k];
+        }
+        rightHandSide.setValue(i, product);
+        for (IndexType j = 0; j < numDirections; j++) {
+            product = 0;
+            for (IndexType k = 0; k < numSamples; k++) {
+                product += perturbations[i][k] * perturbations[j][k];
+            }
+            matrix.setValue(i, j, product);
+        }
+    }
+
+    lama::DenseVector<ValueType> coefficients;
+    EXPECT_TRUE(StepLengthSearch<ValueType>::subspaceFit(matrix, rightHandSide, coefficients));
+    for (IndexType i = 0; i < numDirections; i++) {
+        EXPECT_NEAR(solution[i], coefficients.getValue(i), 1e-10);
+    }
+
+    // the separate line fits of the coupled directions are worse than the subspace fit
+    auto misfit = [&](std::vector<ValueType> const &c) {
+        ValueType value = 0;
+        for (IndexType i = 0; i < numDirections; i++) {
+            value -= c[i] * rightHandSide.getValue(i);
+            for (IndexType j = 0; j < numDirections; j++) {
+                value += 0.5 * c[i] * matrix.getValue(i, j) * c[j];
+            }
+        }
+        return value;
+    };
+    std::vector<ValueType> lineFit(numDirections);
+    for (IndexType i = 0; i < numDirections; i++) {
+        lineFit[i] = rightHandSide.getValue(i) / matrix.getValue(i, i);
+    }
+    EXPECT_LT(misfit(solution), misfit(lineFit));
+
+    // linearly dependent directions fall back to the line fit of each direction
+    for (IndexType j = 0; j < numDirections; j++) {
+        matrix.setValue(1, j, matrix.getValue(0, j));
+        matrix.setValue(j, 1, matrix.getValue(j, 0));
+    }
+    rightHandSide.setValue(1, rightHandSide.getValue(0));
+    EXPECT_FALSE(StepLengthSearch<ValueType>::subspaceFit(matrix, rightHandSide, coefficients));
+    for (IndexType i = 0; i < numDirections; i++) {
+        EXPECT_DOUBLE_EQ(rightHandSide.getValue(i) / matrix.getValue(i, i), coefficients.getValue(i));
+    }
+}
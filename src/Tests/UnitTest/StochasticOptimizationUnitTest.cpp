@@ -0,0 +1,161 @@
+#include "../../Optimization/Adam.hpp"
+#include "../../Optimization/Nesterov.hpp"
+#include "../../Optimization/SVRG.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+/* Noisy quadratic: the misfit of shot i is 0.5 * sum_k a_k (x_k - c_k - b_ik)^2, the noise b_i of the shots sums up to zero, so the minimum of the sum of all shots is c */
+class NoisyQuadratic
+{
+  public:
+    NoisyQuadratic() : numShots(6), dist(new dmemo::NoDistribution(4))
+    {
+        std::vector<ValueType> curvatureValues{1, 2, 4, 8};
+        std::vector<ValueType> minimumValues{1, -2, 0.5, 3};
+        curvature.setSameValue(dist, 0);
+        minimum.setSameValue(dist, 0);
+        for (IndexType k = 0; k < 4; k++) {
+            curvature.setValue(k, curvatureValues[k]);
+            minimum.setValue(k, minimumValues[k]);
+        }
+        noise.assign(numShots, lama::DenseVector<ValueType>());
+        for (IndexType i = 0; i < numShots; i++) {
+            noise[i].setSameValue(dist, 0);
+            for (IndexType k = 0; k < 4; k++) {
+                ValueType mean = 0;
+                for (IndexType j = 0; j < numShots; j++) {
+                    mean += 0.5 * ((3 * j + 5 * k) % 7) - 1.5;
+                }
+                noise[i].setValue(k, 0.5 * ((3 * i + 5 * k) % 7) - 1.5 - mean / numShots);
+            }
+        }
+    }
+
+    lama::DenseVector<ValueType> calcGradient(lama::DenseVector<ValueType> const &x, IndexType shotInd) const
+    {
+        lama::DenseVector<ValueType> gradient;
+        gradient = x - minimum;
+        gradient -= noise[shotInd];
+        gradient.binaryOp(gradient, common::BinaryOp::MULT, curvature);
+        return gradient;
+    }
+
+    ValueType calcError(lama::DenseVector<ValueType> const &x) const
+    {
+        lama::DenseVector<ValueType> difference;
+        difference = x - minimum;
+        return difference.maxNorm();
+    }
+
+    IndexType numShots;
+    dmemo::DistributionPtr dist;
+    lama::DenseVector<ValueType> curvature;
+    lama::DenseVector<ValueType> minimum;
+    std::vector<lama::DenseVector<ValueType>> noise;
+};
+
+TEST(StochasticOptimizationTest, TestNesterovDirection)
+{
+    NoisyQuadratic quadratic;
+    lama::DenseVector<ValueType> x(quadratic.dist, 0);
+    lama::DenseVector<ValueType> velocity(quadratic.dist, 0);
+    lama::DenseVector<ValueType> direction;
+    lama::DenseVector<ValueType> difference;
+
+    // without momentum the direction is the gradient
+    lama::DenseVector<ValueType> gradient0 = quadratic.calcGradient(x, 0);
+    Optimization::Nesterov<ValueType>::calcDirection(direction, velocity, gradient0, 0);
+    difference = direction - gradient0;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+
+    // the second direction looks ahead along the velocity g1 + 0.5 * (0.5 * g0 + g1)
+    velocity.setSameValue(quadratic.dist, 0);
+    lama::DenseVector<ValueType> gradient1 = quadratic.calcGradient(x, 1);
+    Optimization::Nesterov<ValueType>::calcDirection(direction, velocity, gradient0, 0.5);
+    Optimization::Nesterov<ValueType>::calcDirection(direction, velocity, gradient1, 0.5);
+    difference = direction - 1.5 * gradient1;
+    difference -= 0.25 * gradient0;
+    EXPECT_LT(difference.maxNorm(), 1e-12);
+
+    // mini-batches of one shot with a fixed step length approach the minimum
+    velocity.setSameValue(quadratic.dist, 0);
+    ValueType errorStart = quadratic.calcError(x);
+    for (IndexType iteration = 0; iteration < 300; iteration++) {
+        Optimization::Nesterov<ValueType>::calcDirection(direction, velocity, quadratic.calcGradient(x, iteration % quadratic.numShots), 0.5);
+        x -= 0.02 * direction;
+    }
+    EXPECT_LT(quadratic.calcError(x), 0.1 * errorStart);
+}
+
+TEST(StochasticOptimizationTest, TestAdamScalingPerCell)
+{
+    NoisyQuadratic quadratic;
+    lama::DenseVector<ValueType> firstMoment(quadratic.dist, 0);
+    lama::DenseVector<ValueType> secondMoment(quadratic.dist, 0);
+    lama::DenseVector<ValueType> direction;
+
+    // the first bias corrected step has the same size in all cells although the curvature differs by a factor of 8
+    lama::DenseVector<ValueType> gradient = quadratic.calcGradient(lama::DenseVector<ValueType>(quadratic.dist, 10), 0);
+    Optimization::Adam<ValueType>::calcDirection(direction, firstMoment, secondMoment, gradient, 0.9, 0.999, 1e-8, 1);
+    for (IndexType k = 0; k < 4; k++) {
+        EXPECT_NEAR(direction.getValue(k), 1.0, 1e-6);
+    }
+    secondMoment.setSameValue(quadratic.dist, 0);
+    Optimization::Adam<ValueType>::calcDirectionAdaGrad(direction, secondMoment, gradient, 1e-8);
+    for (IndexType k = 0; k < 4; k++) {
+        EXPECT_NEAR(direction.getValue(k), 1.0, 1e-6);
+    }
+
+    // mini-batches of one shot with a fixed step length end closer to the minimum than plain stochastic gradient descent
+    lama::DenseVector<ValueType> x(quadratic.dist, 0);
+    lama::DenseVector<ValueType> xAdaGrad(quadratic.dist, 0);
+    lama::DenseVector<ValueType> xDescent(quadratic.dist, 0);
+    firstMoment.setSameValue(quadratic.dist, 0);
+    secondMoment.setSameValue(quadratic.dist, 0);
+    lama::DenseVector<ValueType> secondMomentAdaGrad(quadratic.dist, 0);
+    for (IndexType iteration = 0; iteration < 300; iteration++) {
+        IndexType shotInd = iteration % quadratic.numShots;
+        Optimization::Adam<ValueType>::calcDirection(direction, firstMoment, secondMoment, quadratic.calcGradient(x, shotInd), 0.9, 0.999, 1e-3, iteration + 1);
+        x -= 0.05 * direction;
+        Optimization::Adam<ValueType>::calcDirectionAdaGrad(direction, secondMomentAdaGrad, quadratic.calcGradient(xAdaGrad, shotInd), 1e-3);
+        xAdaGrad -= 0.5 * direction;
+        xDescent -= 0.05 * quadratic.calcGradient(xDescent, shotInd);
+    }
+    EXPECT_LT(quadratic.calcError(x), 0.05);
+    EXPECT_LT(quadratic.calcError(xAdaGrad), 0.05);
+    EXPECT_GT(quadratic.calcError(xDescent), 0.1);
+}
+
+TEST(StochasticOptimizationTest, TestSVRGConvergence)
+{
+    NoisyQuadratic quadratic;
+    IndexType numShots = quadratic.numShots;
+    lama::DenseVector<ValueType> x(quadratic.dist, 0);
+    lama::DenseVector<ValueType> direction;
+    lama::DenseVector<ValueType> fullGradient;
+    std::vector<lama::DenseVector<ValueType>> snapshotGradients(numShots);
+
+    // the snapshot is refreshed every numShots iterations, in between the batch is one shot
+    for (IndexType iteration = 0; iteration < 300; iteration++) {
+        if (iteration % numShots == 0) {
+            fullGradient.setSameValue(quadratic.dist, 0);
+            for (IndexType shotInd = 0; shotInd < numShots; shotInd++) {
+                snapshotGradients[shotInd] = quadratic.calcGradient(x, shotInd);
+                fullGradient += snapshotGradients[shotInd];
+            }
+            direction = fullGradient;
+        } else {
+            IndexType shotInd = iteration % numShots;
+            lama::DenseVector<ValueType> gradientCorrected;
+            gradientCorrected = quadratic.calcGradient(x, shotInd) - snapshotGradients[shotInd];
+            Optimization::SVRG<ValueType>::calcDirection(direction, gradientCorrected, fullGradient, 1, numShots);
+        }
+        x -= 0.05 / numShots * direction;
+    }
+    // the variance of the direction vanishes at the minimum, so the fixed step length converges
+    EXPECT_LT(quadratic.calcError(x), 1e-5);
+}
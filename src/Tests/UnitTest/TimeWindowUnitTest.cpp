@@ -0,0 +1,83 @@
+#include "../../Common/TimeWindow.hpp"
+#include "GradientCalculationTestShot.hpp"
+#include <gtest/gtest.h>
+#include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(TimeWindowTest, TestLastNonZeroSample)
+{
+    dmemo::DistributionPtr traceDist(new dmemo::NoDistribution(3));
+    dmemo::DistributionPtr sampleDist(new dmemo::NoDistribution(20));
+    lama::DenseMatrix<ValueType> taper(traceDist, sampleDist);
+    EXPECT_EQ(TimeWindow<ValueType>::calcLastNonZeroSample(taper), -1);
+
+    // mutes after sample 8 and after sample 12 of the second trace
+    for (IndexType iTrace = 0; iTrace < 3; iTrace++) {
+        for (IndexType iSample = 0; iSample <= (iTrace == 1 ? 12 : 8); iSample++) {
+            taper.setValue(iTrace, iSample, 1.0);
+        }
+    }
+    EXPECT_EQ(TimeWindow<ValueType>::calcLastNonZeroSample(taper), 12);
+    EXPECT_EQ(TimeWindow<ValueType>::calcForwardEnd(12, 20), 14);
+    EXPECT_EQ(TimeWindow<ValueType>::calcForwardEnd(19, 20), 20);
+    EXPECT_EQ(TimeWindow<ValueType>::calcAdjointStart(12, 20), 13);
+    EXPECT_EQ(TimeWindow<ValueType>::calcAdjointStart(-1, 20), 0);
+}
+
+TEST(TimeWindowTest, TestGradientUnchangedForMutedData)
+{
+    // gradient of an acoustic shot whose seismogram taper mutes the data after lastTaperSample: the time window truncates
+    // the forward and the adjoint modelling, the reference models all time steps
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testTimeWindow_config.txt");
+    IndexType tStepEnd = static_cast<IndexType>((testConfig.get<ValueType>("T") / testConfig.get<ValueType>("DT")) + 0.5);
+    IndexType lastTaperSample = 100;
+
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), 1, testConfig.get<ValueType>("DH"));
+    dmemo::DistributionPtr dist(new dmemo::BlockDistribution(modelCoordinates.getNGridpoints(), commAll));
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model(Modelparameter::Factory<ValueType>::Create("acoustic"));
+    model->prepareForInversion(testConfig, commAll);
+    model->init(testConfig, ctx, dist, modelCoordinates);
+
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    IndexType numTraces = receivers.getSeismogramHandler().getNumTracesGlobal(Acquisition::SeismogramType::P);
+    lama::DenseMatrix<ValueType> taperData(std::make_shared<dmemo::NoDistribution>(numTraces), std::make_shared<dmemo::NoDistribution>(tStepEnd));
+    for (IndexType iTrace = 0; iTrace < numTraces; iTrace++) {
+        for (IndexType iSample = 0; iSample <= lastTaperSample; iSample++) {
+            taperData.setValue(iTrace, iSample, 1.0);
+        }
+    }
+    taperData.writeToFile("testTimeWindow_taper.mtx");
+    Taper::Taper2D<ValueType> seismogramTaper2D;
+    seismogramTaper2D.init(receivers.getSeismogramHandler());
+    seismogramTaper2D.read("testTimeWindow_taper.mtx");
+
+    WavefieldCompensation<ValueType> wavefieldCompensation;
+    wavefieldCompensation.init(testConfig);
+    auto storeWavefields = [](Wavefields::Wavefields<ValueType> &wavefieldsInversion, Wavefields::Wavefields<ValueType> &wavefields, IndexType) {
+        wavefieldsInversion = wavefields;
+    };
+
+    TimeWindow<ValueType> timeWindowReference;
+    typename Gradient::Gradient<ValueType>::GradientPtr gradientReference = calcGradientPerShot<ValueType>(testConfig, *model, modelCoordinates, dist, tStepEnd, &seismogramTaper2D, timeWindowReference, wavefieldCompensation, storeWavefields);
+
+    TimeWindow<ValueType> timeWindow;
+    timeWindow.init(testConfig);
+    ASSERT_TRUE(timeWindow.isActive());
+    IndexType tStepForwardEnd = timeWindow.calcForwardEnd(seismogramTaper2D, tStepEnd, true);
+    EXPECT_EQ(tStepForwardEnd, TimeWindow<ValueType>::calcForwardEnd(lastTaperSample, tStepEnd));
+    EXPECT_LT(tStepForwardEnd, tStepEnd);
+    typename Gradient::Gradient<ValueType>::GradientPtr gradient = calcGradientPerShot<ValueType>(testConfig, *model, modelCoordinates, dist, tStepForwardEnd, &seismogramTaper2D, timeWindow, wavefieldCompensation, storeWavefields);
+    EXPECT_GT(timeWindow.getNumSkippedAdjointShot(), 0);
+
+    ValueType maxReference = gradientReference->getVelocityP().maxNorm();
+    lama::DenseVector<ValueType> difference = gradient->getVelocityP() - gradientReference->getVelocityP();
+    EXPECT_GT(maxReference, 0.0);
+    EXPECT_LT(difference.maxNorm(), 1e-12 * maxReference);
+}
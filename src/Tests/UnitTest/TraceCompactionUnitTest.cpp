@@ -0,0 +1,104 @@
+#include "../../Common/TraceCompaction.hpp"
+#include "../../Misfit/MisfitFactory.hpp"
+#include <Acquisition/Receivers.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+/* Set the traces outside of the offset window (rows 0-5 and 15-20) and one dead trace (row 10) to zero */
+void muteTraces(lama::DenseMatrix<ValueType> &data)
+{
+    lama::DenseVector<ValueType> mute;
+    mute.setSameValue(data.getRowDistributionPtr(), 1);
+    for (IndexType iRow = 0; iRow < data.getNumRows(); iRow++) {
+        if (iRow <= 5 || iRow >= 15 || iRow == 10)
+            mute.setValue(iRow, 0);
+    }
+    data.scaleRows(mute);
+}
+
+TEST(TraceCompactionTest, TestCompactExpandRows)
+{
+    lama::DenseMatrix<ValueType> data;
+    data.readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    muteTraces(data);
+
+    std::vector<IndexType> activeRows = TraceCompaction<ValueType>::calcActiveRows(data);
+    ASSERT_EQ(activeRows.size(), 8u);
+    EXPECT_EQ(activeRows.front(), 6);
+    EXPECT_EQ(activeRows.back(), 14);
+
+    lama::DenseMatrix<ValueType> dataCompact;
+    TraceCompaction<ValueType>::compactRows(data, activeRows, std::make_shared<dmemo::NoDistribution>(activeRows.size()), dataCompact);
+    EXPECT_EQ(dataCompact.getNumRows(), 8);
+    EXPECT_EQ(dataCompact.getNumColumns(), data.getNumColumns());
+
+    lama::DenseMatrix<ValueType> dataExpanded;
+    TraceCompaction<ValueType>::expandRows(dataCompact, activeRows, data.getRowDistributionPtr(), dataExpanded);
+    lama::DenseMatrix<ValueType> difference;
+    difference = data - dataExpanded;
+    EXPECT_EQ(difference.maxNorm(), 0.0);
+    EXPECT_GT(data.maxNorm(), 0.0);
+}
+
+TEST(TraceCompactionTest, TestMisfitMatchesUncompacted)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(10000));
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    IndexType seedtime = 0;
+
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testTraceCompaction_config.txt");
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+
+    Acquisition::Receivers<ValueType> receivers;
+    receivers.init(testConfig, modelCoordinates, ctx, dist);
+    receivers.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    Acquisition::Receivers<ValueType> receiversTrue;
+    receiversTrue.init(testConfig, modelCoordinates, ctx, dist);
+    receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_true.shot_0.p.mtx");
+    muteTraces(receiversTrue.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData());
+
+    // the uncompacted path mutes the synthetic data as well
+    Acquisition::Receivers<ValueType> receiversMuted;
+    receiversMuted.init(testConfig, modelCoordinates, ctx, dist);
+    receiversMuted.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData().readFromFile("../src/Tests/Testfiles/testSourceTimeInversion_synth.shot_0.p.mtx");
+    muteTraces(receiversMuted.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData());
+
+    Acquisition::Receivers<ValueType> adjointSources;
+    adjointSources.init(testConfig, modelCoordinates, ctx, dist);
+    Acquisition::Receivers<ValueType> adjointSourcesCompact;
+    adjointSourcesCompact.init(testConfig, modelCoordinates, ctx, dist);
+
+    typename Misfit::Misfit<ValueType>::MisfitPtr misfit(Misfit::Factory<ValueType>::Create("l2"));
+    misfit->init(testConfig, std::vector<IndexType>(), 1, 0, 1500, seedtime);
+    ValueType misfitRef = misfit->calc(receiversMuted, receiversTrue, 0);
+    misfit->calcAdjointSources(adjointSources, receiversMuted, receiversTrue, 0);
+
+    TraceCompaction<ValueType> traceCompaction;
+    traceCompaction.init(testConfig);
+    ASSERT_TRUE(traceCompaction.isActive());
+    EXPECT_TRUE(traceCompaction.update(receiversTrue, 0, 0));
+    EXPECT_FALSE(traceCompaction.update(receiversTrue, 0, 0));
+    EXPECT_EQ(traceCompaction.getNumActiveTraces(0), 8);
+    EXPECT_EQ(traceCompaction.getNumTraces(0), 21);
+
+    typename Misfit::Misfit<ValueType>::MisfitPtr misfitCompact(Misfit::Factory<ValueType>::Create("l2"));
+    misfitCompact->init(testConfig, std::vector<IndexType>(), 1, 0, 1500, seedtime);
+    misfitCompact->setTraceCompaction(&traceCompaction);
+    ValueType misfitCompacted = misfitCompact->calc(receivers, receiversTrue, 0);
+    misfitCompact->calcAdjointSources(adjointSourcesCompact, receivers, receiversTrue, 0);
+
+    EXPECT_GT(misfitRef, 0.0);
+    EXPECT_NEAR(misfitCompacted, misfitRef, 1e-12 * misfitRef);
+
+    lama::DenseMatrix<ValueType> const &adjoint = adjointSources.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    lama::DenseMatrix<ValueType> const &adjointCompact = adjointSourcesCompact.getSeismogramHandler().getSeismogram(Acquisition::SeismogramType::P).getData();
+    ASSERT_EQ(adjointCompact.getNumRows(), adjoint.getNumRows());
+    lama::DenseMatrix<ValueType> difference;
+    difference = adjoint - adjointCompact;
+    EXPECT_LT(difference.maxNorm(), 1e-12 * adjoint.maxNorm());
+    EXPECT_GT(adjoint.maxNorm(), 0.0);
+}
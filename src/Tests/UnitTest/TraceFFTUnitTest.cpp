@@ -0,0 +1,96 @@
+#include "../../Common/TraceFFT.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+#include <scai/lama/fft.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+typedef TraceFFT<ValueType>::ComplexValueType ComplexValueType;
+
+TEST(TraceFFTTest, TestCompareComplexFFT)
+{
+    IndexType numTraces = 7;
+    IndexType nt = 100;
+    IndexType nFFT = 128;
+    lama::DenseMatrix<ValueType> traces(std::make_shared<dmemo::NoDistribution>(numTraces), std::make_shared<dmemo::NoDistribution>(nt));
+    lama::DenseVector<ValueType> trace;
+    for (IndexType iTrace = 0; iTrace < numTraces; iTrace++) {
+        trace = lama::linearDenseVector<ValueType>(nt, 0.1 * iTrace, 0.37 + 0.05 * iTrace);
+        trace.unaryOp(trace, common::UnaryOp::SIN);
+        traces.setRow(trace, iTrace, common::BinaryOp::COPY);
+    }
+
+    // complex path: zero-padded complex FFT of all nFFT frequencies
+    lama::DenseMatrix<ComplexValueType> spectraComplex;
+    spectraComplex = lama::cast<ComplexValueType>(traces);
+    spectraComplex.resize(traces.getRowDistributionPtr(), std::make_shared<dmemo::NoDistribution>(nFFT));
+    lama::fft<ComplexValueType>(spectraComplex, 1);
+
+    TraceFFT<ValueType> traceFFT;
+    traceFFT.init(nt, nFFT);
+    ASSERT_EQ(traceFFT.getNumFrequencies(), nFFT / 2 + 1);
+    lama::DenseMatrix<ComplexValueType> spectra;
+    traceFFT.forward(traces, spectra);
+    ASSERT_EQ(spectra.getNumColumns(), nFFT / 2 + 1);
+
+    lama::DenseVector<ComplexValueType> row;
+    lama::DenseVector<ComplexValueType> rowComplex;
+    for (IndexType iTrace = 0; iTrace < numTraces; iTrace++) {
+        spectra.getRow(row, iTrace);
+        spectraComplex.getRow(rowComplex, iTrace);
+        rowComplex.resize(row.getDistributionPtr());
+        row -= rowComplex;
+        EXPECT_LT(row.maxNorm(), 1e-10 * rowComplex.maxNorm());
+    }
+
+    // a single trace and the expansion to all frequencies
+    lama::DenseVector<ComplexValueType> spectrum;
+    lama::DenseVector<ComplexValueType> spectrumFull;
+    traces.getRow(trace, 3);
+    traceFFT.forward(trace, spectrum);
+    TraceFFT<ValueType>::expandSpectrum(spectrum, spectrumFull, nFFT);
+    spectraComplex.getRow(rowComplex, 3);
+    spectrumFull -= rowComplex;
+    EXPECT_LT(spectrumFull.maxNorm(), 1e-10 * rowComplex.maxNorm());
+
+    // filtering: the inverse equals the real part of the scaled complex inverse
+    lama::DenseVector<ComplexValueType> filter;
+    trace = lama::linearDenseVector<ValueType>(nt, 1.0, -0.01);
+    traceFFT.forward(trace, filter);
+    spectra.scaleColumns(filter);
+    lama::DenseMatrix<ValueType> tracesFiltered;
+    traceFFT.inverse(spectra, tracesFiltered);
+
+    TraceFFT<ValueType>::expandSpectrum(filter, spectrumFull, nFFT);
+    spectraComplex.scaleColumns(spectrumFull);
+    lama::ifft<ComplexValueType>(spectraComplex, 1);
+    spectraComplex *= 1.0 / ValueType(nFFT);
+    spectraComplex.resize(traces.getRowDistributionPtr(), traces.getColDistributionPtr());
+    lama::DenseMatrix<ValueType> tracesFilteredComplex;
+    tracesFilteredComplex = lama::real(spectraComplex);
+    ASSERT_EQ(tracesFiltered.getNumColumns(), nt);
+    lama::DenseMatrix<ValueType> difference;
+    difference = tracesFiltered - tracesFilteredComplex;
+    EXPECT_LT(difference.maxNorm(), 1e-10 * tracesFilteredComplex.maxNorm());
+
+    // the inverse of the forward transform restores the traces
+    traceFFT.forward(traces, spectra);
+    traceFFT.inverse(spectra, tracesFiltered);
+    difference = tracesFiltered - traces;
+    EXPECT_LT(difference.maxNorm(), 1e-12);
+}
+
+TEST(TraceFFTTest, TestPlanCache)
+{
+    IndexType numPlans = TraceFFT<float>::getNumPlans();
+    TraceFFT<float> traceFFT1;
+    TraceFFT<float> traceFFT2;
+    traceFFT1.init(1000, 1024);
+    traceFFT2.init(1000, 1024);
+    EXPECT_EQ(TraceFFT<float>::getNumPlans(), numPlans + 1);
+    traceFFT2.init(1000, 2048);
+    EXPECT_EQ(TraceFFT<float>::getNumPlans(), numPlans + 2);
+    EXPECT_EQ(traceFFT2.getNFFT(), 2048);
+    EXPECT_GT(traceFFT1.getMemory(), 0.0);
+}
@@ -0,0 +1,70 @@
+#include "../../Common/WavefieldActivity.hpp"
+#include <Modelparameter/ModelparameterFactory.hpp>
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+#include <vector>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(WavefieldActivityTest, TestRadiusAndDistance)
+{
+    // the radius is constant within an update interval of 3 time steps
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcRadius(1, 3, 2, 0), 6);
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcRadius(3, 3, 2, 0), 6);
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcRadius(4, 3, 2, 0), 12);
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcRadius(4, 1, 0.3, 5), 7);
+
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcBlockDistance(2, 2, 8), 0);
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcBlockDistance(3, 2, 8), 1);
+    EXPECT_EQ(WavefieldActivity<ValueType>::calcBlockDistance(0, 2, 8), 9);
+}
+
+TEST(WavefieldActivityTest, TestDomainOfDependence)
+{
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testWavefieldActivity_config.txt");
+    IndexType NX = testConfig.get<IndexType>("NX");
+    IndexType NY = testConfig.get<IndexType>("NY");
+    IndexType reach = testConfig.get<IndexType>("spatialFDorder");
+    Acquisition::Coordinates<ValueType> modelCoordinates(NX, NY, testConfig.get<IndexType>("NZ"), testConfig.get<ValueType>("DH"));
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(NX * NY));
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model(Modelparameter::Factory<ValueType>::Create("acoustic"));
+
+    WavefieldActivity<ValueType> wavefieldActivity;
+    wavefieldActivity.init(testConfig, modelCoordinates, dist);
+    ASSERT_TRUE(wavefieldActivity.isActive());
+    IndexType sourceIndex = 20 + NX * 30;
+    wavefieldActivity.initForward(lama::DenseVector<IndexType>(1, sourceIndex), *model, 1e-3);
+
+    // time stepping with a stencil which reaches spatialFDorder grid points per time step in each direction and a source which injects in every time step
+    std::vector<ValueType> wavefield(NX * NY, 0.0);
+    for (IndexType tStep = 0; tStep < 20; tStep++) {
+        std::vector<ValueType> wavefieldNew(wavefield);
+        for (IndexType y = 0; y < NY; y++) {
+            for (IndexType x = 0; x < NX; x++) {
+                for (IndexType offset = 1; offset <= reach; offset++) {
+                    wavefieldNew[x + NX * y] += 0.1 * ((x >= offset ? wavefield[x - offset + NX * y] : 0) + (x + offset < NX ? wavefield[x + offset + NX * y] : 0) + (y >= offset ? wavefield[x + NX * (y - offset)] : 0) + (y + offset < NY ? wavefield[x + NX * (y + offset)] : 0));
+                }
+            }
+        }
+        wavefieldNew[sourceIndex] += 1;
+        wavefield = wavefieldNew;
+
+        std::vector<bool> isActive(NX * NY, false);
+        auto const *activeRanges = wavefieldActivity.getForwardRanges(tStep);
+        if (activeRanges == nullptr) {
+            isActive.assign(NX * NY, true);
+        } else {
+            for (auto const &range : *activeRanges) {
+                for (IndexType i = range.first; i < range.second; i++)
+                    isActive[i] = true;
+            }
+        }
+        for (IndexType i = 0; i < NX * NY; i++) {
+            ASSERT_TRUE(isActive[i] || wavefield[i] == 0) << "time step " << tStep << ", grid point " << i;
+        }
+    }
+    EXPECT_GT(wavefieldActivity.getSkippedFraction(), 0.2);
+}
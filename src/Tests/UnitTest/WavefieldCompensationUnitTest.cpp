@@ -0,0 +1,88 @@
+#include "../../Common/WavefieldCompensation.hpp"
+#include "GradientCalculationTestShot.hpp"
+#include <gtest/gtest.h>
+#include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(WavefieldCompensationTest, TestAdvancedFactor)
+{
+    dmemo::DistributionPtr dist(new dmemo::NoDistribution(50));
+    // exp(a * DT) of a conductivity which varies over the grid points
+    lama::DenseVector<ValueType> logStepFactor = lama::linearDenseVector<ValueType>(dist, 1e-4, 2e-5);
+    lama::DenseVector<ValueType> stepFactor = logStepFactor;
+    stepFactor.unaryOp(stepFactor, common::UnaryOp::EXP);
+
+    WavefieldCompensation<ValueType> wavefieldCompensation;
+    wavefieldCompensation.initStepFactor(stepFactor);
+    EXPECT_TRUE(wavefieldCompensation.getIsExponential());
+
+    // more advances than the interval of the exact recalculation, with a skip of stored time steps
+    lama::DenseVector<ValueType> factorReference;
+    lama::DenseVector<ValueType> difference;
+    IndexType skipDT = 3;
+    for (IndexType tStep = 0; tStep < 3 * WavefieldCompensation<ValueType>::exactInterval * skipDT; tStep += skipDT) {
+        factorReference = ValueType(tStep) * logStepFactor;
+        factorReference.unaryOp(factorReference, common::UnaryOp::EXP);
+        difference = wavefieldCompensation.getFactor(tStep) - factorReference;
+        EXPECT_LT(difference.maxNorm(), 1e-12 * factorReference.maxNorm());
+    }
+
+    // a backward jump recalculates the factor
+    factorReference = ValueType(5) * logStepFactor;
+    factorReference.unaryOp(factorReference, common::UnaryOp::EXP);
+    difference = wavefieldCompensation.getFactor(5) - factorReference;
+    EXPECT_LT(difference.maxNorm(), 1e-14 * factorReference.maxNorm());
+
+    difference = wavefieldCompensation.getStepFactor() - stepFactor;
+    EXPECT_DOUBLE_EQ(difference.maxNorm(), 0.0);
+}
+
+TEST(WavefieldCompensationTest, TestCompensatedGradient)
+{
+    // gradient of a TMEM shot in a model whose conductivity varies over the grid points: the forward wavefields are stored with the advanced factor
+    // and, as reference, with the factor of the model in every stored time step
+    dmemo::CommunicatorPtr commAll = dmemo::Communicator::getCommunicatorPtr();
+    hmemo::ContextPtr ctx = hmemo::Context::getContextPtr();
+    Configuration::Configuration testConfig("../src/Tests/Testfiles/testWavefieldCompensation_config.txt");
+    ValueType DT = testConfig.get<ValueType>("DT");
+    IndexType tStepEnd = static_cast<IndexType>((testConfig.get<ValueType>("T") / DT) + 0.5);
+    ASSERT_GT(tStepEnd, WavefieldCompensation<ValueType>::exactInterval);
+
+    Acquisition::Coordinates<ValueType> modelCoordinates(testConfig.get<IndexType>("NX"), testConfig.get<IndexType>("NY"), 1, testConfig.get<ValueType>("DH"));
+    dmemo::DistributionPtr dist(new dmemo::BlockDistribution(modelCoordinates.getNGridpoints(), commAll));
+    typename Modelparameter::Modelparameter<ValueType>::ModelparameterPtr model(Modelparameter::Factory<ValueType>::Create("tmem"));
+    model->prepareForInversion(testConfig, commAll);
+    model->init(testConfig, ctx, dist, modelCoordinates);
+    lama::DenseVector<ValueType> electricConductivity = lama::linearDenseVector<ValueType>(dist, 0.002, 0.008 / modelCoordinates.getNGridpoints());
+    model->setElectricConductivity(electricConductivity);
+
+    WavefieldCompensation<ValueType> wavefieldCompensation;
+    wavefieldCompensation.init(testConfig);
+    ASSERT_TRUE(wavefieldCompensation.isActive());
+    TimeWindow<ValueType> timeWindow;
+    lama::CSRSparseMatrix<ValueType> identity;
+    identity.setIdentity(dist);
+
+    typename Gradient::Gradient<ValueType>::GradientPtr gradient = calcGradientPerShot<ValueType>(testConfig, *model, modelCoordinates, dist, tStepEnd, nullptr, timeWindow, wavefieldCompensation, [&](Wavefields::Wavefields<ValueType> &wavefieldsInversion, Wavefields::Wavefields<ValueType> &wavefields, IndexType tStep) {
+        wavefieldCompensation.storeWavefields(wavefieldsInversion, wavefields, tStep, identity, false);
+    });
+    EXPECT_TRUE(wavefieldCompensation.getIsExponential());
+    typename Gradient::Gradient<ValueType>::GradientPtr gradientReference = calcGradientPerShot<ValueType>(testConfig, *model, modelCoordinates, dist, tStepEnd, nullptr, timeWindow, wavefieldCompensation, [&](Wavefields::Wavefields<ValueType> &wavefieldsInversion, Wavefields::Wavefields<ValueType> &wavefields, IndexType tStep) {
+        wavefieldsInversion = wavefields;
+        wavefieldsInversion *= model->getCompensation(DT, tStep);
+    });
+
+    lama::DenseVector<ValueType> difference;
+    ValueType maxReference = gradientReference->getElectricConductivity().maxNorm();
+    difference = gradient->getElectricConductivity() - gradientReference->getElectricConductivity();
+    EXPECT_GT(maxReference, 0.0);
+    EXPECT_LT(difference.maxNorm(), 1e-10 * maxReference);
+    maxReference = gradientReference->getDielectricPermittivity().maxNorm();
+    difference = gradient->getDielectricPermittivity() - gradientReference->getDielectricPermittivity();
+    EXPECT_GT(maxReference, 0.0);
+    EXPECT_LT(difference.maxNorm(), 1e-10 * maxReference);
+}
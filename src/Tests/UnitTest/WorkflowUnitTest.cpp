@@ -0,0 +1,31 @@
+#include "../../Workflow/Workflow.hpp"
+#include <gtest/gtest.h>
+#include <scai/lama.hpp>
+
+using namespace scai;
+using namespace KITGPI;
+typedef double ValueType;
+
+TEST(WorkflowTest, TestCoarseningFactor)
+{
+    std::vector<IndexType> gridSizes = {120, 120, 1};
+    // shortest wavelength 3500 m/s / 3 Hz = 1167 m sampled with 4 points on a grid with DH = 50 m
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 8, gridSizes), 5);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 4, gridSizes), 4);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 6, 4, 4, gridSizes), 2);
+    // the modelling grid is kept if the wavelength is not sampled on a coarser grid, the data is not low-pass filtered or the velocity is zero
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 20, 4, 4, gridSizes), 1);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 0, 4, 4, gridSizes), 1);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 0, 3, 4, 4, gridSizes), 1);
+}
+
+TEST(WorkflowTest, TestCoarseningFactorDividesGrid)
+{
+    // the factor 5 of the wavelength does not divide NX = 100 and NY = 102, the largest common divisor below is 2
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 8, {100, 102, 1}), 2);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 8, {100, 100, 1}), 5);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 4, {100, 100, 1}), 4);
+    // NX = 99 has no divisor up to 5 except 3, NZ = 98 of the 3D grid excludes it
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 8, {99, 99, 1}), 3);
+    EXPECT_EQ(Workflow::Workflow<ValueType>::calcCoarseningFactor(50, 3500, 3, 4, 8, {99, 99, 98}), 1);
+}
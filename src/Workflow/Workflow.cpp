@@ -37,7 +37,9 @@ void KITGPI::Workflow::Workflow<ValueType>::changeStage(KITGPI::Configuration::C
     steplengthInit = config.get<ValueType>("steplengthInit");  
     
     IndexType gradientDomain = config.getAndCatch("gradientDomain", 0);
-    IndexType dtinversion = config.getAndCatch("DTInversion", 1); 
+    // with DHInversionPerStage the time sampling of the stored wavefields follows the stage like their grid, unless DTInversion is given
+    IndexType dtinversion = config.getAndCatch("DTInversion", config.getAndCatch("DHInversionPerStage", 0) != 0 ? 2 : 1); 
+    DHInversion = config.getAndCatch("DHInversion", 1);
     if (dtinversion == 1 || upperCornerFreq == 0.0) {
         skipDT = 1;
     } else {
@@ -93,6 +95,76 @@ void KITGPI::Workflow::Workflow<ValueType>::changeStage(KITGPI::Configuration::C
     }
 }
 
+/*! \brief Choose the grid of the stored wavefields and the cross correlation of the current stage
+ *
+ * With DHInversionPerStage = 1 the wavefields are averaged onto the coarsest grid which still samples the shortest wavelength of the stage, velocityMin / upperCornerFreq, with DHInversionPointsPerWavelength grid points (see calcCoarseningFactor).
+ * The forward and adjoint modelling keep the grid and DT of the configuration. Has to be called after changeStage.
+ \param config Configuration
+ \param velocityMin Minimum velocity of the current model
+ \param gridSizes Number of grid points of the modelling grid in each direction (NX, NY, NZ)
+ */
+template <typename ValueType>
+void KITGPI::Workflow::Workflow<ValueType>::calcDHInversion(KITGPI::Configuration::Configuration config, ValueType velocityMin, std::vector<scai::IndexType> const &gridSizes)
+{
+    if (config.getAndCatch("DHInversionPerStage", 0) != 0) {
+        ValueType pointsPerWavelength = config.getAndCatch("DHInversionPointsPerWavelength", ValueType(4));
+        IndexType maxFactor = config.getAndCatch("DHInversionMax", IndexType(4));
+        SCAI_ASSERT_ERROR(pointsPerWavelength >= 2, "DHInversionPointsPerWavelength = " << pointsPerWavelength << " does not sample the wavelength");
+        DHInversion = calcCoarseningFactor(config.get<ValueType>("DH"), velocityMin, upperCornerFreq, pointsPerWavelength, maxFactor, gridSizes);
+    }
+}
+
+/*! \brief Return the largest factor of DH which samples the shortest wavelength with pointsPerWavelength grid points
+ *
+ * The factor divides the number of grid points in every direction, since the inversion grid consists of complete blocks of the modelling grid (see Taper2D::calcAverageMatrix and BlockAverage::init).
+ \param DH Grid spacing of the modelling
+ \param velocityMin Minimum velocity
+ \param upperCornerFreq Upper corner frequency of the stage, 0 if the data is not low-pass filtered
+ \param pointsPerWavelength Grid points per shortest wavelength on the coarse grid
+ \param maxFactor Largest factor
+ \param gridSizes Number of grid points of the modelling grid in each direction, directions with one grid point are ignored
+ \return 1 if the data is not low-pass filtered or the velocity is unknown
+ */
+template <typename ValueType>
+scai::IndexType KITGPI::Workflow::Workflow<ValueType>::calcCoarseningFactor(ValueType DH, ValueType velocityMin, ValueType upperCornerFreq, ValueType pointsPerWavelength, scai::IndexType maxFactor, std::vector<scai::IndexType> const &gridSizes)
+{
+    if (upperCornerFreq <= 0.0 || velocityMin <= 0.0)
+        return 1;
+    ValueType DHMax = velocityMin / (upperCornerFreq * pointsPerWavelength);
+    IndexType factor = std::min(static_cast<IndexType>(std::floor(DHMax / DH)), maxFactor);
+    for (; factor > 1; factor--) {
+        bool isDivisor = true;
+        for (auto gridSize : gridSizes) {
+            if (gridSize > 1 && gridSize % factor != 0)
+                isDivisor = false;
+        }
+        if (isDivisor)
+            break;
+    }
+    return std::max(IndexType(1), factor);
+}
+
+/*! \brief Return true if the inversion grid of DHInversion is applied to the accumulated cross correlation instead of the wavefields of every time step
+ *
+ * The average of the product of the wavefields is not the product of the averages, so both strategies result in different gradients (see WAVE_Inversion_guide).
+ * The accumulated cross correlation is only available for time domain gradients.
+ \param DHInversionRestriction 0 = restriction of the wavefields of every time step, 1 = restriction after the accumulation, 2 = restriction after the accumulation if the wavefields on the modelling grid fit into the memory limit
+ \param DHInversion Factor of DH of the inversion grid
+ \param gradientDomain Domain of the cross correlation
+ \param memoryPrediction Predicted memory peak in MB per process if the wavefields are stored on the modelling grid
+ \param memoryLimit Memory limit in MB per process, 0 = no limit
+ */
+template <typename ValueType>
+bool KITGPI::Workflow::Workflow<ValueType>::calcRestrictAfterAccumulation(scai::IndexType DHInversionRestriction, scai::IndexType DHInversion, scai::IndexType gradientDomain, double memoryPrediction, double memoryLimit)
+{
+    SCAI_ASSERT_ERROR(DHInversionRestriction >= 0 && DHInversionRestriction <= 2, "DHInversionRestriction = " << DHInversionRestriction);
+    if (DHInversion <= 1 || gradientDomain != 0 || DHInversionRestriction == 0)
+        return false;
+    if (DHInversionRestriction == 1)
+        return true;
+    return memoryLimit <= 0 || memoryPrediction <= memoryLimit;
+}
+
 /*! \brief Read parameters from workflow file
  *
  * 
@@ -173,6 +245,8 @@ void KITGPI::Workflow::Workflow<ValueType>::printParameters(scai::dmemo::Communi
     HOST_PRINT(comm, "minOffset = " << minOffset << "\n");
     HOST_PRINT(comm, "maxOffset = " << maxOffset << "\n");
     HOST_PRINT(comm, "timeDampingFactor = " << timeDampingFactor << "\n");
+    if (DHInversion > 1)
+        HOST_PRINT(comm, "DHInversion = " << DHInversion << (restrictAfterAccumulation ? " (restriction after accumulation)" : "") << "\n");
     if (weightingFreq.size() != 0) {
         HOST_PRINT(comm, "frequencyVector =");
         for (int i=0; i<frequencyVector.size(); i++) {
@@ -2,6 +2,7 @@
 
 #include <scai/lama.hpp>
 #include <iostream>
+#include <vector>
 
 #include <Common/HostPrint.hpp>
 #include <Configuration/Configuration.hpp>
@@ -33,6 +34,10 @@ namespace KITGPI
             void readFromFile(std::string workflowFilename);
             void printParameters(scai::dmemo::CommunicatorPtr comm) const;
             void printInvertForParameters(scai::dmemo::CommunicatorPtr comm) const;
+            void calcDHInversion(KITGPI::Configuration::Configuration config, ValueType velocityMin, std::vector<scai::IndexType> const &gridSizes);
+            
+            static scai::IndexType calcCoarseningFactor(ValueType DH, ValueType velocityMin, ValueType upperCornerFreq, ValueType pointsPerWavelength, scai::IndexType maxFactor, std::vector<scai::IndexType> const &gridSizes);
+            static bool calcRestrictAfterAccumulation(scai::IndexType DHInversionRestriction, scai::IndexType DHInversion, scai::IndexType gradientDomain, double memoryPrediction, double memoryLimit);
             
             bool getInvertForVp() const;
             bool getInvertForVs() const;
@@ -64,6 +69,8 @@ namespace KITGPI
             scai::IndexType iteration;
             scai::IndexType skipCount;
             scai::IndexType skipDT;
+            scai::IndexType DHInversion = 1; // factor of DH of the grid of the stored wavefields and the cross correlation
+            bool restrictAfterAccumulation = false; // the wavefields are stored and correlated on the modelling grid and the accumulated cross correlation is averaged to the grid of DHInversion
             bool isSeismic;
 
         private:
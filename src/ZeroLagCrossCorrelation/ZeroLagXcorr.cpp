@@ -1,5 +1,7 @@
 #include "ZeroLagXcorr.hpp"
 
+#include <memory>
+
 using namespace scai;
 
 /*! \brief Reset a single wavefield to zero.
@@ -72,5 +74,85 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr<ValueType>::writeWavefield(scai::lama::D
     vector.writeToFile(fileName);
 }
 
+/*! \brief Restrict the time domain cross correlation (update) to local index ranges
+ *
+ * Outside of the ranges the forward or the adjoint wavefield has to be zero, e.g. before the wavefield arrives (see WavefieldActivity).
+ \param ranges Local index ranges, nullptr for all grid points
+ */
+template <typename ValueType>
+void KITGPI::ZeroLagXcorr::ZeroLagXcorr<ValueType>::setActiveRanges(IndexRanges const *ranges)
+{
+    activeRanges = ranges;
+}
+
+/*! \brief Average and recover the correlated wavefields of the gradients on the inversion grid after the accumulation (restriction after accumulation)
+ *
+ * Correlated wavefields which are not allocated on the modelling grid of the block average are not used by the gradient and are skipped.
+ \param blockAverage Block average of the inversion grid
+ */
+template <typename ValueType>
+void KITGPI::ZeroLagXcorr::ZeroLagXcorr<ValueType>::applyBlockAverage(KITGPI::Taper::BlockAverage<ValueType> const &blockAverage)
+{
+    for (scai::lama::DenseVector<ValueType> *xcorr : {&xcorrRho, &xcorrLambda, &xcorrMuA, &xcorrMuB, &xcorrMuC, &xcorrSigma, &xcorrEpsilon, &xcorrREpsilonSigma}) {
+        if (xcorr->size() > 0 && xcorr->getDistribution() == *blockAverage.getDistributionPtr())
+            blockAverage.apply(*xcorr);
+    }
+}
+
+/*! \brief Add the product of the sums of forward and adjoint components to a correlated wavefield: xcorr += (f_1 + f_2 + ...) * (a_1 + a_2 + ...)
+ *
+ * Without active ranges the product is calculated with vector operations, otherwise in a single pass over the active ranges only.
+ \param xcorr Correlated wavefield
+ \param forwardComponents Components of the forward wavefield (derivative)
+ \param adjointComponents Components of the adjoint wavefield
+ */
+template <typename ValueType>
+void KITGPI::ZeroLagXcorr::ZeroLagXcorr<ValueType>::addProduct(scai::lama::DenseVector<ValueType> &xcorr, std::initializer_list<scai::lama::DenseVector<ValueType> const *> forwardComponents, std::initializer_list<scai::lama::DenseVector<ValueType> const *> adjointComponents)
+{
+    if (activeRanges == nullptr) {
+        lama::DenseVector<ValueType> &temp1 = productTemp1;
+        lama::DenseVector<ValueType> &temp2 = productTemp2;
+        temp1 = **forwardComponents.begin();
+        for (auto component = forwardComponents.begin() + 1; component != forwardComponents.end(); component++)
+            temp1 += **component;
+        if (adjointComponents.size() == 1) {
+            temp1 *= **adjointComponents.begin();
+        } else {
+            temp2 = **adjointComponents.begin();
+            for (auto component = adjointComponents.begin() + 1; component != adjointComponents.end(); component++)
+                temp2 += **component;
+            temp1 *= temp2;
+        }
+        xcorr += temp1;
+        return;
+    }
+
+    hmemo::ContextPtr hostCtx = hmemo::Context::getHostPtr();
+    std::vector<std::unique_ptr<hmemo::ReadAccess<ValueType>>> readComponents;
+    std::vector<const ValueType *> forwardValues;
+    std::vector<const ValueType *> adjointValues;
+    for (auto component : forwardComponents) {
+        readComponents.emplace_back(new hmemo::ReadAccess<ValueType>(component->getLocalValues(), hostCtx));
+        forwardValues.push_back(readComponents.back()->get());
+    }
+    for (auto component : adjointComponents) {
+        readComponents.emplace_back(new hmemo::ReadAccess<ValueType>(component->getLocalValues(), hostCtx));
+        adjointValues.push_back(readComponents.back()->get());
+    }
+    hmemo::WriteAccess<ValueType> writeXcorr(xcorr.getLocalValues(), hostCtx);
+    ValueType *xcorrValues = writeXcorr.get();
+    for (auto const &range : *activeRanges) {
+        for (IndexType i = range.first; i < range.second; i++) {
+            ValueType forwardSum = forwardValues[0][i];
+            for (unsigned iComponent = 1; iComponent < forwardValues.size(); iComponent++)
+                forwardSum += forwardValues[iComponent][i];
+            ValueType adjointSum = adjointValues[0][i];
+            for (unsigned iComponent = 1; iComponent < adjointValues.size(); iComponent++)
+                adjointSum += adjointValues[iComponent][i];
+            xcorrValues[i] += forwardSum * adjointSum;
+        }
+    }
+}
+
 template class KITGPI::ZeroLagXcorr::ZeroLagXcorr<float>;
 template class KITGPI::ZeroLagXcorr::ZeroLagXcorr<double>;
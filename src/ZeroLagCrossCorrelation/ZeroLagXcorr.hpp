@@ -9,6 +9,11 @@
 #include <scai/dmemo/BlockDistribution.hpp>
 #include <scai/hmemo/HArray.hpp>
 
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "../Taper/BlockAverage.hpp"
 #include "../Workflow/Workflow.hpp"
 
 namespace KITGPI
@@ -35,6 +40,8 @@ namespace KITGPI
 
             //! \brief Declare ZeroLagXcorr pointer
             typedef std::shared_ptr<ZeroLagXcorr<ValueType>> ZeroLagXcorrPtr;
+            //! \brief Local index ranges [first, second) the time domain cross correlation is restricted to
+            typedef std::vector<std::pair<scai::IndexType, scai::IndexType>> IndexRanges;
 
             /* Common */
             //! Reset cross correlated wavefields
@@ -56,6 +63,8 @@ namespace KITGPI
 
             virtual void write(std::string filename, scai::IndexType t, KITGPI::Workflow::Workflow<ValueType> const &workflow) = 0;
             void prepareForInversion(scai::IndexType setGradientKernel, KITGPI::Configuration::Configuration config);
+            void setActiveRanges(IndexRanges const *ranges);
+            void applyBlockAverage(KITGPI::Taper::BlockAverage<ValueType> const &blockAverage);
 
             /* Seismic */
             virtual scai::lama::DenseVector<ValueType> const &getXcorrRho() const = 0;
@@ -74,6 +83,7 @@ namespace KITGPI
             void resetWavefield(scai::lama::DenseVector<ValueType> &vector);
             void initWavefield(scai::lama::DenseVector<ValueType> &vector, scai::hmemo::ContextPtr ctx, scai::dmemo::DistributionPtr dist);
             void writeWavefield(scai::lama::DenseVector<ValueType> &vector, std::string vectorName, std::string type, scai::IndexType t);
+            void addProduct(scai::lama::DenseVector<ValueType> &xcorr, std::initializer_list<scai::lama::DenseVector<ValueType> const *> forwardComponents, std::initializer_list<scai::lama::DenseVector<ValueType> const *> adjointComponents);
 
             typedef scai::common::Complex<scai::RealType<ValueType>> ComplexValueType;
             int numDimension;
@@ -87,6 +97,9 @@ namespace KITGPI
             scai::IndexType useSourceEncode = 0;
             scai::IndexType numRelaxationMechanisms = 0; //!< Number of relaxation mechanisms
             std::vector<ValueType> relaxationFrequency; 
+            IndexRanges const *activeRanges = nullptr; //!< local ranges of the time domain cross correlation, nullptr for all grid points
+            scai::lama::DenseVector<ValueType> productTemp1; //!< temporary vectors of addProduct, kept to avoid an allocation per time step
+            scai::lama::DenseVector<ValueType> productTemp2;
             
             /* Seismic */
             scai::lama::DenseVector<ValueType> xcorrMuA; //!< correlated Wavefields for the Mu gradient
@@ -122,9 +122,7 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dacoustic<ValueType>::update(Wavefields:
     if (workflow.getInvertForVp() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
         if (gradientKernel == 0 || decomposition == 0) {   
             // Born kernel or FWI kernel
-            temp = adjointWavefield.getRefP();
-            temp *= forwardWavefieldDerivative.getRefP();
-            xcorrLambda += temp;
+            addProduct(xcorrLambda, {&forwardWavefieldDerivative.getRefP()}, {&adjointWavefield.getRefP()});
         } else if (gradientKernel == 1 && decomposition == 1) {    
             // migration kernel using up/down-going wavefields   
             temp = adjointWavefield.getRefPdown();
@@ -148,12 +146,8 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dacoustic<ValueType>::update(Wavefields:
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
         if (gradientKernel == 0 || decomposition == 0) { 
             // Born kernel or FWI kernel
-            temp = forwardWavefieldDerivative.getRefVX();
-            temp *= adjointWavefield.getRefVX();
-            xcorrRho += temp;
-            temp = forwardWavefieldDerivative.getRefVY();
-            temp *= adjointWavefield.getRefVY();
-            xcorrRho += temp;
+            addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVX()}, {&adjointWavefield.getRefVX()});
+            addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVY()}, {&adjointWavefield.getRefVY()});
         } else if (gradientKernel == 1 && decomposition == 1) {    
             // migration kernel using up/down-going wavefields   
             temp = forwardWavefieldDerivative.getRefVXdown();
@@ -171,18 +165,10 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dacoustic<ValueType>::update(Wavefields:
             xcorrRho = xcorrRhoSdRu + xcorrRhoSuRd;
         } else if (gradientKernel == 2 && decomposition == 1) {    
             // tomographic kernel using up/down-going wavefields
-            temp = forwardWavefieldDerivative.getRefVXdown();
-            temp *= adjointWavefield.getRefVXup();
-            xcorrRhoSdRd += temp;
-            temp = forwardWavefieldDerivative.getRefVYdown();
-            temp *= adjointWavefield.getRefVYup();
-            xcorrRhoSdRd += temp;
-            temp = forwardWavefieldDerivative.getRefVXup();
-            temp *= adjointWavefield.getRefVXdown();
-            xcorrRhoSuRu += temp;
-            temp = forwardWavefieldDerivative.getRefVYup();
-            temp *= adjointWavefield.getRefVYdown();
-            xcorrRhoSuRu += temp;
+            addProduct(xcorrRhoSdRd, {&forwardWavefieldDerivative.getRefVXdown()}, {&adjointWavefield.getRefVXup()});
+            addProduct(xcorrRhoSdRd, {&forwardWavefieldDerivative.getRefVYdown()}, {&adjointWavefield.getRefVYup()});
+            addProduct(xcorrRhoSuRu, {&forwardWavefieldDerivative.getRefVXup()}, {&adjointWavefield.getRefVXdown()});
+            addProduct(xcorrRhoSuRu, {&forwardWavefieldDerivative.getRefVYup()}, {&adjointWavefield.getRefVYdown()});
             xcorrRho = xcorrRhoSdRd + xcorrRhoSuRu;
         }
     }
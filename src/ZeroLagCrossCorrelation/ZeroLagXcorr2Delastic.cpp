@@ -203,42 +203,23 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Delastic<ValueType>::resetXcorr(KITGPI::
 template <typename ValueType>
 void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Delastic<ValueType>::update(Wavefields::Wavefields<ValueType> &forwardWavefieldDerivative, Wavefields::Wavefields<ValueType> &forwardWavefield, Wavefields::Wavefields<ValueType> &adjointWavefield, KITGPI::Workflow::Workflow<ValueType> const &workflow)
 {
-    scai::lama::DenseVector<ValueType> temp;
-    scai::lama::DenseVector<ValueType> temp1;
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefVX();
-        temp *= adjointWavefield.getRefVX();
-        xcorrRho += temp;
-        temp = forwardWavefieldDerivative.getRefVY();
-        temp *= adjointWavefield.getRefVY();
-        xcorrRho += temp;
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVX()}, {&adjointWavefield.getRefVX()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVY()}, {&adjointWavefield.getRefVY()});
     }
     
     if (workflow.getInvertForVp() || workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefSxx() + forwardWavefieldDerivative.getRefSyy();
-        temp1 = adjointWavefield.getRefSxx() + adjointWavefield.getRefSyy();
-        temp *= temp1;
-        xcorrLambda += temp;
+        addProduct(xcorrLambda, {&forwardWavefieldDerivative.getRefSxx(), &forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSxx(), &adjointWavefield.getRefSyy()});
     }
 
     if (workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefSxx();
-        temp *= adjointWavefield.getRefSxx();
-        xcorrMuA += temp;
-        temp = forwardWavefieldDerivative.getRefSyy();
-        temp *= adjointWavefield.getRefSyy();
-        xcorrMuA += temp;
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSxx()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSyy()});
 
-        temp = forwardWavefieldDerivative.getRefSyy();
-        temp *= adjointWavefield.getRefSxx();
-        xcorrMuB += temp;
-        temp = forwardWavefieldDerivative.getRefSxx();
-        temp *= adjointWavefield.getRefSyy();
-        xcorrMuB += temp;
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSxx()}, {&adjointWavefield.getRefSyy()});
 
-        temp = forwardWavefieldDerivative.getRefSxy();
-        temp *= adjointWavefield.getRefSxy();
-        xcorrMuC += temp;
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSxy()}, {&adjointWavefield.getRefSxy()});
     }
 }
 
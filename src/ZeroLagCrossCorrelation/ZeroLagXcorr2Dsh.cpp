@@ -150,21 +150,13 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dsh<ValueType>::resetXcorr(KITGPI::Workf
 template <typename ValueType>
 void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dsh<ValueType>::update(Wavefields::Wavefields<ValueType> &forwardWavefieldDerivative, Wavefields::Wavefields<ValueType> &forwardWavefield, Wavefields::Wavefields<ValueType> &adjointWavefield, KITGPI::Workflow::Workflow<ValueType> const &workflow)
 {
-    //temporary wavefield allocated for every timestep (might be inefficient)
-    lama::DenseVector<ValueType> temp;
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefVZ();
-        temp *= adjointWavefield.getRefVZ();
-        xcorrRho += temp;
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVZ()}, {&adjointWavefield.getRefVZ()});
     }
     
     if (workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefSxz();
-        temp *= adjointWavefield.getRefSxz();
-        xcorrMuC += temp;
-        temp = forwardWavefieldDerivative.getRefSyz();
-        temp *= adjointWavefield.getRefSyz();
-        xcorrMuC += temp;
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSxz()}, {&adjointWavefield.getRefSxz()});
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSyz()}, {&adjointWavefield.getRefSyz()});
     }
 }
 
@@ -91,43 +91,23 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dviscoelastic<ValueType>::resetXcorr(KIT
 template <typename ValueType>
 void KITGPI::ZeroLagXcorr::ZeroLagXcorr2Dviscoelastic<ValueType>::update(Wavefields::Wavefields<ValueType> &forwardWavefieldDerivative, Wavefields::Wavefields<ValueType> &forwardWavefield, Wavefields::Wavefields<ValueType> &adjointWavefield, KITGPI::Workflow::Workflow<ValueType> const &workflow)
 {
-    //temporary wavefields allocated for every timestep (might be inefficient)
-    lama::DenseVector<ValueType> temp1;
-    lama::DenseVector<ValueType> temp2;
     if (workflow.getInvertForVp() || workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefSxx() + forwardWavefieldDerivative.getRefSyy();
-        temp2 = adjointWavefield.getRefSxx() + adjointWavefield.getRefSyy();
-        temp1 *= temp2;
-        xcorrLambda += temp1;
+        addProduct(xcorrLambda, {&forwardWavefieldDerivative.getRefSxx(), &forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSxx(), &adjointWavefield.getRefSyy()});
     }
 
     if (workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefSxx();
-        temp1 *= adjointWavefield.getRefSxx();
-        xcorrMuA += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSyy();
-        temp1 *= adjointWavefield.getRefSyy();
-        xcorrMuA += temp1;
-
-        temp1 = forwardWavefieldDerivative.getRefSyy();
-        temp1 *= adjointWavefield.getRefSxx();
-        xcorrMuB += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSxx();
-        temp1 *= adjointWavefield.getRefSyy();
-        xcorrMuB += temp1;
-
-        temp1 = forwardWavefieldDerivative.getRefSxy();
-        temp1 *= adjointWavefield.getRefSxy();
-        xcorrMuC += temp1;
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSxx()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSyy()});
+
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSxx()}, {&adjointWavefield.getRefSyy()});
+
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSxy()}, {&adjointWavefield.getRefSxy()});
     }
 
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefVX();
-        temp1 *= adjointWavefield.getRefVX();
-        xcorrRho += temp1;
-        temp1 = forwardWavefieldDerivative.getRefVY();
-        temp1 *= adjointWavefield.getRefVY();
-        xcorrRho += temp1;
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVX()}, {&adjointWavefield.getRefVX()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVY()}, {&adjointWavefield.getRefVY()});
     }
 }
 
@@ -76,23 +76,13 @@ void KITGPI::ZeroLagXcorr::ZeroLagXcorr3Dacoustic<ValueType>::resetXcorr(KITGPI:
 template <typename ValueType>
 void KITGPI::ZeroLagXcorr::ZeroLagXcorr3Dacoustic<ValueType>::update(Wavefields::Wavefields<ValueType> &forwardWavefieldDerivative, Wavefields::Wavefields<ValueType> &forwardWavefield, Wavefields::Wavefields<ValueType> &adjointWavefield, KITGPI::Workflow::Workflow<ValueType> const &workflow)
 {
-    //temporary wavefield allocated for every timestep (might be inefficient)
-    lama::DenseVector<ValueType> temp;
     if (workflow.getInvertForVp() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefP();
-        temp *= adjointWavefield.getRefP();
-        xcorrLambda += temp;
+        addProduct(xcorrLambda, {&forwardWavefieldDerivative.getRefP()}, {&adjointWavefield.getRefP()});
     }
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp = forwardWavefieldDerivative.getRefVX();
-        temp *= adjointWavefield.getRefVX();
-        xcorrRho += temp;
-        temp = forwardWavefieldDerivative.getRefVY();
-        temp *= adjointWavefield.getRefVY();
-        xcorrRho += temp;
-        temp = forwardWavefieldDerivative.getRefVZ();
-        temp *= adjointWavefield.getRefVZ();
-        xcorrRho += temp;
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVX()}, {&adjointWavefield.getRefVX()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVY()}, {&adjointWavefield.getRefVY()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVZ()}, {&adjointWavefield.getRefVZ()});
     }
 }
 
@@ -106,64 +106,28 @@ std::string KITGPI::ZeroLagXcorr::ZeroLagXcorr3Dviscoelastic<ValueType>::getEqua
 template <typename ValueType>
 void KITGPI::ZeroLagXcorr::ZeroLagXcorr3Dviscoelastic<ValueType>::update(Wavefields::Wavefields<ValueType> &forwardWavefieldDerivative, Wavefields::Wavefields<ValueType> &forwardWavefield, Wavefields::Wavefields<ValueType> &adjointWavefield, KITGPI::Workflow::Workflow<ValueType> const &workflow)
 {
-    //temporary wavefields allocated for every timestep (might be inefficient)
-    lama::DenseVector<ValueType> temp1;
-    lama::DenseVector<ValueType> temp2;
-
     if (workflow.getInvertForVp() || workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefSxx() + forwardWavefieldDerivative.getRefSyy();
-        temp1 += forwardWavefieldDerivative.getRefSzz();
-        temp2 = adjointWavefield.getRefSxx() + adjointWavefield.getRefSyy();
-        temp2 += adjointWavefield.getRefSzz();
-        temp1 *= temp2;
-        xcorrLambda += temp1;
+        addProduct(xcorrLambda, {&forwardWavefieldDerivative.getRefSxx(), &forwardWavefieldDerivative.getRefSyy(), &forwardWavefieldDerivative.getRefSzz()}, {&adjointWavefield.getRefSxx(), &adjointWavefield.getRefSyy(), &adjointWavefield.getRefSzz()});
     }
 
     if (workflow.getInvertForVs() || workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefSxx();
-        temp1 *= adjointWavefield.getRefSxx();
-        xcorrMuA += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSyy();
-        temp1 *= adjointWavefield.getRefSyy();
-        xcorrMuA += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSzz();
-        temp1 *= adjointWavefield.getRefSzz();
-        xcorrMuA += temp1;
-
-        temp1 = forwardWavefieldDerivative.getRefSyy();
-        temp1 += forwardWavefieldDerivative.getRefSzz();
-        temp1 *= adjointWavefield.getRefSxx();
-        xcorrMuB += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSxx();
-        temp1 += forwardWavefieldDerivative.getRefSzz();
-        temp1 *= adjointWavefield.getRefSyy();
-        xcorrMuB += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSxx();
-        temp1 += forwardWavefieldDerivative.getRefSyy();
-        temp1 *= adjointWavefield.getRefSzz();
-        xcorrMuB += temp1;
-
-        temp1 = forwardWavefieldDerivative.getRefSxy();
-        temp1 *= adjointWavefield.getRefSxy();
-        xcorrMuC += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSyz();
-        temp1 *= adjointWavefield.getRefSyz();
-        xcorrMuC += temp1;
-        temp1 = forwardWavefieldDerivative.getRefSxz();
-        temp1 *= adjointWavefield.getRefSxz();
-        xcorrMuC += temp1;
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSxx()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSyy()});
+        addProduct(xcorrMuA, {&forwardWavefieldDerivative.getRefSzz()}, {&adjointWavefield.getRefSzz()});
+
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSyy(), &forwardWavefieldDerivative.getRefSzz()}, {&adjointWavefield.getRefSxx()});
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSxx(), &forwardWavefieldDerivative.getRefSzz()}, {&adjointWavefield.getRefSyy()});
+        addProduct(xcorrMuB, {&forwardWavefieldDerivative.getRefSxx(), &forwardWavefieldDerivative.getRefSyy()}, {&adjointWavefield.getRefSzz()});
+
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSxy()}, {&adjointWavefield.getRefSxy()});
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSyz()}, {&adjointWavefield.getRefSyz()});
+        addProduct(xcorrMuC, {&forwardWavefieldDerivative.getRefSxz()}, {&adjointWavefield.getRefSxz()});
     }
 
     if (workflow.getInvertForDensity() || workflow.getInvertForPorosity() || workflow.getInvertForSaturation()) {
-        temp1 = forwardWavefieldDerivative.getRefVX();
-        temp1 *= adjointWavefield.getRefVX();
-        xcorrRho += temp1;
-        temp1 = forwardWavefieldDerivative.getRefVY();
-        temp1 *= adjointWavefield.getRefVY();
-        xcorrRho += temp1;
-        temp1 = forwardWavefieldDerivative.getRefVZ();
-        temp1 *= adjointWavefield.getRefVZ();
-        xcorrRho += temp1;
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVX()}, {&adjointWavefield.getRefVX()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVY()}, {&adjointWavefield.getRefVY()});
+        addProduct(xcorrRho, {&forwardWavefieldDerivative.getRefVZ()}, {&adjointWavefield.getRefVZ()});
     }
 }
 